@@ -107,7 +107,11 @@ Network Connectivity::calculateConnectivity() const
     }
 
     if(m_pConnectivitySettings->m_sConnectivityMethod == "COR") {
-        return ConnectivityMeasures::pearsonsCorrelationCoeff(matData, matNodePos);
+        return ConnectivityMeasures::pearsonsCorrelationCoeff(matData,
+                                                              matNodePos,
+                                                              m_pConnectivitySettings->m_dCorrThreshold,
+                                                              m_pConnectivitySettings->m_iCorrTopK,
+                                                              m_pConnectivitySettings->m_bSinglePrecision);
     } else if(m_pConnectivitySettings->m_sConnectivityMethod == "XCOR") {
         return ConnectivityMeasures::crossCorrelation(matData, matNodePos);
     }
@@ -45,6 +45,9 @@
 #include "network/network.h"
 
 #include <iostream>
+#include <algorithm>
+#include <functional>
+#include <vector>
 
 
 //*************************************************************************************************************
@@ -53,6 +56,8 @@
 //=============================================================================================================
 
 #include <QDebug>
+#include <QList>
+#include <QtConcurrent>
 
 
 //*************************************************************************************************************
@@ -72,11 +77,82 @@ using namespace CONNECTIVITYLIB;
 using namespace Eigen;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define CORRELATION_ROW_BLOCK 64
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE GLOBAL METHODS
 //=============================================================================================================
 
+/**
+* Job for one block of rows of the upper triangle of the correlation matrix.
+*/
+template<typename T>
+struct CorrelationBlockJob {
+    int iStart;                                                     /**< The first row of the block. */
+    int iRows;                                                      /**< The number of rows of the block. */
+    const Matrix<T,Dynamic,Dynamic>* pMatStd;                       /**< The standardized data. */
+    Matrix<T,Dynamic,Dynamic>* pMatCorr;                            /**< The correlation matrix to fill. */
+};
+
+
+//*************************************************************************************************************
+
+template<typename T>
+void computeCorrelationBlock(CorrelationBlockJob<T>& job)
+{
+    int nCols = job.pMatStd->rows() - job.iStart;
+
+    job.pMatCorr->block(job.iStart, job.iStart, job.iRows, nCols).noalias() =
+            job.pMatStd->middleRows(job.iStart, job.iRows) * job.pMatStd->bottomRows(nCols).transpose();
+}
+
+
+//*************************************************************************************************************
+
+template<typename T>
+MatrixXd computeCorrelationMatrix(const MatrixXd& matData)
+{
+    //Standardize the rows: zero mean and unit norm, so that the product yields the correlation coefficients
+    Matrix<T,Dynamic,Dynamic> matStd = (matData.colwise() - matData.rowwise().mean()).template cast<T>();
+
+    for(int i = 0; i < matStd.rows(); ++i) {
+        T norm = matStd.row(i).norm();
+
+        if(norm > 0) {
+            matStd.row(i) /= norm;
+        } else {
+            matStd.row(i).setZero();
+        }
+    }
+
+    Matrix<T,Dynamic,Dynamic> matCorr = Matrix<T,Dynamic,Dynamic>::Zero(matStd.rows(), matStd.rows());
+
+    QList<CorrelationBlockJob<T> > lJobs;
+    for(int i = 0; i < matStd.rows(); i += CORRELATION_ROW_BLOCK) {
+        CorrelationBlockJob<T> job;
+        job.iStart = i;
+        job.iRows = std::min(CORRELATION_ROW_BLOCK, int(matStd.rows()) - i);
+        job.pMatStd = &matStd;
+        job.pMatCorr = &matCorr;
+        lJobs.append(job);
+    }
+
+    QFuture<void> future = QtConcurrent::map(lJobs, computeCorrelationBlock<T>);
+    future.waitForFinished();
+
+    //The diagonal blocks also produced parts of the lower triangle
+    matCorr.template triangularView<StrictlyLower>().setZero();
+
+    return matCorr.template cast<double>();
+}
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -90,7 +166,11 @@ ConnectivityMeasures::ConnectivityMeasures()
 
 //*************************************************************************************************************
 
-Network ConnectivityMeasures::pearsonsCorrelationCoeff(const MatrixXd& matData, const MatrixX3f& matVert)
+Network ConnectivityMeasures::pearsonsCorrelationCoeff(const MatrixXd& matData,
+                                                       const MatrixX3f& matVert,
+                                                       double dThreshold,
+                                                       int iTopK,
+                                                       bool bSinglePrecision)
 {
     Network finalNetwork("Pearson's Correlation Coefficient");
 
@@ -107,10 +187,47 @@ Network ConnectivityMeasures::pearsonsCorrelationCoeff(const MatrixXd& matData,
         finalNetwork << NetworkNode::SPtr(new NetworkNode(i, rowVert));
     }
 
+    const int nNodes = matData.rows();
+
+    MatrixXd matCorr = pearsonsCorrelationMatrix(matData, bSinglePrecision);
+
+    bool bSparse = dThreshold > 0.0 || iTopK > 0;
+
+    //Per node selection threshold: the k-th strongest absolute connection
+    VectorXd vecNodeThreshold = VectorXd::Zero(nNodes);
+
+    if(iTopK > 0 && iTopK < nNodes - 1) {
+        std::vector<double> vecAbs(nNodes - 1);
+
+        for(int i = 0; i < nNodes; ++i) {
+            int k = 0;
+            for(int j = 0; j < nNodes; ++j) {
+                if(j != i) {
+                    vecAbs[k++] = std::fabs(i < j ? matCorr(i,j) : matCorr(j,i));
+                }
+            }
+
+            std::nth_element(vecAbs.begin(), vecAbs.begin() + (iTopK - 1), vecAbs.end(), std::greater<double>());
+            vecNodeThreshold(i) = vecAbs[iTopK - 1];
+        }
+    }
+
     //Create edges
-    for(int i = 0; i < matData.rows(); ++i) {
-        for(int j = i; j < matData.rows(); ++j) {
-            double pearsonsCoeff = calcPearsonsCorrelationCoeff(matData.row(i), matData.row(j));
+    for(int i = 0; i < nNodes; ++i) {
+        for(int j = i; j < nNodes; ++j) {
+            double pearsonsCoeff = matCorr(i,j);
+
+            if(bSparse) {
+                double dAbs = std::fabs(pearsonsCoeff);
+
+                if(i == j || dAbs < dThreshold) {
+                    continue;
+                }
+
+                if(iTopK > 0 && dAbs < vecNodeThreshold(i) && dAbs < vecNodeThreshold(j)) {
+                    continue;
+                }
+            }
 
             QSharedPointer<NetworkEdge> pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(finalNetwork.getNodes()[i], finalNetwork.getNodes()[j], pearsonsCoeff));
 
@@ -123,6 +240,18 @@ Network ConnectivityMeasures::pearsonsCorrelationCoeff(const MatrixXd& matData,
 }
 
 
+//*************************************************************************************************************
+
+MatrixXd ConnectivityMeasures::pearsonsCorrelationMatrix(const MatrixXd& matData, bool bSinglePrecision)
+{
+    if(bSinglePrecision) {
+        return computeCorrelationMatrix<float>(matData);
+    }
+
+    return computeCorrelationMatrix<double>(matData);
+}
+
+
 //*************************************************************************************************************
 
 Network ConnectivityMeasures::crossCorrelation(const MatrixXd& matData, const MatrixX3f& matVert)
@@ -142,12 +271,31 @@ Network ConnectivityMeasures::crossCorrelation(const MatrixXd& matData, const Ma
         finalNetwork << NetworkNode::SPtr(new NetworkNode(i, rowVert));
     }
 
+    //Compute the FFT size as the "next power of 2" of the input vector's length
+    int iFftSize = pow(2, ceil(log2(2.0 * matData.cols() - 1)));
+
+    //Transform each row only once
+    MatrixXcd matSpectra = calcSpectra(matData, iFftSize);
+
+    //Correlate each row against all following rows in parallel
+    QList<CrossCorrelationRowJob> lJobs;
+    for(int i = 0; i < matData.rows(); ++i) {
+        CrossCorrelationRowJob job;
+        job.iRow = i;
+        job.iFftSize = iFftSize;
+        job.pMatSpectra = &matSpectra;
+        lJobs.append(job);
+    }
+
+    QFuture<void> future = QtConcurrent::map(lJobs, calcCrossCorrelationRow);
+    future.waitForFinished();
+
     //Create edges
     for(int i = 0; i < matData.rows(); ++i) {
-        for(int j = i; j < matData.rows(); ++j) {
-            QPair<int,double> crossCorrPair = calcCrossCorrelation(matData.row(i), matData.row(j));
+        const QVector<QPair<int,double> >& vecResults = lJobs.at(i).vecResults;
 
-            QSharedPointer<NetworkEdge> pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(finalNetwork.getNodes()[i], finalNetwork.getNodes()[j], crossCorrPair.second));
+        for(int j = i; j < matData.rows(); ++j) {
+            QSharedPointer<NetworkEdge> pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(finalNetwork.getNodes()[i], finalNetwork.getNodes()[j], vecResults.at(j - i).second));
 
             *finalNetwork.getNodeAt(i) << pEdge;
             finalNetwork << pEdge;
@@ -161,6 +309,57 @@ Network ConnectivityMeasures::crossCorrelation(const MatrixXd& matData, const Ma
 }
 
 
+//*************************************************************************************************************
+
+MatrixXcd ConnectivityMeasures::calcSpectra(const MatrixXd &matData, int iFftSize)
+{
+    Eigen::FFT<double> fft;
+    fft.SetFlag(Eigen::FFT<double>::HalfSpectrum);
+
+    MatrixXcd matSpectra(iFftSize/2 + 1, matData.rows());
+
+    //Zero Padd
+    VectorXd vecPadded = VectorXd::Zero(iFftSize);
+
+    for(int i = 0; i < matData.rows(); ++i) {
+        vecPadded.head(matData.cols()) = matData.row(i).transpose();
+        fft.fwd(matSpectra.col(i).data(), vecPadded.data(), iFftSize);
+    }
+
+    return matSpectra;
+}
+
+
+//*************************************************************************************************************
+
+void ConnectivityMeasures::calcCrossCorrelationRow(CrossCorrelationRowJob &job)
+{
+    //Each job owns its FFT, the plan cache of Eigen::FFT is not thread safe
+    Eigen::FFT<double> fft;
+    fft.SetFlag(Eigen::FFT<double>::HalfSpectrum);
+
+    const MatrixXcd& matSpectra = *job.pMatSpectra;
+    const int nCols = matSpectra.cols();
+
+    VectorXcd vecProduct(matSpectra.rows());
+    VectorXd vecResult(job.iFftSize);
+
+    job.vecResults.resize(nCols - job.iRow);
+
+    for(int j = job.iRow; j < nCols; ++j) {
+        //Main step of cross corr
+        vecProduct = matSpectra.col(job.iRow).cwiseProduct(matSpectra.col(j).conjugate());
+
+        fft.inv(vecResult.data(), vecProduct.data(), job.iFftSize);
+
+        int idx = 0;
+        double maxValue = vecResult.maxCoeff(&idx);
+
+        job.vecResults[j - job.iRow] = QPair<int,double>(idx, maxValue);
+    }
+}
+
+
 //*************************************************************************************************************
 
 double ConnectivityMeasures::calcPearsonsCorrelationCoeff(const Eigen::RowVectorXd &vecFirst, const Eigen::RowVectorXd &vecSecond)
@@ -202,7 +401,7 @@ QPair<int,double> ConnectivityMeasures::calcCrossCorrelation(const RowVectorXd&
     fft.fwd(freqvec2, xCorrInputVecSecond);
 
     //Create conjugate complex
-    freqvec2.conjugate();
+    freqvec2 = freqvec2.conjugate();
 
     //Main step of cross corr
     for (int i = 0; i < fftsize; i++) {
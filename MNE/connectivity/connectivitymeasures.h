@@ -53,6 +53,7 @@
 #include <QSharedPointer>
 #include <QPair>
 #include <QString>
+#include <QVector>
 
 
 //*************************************************************************************************************
@@ -107,13 +108,35 @@ public:
     //=========================================================================================================
     /**
     * Calculates the Pearson's correlation coefficient between the rows of the data matrix.
+    * The full correlation matrix is computed with one product of the standardized data with its transpose.
+    * If a threshold or a top-k count is given only the selected edges are created and self connections are omitted.
     *
-    * @param[in] matData    The input data for whicht the cross correlation is to be calculated.
-    * @param[in] matVert    The vertices of each network node.
+    * @param[in] matData            The input data for whicht the cross correlation is to be calculated.
+    * @param[in] matVert            The vertices of each network node.
+    * @param[in] dThreshold         Only keep edges with an absolute correlation >= dThreshold. Disabled if <= 0. Default is 0.
+    * @param[in] iTopK              Only keep the iTopK strongest (absolute) connections of each node. Disabled if <= 0. Default is 0.
+    * @param[in] bSinglePrecision   Whether to compute the correlation matrix in single precision. Default is false.
     *
-    * @return               The connectivity information in form of a network structure.
+    * @return                       The connectivity information in form of a network structure.
+    */
+    static Network pearsonsCorrelationCoeff(const Eigen::MatrixXd& matData,
+                                            const Eigen::MatrixX3f& matVert,
+                                            double dThreshold = 0.0,
+                                            int iTopK = 0,
+                                            bool bSinglePrecision = false);
+
+    //=========================================================================================================
+    /**
+    * Calculates the matrix of Pearson's correlation coefficients between the rows of the data matrix.
+    * Only the upper triangle (including the diagonal) is filled, the strictly lower triangle is zero.
+    *
+    * @param[in] matData            The input data.
+    * @param[in] bSinglePrecision   Whether to compute the product in single precision. Default is false.
+    *
+    * @return                       The upper triangle of the correlation matrix.
     */
-    static Network pearsonsCorrelationCoeff(const Eigen::MatrixXd& matData, const Eigen::MatrixX3f& matVert);
+    static Eigen::MatrixXd pearsonsCorrelationMatrix(const Eigen::MatrixXd& matData,
+                                                     bool bSinglePrecision = false);
 
     //=========================================================================================================
     /**
@@ -127,6 +150,37 @@ public:
     static Network crossCorrelation(const Eigen::MatrixXd& matData, const Eigen::MatrixX3f& matVert);
 
 protected:
+    //=========================================================================================================
+    /**
+    * Job for the cross correlation of one row against all rows with a higher or equal index.
+    */
+    struct CrossCorrelationRowJob {
+        int iRow;                                       /**< The row index this job correlates against all rows j >= iRow. */
+        int iFftSize;                                   /**< The (zero padded) FFT length. */
+        const Eigen::MatrixXcd* pMatSpectra;            /**< The half spectra of all rows, one column per row. */
+        QVector<QPair<int,double> > vecResults;         /**< The results for the pairs (iRow, iRow + k). */
+    };
+
+    //=========================================================================================================
+    /**
+    * Calculates the zero padded half spectra of all rows of the data matrix.
+    *
+    * @param[in] matData    The input data.
+    * @param[in] iFftSize   The FFT length. Must be at least 2 * matData.cols() - 1.
+    *
+    * @return               The half spectra (iFftSize/2 + 1 frequencies) with one column per data row.
+    */
+    static Eigen::MatrixXcd calcSpectra(const Eigen::MatrixXd &matData, int iFftSize);
+
+    //=========================================================================================================
+    /**
+    * Calculates the cross correlation of one row against all following rows from the cached spectra.
+    * Used as QtConcurrent map function.
+    *
+    * @param[in, out] job   The row job. The results are written to job.vecResults.
+    */
+    static void calcCrossCorrelationRow(CrossCorrelationRowJob &job);
+
     //=========================================================================================================
     /**
     * Calculates the actual Pearson's correlation coefficient between two data vectors.
@@ -102,6 +102,9 @@ void ConnectivitySettings::parseArguments(const QStringList& arguments)
     QCommandLineOption snrOption("snr", "The SNR <value> used for computation (for source level usage only).", "value", "3.0");
     QCommandLineOption evokedIndexOption("aveIdx", "The average <index> to choose from the average file.", "index", "0");
     QCommandLineOption coilTypeOption("coilType", "The coil <type> (for sensor level usage only), i.e. 'grad' or 'mag'.", "type", "grad");
+    QCommandLineOption corrThresholdOption("corrThreshold", "Only keep COR edges with an absolute <value> above the threshold, 0 keeps all.", "value", "0.0");
+    QCommandLineOption corrTopKOption("corrTopK", "Only keep the <k> strongest COR edges per node, 0 keeps all.", "k", "0");
+    QCommandLineOption singlePrecisionOption("singlePrecision", "Compute the COR matrix in single precision.", "singlePrecision", "false");
     QCommandLineOption chTypeOption("chType", "The channel <type> (for sensor level usage only), i.e. 'eeg' or 'meg'.", "type", "meg");
 
     parser.addOption(annotOption);
@@ -118,6 +121,9 @@ void ConnectivitySettings::parseArguments(const QStringList& arguments)
     parser.addOption(evokedIndexOption);
     parser.addOption(coilTypeOption);
     parser.addOption(chTypeOption);
+    parser.addOption(corrThresholdOption);
+    parser.addOption(corrTopKOption);
+    parser.addOption(singlePrecisionOption);
 
     parser.process(arguments);
 
@@ -145,7 +151,15 @@ void ConnectivitySettings::parseArguments(const QStringList& arguments)
         m_bDoClust = true;
     }
 
+    if(parser.value(singlePrecisionOption) == "true" || parser.value(singlePrecisionOption) == "1") {
+        m_bSinglePrecision = true;
+    } else {
+        m_bSinglePrecision = false;
+    }
+
     m_dSnr = parser.value(snrOption).toDouble();
+    m_dCorrThreshold = parser.value(corrThresholdOption).toDouble();
+    m_iCorrTopK = parser.value(corrTopKOption).toInt();
     m_iAveIdx = parser.value(evokedIndexOption).toInt();
 }
 
@@ -115,6 +115,9 @@ public:
     bool m_bDoClust;                        /**< Whether to cluster the source space for source localization. */
 
     double m_dSnr;                          /**< The SNR value. */
+    double m_dCorrThreshold;                /**< Only keep correlation edges with an absolute value above this threshold. Disabled if <= 0. */
+    int m_iCorrTopK;                        /**< Only keep the k strongest correlation edges per node. Disabled if <= 0. */
+    bool m_bSinglePrecision;                /**< Whether to compute the correlation matrix in single precision. */
     int m_iAveIdx;                          /**< The The average index to take from the input data. */
 
 protected:
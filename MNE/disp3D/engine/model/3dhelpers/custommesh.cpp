@@ -195,6 +195,18 @@ void CustomMesh::setColor(const Eigen::MatrixX3f& tMatColors)
 }
 
 
+//*************************************************************************************************************
+
+void CustomMesh::setColor(const QByteArray& arrayColors)
+{
+    //Update color
+    m_pColorDataBuffer->setData(arrayColors);
+
+    m_pColorAttribute->setBuffer(m_pColorDataBuffer);
+    m_pColorAttribute->setCount(arrayColors.size() / (3 * (int)sizeof(float)));
+}
+
+
 //*************************************************************************************************************
 
 void CustomMesh::setNormals(const Eigen::MatrixX3f& tMatNorm)
@@ -136,6 +136,14 @@ public:
     */
     void setColor(const Eigen::MatrixX3f &tMatColors);
 
+    //=========================================================================================================
+    /**
+    * Set the vertices colors of the mesh from an upload ready buffer. The buffer is shared, not copied.
+    *
+    * @param[in] arrayColors    Interleaved rgb float colors of the vertices.
+    */
+    void setColor(const QByteArray &arrayColors);
+
     //=========================================================================================================
     /**
     * Set the normals the mesh.
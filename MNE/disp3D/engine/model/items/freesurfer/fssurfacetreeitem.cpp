@@ -314,13 +314,11 @@ void FsSurfaceTreeItem::addData(const Surface& tSurface, Qt3DCore::QEntity* pare
 
 //*************************************************************************************************************
 
-void FsSurfaceTreeItem::setRtVertColor(const MatrixX3f& sourceColorSamples)
+void FsSurfaceTreeItem::setRtVertColor(const QByteArray& sourceColorSamples)
 {
-    //Set new data.
-    //In setData(data, Data3DTreeModelItemRoles::SurfaceCurrentColorVert) we pass the new color values to the renderer (see setData function).
-    QVariant data;
-    data.setValue(sourceColorSamples);
-    this->setData(data, Data3DTreeModelItemRoles::SurfaceCurrentColorVert);
+    //Pass the new colors directly to the renderer. SurfaceCurrentColorVert keeps the color origin, which the
+    //activation is plotted on.
+    m_pRenderable3DEntity->getCustomMesh()->setColor(sourceColorSamples);
 }
 
 
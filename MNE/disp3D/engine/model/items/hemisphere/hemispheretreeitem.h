@@ -162,9 +162,9 @@ public:
     /**
     * Call this function whenever new colors for the activation data plotting are available.
     *
-    * @param[in] sourceColorSamples     The color values for each estimated source.
+    * @param[in] sourceColorSamples     The interleaved rgb float colors of the vertices.
     */
-    void setRtVertColor(const MatrixX3f &sourceColorSamples);
+    void setRtVertColor(const QByteArray &sourceColorSamples);
 
     //=========================================================================================================
     /**
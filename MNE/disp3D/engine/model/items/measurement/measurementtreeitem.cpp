@@ -381,7 +381,7 @@ void MeasurementTreeItem::onCheckStateChanged(const Qt::CheckState& checkState)
 
 //*************************************************************************************************************
 
-void MeasurementTreeItem::onRtVertColorChanged(const QPair<MatrixX3f, MatrixX3f>& sourceColorSamples)
+void MeasurementTreeItem::onRtVertColorChanged(const QPair<QByteArray, QByteArray>& sourceColorSamples)
 {
     emit rtVertColorChanged(sourceColorSamples);
 }
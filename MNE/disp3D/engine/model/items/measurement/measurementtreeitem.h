@@ -227,9 +227,9 @@ private:
     /**
     * Call this function whenever new colors for the activation data plotting are available.
     *
-    * @param[in] sourceColorSamples     The color values for each estimated source for left and right hemisphere.
+    * @param[in] sourceColorSamples     The interleaved rgb float colors of the vertices for left and right hemisphere.
     */
-    void onRtVertColorChanged(const QPair<MatrixX3f, MatrixX3f>& sourceColorSamples);
+    void onRtVertColorChanged(const QPair<QByteArray, QByteArray>& sourceColorSamples);
 
     MneEstimateTreeItem*                m_pMneEstimateTreeItem;         /**< The rt source loc data item of this item. */
     NetworkTreeItem*                    m_pNetworkTreeItem;             /**< The rt connectivity data item of this item. */
@@ -242,7 +242,7 @@ signals:
     *
     * @param[in] sourceColorSamples        Real tiem colors for both hemispheres.
     */
-    void rtVertColorChanged(const QPair<MatrixX3f, MatrixX3f>& sourceColorSamples);
+    void rtVertColorChanged(const QPair<QByteArray, QByteArray>& sourceColorSamples);
 
 };
 
@@ -177,7 +177,7 @@ FsSurfaceTreeItem* MriTreeItem::addData(const Surface& tSurface, const Annotatio
 
 //*************************************************************************************************************
 
-void MriTreeItem::setRtVertColor(const QPair<MatrixX3f, MatrixX3f>& sourceColorSamples)
+void MriTreeItem::setRtVertColor(const QPair<QByteArray, QByteArray>& sourceColorSamples)
 {
     QList<QStandardItem*> itemList = this->findChildren(Data3DTreeModelItemTypes::HemisphereItem);
 
@@ -161,9 +161,9 @@ public:
     /**
     * Call this function whenever new colors for the activation data plotting are available.
     *
-    * @param[in] sourceColorSamples     The color values for each estimated source for left and right hemisphere.
+    * @param[in] sourceColorSamples     The interleaved rgb float colors of the vertices for left and right hemisphere.
     */
-    void setRtVertColor(const QPair<MatrixX3f, MatrixX3f> &sourceColorSamples);
+    void setRtVertColor(const QPair<QByteArray, QByteArray> &sourceColorSamples);
 
 private:
     //=========================================================================================================
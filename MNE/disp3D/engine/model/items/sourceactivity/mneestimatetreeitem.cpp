@@ -447,7 +447,7 @@ void MneEstimateTreeItem::onCheckStateWorkerChanged(const Qt::CheckState& checkS
 
 //*************************************************************************************************************
 
-void MneEstimateTreeItem::onNewRtData(const QPair<MatrixX3f, MatrixX3f>& sourceColorSamples)
+void MneEstimateTreeItem::onNewRtData(const QPair<QByteArray, QByteArray>& sourceColorSamples)
 {
     emit rtVertColorChanged(sourceColorSamples);
 }
@@ -240,9 +240,9 @@ private:
     /**
     * This function gets called whenever this item receives new color values for each estimated source.
     *
-    * @param[in] sourceColorSamples     The color values for each estimated source for left and right hemisphere.
+    * @param[in] sourceColorSamples     The interleaved rgb float colors of the vertices for left and right hemisphere.
     */
-    void onNewRtData(const QPair<MatrixX3f, MatrixX3f> &sourceColorSamples);
+    void onNewRtData(const QPair<QByteArray, QByteArray> &sourceColorSamples);
 
     //=========================================================================================================
     /**
@@ -301,9 +301,9 @@ signals:
     /**
     * Emit this signal whenever you want to provide newly generated colors from the stream rt data.
     *
-    * @param[in] sourceColorSamples     The color values for each estimated source for left and right hemisphere.
+    * @param[in] sourceColorSamples     The interleaved rgb float colors of the vertices for left and right hemisphere.
     */
-    void rtVertColorChanged(const QPair<MatrixX3f, MatrixX3f>& sourceColorSamples);
+    void rtVertColorChanged(const QPair<QByteArray, QByteArray>& sourceColorSamples);
 };
 
 //*************************************************************************************************************
@@ -47,6 +47,7 @@
 #include <fs/annotation.h>
 
 #include <iostream>
+#include <algorithm>
 
 
 //*************************************************************************************************************
@@ -60,6 +61,7 @@
 #include <QTime>
 #include <QDebug>
 #include <QtConcurrent>
+#include <QHash>
 
 
 //*************************************************************************************************************
@@ -70,6 +72,18 @@
 #include <Eigen/Core>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define SMOOTH_ROW_BLOCK                4096    /**< Vertices per smoothing operator job */
+#define SMOOTH_GRID_CELLS_PER_SOURCE    8       /**< Maximal number of source grid cells per source */
+#define SMOOTH_GRID_MIN_CELLS           4096    /**< Grid cells which are always allowed */
+#define SMOOTH_REACH_MARGIN             1e-4    /**< Relative enlargement of the threshold box searched around a vertex */
+#define COLOR_LUT_SIZE                  1024    /**< Number of entries of the color map lookup table */
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // USED NAMESPACES
@@ -87,202 +101,310 @@ using namespace UTILSLIB;
 // DEFINE GLOBAL METHODS
 //=============================================================================================================
 
-void generateWeightsPerVertex(SmoothVertexInfo& input)
+void generateSourceGrid(const SmoothOperatorInfo& input, SmoothSourceGrid& grid)
 {
-    QVector3D from = input.vVertPos;
-    QVector3D to;
+    int nSources = input.vecVertNo.rows();
 
-    double dist, valueWeight;
-    double dWeightsSum = 0;
+    grid.matSourcePos.resize(nSources, 3);
+    for(int j = 0; j < nSources; ++j) {
+        grid.matSourcePos.row(j) = input.matVertPos.row(input.vecVertNo(j));
+    }
 
-    for(int j = 0; j < input.lSourcePos.size(); ++j) {
-        to = input.lSourcePos.at(j);
+    if(nSources == 0) {
+        grid.vecOrigin = Vector3f::Zero();
+        grid.fCellSize = 1.0f;
+        grid.iDims[0] = grid.iDims[1] = grid.iDims[2] = 0;
+        grid.vecCellStart = VectorXi::Zero(1);
+        grid.vecCellSources = VectorXi();
+        return;
+    }
 
-        if(to == from) {
-            dist = exp(-25);
-        } else {
-            dist = from.distanceToPoint(to);
-        }
+    grid.vecOrigin = grid.matSourcePos.colwise().minCoeff().transpose();
+    Vector3f vecExtent = grid.matSourcePos.colwise().maxCoeff().transpose() - grid.vecOrigin;
 
-        if(dist <= input.dThresholdDistance) {
-            valueWeight = fabs(1.0/pow(dist,input.iDistPow));
+    //Cells of the threshold size, coarsened until the grid is not much larger than the number of sources
+    grid.fCellSize = input.dThresholdDistance > 0 ? (float)input.dThresholdDistance : vecExtent.maxCoeff() + 1.0f;
+    qint64 iNumCells;
+    forever {
+        for(int c = 0; c < 3; ++c) {
+            grid.iDims[c] = (int)(vecExtent(c) / grid.fCellSize) + 1;
+        }
+        iNumCells = (qint64)grid.iDims[0] * grid.iDims[1] * grid.iDims[2];
+        if(iNumCells <= qMax((qint64)SMOOTH_GRID_CELLS_PER_SOURCE * nSources, (qint64)SMOOTH_GRID_MIN_CELLS)) {
+            break;
+        }
+        grid.fCellSize *= 2.0f;
+    }
 
-            input.lTriplets.append(Eigen::Triplet<double>(input.iVertIdx, j, valueWeight));
-            dWeightsSum += valueWeight;
+    //Counting sort of the sources by cell
+    VectorXi vecSourceCell(nSources);
+    grid.vecCellStart = VectorXi::Zero(iNumCells + 1);
+    for(int j = 0; j < nSources; ++j) {
+        int idx[3];
+        for(int c = 0; c < 3; ++c) {
+            idx[c] = qMin((int)((grid.matSourcePos(j,c) - grid.vecOrigin(c)) / grid.fCellSize), grid.iDims[c] - 1);
         }
+        vecSourceCell(j) = (idx[2] * grid.iDims[1] + idx[1]) * grid.iDims[0] + idx[0];
+        ++grid.vecCellStart(vecSourceCell(j) + 1);
+    }
+    for(qint64 c = 0; c < iNumCells; ++c) {
+        grid.vecCellStart(c + 1) += grid.vecCellStart(c);
     }
 
-    //Divide by the sum of all weights
-    for(int j = 0; j < input.lTriplets.size(); ++j) {
-        input.lTriplets[j] = Eigen::Triplet<double>(input.lTriplets.at(j).row(), input.lTriplets.at(j).col(), input.lTriplets.at(j).value()/dWeightsSum);
+    VectorXi vecFill = grid.vecCellStart.head(iNumCells);
+    grid.vecCellSources.resize(nSources);
+    for(int j = 0; j < nSources; ++j) {
+        grid.vecCellSources(vecFill(vecSourceCell(j))++) = j;
     }
 }
 
 
 //*************************************************************************************************************
 
-void generateSmoothOperator(SmoothOperatorInfo& input)
+void generateWeightsPerRowBlock(SmoothRowBlockInfo& input)
 {
-    //Prepare data
-    QList<SmoothVertexInfo> lInputData;
-    SmoothVertexInfo vertInfo;
-    QList<QVector3D> lSourcePos;
-    QVector3D vertPos;
-
-    //Create list with all source positions
-    for(int j = 0; j < input.vecVertNo.rows(); ++j) {
-        vertPos.setX(input.matVertPos(input.vecVertNo(j),0));
-        vertPos.setY(input.matVertPos(input.vecVertNo(j),1));
-        vertPos.setZ(input.matVertPos(input.vecVertNo(j),2));
-
-        lSourcePos.append(vertPos);
+    const SmoothOperatorInfo& info = *input.pOperatorInfo;
+    const SmoothSourceGrid& grid = *input.pGrid;
+
+    QVector<QPair<int, double> > lRow;
+    double dist, valueWeight, dWeightsSum;
+
+    input.vecNumNonZeros.resize(input.iRowEnd - input.iRowStart);
+    input.vecCols.clear();
+    input.vecValues.clear();
+
+    for(int r = input.iRowStart; r < input.iRowEnd; ++r) {
+        lRow.clear();
+
+        //Range of the cells overlapped by the threshold box around the vertex, clipped to the grid. The box is
+        //slightly enlarged, so that rounding can not drop a source at exactly the threshold distance
+        double dReach = info.dThresholdDistance * (1.0 + SMOOTH_REACH_MARGIN);
+        int lo[3], hi[3];
+        bool bInside = grid.vecCellSources.size() > 0;
+        for(int c = 0; c < 3 && bInside; ++c) {
+            double dLo = floor((info.matVertPos(r,c) - dReach - grid.vecOrigin(c)) / grid.fCellSize);
+            double dHi = floor((info.matVertPos(r,c) + dReach - grid.vecOrigin(c)) / grid.fCellSize);
+            bInside = dHi >= 0.0 && dLo <= grid.iDims[c] - 1;
+            if(bInside) {
+                lo[c] = (int)qMax(dLo, 0.0);
+                hi[c] = (int)qMin(dHi, (double)(grid.iDims[c] - 1));
+            }
+        }
+
+        dWeightsSum = 0;
+        for(int z = lo[2]; bInside && z <= hi[2]; ++z) {
+            for(int y = lo[1]; y <= hi[1]; ++y) {
+                for(int x = lo[0]; x <= hi[0]; ++x) {
+                    int iCell = (z * grid.iDims[1] + y) * grid.iDims[0] + x;
+
+                    for(int k = grid.vecCellStart(iCell); k < grid.vecCellStart(iCell + 1); ++k) {
+                        int j = grid.vecCellSources(k);
+                        //Same rounding as QVector3D::distanceToPoint -> ties at the threshold are decided as before
+                        float dx = info.matVertPos(r,0) - grid.matSourcePos(j,0);
+                        float dy = info.matVertPos(r,1) - grid.matSourcePos(j,1);
+                        float dz = info.matVertPos(r,2) - grid.matSourcePos(j,2);
+
+                        if(dx == 0.0f && dy == 0.0f && dz == 0.0f) {
+                            dist = exp(-25);
+                        } else {
+                            dist = (float)sqrt((double)dx*dx + (double)dy*dy + (double)dz*dz);
+                        }
+
+                        if(dist <= info.dThresholdDistance) {
+                            valueWeight = fabs(1.0/pow(dist,info.iDistPow));
+                            lRow.append(QPair<int, double>(j, valueWeight));
+                            dWeightsSum += valueWeight;
+                        }
+                    }
+                }
+            }
+        }
+
+        //Columns have to be sorted within a CSR row; divide by the sum of all weights
+        std::sort(lRow.begin(), lRow.end());
+        for(int j = 0; j < lRow.size(); ++j) {
+            input.vecCols.append(lRow.at(j).first);
+            input.vecValues.append(lRow.at(j).second/dWeightsSum);
+        }
+        input.vecNumNonZeros[r - input.iRowStart] = lRow.size();
     }
+}
 
-    for(int j = 0; j < input.matVertPos.rows(); ++j) {
-        vertPos.setX(input.matVertPos(j,0));
-        vertPos.setY(input.matVertPos(j,1));
-        vertPos.setZ(input.matVertPos(j,2));
 
-        vertInfo.vVertPos = vertPos;
-        vertInfo.dThresholdDistance = input.dThresholdDistance;
-        vertInfo.lSourcePos = lSourcePos;
-        vertInfo.iDistPow = input.iDistPow;
-        vertInfo.iVertIdx = j;
+//*************************************************************************************************************
 
-        lInputData << vertInfo;
+void generateSmoothOperator(SmoothOperatorInfo& input)
+{
+    SmoothSourceGrid grid;
+    generateSourceGrid(input, grid);
+
+    //Do the vertex dist weight calculation for blocks of vertices in different threads
+    QList<SmoothRowBlockInfo> lInputData;
+    SmoothRowBlockInfo blockInfo;
+    blockInfo.pOperatorInfo = &input;
+    blockInfo.pGrid = &grid;
+
+    int nRows = input.matVertPos.rows();
+    for(int j = 0; j < nRows; j += SMOOTH_ROW_BLOCK) {
+        blockInfo.iRowStart = j;
+        blockInfo.iRowEnd = qMin(j + SMOOTH_ROW_BLOCK, nRows);
+        lInputData << blockInfo;
     }
 
-    //Do the vertex dist weight calculation for each vertex in a different thread
-    QFuture<void> future = QtConcurrent::map(lInputData, generateWeightsPerVertex);
+    QFuture<void> future = QtConcurrent::map(lInputData, generateWeightsPerRowBlock);
     future.waitForFinished();
 
-    QList<Eigen::Triplet<double> > lFinalTriplets;
+    //Assemble the blocks directly in compressed row storage
+    int nNonZeros = 0;
     for(int j = 0; j < lInputData.size(); ++j) {
-        lFinalTriplets.append(lInputData.at(j).lTriplets);
+        nNonZeros += lInputData.at(j).vecCols.size();
     }
 
-    input.sparseSmoothMatrix.setFromTriplets(lFinalTriplets.begin(), lFinalTriplets.end());
+    input.sparseSmoothMatrix.resize(nRows, input.vecVertNo.rows());
+    input.sparseSmoothMatrix.resizeNonZeros(nNonZeros);
+
+    int* pOuter = input.sparseSmoothMatrix.outerIndexPtr();
+    int* pInner = input.sparseSmoothMatrix.innerIndexPtr();
+    double* pValues = input.sparseSmoothMatrix.valuePtr();
+
+    int iRow = 0, iOffset = 0;
+    pOuter[0] = 0;
+    for(int j = 0; j < lInputData.size(); ++j) {
+        const SmoothRowBlockInfo& block = lInputData.at(j);
+
+        for(int r = 0; r < block.vecNumNonZeros.size(); ++r, ++iRow) {
+            pOuter[iRow + 1] = pOuter[iRow] + block.vecNumNonZeros.at(r);
+        }
+
+        if(!block.vecCols.isEmpty()) {
+            memcpy(pInner + iOffset, block.vecCols.constData(), block.vecCols.size() * sizeof(int));
+            memcpy(pValues + iOffset, block.vecValues.constData(), block.vecValues.size() * sizeof(double));
+            iOffset += block.vecCols.size();
+        }
+    }
 }
 
 
 //*************************************************************************************************************
 
-void transformDataToColor(const VectorXd& data, MatrixX3f& matFinalVertColor, double dTrehsoldX, double dTrehsoldZ, QRgb (*functionHandlerColorMap)(double v))
+void createColorLut(VisualizationInfo& input)
 {
-    //Note: This function needs to be implemented extremley efficient. That is why we have three if clauses.
-    //      Otherwise we would have to check which color map to take for each vertex.
-    //QElapsedTimer timer;
-    //timer.start();
+    //Sample the color map once, so that each frame only needs table lookups
+    input.vecColorLut.resize(3 * COLOR_LUT_SIZE);
+
+    for(int i = 0; i < COLOR_LUT_SIZE; ++i) {
+        QRgb qRgb = input.functionHandlerColorMap((double)i / (COLOR_LUT_SIZE - 1));
 
-    if(data.rows() != matFinalVertColor.rows()) {
-        qDebug() << "RtSourceLocDataWorker::transformDataToColor - Sizes of input data (" <<data.rows() <<") do not match output data ("<< matFinalVertColor.rows() <<"). Returning ...";
+        input.vecColorLut[3*i] = (float)qRed(qRgb)/255.0f;
+        input.vecColorLut[3*i+1] = (float)qGreen(qRgb)/255.0f;
+        input.vecColorLut[3*i+2] = (float)qBlue(qRgb)/255.0f;
     }
+}
 
-    float dSample;
-    QRgb qRgb;
-    double dTrehsoldDiff = dTrehsoldZ - dTrehsoldX;
 
-    for(int r = 0; r < data.rows(); ++r) {
-        dSample = data(r);
-
-        if(dSample >= dTrehsoldX) {
-            //Check lower and upper thresholds and normalize to one
-            if(dSample >= dTrehsoldZ) {
-                dSample = 1.0;
-            } else if(dSample < dTrehsoldX) {
-                dSample = 0.0;
-            } else {
-                dSample = (dSample - dTrehsoldX) / (dTrehsoldDiff);
-            }
+//*************************************************************************************************************
 
-            qRgb = functionHandlerColorMap(dSample);
+QByteArray createInterleavedColor(const MatrixX3f& matColor)
+{
+    QByteArray arrayColor;
+    arrayColor.resize(matColor.rows() * 3 * (int)sizeof(float));
 
-            matFinalVertColor(r,0) = (float)qRed(qRgb)/255.0f;
-            matFinalVertColor(r,1) = (float)qGreen(qRgb)/255.0f;
-            matFinalVertColor(r,2) = (float)qBlue(qRgb)/255.0f;
-        }
-    }
+    Map<Matrix<float, Dynamic, 3, RowMajor> >(reinterpret_cast<float *>(arrayColor.data()), matColor.rows(), 3) = matColor;
 
-    //int elapsed = timer.elapsed();
-    //qDebug()<<"RtSourceLocDataWorker::transformDataToColor - elapsed"<<elapsed;
+    return arrayColor;
 }
 
 
 //*************************************************************************************************************
 
-void transformDataToColor(float fSample, QColor& finalVertColor, double dTrehsoldX, double dTrehsoldZ, QRgb (*functionHandlerColorMap)(double v))
+float* beginFinalVertColor(VisualizationInfo& input)
 {
-    //Note: This function needs to be implemented extremley efficient. That is why we have three if clauses.
-    //      Otherwise we would have to check which color map to take for each vertex.
-    double dTrehsoldDiff = dTrehsoldZ - dTrehsoldX;
-
-    //Check lower and upper thresholds and normalize to one
-    if(fSample >= dTrehsoldZ) {
-        fSample = 1.0;
-    } else if(fSample < dTrehsoldX) {
-        fSample = 0.0;
-    } else {
-        fSample = (fSample - dTrehsoldX) / dTrehsoldDiff;
+    //Alternate between two buffers: the one emitted last is still held by the renderer, the other one was released
+    //and is overwritten without any allocation
+    input.iFinalVertColor = 1 - input.iFinalVertColor;
+    QByteArray& arrayColor = input.arrayFinalVertColor[input.iFinalVertColor];
+
+    if(arrayColor.size() != input.arrayOriginalVertColor.size()) {
+        arrayColor.resize(input.arrayOriginalVertColor.size());
     }
 
-    QRgb qRgb;
-    qRgb = (functionHandlerColorMap)(fSample);
+    //Start with the original colors
+    memcpy(arrayColor.data(), input.arrayOriginalVertColor.constData(), arrayColor.size());
 
-    finalVertColor.setRedF((float)qRed(qRgb)/255.0f);
-    finalVertColor.setGreenF((float)qGreen(qRgb)/255.0f);
-    finalVertColor.setBlueF((float)qBlue(qRgb)/255.0f);
+    return reinterpret_cast<float *>(arrayColor.data());
 }
 
 
 //*************************************************************************************************************
 
-void generateColorsPerVertex(VisualizationInfo& input)
+inline double lutScale(const VisualizationInfo& input)
+{
+    return (COLOR_LUT_SIZE - 1) / qMax(input.dThresholdZ - input.dThresholdX, 1e-12);
+}
+
+
+//*************************************************************************************************************
+
+void transformDataToColor(const VectorXd& data, const VectorXi* pVertNo, float* pFinalVertColor, VisualizationInfo& input)
 {
-    QColor color;
+    //Note: This function needs to be implemented extremley efficient. The normalization to the thresholds and the
+    //      scaling to the lookup table are vectorized, the remaining work per vertex is copying one table entry.
+    double dScale = lutScale(input);
 
-    //Fill final QByteArray with colors based on the current anatomical information
-    for(int i = 0; i < input.vVertNo.rows(); ++i) {
-        if(input.vSourceColorSamples(i) >= input.dThresholdX) {
-            transformDataToColor(input.vSourceColorSamples(i), color, input.dThresholdX, input.dThresholdZ, input.functionHandlerColorMap);
+    input.vLutIdx = ((data.array() - input.dThresholdX) * dScale + 0.5).max(0.0).min(COLOR_LUT_SIZE - 1.0).cast<int>();
 
-            input.matFinalVertColor(input.vVertNo(i),0) = color.redF();
-            input.matFinalVertColor(input.vVertNo(i),1) = color.greenF();
-            input.matFinalVertColor(input.vVertNo(i),2) = color.blueF();
+    const float* pLut = input.vecColorLut.constData();
+
+    for(int r = 0; r < data.rows(); ++r) {
+        if(data(r) >= input.dThresholdX) {
+            int iVert = pVertNo ? (*pVertNo)(r) : r;
+            memcpy(pFinalVertColor + 3*iVert, pLut + 3*input.vLutIdx(r), 3 * sizeof(float));
         }
     }
 }
 
 
+//*************************************************************************************************************
+
+void generateColorsPerVertex(VisualizationInfo& input)
+{
+    float* pFinalVertColor = beginFinalVertColor(input);
+
+    //Fill final colors based on the current source activation
+    transformDataToColor(input.vSourceColorSamples, &input.vVertNo, pFinalVertColor, input);
+}
+
+
 //*************************************************************************************************************
 
 void generateColorsPerAnnotation(VisualizationInfo& input)
 {
+    float* pFinalVertColor = beginFinalVertColor(input);
+
     //Find maximum actiavtion for each label
-    QMap<qint32, double> vecLabelActivation;
+    input.vLabelActivation.setZero(input.lLabels.size());
 
     for(int i = 0; i < input.vSourceColorSamples.rows(); ++i) {
         //Find out label for source
-        qint32 labelIdx = input.mapLabelIdSources[input.vVertNo(i)];
+        int labelIdx = input.vSourceLabelIdx(i);
 
-        if(fabs(input.vSourceColorSamples(i)) > fabs(vecLabelActivation[labelIdx]))
-            vecLabelActivation.insert(labelIdx, input.vSourceColorSamples(i));
+        if(labelIdx >= 0 && fabs(input.vSourceColorSamples(i)) > fabs(input.vLabelActivation(labelIdx))) {
+            input.vLabelActivation(labelIdx) = input.vSourceColorSamples(i);
+        }
     }
 
     //Color all labels respectivley to their activation
-    QColor color;
+    double dScale = lutScale(input);
+    const float* pLut = input.vecColorLut.constData();
 
-    for(int i = 0; i<input.lLabels.size(); i++) {
-        FSLIB::Label label = input.lLabels.at(i);
-
-        //Transform label activations to rgb colors
+    for(int i = 0; i < input.lLabels.size(); i++) {
         //Check if value is bigger than lower threshold. If not, don't plot activation
-        if(vecLabelActivation[label.label_id] >= input.dThresholdX) {
-            transformDataToColor(vecLabelActivation[label.label_id], color, input.dThresholdX, input.dThresholdZ, input.functionHandlerColorMap);
+        if(input.vLabelActivation(i) >= input.dThresholdX) {
+            int iLutIdx = (int)qMin((input.vLabelActivation(i) - input.dThresholdX) * dScale + 0.5, COLOR_LUT_SIZE - 1.0);
+            const VectorXi& vertices = input.lLabels.at(i).vertices;
 
-            for(int j = 0; j<label.vertices.rows(); j++) {
-                input.matFinalVertColor(label.vertices(j),0) = color.redF();
-                input.matFinalVertColor(label.vertices(j),1) = color.greenF();
-                input.matFinalVertColor(label.vertices(j),2) = color.blueF();
+            for(int j = 0; j < vertices.rows(); j++) {
+                memcpy(pFinalVertColor + 3*vertices(j), pLut + 3*iLutIdx, 3 * sizeof(float));
             }
         }
     }
@@ -356,10 +478,15 @@ void generateSmoothedColors(VisualizationInfo& input)
 //    }
 
     //Option 2 - Inverse weighted distance smoothing operator
-    VectorXd smooth_val = input.matWDistSmooth * input.vSourceColorSamples;
+    input.vSmoothedSamples.noalias() = input.matWDistSmooth * input.vSourceColorSamples;
+
+    if(input.vSmoothedSamples.rows() * 3 * (int)sizeof(float) != input.arrayOriginalVertColor.size()) {
+        qDebug() << "RtSourceLocDataWorker::generateSmoothedColors - Sizes of smoothed data (" << input.vSmoothedSamples.rows() << ") do not match the surface colors. Returning ...";
+        return;
+    }
 
     //Produce final color
-    transformDataToColor(smooth_val, input.matFinalVertColor, input.dThresholdX, input.dThresholdZ, input.functionHandlerColorMap);
+    transformDataToColor(input.vSmoothedSamples, Q_NULLPTR, beginFinalVertColor(input), input);
 
     //int iAllTimer = allTimer.elapsed();
     //qDebug() << "All time" << iAllTimer;
@@ -383,7 +510,12 @@ RtSourceLocDataWorker::RtSourceLocDataWorker(QObject* parent)
 , m_bAnnotationDataIsInit(false)
 {
     m_lVisualizationInfo << VisualizationInfo() << VisualizationInfo();
-    m_lVisualizationInfo[0].functionHandlerColorMap = ColorMap::valueToHotNegative2;
+
+    for(int h = 0; h < m_lVisualizationInfo.size(); ++h) {
+        m_lVisualizationInfo[h].functionHandlerColorMap = ColorMap::valueToHotNegative2;
+        m_lVisualizationInfo[h].iFinalVertColor = 0;
+        createColorLut(m_lVisualizationInfo[h]);
+    }
 }
 
 
@@ -462,6 +594,9 @@ void RtSourceLocDataWorker::setSurfaceColor(const MatrixX3f& matSurfaceVertColor
 
     m_lVisualizationInfo[0].matOriginalVertColor = matSurfaceVertColorLeftHemi;
     m_lVisualizationInfo[1].matOriginalVertColor = matSurfaceVertColorRightHemi;
+
+    m_lVisualizationInfo[0].arrayOriginalVertColor = createInterleavedColor(matSurfaceVertColorLeftHemi);
+    m_lVisualizationInfo[1].arrayOriginalVertColor = createInterleavedColor(matSurfaceVertColorRightHemi);
 }
 
 
@@ -482,13 +617,22 @@ void RtSourceLocDataWorker::setAnnotationData(const Eigen::VectorXi& vecLabelIds
     m_lVisualizationInfo[0].lLabels = lLabelsLeftHemi;
     m_lVisualizationInfo[1].lLabels = lLabelsRightHemi;
 
-    //Generate fast lookup map for each source and corresponding label
-    for(qint32 i = 0; i < m_lVisualizationInfo[0].vVertNo.rows(); ++i) {
-        m_lVisualizationInfo[0].mapLabelIdSources.insert(m_lVisualizationInfo[0].vVertNo(i), vecLabelIdsLeftHemi(m_lVisualizationInfo[0].vVertNo(i)));
-    }
+    //Generate fast lookup table for each source and the index of its label
+    QList<VectorXi> lLabelIds;
+    lLabelIds << vecLabelIdsLeftHemi << vecLabelIdsRightHemi;
 
-    for(qint32 i = 0; i < m_lVisualizationInfo[1].vVertNo.rows(); ++i) {
-        m_lVisualizationInfo[1].mapLabelIdSources.insert(m_lVisualizationInfo[1].vVertNo(i), vecLabelIdsRightHemi(m_lVisualizationInfo[1].vVertNo(i)));
+    for(int h = 0; h < 2; ++h) {
+        VisualizationInfo& info = m_lVisualizationInfo[h];
+
+        QHash<qint32, int> hashLabelIdx;
+        for(int j = 0; j < info.lLabels.size(); ++j) {
+            hashLabelIdx.insert(info.lLabels.at(j).label_id, j);
+        }
+
+        info.vSourceLabelIdx.resize(info.vVertNo.rows());
+        for(qint32 i = 0; i < info.vVertNo.rows(); ++i) {
+            info.vSourceLabelIdx(i) = hashLabelIdx.value(lLabelIds.at(h)(info.vVertNo(i)), -1);
+        }
     }
 
     m_bAnnotationDataIsInit = true;
@@ -539,6 +683,9 @@ void RtSourceLocDataWorker::setColormapType(const QString& sColormapType)
         m_lVisualizationInfo[0].functionHandlerColorMap = ColorMap::valueToHot;
         m_lVisualizationInfo[1].functionHandlerColorMap = ColorMap::valueToHot;
     }
+
+    createColorLut(m_lVisualizationInfo[0]);
+    createColorLut(m_lVisualizationInfo[1]);
 }
 
 
@@ -667,7 +814,7 @@ void RtSourceLocDataWorker::run()
 
 //*************************************************************************************************************
 
-QPair<MatrixX3f, MatrixX3f> RtSourceLocDataWorker::performVisualizationTypeCalculation(const VectorXd& vSourceColorSamples)
+QPair<QByteArray, QByteArray> RtSourceLocDataWorker::performVisualizationTypeCalculation(const VectorXd& vSourceColorSamples)
 {
     //NOTE: This function is called for every new sample point and therefore must be kept highly efficient!
 //    QTime allTimer;
@@ -675,25 +822,25 @@ QPair<MatrixX3f, MatrixX3f> RtSourceLocDataWorker::performVisualizationTypeCalcu
 
     if(vSourceColorSamples.rows() != m_lVisualizationInfo[0].vVertNo.rows() + m_lVisualizationInfo[1].vVertNo.rows()) {
         qDebug() << "RtSourceLocDataWorker::performVisualizationTypeCalculation - Number of new vertex colors (" << vSourceColorSamples.rows() << ") do not match with previously set number of vertices (" << m_lVisualizationInfo[0].vVertNo.rows() + m_lVisualizationInfo[1].vVertNo.rows() << "). Returning...";
-        QPair<MatrixX3f, MatrixX3f> colorPair;
-        colorPair.first =  m_lVisualizationInfo[0].matOriginalVertColor;
-        colorPair.second = m_lVisualizationInfo[1].matOriginalVertColor;
+        QPair<QByteArray, QByteArray> colorPair;
+        colorPair.first =  m_lVisualizationInfo[0].arrayOriginalVertColor;
+        colorPair.second = m_lVisualizationInfo[1].arrayOriginalVertColor;
         return colorPair;
     }
 
     if(!m_bSurfaceDataIsInit) {
         qDebug() << "RtSourceLocDataWorker::performVisualizationTypeCalculation - Surface data was not initialized. Returning ...";
-        QPair<MatrixX3f, MatrixX3f> colorPair;
-        colorPair.first =  m_lVisualizationInfo[0].matOriginalVertColor;
-        colorPair.second = m_lVisualizationInfo[1].matOriginalVertColor;
+        QPair<QByteArray, QByteArray> colorPair;
+        colorPair.first =  m_lVisualizationInfo[0].arrayOriginalVertColor;
+        colorPair.second = m_lVisualizationInfo[1].arrayOriginalVertColor;
         return colorPair;
     }
 
     if(!m_bAnnotationDataIsInit) {
         qDebug() << "RtSourceLocDataWorker::performVisualizationTypeCalculation - Annotation data was not initialized. Returning ...";
-        QPair<MatrixX3f, MatrixX3f> colorPair;
-        colorPair.first =  m_lVisualizationInfo[0].matOriginalVertColor;
-        colorPair.second = m_lVisualizationInfo[1].matOriginalVertColor;
+        QPair<QByteArray, QByteArray> colorPair;
+        colorPair.first =  m_lVisualizationInfo[0].arrayOriginalVertColor;
+        colorPair.second = m_lVisualizationInfo[1].arrayOriginalVertColor;
         return colorPair;
     }
 
@@ -701,10 +848,6 @@ QPair<MatrixX3f, MatrixX3f> RtSourceLocDataWorker::performVisualizationTypeCalcu
     m_lVisualizationInfo[0].vSourceColorSamples = vSourceColorSamples.segment(0, m_lVisualizationInfo[0].vVertNo.rows());
     m_lVisualizationInfo[1].vSourceColorSamples = vSourceColorSamples.segment(m_lVisualizationInfo[0].vVertNo.rows(), m_lVisualizationInfo[1].vVertNo.rows());
 
-    //Reset to original color as default
-    m_lVisualizationInfo[0].matFinalVertColor = m_lVisualizationInfo[0].matOriginalVertColor;
-    m_lVisualizationInfo[1].matFinalVertColor = m_lVisualizationInfo[1].matOriginalVertColor;
-
     //Generate color data for vertices
     switch(m_iVisualizationType) {
         case Data3DTreeModelItemRoles::VertexBased: {
@@ -732,9 +875,9 @@ QPair<MatrixX3f, MatrixX3f> RtSourceLocDataWorker::performVisualizationTypeCalcu
 //    int iAllTimer = allTimer.elapsed();
 //    qDebug() << "All time" << iAllTimer;
 
-    QPair<MatrixX3f, MatrixX3f> colorPair;
-    colorPair.first =  m_lVisualizationInfo[0].matFinalVertColor;
-    colorPair.second = m_lVisualizationInfo[1].matFinalVertColor;
+    QPair<QByteArray, QByteArray> colorPair;
+    colorPair.first =  m_lVisualizationInfo[0].arrayFinalVertColor[m_lVisualizationInfo[0].iFinalVertColor];
+    colorPair.second = m_lVisualizationInfo[1].arrayFinalVertColor[m_lVisualizationInfo[1].iFinalVertColor];
     return colorPair;
 }
 
@@ -53,6 +53,9 @@
 #include <QThread>
 #include <QMutex>
 #include <QVector3D>
+#include <QVector>
+#include <QByteArray>
+#include <QPair>
 
 
 //*************************************************************************************************************
@@ -87,24 +90,40 @@ namespace DISP3DLIB
 * The strucut specifing the smoothing operator info.
 */
 struct SmoothOperatorInfo {
-    VectorXi                vecVertNo;
-    SparseMatrix<double>    sparseSmoothMatrix;
-    MatrixX3f               matVertPos;
-    int                     iDistPow;
-    double                  dThresholdDistance;
+    VectorXi                            vecVertNo;
+    SparseMatrix<double, RowMajor>      sparseSmoothMatrix;
+    MatrixX3f                           matVertPos;
+    int                                 iDistPow;
+    double                              dThresholdDistance;
 };
 
 //=========================================================================================================
 /**
-* The strucut specifing the smoothing vertex info.
+* The strucut specifing the uniform grid over the source positions. The cell size is at least the threshold
+* distance, so all sources within the threshold of a vertex lie in the few cells overlapped by the threshold
+* box around it.
 */
-struct SmoothVertexInfo {
-    int                                 iVertIdx;
-    QList<Eigen::Triplet<double> >      lTriplets;
-    QList<QVector3D>                    lSourcePos;
-    QVector3D                           vVertPos;
-    int                                 iDistPow;
-    double                              dThresholdDistance;
+struct SmoothSourceGrid {
+    MatrixX3f                           matSourcePos;
+    Vector3f                            vecOrigin;
+    float                               fCellSize;
+    int                                 iDims[3];
+    VectorXi                            vecCellStart;
+    VectorXi                            vecCellSources;
+};
+
+//=========================================================================================================
+/**
+* The strucut specifing a block of smoothing operator rows, computed in one thread.
+*/
+struct SmoothRowBlockInfo {
+    int                                 iRowStart;
+    int                                 iRowEnd;
+    const SmoothOperatorInfo*           pOperatorInfo;
+    const SmoothSourceGrid*             pGrid;
+    QVector<int>                        vecNumNonZeros;
+    QVector<int>                        vecCols;
+    QVector<double>                     vecValues;
 };
 
 //=========================================================================================================
@@ -113,16 +132,22 @@ struct SmoothVertexInfo {
 */
 struct VisualizationInfo {
     VectorXd                    vSourceColorSamples;
+    VectorXd                    vSmoothedSamples;
+    VectorXi                    vLutIdx;
     VectorXi                    vVertNo;
     QList<FSLIB::Label>         lLabels;
-    QMap<qint32, qint32>        mapLabelIdSources;
+    VectorXi                    vSourceLabelIdx;
+    VectorXd                    vLabelActivation;
     QMap<int, QVector<int> >    mapVertexNeighbors;
-    SparseMatrix<double>        matWDistSmooth;
+    SparseMatrix<double, RowMajor> matWDistSmooth;
     double                      dThresholdX;
     double                      dThresholdZ;
     QRgb (*functionHandlerColorMap)(double v);
+    QVector<float>              vecColorLut;
     MatrixX3f                   matOriginalVertColor;
-    MatrixX3f                   matFinalVertColor;
+    QByteArray                  arrayOriginalVertColor;
+    QByteArray                  arrayFinalVertColor[2];
+    int                         iFinalVertColor;
 };
 
 //*************************************************************************************************************
@@ -283,9 +308,9 @@ private:
     *
     * @param[in] vSourceColorSamples        The color data for the sources.
     *
-    * @return                               Returns the final colors in for the left and right hemisphere.
+    * @return                               Returns the final interleaved rgb float colors for the left and right hemisphere.
     */
-    QPair<MatrixX3f, MatrixX3f> performVisualizationTypeCalculation(const Eigen::VectorXd& vSourceColorSamples);
+    QPair<QByteArray, QByteArray> performVisualizationTypeCalculation(const Eigen::VectorXd& vSourceColorSamples);
 
     //=========================================================================================================
     /**
@@ -317,11 +342,27 @@ signals:
     /**
     * Emit this signal whenever this item should send new colors to its listeners.
     *
-    * @param[in] colorPair     The samples data in form of a QPair rgb colors for each (left, right) hemisphere.
+    * @param[in] colorPair     The samples data in form of a QPair of interleaved rgb float colors for each (left, right) hemisphere,
+    *                          ready to be uploaded to the color buffer of the mesh.
     */
-    void newRtData(const QPair<MatrixX3f, MatrixX3f>& colorPair);
+    void newRtData(const QPair<QByteArray, QByteArray>& colorPair);
 };
 
 } // NAMESPACE
 
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DECLARE GLOBAL METHODS
+//=============================================================================================================
+
+//=========================================================================================================
+/**
+* Creates the smoothing operator of one hemisphere: each vertex is weighted with all sources within the threshold
+* distance by the inverse distance to the power of iDistPow, normalized to a sum of one.
+*
+* @param[in, out] input     The smoothing operator info. The operator is written to input.sparseSmoothMatrix.
+*/
+DISP3DNEWSHARED_EXPORT void generateSmoothOperator(DISP3DLIB::SmoothOperatorInfo& input);
+
 #endif // RTSOURCELOCDATAWORKER_H
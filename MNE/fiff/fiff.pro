@@ -103,6 +103,7 @@ SOURCES += fiff.cpp \
     fiff_io.cpp \
     fiff_dig_point_set.cpp \
     fiff_dir_node.cpp \
+    fiff_data_buffer_codec.cpp \
     c/fiff_coord_trans_old.cpp \
     c/fiff_sparse_matrix.cpp
 
@@ -133,6 +134,7 @@ HEADERS += fiff.h \
     fiff_io.h \
     fiff_dig_point_set.h \
     fiff_dir_node.h \
+    fiff_data_buffer_codec.h \
     c/fiff_coord_trans_old.h \
     c/fiff_sparse_matrix.h \
     c/fiff_types_mne-c.h
@@ -423,12 +423,40 @@ namespace FIFFLIB
 //
 #define FIFF_MNE_RT_COMMAND         3700              /**< Fiff Real-Time Command */
 #define FIFF_MNE_RT_CLIENT_ID       3701              /**< Fiff Real-Time mne_t_server client id */
+#define FIFF_MNE_RT_DATA_BUFFER_ENCODED 3702          /**< Fiff Real-Time compactly encoded raw data buffer, see FiffDataBufferCodec */
 
 //
 // 3710... Real-Time Blocks
 //
 #define FIFFB_MNE_RT_MEAS_INFO      3710              /**< Fiff Real-Time Measurement Info */
 
+//
+// 3720... Dipole fitting
+//
+#define FIFFB_MNE_DIPOLE_GUESSES    3720              /**< Precomputed initial guesses of the dipole fit */
+#define FIFF_MNE_DIPOLE_GUESS_FIELDS 3721             /**< Whitened field basis of the guesses, three rows per guess */
+#define FIFF_MNE_DIPOLE_GUESS_SING  3722              /**< Singular values of the guess fields */
+#define FIFF_MNE_DIPOLE_GUESS_PARAMS 3723             /**< Grid, mindist, exclude and prune limit the guesses were created with */
+#define FIFF_MNE_DIPOLE_GUESS_SOURCE 3724             /**< Guess source space file the guesses were created from */
+#define FIFF_MNE_DIPOLE_GUESS_SURF  3725              /**< Guess boundary surface file the guesses were created with */
+
+//
+// 3730... Forward solution clustering
+//
+#define FIFFB_MNE_CLUSTER_CACHE     3730              /**< Cached result of a forward solution clustering */
+#define FIFFB_MNE_CLUSTER_HEMI      3731              /**< Cluster information of one hemisphere */
+#define FIFF_MNE_CLUSTER_KEY        3732              /**< Hash of the clustering input the cache is valid for */
+#define FIFF_MNE_CLUSTER_SOL        3733              /**< Clustered gain matrix, column major */
+#define FIFF_MNE_CLUSTER_VERTNO     3734              /**< Vertno of the clustered source space (label ids) */
+#define FIFF_MNE_CLUSTER_LABEL_NAMES 3735             /**< Label name of each cluster */
+#define FIFF_MNE_CLUSTER_LABEL_IDS  3736              /**< Label id of each cluster */
+#define FIFF_MNE_CLUSTER_CENTROID_VERTNO 3737         /**< Vertno of each cluster centroid */
+#define FIFF_MNE_CLUSTER_CENTROID_RR 3738             /**< Location of each cluster centroid */
+#define FIFF_MNE_CLUSTER_SIZES      3739              /**< Number of vertices of each cluster */
+#define FIFF_MNE_CLUSTER_VERTNOS    3740              /**< Concatenated vertnos of all clusters */
+#define FIFF_MNE_CLUSTER_RR         3741              /**< Concatenated source locations of all clusters */
+#define FIFF_MNE_CLUSTER_DISTANCES  3742              /**< Concatenated distances to the cluster centroids */
+
 
 //
 // Fiff values associated with MNE computations
@@ -0,0 +1,467 @@
+//=============================================================================================================
+/**
+* @file     fiff_data_buffer_codec.cpp
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     FiffDataBufferCodec class definition.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_data_buffer_codec.h"
+#include "fiff_stream.h"
+#include "fiff_constants.h"
+#include "fiff_file.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtEndian>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <limits>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define CODEC_HEADER_SIZE   12      /**< Encoding, number of channels and number of samples. */
+#define CODEC_MAX_ELEMENTS  (std::numeric_limits<int>::max() / 4)  /**< Most samples of a buffer, as for a float tag. */
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE GLOBAL METHODS
+//=============================================================================================================
+
+static inline quint32 floatToBits(float p_fValue)
+{
+    quint32 t_iBits;
+    memcpy(&t_iBits, &p_fValue, 4);
+    return t_iBits;
+}
+
+
+//*************************************************************************************************************
+
+static inline float bitsToFloat(quint32 p_iBits)
+{
+    float t_fValue;
+    memcpy(&t_fValue, &p_iBits, 4);
+    return t_fValue;
+}
+
+
+//*************************************************************************************************************
+
+static void encodeQuantized(const MatrixXf& p_matData, int p_iMaxInt, int p_iBytes, uchar* p_pOut)
+{
+    const int nchan = p_matData.rows();
+    const int nsamp = p_matData.cols();
+
+    //Per channel scales
+    VectorXf t_vecInvScale(nchan);
+    for(int c = 0; c < nchan; ++c)
+    {
+        float t_fScale = nchan > 0 && nsamp > 0 ? p_matData.row(c).cwiseAbs().maxCoeff() / p_iMaxInt : 0.0f;
+        t_vecInvScale[c] = t_fScale > 0.0f ? 1.0f / t_fScale : 0.0f;
+        qToLittleEndian<quint32>(floatToBits(t_fScale), p_pOut);
+        p_pOut += 4;
+    }
+
+    //Quantize all samples at once
+    MatrixXi t_matQuant = (t_vecInvScale.asDiagonal() * p_matData).array().round().cast<int>().matrix();
+    t_matQuant = t_matQuant.cwiseMax(-p_iMaxInt).cwiseMin(p_iMaxInt);
+
+    const int* t_pQuant = t_matQuant.data();
+    const qint64 nel = (qint64)nchan * nsamp;
+    if(p_iBytes == 2)
+    {
+        for(qint64 i = 0; i < nel; ++i, p_pOut += 2)
+            qToLittleEndian<qint16>((qint16)t_pQuant[i], p_pOut);
+    }
+    else
+    {
+        for(qint64 i = 0; i < nel; ++i, p_pOut += 3)
+        {
+            quint32 t_iValue = (quint32)t_pQuant[i];
+            p_pOut[0] = (uchar)(t_iValue);
+            p_pOut[1] = (uchar)(t_iValue >> 8);
+            p_pOut[2] = (uchar)(t_iValue >> 16);
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+static bool decodeQuantized(const uchar* p_pIn, qint64 p_iSize, int p_iBytes, MatrixXf& p_matData)
+{
+    const int nchan = p_matData.rows();
+    const int nsamp = p_matData.cols();
+
+    if(p_iSize < (qint64)nchan * 4 + (qint64)nchan * nsamp * p_iBytes)
+        return false;
+
+    VectorXf t_vecScale(nchan);
+    for(int c = 0; c < nchan; ++c, p_pIn += 4)
+        t_vecScale[c] = bitsToFloat(qFromLittleEndian<quint32>(p_pIn));
+
+    float* t_pData = p_matData.data();
+    const qint64 nel = (qint64)nchan * nsamp;
+    if(p_iBytes == 2)
+    {
+        for(qint64 i = 0; i < nel; ++i, p_pIn += 2)
+            t_pData[i] = (float)qFromLittleEndian<qint16>(p_pIn);
+    }
+    else
+    {
+        for(qint64 i = 0; i < nel; ++i, p_pIn += 3)
+        {
+            //Sign extend the 24 bit value
+            qint32 t_iValue = (qint32)((quint32)p_pIn[0] << 8 | (quint32)p_pIn[1] << 16 | (quint32)p_pIn[2] << 24) >> 8;
+            t_pData[i] = (float)t_iValue;
+        }
+    }
+
+    p_matData = t_vecScale.asDiagonal() * p_matData;
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+static inline quint32 sampleToCode(float p_fValue, bool p_bIsInteger)
+{
+    return p_bIsInteger ? (quint32)(qint32)p_fValue : floatToBits(p_fValue);
+}
+
+
+//*************************************************************************************************************
+
+static inline float codeToSample(quint32 p_iCode, bool p_bIsInteger)
+{
+    return p_bIsInteger ? (float)(qint32)p_iCode : bitsToFloat(p_iCode);
+}
+
+
+//*************************************************************************************************************
+
+static QByteArray encodeDeltaBitpack(const MatrixXf& p_matData)
+{
+    const int nchan = p_matData.rows();
+    const int nsamp = p_matData.cols();
+
+    //Worst case: mode, first sample, width and 32 bits per difference, checked by encode
+    QByteArray t_blockOut;
+    t_blockOut.resize((int)((qint64)nchan * (6 + 4 * (qint64)nsamp)));
+    uchar* t_pOut = (uchar*)t_blockOut.data();
+    uchar* t_pStart = t_pOut;
+
+    for(int c = 0; c < nchan; ++c)
+    {
+        if(nsamp == 0)
+            break;
+
+        //Integer valued channels (e.g. ADC counts) are coded as integer differences, all others as differences of
+        //the float bit patterns. Both are lossless.
+        bool t_bIsInteger = true;
+        for(int s = 0; s < nsamp && t_bIsInteger; ++s)
+        {
+            float t_fValue = p_matData(c,s);
+            t_bIsInteger = std::fabs(t_fValue) <= 16777216.0f && t_fValue == std::floor(t_fValue);
+        }
+
+        quint32 t_iFirst = sampleToCode(p_matData(c,0), t_bIsInteger);
+
+        //Width of the zigzag coded differences
+        quint32 t_iPrev = t_iFirst;
+        quint32 t_iAllBits = 0;
+        for(int s = 1; s < nsamp; ++s)
+        {
+            quint32 t_iCode = sampleToCode(p_matData(c,s), t_bIsInteger);
+            qint32 t_iDiff = (qint32)(t_iCode - t_iPrev);
+            t_iAllBits |= ((quint32)t_iDiff << 1) ^ (quint32)(t_iDiff >> 31);
+            t_iPrev = t_iCode;
+        }
+
+        int t_iWidth = 0;
+        while(t_iWidth < 32 && (t_iAllBits >> t_iWidth) != 0)
+            ++t_iWidth;
+
+        t_pOut[0] = t_bIsInteger ? 1 : 0;
+        qToLittleEndian<quint32>(t_iFirst, t_pOut + 1);
+        t_pOut[5] = (uchar)t_iWidth;
+        t_pOut += 6;
+
+        if(t_iWidth == 0)
+            continue;
+
+        //Pack
+        quint64 t_iAcc = 0;
+        int t_iAccBits = 0;
+        t_iPrev = t_iFirst;
+        for(int s = 1; s < nsamp; ++s)
+        {
+            quint32 t_iCode = sampleToCode(p_matData(c,s), t_bIsInteger);
+            qint32 t_iDiff = (qint32)(t_iCode - t_iPrev);
+            quint32 t_iZigZag = ((quint32)t_iDiff << 1) ^ (quint32)(t_iDiff >> 31);
+            t_iPrev = t_iCode;
+
+            t_iAcc |= (quint64)t_iZigZag << t_iAccBits;
+            t_iAccBits += t_iWidth;
+            while(t_iAccBits >= 8)
+            {
+                *t_pOut++ = (uchar)t_iAcc;
+                t_iAcc >>= 8;
+                t_iAccBits -= 8;
+            }
+        }
+        if(t_iAccBits > 0)
+            *t_pOut++ = (uchar)t_iAcc;
+    }
+
+    t_blockOut.resize(t_pOut - t_pStart);
+
+    return t_blockOut;
+}
+
+
+//*************************************************************************************************************
+
+static bool decodeDeltaBitpack(const uchar* p_pIn, qint64 p_iSize, MatrixXf& p_matData)
+{
+    const int nchan = p_matData.rows();
+    const int nsamp = p_matData.cols();
+    const uchar* t_pEnd = p_pIn + p_iSize;
+
+    for(int c = 0; c < nchan; ++c)
+    {
+        if(nsamp == 0)
+            break;
+
+        if(t_pEnd - p_pIn < 6)
+            return false;
+
+        bool t_bIsInteger = p_pIn[0] != 0;
+        quint32 t_iPrev = qFromLittleEndian<quint32>(p_pIn + 1);
+        int t_iWidth = p_pIn[5];
+        p_pIn += 6;
+
+        if(t_iWidth > 32 || t_pEnd - p_pIn < ((qint64)(nsamp - 1) * t_iWidth + 7) / 8)
+            return false;
+
+        p_matData(c,0) = codeToSample(t_iPrev, t_bIsInteger);
+
+        quint64 t_iMask = (((quint64)1) << t_iWidth) - 1;
+        quint64 t_iAcc = 0;
+        int t_iAccBits = 0;
+        for(int s = 1; s < nsamp; ++s)
+        {
+            while(t_iAccBits < t_iWidth)
+            {
+                t_iAcc |= (quint64)(*p_pIn++) << t_iAccBits;
+                t_iAccBits += 8;
+            }
+            quint32 t_iZigZag = (quint32)(t_iAcc & t_iMask);
+            t_iAcc >>= t_iWidth;
+            t_iAccBits -= t_iWidth;
+
+            t_iPrev += (t_iZigZag >> 1) ^ (0u - (t_iZigZag & 1));
+            p_matData(c,s) = codeToSample(t_iPrev, t_bIsInteger);
+        }
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+QByteArray FiffDataBufferCodec::encode(const MatrixXf& p_matData, Encoding p_encoding)
+{
+    const int nchan = p_matData.rows();
+    const int nsamp = p_matData.cols();
+    const qint64 nel = (qint64)nchan * nsamp;
+
+    //Largest payload of the encoding
+    qint64 t_iMaxSize;
+    switch(p_encoding)
+    {
+        case Int16:
+            t_iMaxSize = CODEC_HEADER_SIZE + 4 * (qint64)nchan + 2 * nel;
+            break;
+        case Int24:
+            t_iMaxSize = CODEC_HEADER_SIZE + 4 * (qint64)nchan + 3 * nel;
+            break;
+        case DeltaBitpack:
+            t_iMaxSize = CODEC_HEADER_SIZE + 6 * (qint64)nchan + 4 * nel;
+            break;
+        default:
+            printf("FiffDataBufferCodec::encode - Encoding %d is not a compact encoding.\n", p_encoding);
+            return QByteArray();
+    }
+
+    if(nel > CODEC_MAX_ELEMENTS || t_iMaxSize > std::numeric_limits<int>::max())
+    {
+        printf("FiffDataBufferCodec::encode - Buffer of %d x %d samples is too large.\n", nchan, nsamp);
+        return QByteArray();
+    }
+
+    QByteArray t_blockOut;
+
+    switch(p_encoding)
+    {
+        case Int16:
+            t_blockOut.resize((int)t_iMaxSize);
+            encodeQuantized(p_matData, 32767, 2, (uchar*)t_blockOut.data() + CODEC_HEADER_SIZE);
+            break;
+        case Int24:
+            t_blockOut.resize((int)t_iMaxSize);
+            encodeQuantized(p_matData, 8388607, 3, (uchar*)t_blockOut.data() + CODEC_HEADER_SIZE);
+            break;
+        default:
+            t_blockOut.resize(CODEC_HEADER_SIZE);
+            t_blockOut.append(encodeDeltaBitpack(p_matData));
+            break;
+    }
+
+    uchar* t_pHeader = (uchar*)t_blockOut.data();
+    qToLittleEndian<qint32>((qint32)p_encoding, t_pHeader);
+    qToLittleEndian<qint32>((qint32)nchan, t_pHeader + 4);
+    qToLittleEndian<qint32>((qint32)nsamp, t_pHeader + 8);
+
+    return t_blockOut;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffDataBufferCodec::decode(const char* p_pData, qint64 p_iSize, MatrixXf& p_matData)
+{
+    if(p_iSize < CODEC_HEADER_SIZE)
+        return false;
+
+    const uchar* t_pIn = (const uchar*)p_pData;
+    qint32 t_iEncoding = qFromLittleEndian<qint32>(t_pIn);
+    qint32 nchan = qFromLittleEndian<qint32>(t_pIn + 4);
+    qint32 nsamp = qFromLittleEndian<qint32>(t_pIn + 8);
+
+    if(nchan < 0 || nsamp < 0)
+        return false;
+
+    t_pIn += CODEC_HEADER_SIZE;
+    p_iSize -= CODEC_HEADER_SIZE;
+
+    //Validate the header against the payload before anything is allocated
+    const qint64 nel = (qint64)nchan * nsamp;
+    qint64 t_iMinSize;
+    switch(t_iEncoding)
+    {
+        case Int16:
+            t_iMinSize = 4 * (qint64)nchan + 2 * nel;
+            break;
+        case Int24:
+            t_iMinSize = 4 * (qint64)nchan + 3 * nel;
+            break;
+        case DeltaBitpack:
+            t_iMinSize = nsamp > 0 ? 6 * (qint64)nchan : 0;
+            break;
+        default:
+            printf("FiffDataBufferCodec::decode - Unknown encoding %d.\n", t_iEncoding);
+            return false;
+    }
+
+    if(nel > CODEC_MAX_ELEMENTS || p_iSize < t_iMinSize)
+        return false;
+
+    if(p_matData.rows() != nchan || p_matData.cols() != nsamp)
+        p_matData.resize(nchan, nsamp);
+
+    switch(t_iEncoding)
+    {
+        case Int16:
+            return decodeQuantized(t_pIn, p_iSize, 2, p_matData);
+        case Int24:
+            return decodeQuantized(t_pIn, p_iSize, 3, p_matData);
+        default:
+            return decodeDeltaBitpack(t_pIn, p_iSize, p_matData);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffDataBufferCodec::writeToStream(FiffStream* p_pStream, const MatrixXf& p_matData, Encoding p_encoding)
+{
+    if(p_encoding == Float32)
+    {
+        p_pStream->write_float(FIFF_DATA_BUFFER, p_matData.data(), p_matData.rows()*p_matData.cols());
+        return;
+    }
+
+    QByteArray t_blockPayload = encode(p_matData, p_encoding);
+
+    *p_pStream << (qint32)FIFF_MNE_RT_DATA_BUFFER_ENCODED;
+    *p_pStream << (qint32)FIFFT_BYTE;
+    *p_pStream << (qint32)t_blockPayload.size();
+    *p_pStream << (qint32)FIFFV_NEXT_SEQ;
+
+    p_pStream->writeRawData(t_blockPayload.constData(), t_blockPayload.size());
+}
@@ -0,0 +1,146 @@
+//=============================================================================================================
+/**
+* @file     fiff_data_buffer_codec.h
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     FiffDataBufferCodec class declaration.
+*
+*/
+
+#ifndef FIFFLIB_FIFF_DATA_BUFFER_CODEC_H
+#define FIFFLIB_FIFF_DATA_BUFFER_CODEC_H
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QByteArray>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE FIFFLIB
+//=============================================================================================================
+
+namespace FIFFLIB {
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// FIFFLIB FORWARD DECLARATIONS
+//=============================================================================================================
+
+class FiffStream;
+
+
+//=============================================================================================================
+/**
+* Compact encodings of raw data buffers for real-time streaming. An encoded buffer is sent as
+* FIFF_MNE_RT_DATA_BUFFER_ENCODED tag of type FIFFT_BYTE instead of the FIFFT_FLOAT FIFF_DATA_BUFFER tag.
+*
+* The payload starts with the encoding, the number of channels and the number of samples (little endian int32).
+* Int16 and Int24 follow with one float scale per channel (the channel's maximal absolute value in the buffer
+* divided by the maximal integer) and the quantized samples, sample by sample. DeltaBitpack is lossless: per
+* channel a mode byte (1 if all samples are integers, e.g. ADC counts, 0 otherwise), the first sample as integer
+* or float bit pattern, the bit width of the zigzag coded differences of the following ones and the differences
+* packed with that width.
+*
+* @brief Compact raw data buffer encodings for real-time streaming.
+*/
+class FIFFSHARED_EXPORT FiffDataBufferCodec
+{
+
+public:
+    //=========================================================================================================
+    /**
+    * The available raw buffer encodings.
+    */
+    enum Encoding {
+        Float32 = 0,        /**< Plain FIFF_DATA_BUFFER float tag (default). */
+        Int16 = 1,          /**< 16 bit integers with a per channel scale, lossy. */
+        Int24 = 2,          /**< 24 bit integers with a per channel scale, lossy. */
+        DeltaBitpack = 3    /**< Bit packed differences of the float bit patterns, lossless. */
+    };
+
+    static const int NumEncodings = 4;      /**< Number of available encodings. */
+
+    //=========================================================================================================
+    /**
+    * Encodes a raw buffer into the payload of a FIFF_MNE_RT_DATA_BUFFER_ENCODED tag.
+    *
+    * @param[in] p_matData      The raw buffer (channels x samples).
+    * @param[in] p_encoding     The encoding to use, not Float32.
+    *
+    * @return the encoded payload.
+    */
+    static QByteArray encode(const Eigen::MatrixXf& p_matData, Encoding p_encoding);
+
+    //=========================================================================================================
+    /**
+    * Decodes the payload of a FIFF_MNE_RT_DATA_BUFFER_ENCODED tag.
+    *
+    * @param[in] p_pData        The payload.
+    * @param[in] p_iSize        Size of the payload in bytes.
+    * @param[out] p_matData     The decoded raw buffer (channels x samples). Only resized if the size changed.
+    *
+    * @return true if succeeded, false otherwise.
+    */
+    static bool decode(const char* p_pData, qint64 p_iSize, Eigen::MatrixXf& p_matData);
+
+    //=========================================================================================================
+    /**
+    * Writes a raw buffer with the given encoding. Float32 writes the plain FIFF_DATA_BUFFER tag.
+    *
+    * @param[in] p_pStream      The stream to write to.
+    * @param[in] p_matData      The raw buffer (channels x samples).
+    * @param[in] p_encoding     The encoding to use.
+    */
+    static void writeToStream(FiffStream* p_pStream, const Eigen::MatrixXf& p_matData, Encoding p_encoding);
+};
+
+} // NAMESPACE
+
+#endif // FIFFLIB_FIFF_DATA_BUFFER_CODEC_H
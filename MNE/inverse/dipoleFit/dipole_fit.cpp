@@ -6,6 +6,11 @@
 
 #include <string.h>
 
+#include <QtConcurrent>
+#include <QThread>
+#include <QVector>
+#include <QElapsedTimer>
+
 
 
 using namespace INVERSELIB;
@@ -597,6 +602,165 @@ int mne_get_values_from_data_ch (float time,      /* Interesting time point */
 
 
 
+//============================= parallel fitting =============================
+
+#define GUESS_BATCH 256     /* How many time points are matched against the guesses at once */
+
+/*
+ * A contiguous block of time points fitted by one thread
+ */
+class FitDipoleBlock
+{
+public:
+    DipoleFitData*  fit;            /* Fitting data (a thread duplicate if several blocks are fitted concurrently) */
+    GuessData*      guess;          /* The initial guesses */
+    float           *times;         /* Time points of this block */
+    float           **data;         /* The data to fit, one time point per row */
+    int             ntime;          /* How many time points */
+    int             verbose;
+    bool            warm_start;     /* Start from the solution of the preceding time point? */
+    bool            has_prev;       /* Is rd_prev valid? */
+    float           rd_prev[3];     /* Location of the preceding solution */
+    QVector<ECD>    dips;           /* The fitted dipoles */
+    QVector<bool>   ok;             /* Did the fits succeed? */
+};
+
+
+static void fit_dipole_block(FitDipoleBlock* b)
+
+{
+    int            k;
+    QVector<int>   best(b->ntime);
+    QVector<float> good(b->ntime);
+    /*
+     * Scan the guesses for a batch of time points at a time
+     */
+    for (k = 0; k < b->ntime; k += GUESS_BATCH)
+        if (DipoleFitData::select_guesses(b->fit,b->guess,b->data+k,qMin(GUESS_BATCH,b->ntime-k),
+                                          best.data()+k,good.data()+k) == FAIL)
+            for (int j = k; j < qMin(k+GUESS_BATCH,b->ntime); j++)
+                best[j] = -1;
+
+    for (k = 0; k < b->ntime; k++) {
+        b->ok[k] = DipoleFitData::fit_one(b->fit,b->guess,b->times[k],b->data[k],b->verbose,b->dips[k],
+                                          b->warm_start && b->has_prev ? b->rd_prev : NULL,best[k],good[k]);
+        if (b->ok[k]) {
+            for (int c = 0; c < 3; c++)
+                b->rd_prev[c] = b->dips[k].rd[c];
+            b->has_prev = true;
+        }
+    }
+    return;
+}
+
+
+static int fit_dipole_time_points(DipoleFitData* fit,   /* Precomputed fitting data */
+                                  GuessData*     guess, /* The initial guesses */
+                                  float          *times,/* The time points */
+                                  float          **data,/* The data to fit, one time point per row (will be whitened in place) */
+                                  int            ntime,
+                                  int            verbose,
+                                  int            nthreads,
+                                  bool           warm_start,
+                                  bool           *has_prev, /* Preceding solution for the warm start (updated) */
+                                  float          *rd_prev,
+                                  ECDSet&        set)   /* Append the results here in time order */
+/*
+ * Fit the time points in contiguous blocks, one block per thread
+ */
+{
+    QList<FitDipoleBlock*> blocks;
+    FitDipoleBlock*        b;
+    int                    nblock,k,j,start,end;
+    int                    report_interval = 10;
+
+    if (ntime <= 0)
+        return OK;
+    if (nthreads <= 0)
+        nthreads = QThread::idealThreadCount();
+    nblock = qMax(1,qMin(nthreads,ntime));
+
+    for (k = 0; k < nblock; k++) {
+        start = (k*ntime)/nblock;
+        end   = ((k+1)*ntime)/nblock;
+        b = new FitDipoleBlock();
+        b->fit        = nblock > 1 ? DipoleFitData::create_dipole_fit_data_thread_duplicate(fit) : fit;
+        b->guess      = guess;
+        b->times      = times + start;
+        b->data       = data + start;
+        b->ntime      = end - start;
+        b->verbose    = verbose;
+        b->warm_start = warm_start;
+        b->has_prev   = k == 0 && *has_prev;
+        if (b->has_prev)
+            for (j = 0; j < 3; j++)
+                b->rd_prev[j] = rd_prev[j];
+        b->dips.resize(b->ntime);
+        b->ok.fill(false,b->ntime);
+        blocks.append(b);
+    }
+    if (nblock > 1)
+        QtConcurrent::blockingMap(blocks, fit_dipole_block);
+    else
+        fit_dipole_block(blocks[0]);
+    /*
+     * Collect the results in time order
+     */
+    for (k = 0; k < nblock; k++) {
+        b = blocks[k];
+        for (j = 0; j < b->ntime; j++) {
+            if (!b->ok[j])
+                printf("t = %7.1f ms : %s\n",1000*b->times[j],"error (tbd: catch)");
+            else {
+                set.addEcd(b->dips[j]);
+                if (verbose)
+                    b->dips[j].print(stdout);
+                else {
+                    if (set.size() % report_interval == 0)
+                        fprintf(stderr,"%d..",set.size());
+                }
+            }
+        }
+        if (b->has_prev) {
+            *has_prev = true;
+            for (j = 0; j < 3; j++)
+                rd_prev[j] = b->rd_prev[j];
+        }
+        if (b->fit != fit)
+            DipoleFitData::free_dipole_fit_data_thread_duplicate(b->fit);
+        delete b;
+    }
+    return OK;
+}
+
+
+
+
+
+
+static void report_fit_statistics(const ECDSet& set, DipoleFitData* fit, qint64 msecs)
+/*
+ * Summarize the fitting throughput
+ */
+{
+    long neval = 0;
+    int  k;
+
+    if (set.size() == 0)
+        return;
+    for (k = 0; k < set.size(); k++)
+        neval += set[k].neval;
+    printf("%d fits in %.2f s (%.2f ms/fit, %.1f forward evaluations/fit, %s)\n",
+           set.size(),msecs/1000.0,(double)msecs/set.size(),(double)neval/set.size(),
+           fit->fit_method == FIT_METHOD_LM ? "Levenberg-Marquardt" : "simplex");
+    return;
+}
+
+
+
+
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -638,6 +802,7 @@ ECDSet DipoleFit::calculateFit() const
         goto out;
 
     fit_data->fit_mag_dipoles = settings->fit_mag_dipoles;
+    fit_data->fit_method      = settings->use_lm ? FIT_METHOD_LM : FIT_METHOD_SIMPLEX;
     if (settings->is_raw) {
         int c;
         float t1,t2;
@@ -699,22 +864,37 @@ ECDSet DipoleFit::calculateFit() const
     /*
     * Proceed to computing the fits
     */
-    printf("\n---- Computing the forward solution for the guesses...\n\n");
-    if ((guess = new GuessData( settings->guessname,
-                                settings->guess_surfname,
-                                settings->guess_mindist, settings->guess_exclude, settings->guess_grid, fit_data)) == NULL)
-        goto out;
+    if (!settings->guess_fields_name.isEmpty()) {
+        guess = new GuessData();
+        if (!guess->read_guess_fields(settings->guess_fields_name,fit_data,settings->guessname,settings->guess_surfname,
+                                      settings->guess_mindist,settings->guess_exclude,settings->guess_grid,settings->guess_prune)) {
+            delete guess;
+            guess = NULL;
+        }
+    }
+    if (!guess) {
+        printf("\n---- Computing the forward solution for the guesses...\n\n");
+        if ((guess = new GuessData( settings->guessname,
+                                    settings->guess_surfname,
+                                    settings->guess_mindist, settings->guess_exclude, settings->guess_grid, fit_data)) == NULL)
+            goto out;
+        if (settings->guess_prune > 0.0)
+            guess->prune_guesses(1.5*settings->guess_grid,settings->guess_prune,FIT_LIMIT);
+        if (!settings->guess_fields_name.isEmpty())
+            guess->save_guess_fields(settings->guess_fields_name,fit_data,settings->guessname,settings->guess_surfname,
+                                     settings->guess_mindist,settings->guess_exclude,settings->guess_grid,settings->guess_prune);
+    }
 
     fprintf (stderr,"\n---- Fitting : %7.1f ... %7.1f ms (step: %6.1f ms integ: %6.1f ms)\n\n",
              1000*settings->tmin,1000*settings->tmax,1000*settings->tstep,1000*settings->integ);
 
 
     if (raw) {
-        if (fit_dipoles_raw(settings->measname,raw,sel,fit_data,guess,settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose) == FAIL)
+        if (fit_dipoles_raw(settings->measname,raw,sel,fit_data,guess,settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose,set,settings->nthreads,settings->warm_start) == FAIL)
             goto out;
     }
     else {
-        if (fit_dipoles(settings->measname,data,fit_data,guess,settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose,set) == FAIL)
+        if (fit_dipoles(settings->measname,data,fit_data,guess,settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose,set,settings->nthreads,settings->warm_start) == FAIL)
             goto out;
     }
     printf("%d dipoles fitted\n",set.size());
@@ -728,43 +908,43 @@ out : {
 
 //*************************************************************************************************************
 
-int DipoleFit::fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set)
+int DipoleFit::fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set, int nthreads, bool warm_start)
 {
-    float *one = MALLOC(data->nchan,float);
+    int   maxfit = tmax > tmin ? (int)ceil((tmax-tmin)/tstep) + 1 : 1;
+    float **one  = ALLOC_CMATRIX(maxfit,data->nchan);
+    float *times = MALLOC(maxfit,float);
     float time;
     ECDSet set;
-    ECD   dip;
-    int   s;
-    int   report_interval = 10;
+    int   s,nfit;
+    bool  has_prev = false;
+    float rd_prev[3];
+    QElapsedTimer timer;
 
     set.dataname = dataname;
 
+    timer.start();
     fprintf(stderr,"Fitting...%c",verbose ? '\n' : '\0');
-    for (s = 0, time = tmin; time < tmax; s++, time = tmin  + s*tstep) {
+    for (s = 0, nfit = 0, time = tmin; time < tmax && nfit < maxfit; s++, time = tmin  + s*tstep) {
         /*
      * Pick the data point
      */
         if (mne_get_values_from_data(time,integ,data->current->data,data->current->np,data->nchan,data->current->tmin,
-                                     1.0/data->current->tstep,FALSE,one) == FAIL) {
+                                     1.0/data->current->tstep,FALSE,one[nfit]) == FAIL) {
             fprintf(stderr,"Cannot pick time: %7.1f ms\n",1000*time);
             continue;
         }
-
-        if (!DipoleFitData::fit_one(fit,guess,time,one,verbose,dip))
-            printf("t = %7.1f ms : %s\n",1000*time,"error (tbd: catch)");
-        else {
-            set.addEcd(dip);
-            if (verbose)
-                dip.print(stdout);
-            else {
-                if (set.size() % report_interval == 0)
-                    fprintf(stderr,"%d..",set.size());
-            }
-        }
+        times[nfit++] = time;
     }
+    /*
+     * Time points are independent, fit them all at once
+     */
+    fit_dipole_time_points(fit,guess,times,one,nfit,verbose,nthreads,warm_start,&has_prev,rd_prev,set);
+
     if (!verbose)
         fprintf(stderr,"[done]\n");
-    FREE(one);
+    report_fit_statistics(set,fit,timer.elapsed());
+    FREE_CMATRIX(one);
+    FREE(times);
     p_set = set;
     return OK;
 }
@@ -772,9 +952,9 @@ int DipoleFit::fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFi
 
 //*************************************************************************************************************
 
-int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set)
+int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set, int nthreads, bool warm_start)
 {
-    float *one    = MALLOC(sel->nchan,float);
+    float *one    = NULL;
     float sfreq   = raw->info->sfreq;
     float myinteg = integ > 0.0 ? 2*integ : 0.1;
     int   overlap = ceil(myinteg*sfreq);
@@ -782,14 +962,19 @@ int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSe
     int   step    = length - overlap;
     int   stepo   = step + overlap/2;
     int   start   = raw->first_samp;
-    int   s,picks;
+    int   maxfit  = (int)ceil(length/(tstep*sfreq)) + 1;
+    int   s,picks,nfit;
     float time,stime;
     float **data  = ALLOC_CMATRIX(sel->nchan,length);
-    ECD    dip;
+    float **fits  = ALLOC_CMATRIX(maxfit,sel->nchan);
+    float *times  = MALLOC(maxfit,float);
+    bool  has_prev = false;
+    float rd_prev[3];
     ECDSet set;
-    int    report_interval = 10;
+    QElapsedTimer timer;
 
     set.dataname = dataname;
+    timer.start();
 
     /*
    * Load the initial data segment
@@ -798,8 +983,15 @@ int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSe
     if (MneRawData::mne_raw_pick_data_filt(raw,sel,start,length,data) == FAIL)
         goto bad;
     fprintf(stderr,"Fitting...%c",verbose ? '\n' : '\0');
-    for (s = 0, time = tmin; time < tmax; s++, time = tmin  + s*tstep) {
+    for (s = 0, nfit = 0, time = tmin; time < tmax; s++, time = tmin  + s*tstep) {
         picks = time*sfreq - start;
+        if (picks > stepo || nfit == maxfit) {
+            /*
+       * Fit the time points picked from this segment before moving on
+       */
+            fit_dipole_time_points(fit,guess,times,fits,nfit,verbose,nthreads,warm_start,&has_prev,rd_prev,set);
+            nfit = 0;
+        }
         if (picks > stepo) {		/* Need a new data segment? */
             start = start + step;
             if (MneRawData::mne_raw_pick_data_filt(raw,sel,start,length,data) == FAIL)
@@ -810,35 +1002,28 @@ int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSe
         /*
      * Get the values
      */
+        one = fits[nfit];
         if (mne_get_values_from_data_ch (time,integ,data,length,sel->nchan,stime,sfreq,FALSE,one) == FAIL) {
             fprintf(stderr,"Cannot pick time: %8.3f s\n",time);
             continue;
         }
-        /*
-     * Fit
-     */
-        if (!DipoleFitData::fit_one(fit,guess,time,one,verbose,dip))
-            qWarning() << "Error";
-        else {
-            set.addEcd(dip);
-            if (verbose)
-                dip.print(stdout);
-            else {
-                if (set.size() % report_interval == 0)
-                    fprintf(stderr,"%d..",set.size());
-            }
-        }
+        times[nfit++] = time;
     }
+    fit_dipole_time_points(fit,guess,times,fits,nfit,verbose,nthreads,warm_start,&has_prev,rd_prev,set);
+
     if (!verbose)
         fprintf(stderr,"[done]\n");
+    report_fit_statistics(set,fit,timer.elapsed());
     FREE_CMATRIX(data);
-    FREE(one);
+    FREE_CMATRIX(fits);
+    FREE(times);
     p_set = set;
     return OK;
 
 bad : {
         FREE_CMATRIX(data);
-        FREE(one);
+        FREE_CMATRIX(fits);
+        FREE(times);
         return FAIL;
     }
 }
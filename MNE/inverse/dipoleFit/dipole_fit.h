@@ -119,10 +119,12 @@ public:
     * @param[in] integ      Integration time
     * @param[in] verbose    Verbose output?
     * @param[out] p_set     the fitted ECD Set
+    * @param[in] nthreads   Number of threads to distribute the time points over (1 = serial, <= 0 = all cores)
+    * @param[in] warm_start Start each fit from the solution of the preceding time point?
     *
     * @return true when successful
     */
-    static int fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set);
+    static int fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set, int nthreads = 1, bool warm_start = false);
 
     //=========================================================================================================
     /**
@@ -141,10 +143,12 @@ public:
     * @param[in] integ      Integration time
     * @param[in] verbose    Verbose output?
     * @param[out] p_set     Return all results here. Warning: for large data files this may take a lot of memory
+    * @param[in] nthreads   Number of threads to distribute the time points over (1 = serial, <= 0 = all cores)
+    * @param[in] warm_start Start each fit from the solution of the preceding time point?
     *
     * @return true when successful
     */
-    static int fit_dipoles_raw(const QString& dataname, MNELIB::MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set);
+    static int fit_dipoles_raw(const QString& dataname, MNELIB::MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set, int nthreads = 1, bool warm_start = false);
 
     //=========================================================================================================
     /**
@@ -14,6 +14,7 @@
 #include <mne/c/mne_surface_old.h>
 
 #include <fwd/fwd_comp_data.h>
+#include <fwd/fwd_thread_arg.h>
 
 #include <Eigen/Dense>
 
@@ -1597,6 +1598,8 @@ static dipoleFitFuncs new_dipole_fit_funcs()
     f->eeg_pot       = NULL;
     f->meg_vec_field = NULL;
     f->eeg_vec_pot   = NULL;
+    f->meg_field_grad = NULL;
+    f->eeg_pot_grad   = NULL;
     f->meg_client      = NULL;
     f->meg_client_free = NULL;
     f->eeg_client      = NULL;
@@ -1606,6 +1609,67 @@ static dipoleFitFuncs new_dipole_fit_funcs()
 }
 
 
+static dipoleFitFuncs dup_dipole_fit_funcs_for_thread(dipoleFitFuncs f, bool bem_model)
+/*
+ * Duplicate the forward calculation clients so that each thread has its own work areas
+ * The duplicates are created with the same helpers compute_forward uses for its threads
+ */
+{
+    dipoleFitFuncs res;
+    FwdThreadArg*  one;
+    FwdThreadArg*  dup;
+
+    if (!f)
+        return NULL;
+
+    res = new_dipole_fit_funcs();
+    *res = *f;
+    res->meg_client_free = NULL;
+    res->eeg_client_free = NULL;
+
+    if (f->meg_client) {
+        one = new FwdThreadArg();
+        one->client = f->meg_client;
+        dup = FwdThreadArg::create_meg_multi_thread_duplicate(one,bem_model);
+        res->meg_client = dup->client;
+        delete dup;
+        delete one;
+    }
+    if (f->eeg_client) {
+        one = new FwdThreadArg();
+        one->client = f->eeg_client;
+        dup = FwdThreadArg::create_eeg_multi_thread_duplicate(one,bem_model);
+        res->eeg_client = dup->client;
+        delete dup;
+        delete one;
+    }
+    return res;
+}
+
+
+static void free_dipole_fit_funcs_thread_duplicate(dipoleFitFuncs f, bool bem_model)
+
+{
+    FwdThreadArg* one;
+
+    if (!f)
+        return;
+
+    if (f->meg_client) {
+        one = new FwdThreadArg();
+        one->client = f->meg_client;
+        FwdThreadArg::free_meg_multi_thread_duplicate(one,bem_model);
+    }
+    if (f->eeg_client) {
+        one = new FwdThreadArg();
+        one->client = f->eeg_client;
+        FwdThreadArg::free_eeg_multi_thread_duplicate(one,bem_model);
+    }
+    FREE_3(f);
+    return;
+}
+
+
 
 
 //============================= mne_simplex_fit.c =============================
@@ -3789,6 +3853,7 @@ DipoleFitData::DipoleFitData()
 , mag_dipole_funcs (NULL)
 , funcs (NULL)
 , column_norm (COLUMN_NORM_NONE)
+, fit_method (FIT_METHOD_SIMPLEX)
 , fit_mag_dipoles (FALSE)
 {
     r0[0] = 0.0f;
@@ -3838,6 +3903,68 @@ DipoleFitData::~DipoleFitData()
 }
 
 
+//*************************************************************************************************************
+
+DipoleFitData* DipoleFitData::create_dipole_fit_data_thread_duplicate(DipoleFitData* d)
+{
+    DipoleFitData* res = new DipoleFitData();
+
+    *res = *d;
+    res->sphere_funcs     = dup_dipole_fit_funcs_for_thread(d->sphere_funcs,false);
+    res->bem_funcs        = dup_dipole_fit_funcs_for_thread(d->bem_funcs,true);
+    res->mag_dipole_funcs = dup_dipole_fit_funcs_for_thread(d->mag_dipole_funcs,false);
+
+    if (d->funcs == d->bem_funcs)
+        res->funcs = res->bem_funcs;
+    else if (d->funcs == d->mag_dipole_funcs)
+        res->funcs = res->mag_dipole_funcs;
+    else
+        res->funcs = res->sphere_funcs;
+    /*
+     * fit_one installs its own user data
+     */
+    res->user      = NULL;
+    res->user_free = NULL;
+
+    return res;
+}
+
+
+//*************************************************************************************************************
+
+void DipoleFitData::free_dipole_fit_data_thread_duplicate(DipoleFitData* d)
+{
+    if (!d)
+        return;
+
+    free_dipole_fit_funcs_thread_duplicate(d->sphere_funcs,false);
+    free_dipole_fit_funcs_thread_duplicate(d->bem_funcs,true);
+    free_dipole_fit_funcs_thread_duplicate(d->mag_dipole_funcs,false);
+    /*
+     * Everything else is owned by the original
+     */
+    d->mri_head_t       = NULL;
+    d->meg_head_t       = NULL;
+    d->chs              = NULL;
+    d->meg_coils        = NULL;
+    d->eeg_els          = NULL;
+    d->pick             = NULL;
+    d->bem_model        = NULL;
+    d->eeg_model        = NULL;
+    d->noise            = NULL;
+    d->noise_orig       = NULL;
+    d->proj             = NULL;
+    d->sphere_funcs     = NULL;
+    d->bem_funcs        = NULL;
+    d->mag_dipole_funcs = NULL;
+    d->funcs            = NULL;
+    d->user             = NULL;
+    d->user_free        = NULL;
+
+    delete d;
+}
+
+
 //*************************************************************************************************************
 
 int DipoleFitData::setup_forward_model(DipoleFitData *d, MneCTFCompDataSet* comp_data, FwdCoilSet *comp_coils)
@@ -3904,7 +4031,7 @@ int DipoleFitData::setup_forward_model(DipoleFitData *d, MneCTFCompDataSet* comp
            * It works the same way independent of whether or not the compensation is in effect
            */
             comp = FwdCompData::fwd_make_comp_data(comp_data,d->meg_coils,comp_coils,
-                                      FwdBemModel::fwd_bem_field,NULL,NULL,d->bem_model,NULL);
+                                      FwdBemModel::fwd_bem_field,NULL,FwdBemModel::fwd_bem_field_grad,d->bem_model,NULL);
             if (!comp)
                 goto out;
             printf("Compensation setup done.\n");
@@ -3918,6 +4045,7 @@ int DipoleFitData::setup_forward_model(DipoleFitData *d, MneCTFCompDataSet* comp
 
             f->meg_field       = FwdCompData::fwd_comp_field;
             f->meg_vec_field   = NULL;
+            f->meg_field_grad  = FwdCompData::fwd_comp_field_grad;
             f->meg_client      = comp;
             f->meg_client_free = FwdCompData::fwd_free_comp_data;
         }
@@ -3928,6 +4056,7 @@ int DipoleFitData::setup_forward_model(DipoleFitData *d, MneCTFCompDataSet* comp
             printf("[done]\n");
             f->eeg_pot     = FwdBemModel::fwd_bem_pot_els;
             f->eeg_vec_pot = NULL;
+            f->eeg_pot_grad = FwdBemModel::fwd_bem_pot_grad_els;
             f->eeg_client  = d->bem_model;
         }
     }
@@ -3940,6 +4069,7 @@ int DipoleFitData::setup_forward_model(DipoleFitData *d, MneCTFCompDataSet* comp
         VEC_COPY_3(d->eeg_model->r0,d->r0);
         f->eeg_pot     = FwdEegSphereModel::fwd_eeg_spherepot_coil;
         f->eeg_vec_pot = FwdEegSphereModel::fwd_eeg_spherepot_coil_vec;
+        f->eeg_pot_grad = FwdEegSphereModel::fwd_eeg_spherepot_grad_coil;
         f->eeg_client  = d->eeg_model;
     }
     if (d->nmeg > 0) {
@@ -3950,12 +4080,13 @@ int DipoleFitData::setup_forward_model(DipoleFitData *d, MneCTFCompDataSet* comp
         comp = FwdCompData::fwd_make_comp_data(comp_data,d->meg_coils,comp_coils,
                                   FwdBemModel::fwd_sphere_field,
                                   FwdBemModel::fwd_sphere_field_vec,
-                                  NULL,
+                                  FwdBemModel::fwd_sphere_field_grad,
                                   d->r0,NULL);
         if (!comp)
             goto out;
         f->meg_field       = FwdCompData::fwd_comp_field;
         f->meg_vec_field   = FwdCompData::fwd_comp_field_vec;
+        f->meg_field_grad  = FwdCompData::fwd_comp_field_grad;
         f->meg_client      = comp;
         f->meg_client_free = FwdCompData::fwd_free_comp_data;
     }
@@ -4783,36 +4914,7 @@ static int find_best_guess(float     *B,         /* The whitened data */
  * Thanks to the precomputed SVD everything is really simple
  */
 {
-    int    k,c;
-    double B2,Bm2,this_good,one;
-    int    best = -1;
-    float  good = 0.0;
-    DipoleForward* fwd;
-    int    ncomp;
-
-    B2 = mne_dot_vectors_3(B,B,nch);
-    for (k = 0; k < guess->nguess; k++) {
-        fwd = guess->guess_fwd[k];
-        if (fwd->nch == nch) {
-            ncomp = fwd->sing[2]/fwd->sing[0] > limit ? 3 : 2;
-            for (c = 0, Bm2 = 0.0; c < ncomp; c++) {
-                one = mne_dot_vectors_3(fwd->uu[c],B,nch);
-                Bm2 = Bm2 + one*one;
-            }
-            this_good = 1.0 - (B2 - Bm2)/B2;
-            if (this_good > good) {
-                best = k;
-                good = this_good;
-            }
-        }
-    }
-    if (best < 0) {
-        printf("No reasonable initial guess found.");
-        return FAIL;
-    }
-    *bestp = best;
-    *goodp = good;
-    return OK;
+    return guess->find_best_guesses(&B,1,nch,limit,bestp,goodp);
 }
 
 
@@ -5110,6 +5212,224 @@ int simplex_minimize(float **p,		                              /* The initial si
 }
 
 
+//*************************************************************************************************************
+// Levenberg-Marquardt refinement with analytic gradients
+
+static bool lm_available(DipoleFitData* fit)
+/*
+ * Do the current forward functions provide the derivatives?
+ */
+{
+    if (!fit->funcs)
+        return false;
+    if (fit->nmeg > 0 && !fit->funcs->meg_field_grad)
+        return false;
+    if (fit->neeg > 0 && !fit->funcs->eeg_pot_grad)
+        return false;
+    return true;
+}
+
+
+static int lm_residual_jacobian(DipoleFitData*   fit,     /* The fit data (user must be set) */
+                                float            *rd,     /* Dipole location */
+                                float            **fwd,   /* Work area for the fields (3 x nchan) */
+                                float            **grad,  /* Work area for the field derivatives (9 x nchan) */
+                                Eigen::VectorXd& e,       /* The residual */
+                                Eigen::MatrixXd& J)       /* Its derivatives with respect to rd */
+/*
+ * The dipole moment is eliminated by variable projection (Golub & Pereyra):
+ *
+ *   e = (I - P) B, P = G G^+, J_i = - (P_perp dG_i G^+ + (P_perp dG_i G^+)^T) B
+ *
+ * The column normalization and the omission of the pseudoradial component match fit_eval.
+ * If a component is omitted, P is the projector on the leading singular vectors and
+ * the coupling between the kept and the omitted singular vectors is added to its derivative.
+ */
+{
+    fitDipUser user = (fitDipUser)fit->user;
+    int        nch  = fit->nmeg+fit->neeg;
+    int        ncomp,i,j,p;
+    double     S;
+
+    Eigen::MatrixXd G(nch,3);
+    Eigen::MatrixXd dG(nch,3);
+    Eigen::Vector3d scales = Eigen::Vector3d::Ones();
+    Eigen::VectorXd B = Eigen::Map<Eigen::VectorXf>(user->B,nch).cast<double>();
+
+    if (DipoleFitData::compute_dipole_field_grad(fit,rd,TRUE,fwd,grad) == FAIL)
+        return FAIL;
+
+    for (j = 0; j < 3; j++)
+        for (p = 0; p < nch; p++)
+            G(p,j) = fwd[j][p];
+    if (fit->column_norm == COLUMN_NORM_LOC) {
+        S = G.norm();
+        if (S > 0.0)
+            scales.setConstant(3.0/S);
+    }
+    else if (fit->column_norm == COLUMN_NORM_COMP) {
+        for (j = 0; j < 3; j++) {
+            S = G.col(j).norm();
+            if (S > 0.0)
+                scales[j] = 1.0/S;
+        }
+    }
+    G = G*scales.asDiagonal();
+
+    Eigen::JacobiSVD<Eigen::MatrixXd> svd(G,Eigen::ComputeThinU | Eigen::ComputeThinV);
+    Eigen::VectorXd sing = svd.singularValues();
+    if (sing[0] <= 0.0)
+        return FAIL;
+    ncomp = sing[2]/sing[0] > user->limit ? 3 : 2;
+
+    const Eigen::MatrixXd& UU = svd.matrixU();
+    const Eigen::MatrixXd& VV = svd.matrixV();
+    Eigen::MatrixXd U  = UU.leftCols(ncomp);
+    Eigen::MatrixXd Gp = VV.leftCols(ncomp)*sing.head(ncomp).cwiseInverse().asDiagonal()*U.transpose();
+    Eigen::VectorXd q  = Gp*B;
+    Eigen::VectorXd UB = UU.transpose()*B;
+    Eigen::VectorXd Bc = B - UU*UB;          /* Component of B outside the range of G */
+    Eigen::VectorXd a;
+    double          c;
+
+    e = B - U*(U.transpose()*B);
+    J.resize(nch,3);
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++)
+            for (p = 0; p < nch; p++)
+                dG(p,j) = scales[j]*grad[3*j+i][p];
+        a = dG*q;
+        a -= UU*(UU.transpose()*a);
+        a += Gp.transpose()*(dG.transpose()*Bc);
+        for (j = 0; j < ncomp; j++)
+            for (p = ncomp; p < 3; p++) {
+                c = (sing[j]*UU.col(p).dot(dG*VV.col(j)) + sing[p]*UU.col(j).dot(dG*VV.col(p)))/(sing[j]*sing[j] - sing[p]*sing[p]);
+                a += c*(UB[j]*UU.col(p) + UB[p]*UU.col(j));
+            }
+        J.col(i) = -a;
+    }
+    return OK;
+}
+
+
+static int lm_minimize(DipoleFitData* fit,          /* The fit data (user must be set) */
+                       float          *rd,          /* Starting point on input, the result on output */
+                       float          ftol,         /* Relative convergence tolerance for the target function */
+                       float          atol,         /* Convergence tolerance for the dipole movement */
+                       int            max_eval,     /* Maximum number of forward evaluations */
+                       float          *fval,        /* Target function value at the result */
+                       int            *neval,       /* Number of forward evaluations (gradient evaluations included) */
+                       int            *niter,       /* Number of iterations */
+                       int            report)       /* Report each iteration? */
+/*
+ * Minimize the residual sum of squares over the dipole location.
+ * Each iteration costs one field+gradient evaluation and one or a few field evaluations,
+ * compared with the several dozen evaluations of a typical simplex search.
+ */
+{
+    int             nch    = fit->nmeg+fit->neeg;
+    float           **fwd  = ALLOC_CMATRIX_3(3,nch);
+    float           **grad = ALLOC_CMATRIX_3(9,nch);
+    double          lambda = 1e-3;
+    float           rd_try[3],f,f_try,f_prev;
+    int             result = OK;
+    bool            accepted;
+    int             j;
+    Eigen::VectorXd e;
+    Eigen::MatrixXd J;
+    Eigen::Matrix3d A,M;
+    Eigen::Vector3d g,delta = Eigen::Vector3d::Zero();
+
+    *niter = 0;
+    f = fit_eval(rd,3,fit);
+    *neval = 1;
+    for (;;) {
+        if (*neval >= max_eval) {
+            printf("Maximum number of evaluations exceeded.\n");
+            result = FAIL;
+            break;
+        }
+        if (lm_residual_jacobian(fit,rd,fwd,grad,e,J) == FAIL) {
+            result = FAIL;
+            break;
+        }
+        (*neval)++;
+        (*niter)++;
+        A = J.transpose()*J;
+        g = J.transpose()*e;
+        /*
+         * Increase the damping until the step decreases the residual
+         */
+        f_prev   = f;
+        accepted = false;
+        while (!accepted && *neval < max_eval && lambda < 1e10) {
+            M = A;
+            M.diagonal() += lambda*(A.diagonal().array() + 1e-12*A.trace()).matrix();
+            delta = -M.ldlt().solve(g);
+            for (j = 0; j < 3; j++)
+                rd_try[j] = rd[j] + delta[j];
+            f_try = fit_eval(rd_try,3,fit);
+            (*neval)++;
+            if (f_try < f) {
+                VEC_COPY_3(rd,rd_try);
+                f        = f_try;
+                lambda   = qMax(lambda/10.0,1e-10);
+                accepted = true;
+            }
+            else
+                lambda = 10.0*lambda;
+        }
+        if (report)
+            fprintf(stdout,"LM iter %d rd %7.2f %7.2f %7.2f fval %g lambda %g step %g\n",
+                    *niter,1000*rd[0],1000*rd[1],1000*rd[2],f,lambda,1000*delta.norm());
+        /*
+         * No downhill step left or converged. Running out of evaluations while searching for the step
+         * fails like running out of them at the start of an iteration.
+         */
+        if (!accepted) {
+            if (*neval >= max_eval) {
+                printf("Maximum number of evaluations exceeded.\n");
+                result = FAIL;
+            }
+            break;
+        }
+        if (delta.norm() < atol || 2.0*(f_prev-f) <= ftol*(f_prev+f))
+            break;
+    }
+    *fval = f;
+    FREE_CMATRIX_3(fwd);
+    FREE_CMATRIX_3(grad);
+    return result;
+}
+
+
+//*************************************************************************************************************
+
+int DipoleFitData::select_guesses(DipoleFitData* fit, GuessData* guess, float **B, int nB, int *best, float *good)
+{
+    int   nchan = fit->nmeg+fit->neeg;
+    float **work;
+    int   k,res = FAIL;
+
+    if (nB <= 0)
+        return OK;
+    work = ALLOC_CMATRIX_3(nB,nchan);
+    for (k = 0; k < nB; k++) {
+        memcpy(work[k],B[k],nchan*sizeof(float));
+        if (MneProjOp::mne_proj_op_proj_vector(fit->proj,work[k],nchan,TRUE) == FAIL)
+            goto out;
+        if (mne_whiten_one_data(work[k],work[k],nchan,fit->noise) == FAIL)
+            goto out;
+    }
+    res = guess->find_best_guesses(work,nB,nchan,FIT_LIMIT,best,good);
+
+out : {
+        FREE_CMATRIX_3(work);
+        return res;
+    }
+}
+
+
 //*************************************************************************************************************
 // fit_dipoles.c
 bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitting data */
@@ -5117,25 +5437,31 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
                     float         time,              /* Which time is it? */
                     float         *B,	            /* The field to fit */
                     int           verbose,
-                    ECD&          res               /* The fitted dipole */
+                    ECD&          res,              /* The fitted dipole */
+                    float         *rd_warm,         /* Optional starting location */
+                    int           best,             /* Precomputed best guess (-1 if not known) */
+                    float         good              /* Goodness of fit of the precomputed best guess */
                     )
 {
     float  **simplex       = NULL;	       /* The simplex */
     float  vals[4];			       /* Values at the vertices */
-    float  limit           = 0.2;	               /* (pseudo) radial component omission limit */
+    float  limit           = FIT_LIMIT;	       /* (pseudo) radial component omission limit */
     float  size            = 1e-2;	       /* Size of the initial simplex */
     float  ftol[]          = { 1e-2, 1e-2 };     /* Tolerances on the the two passes */
+    float  lm_ftol         = 1e-6;               /* Relative tolerance for the Levenberg-Marquardt iterations */
     float  atol[]          = { 0.2e-3, 0.2e-3 }; /* If dipole movement between two iterations is less than this,
                                                   we consider to have converged */
     int    ntol            = 2;
     int    max_eval        = 1000;	       /* Limit for fit function evaluations */
     int    report_interval = verbose ? 1 : -1;   /* How often to report the intermediate result */
 
-    int        best;
-    float      good,rd_guess[3],rd_final[3],Q[3],final_val;
+    float      rd_guess[3],rd_final[3],Q[3],final_val;
     fitDipUserRec user;
     int        k,p,neval,neval_tot,nchan,ncomp;
+    int        niter,niter_tot;
     int        fit_fail;
+    bool       use_lm;
+    float      warm_val;
 
     nchan = fit->nmeg+fit->neeg;
     user.fwd = NULL;
@@ -5148,7 +5474,7 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
     /*
    * Get the initial guess
    */
-    if (find_best_guess(B,nchan,guess,limit,&best,&good) < 0)
+    if (best < 0 && find_best_guess(B,nchan,guess,limit,&best,&good) < 0)
         goto bad;
 
 
@@ -5160,9 +5486,19 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
     fit->user  = &user;
 
     VEC_COPY_3(rd_guess,guess->rr[best]);
-    VEC_COPY_3(rd_final,guess->rr[best]);
+    if (rd_warm) {
+        /*
+         * Start from the neighboring solution instead if it explains the data at least as well
+         */
+        fit->funcs = fit->sphere_funcs;
+        warm_val = fit_eval(rd_warm,3,fit);
+        if (1.0 - warm_val/user.B2 >= good)
+            VEC_COPY_3(rd_guess,rd_warm);
+    }
+    VEC_COPY_3(rd_final,rd_guess);
 
     neval_tot = 0;
+    niter_tot = 0;
     fit_fail = FALSE;
     for (k = 0; k < ntol; k++) {
         /*
@@ -5173,6 +5509,23 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
         else
             fit->funcs = !fit->bemname.isEmpty() ? fit->bem_funcs : fit->sphere_funcs;
 
+        use_lm = fit->fit_method == FIT_METHOD_LM && lm_available(fit);
+        if (use_lm) {
+            if (lm_minimize(fit,rd_guess,lm_ftol,atol[k],max_eval,&final_val,&neval,&niter,verbose) != OK) {
+                if (k == 0)
+                    goto bad;
+                else {
+                    printf("\nWarning (t = %8.1f ms) : g = %6.1f %% final val = %7.3f (Levenberg-Marquardt)\n",
+                           1000*time,100*(1 - final_val/user.B2),final_val);
+                    fit_fail = TRUE;
+                }
+            }
+            VEC_COPY_3(rd_final,rd_guess);
+            neval_tot += neval;
+            niter_tot += niter;
+            continue;
+        }
+
         simplex = make_initial_dipole_simplex(rd_guess,size);
         for (p = 0; p < 4; p++)
             vals[p] = fit_eval(simplex[p],3,fit);
@@ -5224,6 +5577,8 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
         else
             res.nfree = nchan-3-ncomp;
         res.neval = neval_tot;
+        if (verbose && niter_tot > 0)
+            printf("t = %7.1f ms : %d Levenberg-Marquardt iterations, %d forward evaluations\n",1000*time,niter_tot,neval_tot);
     }
     else
         goto bad;
@@ -5339,3 +5694,65 @@ int DipoleFitData::compute_dipole_field(DipoleFitData* d, float *rd, int whiten,
 bad :
     return FAIL;
 }
+
+
+//*************************************************************************************************************
+
+int DipoleFitData::compute_dipole_field_grad(DipoleFitData* d, float *rd, int whiten, float **fwd, float **grad)
+/*
+ * Compute the field and its derivatives and take whitening and projection into account
+ */
+{
+    static float Qx[] = {1.0,0.0,0.0};
+    static float Qy[] = {0.0,1.0,0.0};
+    static float Qz[] = {0.0,0.0,1.0};
+    float *Q[] = { Qx, Qy, Qz };
+    int k;
+
+    if (!d->funcs)
+        goto bad;
+    /*
+   * Compute the fields and the derivatives for the three dipole orientations
+   */
+    if (d->nmeg > 0) {
+        if (!d->funcs->meg_field_grad) {
+            printf("MEG field derivatives are not available with this forward model.");
+            goto bad;
+        }
+        for (k = 0; k < 3; k++)
+            if (d->funcs->meg_field_grad(rd,Q[k],d->meg_coils,fwd[k],grad[3*k],grad[3*k+1],grad[3*k+2],d->funcs->meg_client) != OK)
+                goto bad;
+    }
+    if (d->neeg > 0) {
+        if (!d->funcs->eeg_pot_grad) {
+            printf("EEG potential derivatives are not available with this forward model.");
+            goto bad;
+        }
+        for (k = 0; k < 3; k++)
+            if (d->funcs->eeg_pot_grad(rd,Q[k],d->eeg_els,fwd[k]+d->nmeg,
+                                       grad[3*k]+d->nmeg,grad[3*k+1]+d->nmeg,grad[3*k+2]+d->nmeg,d->funcs->eeg_client) != OK)
+                goto bad;
+    }
+    /*
+   * Apply projection
+   */
+    for (k = 0; k < 3; k++)
+        if (MneProjOp::mne_proj_op_proj_vector(d->proj,fwd[k],d->nmeg+d->neeg,TRUE) == FAIL)
+            goto bad;
+    for (k = 0; k < 9; k++)
+        if (MneProjOp::mne_proj_op_proj_vector(d->proj,grad[k],d->nmeg+d->neeg,TRUE) == FAIL)
+            goto bad;
+    /*
+   * Whiten
+   */
+    if (d->noise && whiten) {
+        if (mne_whiten_data(fwd,fwd,3,d->nmeg+d->neeg,d->noise) == FAIL)
+            goto bad;
+        if (mne_whiten_data(grad,grad,9,d->nmeg+d->neeg,d->noise) == FAIL)
+            goto bad;
+    }
+    return OK;
+
+bad :
+    return FAIL;
+}
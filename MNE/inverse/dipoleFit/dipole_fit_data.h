@@ -71,6 +71,11 @@
 #define COLUMN_NORM_COMP 1	    /* Componentwise normalization */
 #define COLUMN_NORM_LOC  2	    /* Dipole locationwise normalization */
 
+#define FIT_METHOD_SIMPLEX 0	    /* Refine the best guess with the simplex method */
+#define FIT_METHOD_LM      1	    /* Refine the best guess with Levenberg-Marquardt using analytic gradients */
+
+#define FIT_LIMIT          0.2	    /* (pseudo) radial component omission limit */
+
 
 /*
  * These are the type definitions for dipole fitting
@@ -82,11 +87,13 @@ typedef void (*fitUserFreeFunc)(void *);
 typedef struct {
   fwdFieldFunc    meg_field;	    /* MEG forward calculation functions */
   fwdVecFieldFunc meg_vec_field;
+  fwdFieldGradFunc meg_field_grad;  /* MEG field and its derivatives with respect to the dipole location */
   void            *meg_client;	    /* Client data for MEG field computations */
   mneUserFreeFunc meg_client_free;
 
   fwdFieldFunc    eeg_pot;	    /* EEG forward calculation functions */
   fwdVecFieldFunc eeg_vec_pot;
+  fwdFieldGradFunc eeg_pot_grad;    /* EEG potential and its derivatives with respect to the dipole location */
   void            *eeg_client;	    /* Client data for EEG field computations */
   mneUserFreeFunc eeg_client_free;
 } *dipoleFitFuncs,dipoleFitFuncsRec;
@@ -211,8 +218,47 @@ public:
     * @param[in] B          The field to fit
     * @param[in] verbose
     * @param[in] res        The fitted dipole
+    * @param[in] rd_warm    Optional starting location, e.g., the solution of the neighboring time point.
+    *                       It is used instead of the best guess if it explains the data at least as well.
+    * @param[in] best       Index of the best guess if already known from select_guesses, -1 to search it here
+    * @param[in] good       Goodness of fit of the best guess if best is given
     */
-    static bool fit_one(DipoleFitData* fit, GuessData* guess, float time, float *B, int verbose, ECD& res);
+    static bool fit_one(DipoleFitData* fit, GuessData* guess, float time, float *B, int verbose, ECD& res, float *rd_warm = NULL, int best = -1, float good = 0.0);
+
+    //=========================================================================================================
+    /**
+    * Find the best initial guesses for a batch of time points with one pass over the guess fields.
+    * The data are projected and whitened into a work copy, B is not modified.
+    *
+    * @param[in] fit        Precomputed fitting data
+    * @param[in] guess      The initial guesses
+    * @param[in] B          The fields to fit, one time point per row
+    * @param[in] nB         Number of time points
+    * @param[out] best      Index of the best guess for each time point
+    * @param[out] good      Goodness of fit of the best guess for each time point
+    *
+    * @return OK or FAIL
+    */
+    static int select_guesses(DipoleFitData* fit, GuessData* guess, float **B, int nB, int *best, float *good);
+
+    //=========================================================================================================
+    /**
+    * Create a duplicate of the fitting data which can be used in fit_one concurrently with the original.
+    * Read-only parts are shared, the forward calculation clients and their work areas are duplicated.
+    *
+    * @param[in] d          The fitting data to duplicate
+    *
+    * @return the thread-local duplicate, to be released with free_dipole_fit_data_thread_duplicate
+    */
+    static DipoleFitData* create_dipole_fit_data_thread_duplicate(DipoleFitData* d);
+
+    //=========================================================================================================
+    /**
+    * Release a duplicate created with create_dipole_fit_data_thread_duplicate without touching the shared parts
+    *
+    * @param[in] d          The duplicate to release
+    */
+    static void free_dipole_fit_data_thread_duplicate(DipoleFitData* d);
 
 
 
@@ -220,6 +266,21 @@ public:
 
     static int compute_dipole_field(DipoleFitData* d, float *rd, int whiten, float **fwd);
 
+    //=========================================================================================================
+    /**
+    * Compute the field and its derivatives with respect to the dipole location and take whitening and
+    * projection into account
+    *
+    * @param[in] d          The fitting data
+    * @param[in] rd         The dipole location
+    * @param[in] whiten     Apply whitening?
+    * @param[out] fwd       The fields of the x, y, and z dipoles (3 x nchan)
+    * @param[out] grad      grad[3*j+i] is the derivative of fwd[j] with respect to rd[i] (9 x nchan)
+    *
+    * @return OK when successful, FAIL if the current forward functions do not provide gradients
+    */
+    static int compute_dipole_field_grad(DipoleFitData* d, float *rd, int whiten, float **fwd, float **grad);
+
     //============================= dipole_forward.c
 
     static DipoleForward* dipole_forward_one(DipoleFitData* d,
@@ -260,6 +321,7 @@ public:
       int               nave;               /**< How many averages does this correspond to? */
       MNELIB::MneProjOp*        proj;               /**< The projection operator to use */
       int               column_norm;        /**< What kind of column normalization to apply to the forward solution */
+      int               fit_method;         /**< Which optimizer refines the initial guess (FIT_METHOD_SIMPLEX or FIT_METHOD_LM) */
       int               fit_mag_dipoles;    /**< Fit magnetic dipoles? */
       void              *user;              /**< User data for anything we need */
       fitUserFreeFunc   user_free;          /**< Function to free the above */
@@ -139,6 +139,10 @@ void DipoleFitSettings::checkIntegrity()
         if (guess_exclude > 0)
             printf("Guess exclude    : %6.1f mm\n",1000*guess_exclude);
     }
+    if (!guess_fields_name.isEmpty())
+        printf("Guess fields     : %s\n",guess_fields_name.toUtf8().data());
+    if (guess_prune > 0.0)
+        printf("Guess pruning    : %.3f\n",guess_prune);
     printf("Data             : %s\n",measname.toUtf8().data());
     if (projnames.size() > 0) {
         printf("SSP sources      :\n");
@@ -162,6 +166,12 @@ void DipoleFitSettings::checkIntegrity()
     }
     if (fit_mag_dipoles)
         printf("Fit data with magnetic dipoles\n");
+    if (nthreads != 1)
+        printf("Fitting threads  : %d%s\n",nthreads,nthreads <= 0 ? " (all cores)" : "");
+    if (warm_start)
+        printf("Warm start from the preceding time point\n");
+    if (use_lm)
+        printf("Optimizer        : Levenberg-Marquardt\n");
     if (!dipname.isEmpty())
         printf("dip output      : %s\n",dipname.toUtf8().data());
     if (!bdipname.isEmpty())
@@ -236,7 +246,13 @@ void DipoleFitSettings::usage(char *name)
     printf("\t--exclude dist/mm Exclude points which are closer than this distance from the CM of the inner skull surface (default =  %6.1f mm).\n",1000*guess_exclude);
     printf("\t--mindist dist/mm Exclude points which are closer than this distance from the inner skull surface  (default = %6.1f mm).\n",1000*guess_mindist);
     printf("\t--grid    dist/mm Source space grid size (default = %6.1f mm).\n",1000*guess_grid);
+    printf("\t--guessfields name Read the precomputed guess fields from this file if they match the present setup.\n");
+    printf("\t                  Otherwise the fields are computed and saved to this file.\n");
+    printf("\t--guessprune corr Omit guesses whose field subspace correlation with a neighbor is at least corr (default = off).\n");
     printf("\t--magdip          Fit magnetic dipoles instead of current dipoles.\n");
+    printf("\t--threads n       Distribute the time points over n threads (0 = all cores, default = %d).\n",nthreads);
+    printf("\t--warmstart       Start each fit from the solution of the preceding time point.\n");
+    printf("\t--lm              Refine the guesses with Levenberg-Marquardt using analytic gradients instead of the simplex.\n");
     printf("\nOutput:\n\n");
     printf("\t--dip     name    xfit dip format output file name\n");
     printf("\t--bdip    name    xfit bdip format output file name\n");
@@ -371,6 +387,30 @@ bool DipoleFitSettings::check_args (int *argc,char **argv)
             }
             guess_grid = guess_grid/1000.0;
         }
+        else if (strcmp(argv[k],"--guessfields") == 0) {
+            found = 2;
+            if (k == *argc - 1) {
+                qCritical ("--guessfields: argument required.");
+                return false;
+            }
+            guess_fields_name = QString(argv[k+1]);
+        }
+        else if (strcmp(argv[k],"--guessprune") == 0) {
+            found = 2;
+            if (k == *argc - 1) {
+                qCritical ("--guessprune: argument required.");
+                return false;
+            }
+            if (sscanf(argv[k+1],"%f",&fval) != 1) {
+                qCritical ("Could not interpret the correlation limit.");
+                return false;
+            }
+            if (fval < 0.0 || fval > 1.0) {
+                qCritical ("The correlation limit should be between 0 and 1");
+                return false;
+            }
+            guess_prune = fval;
+        }
         else if (strcmp(argv[k],"--mri") == 0) {
             found = 2;
             if (k == *argc - 1) {
@@ -803,6 +843,25 @@ bool DipoleFitSettings::check_args (int *argc,char **argv)
             found = 1;
             verbose = true;
         }
+        else if (strcmp(argv[k],"--threads") == 0) {
+            found = 2;
+            if (k == *argc - 1) {
+                qCritical ("--threads: argument required.");
+                return false;
+            }
+            if (sscanf(argv[k+1],"%d",&nthreads) != 1) {
+                qCritical() << "Illegal number:" << argv[k+1];
+                return false;
+            }
+        }
+        else if (strcmp(argv[k],"--warmstart") == 0) {
+            found = 1;
+            warm_start = true;
+        }
+        else if (strcmp(argv[k],"--lm") == 0) {
+            found = 1;
+            use_lm = true;
+        }
         if (found) {
             for (int p = k; p < *argc-found; p++)
                 argv[p] = argv[p+found];
@@ -148,6 +148,8 @@ public:
     float guess_mindist = 0.010f;       /**< Minimum allowed distance to the surface */
     float guess_exclude = 0.020f;       /**< Exclude points closer than this to the origin */
     float guess_grid    = 0.010f;       /**< Grid spacing */
+    QString guess_fields_name;          /**< Read the precomputed guess fields from here, or save them here if not usable */
+    float guess_prune   = 0.0f;         /**< Drop guesses whose field subspace correlation with a neighbor is at least this (0 = keep all) */
 
     QString noisename;                  /**< Noise-covariance matrix */
     float grad_std     = 5e-13f;        /**< Standard deviations to be used if noise covariance is not specified */
@@ -169,6 +171,9 @@ public:
     bool  do_baseline  = false;         /**< Are both baseline limits set? */
     int   setno        = 1;             /**< Which data set */
     bool  verbose      = false;
+    int   nthreads     = 1;             /**< Threads used for fitting the time points (1 = serial, <= 0 = all cores) */
+    bool  warm_start   = false;         /**< Start each fit from the solution of the preceding time point */
+    bool  use_lm       = false;         /**< Refine the guesses with Levenberg-Marquardt instead of the simplex */
     mneFilterDefRec     filter;
     QStringList projnames;              /**< Projection file names */
     bool omit_data_proj = false;
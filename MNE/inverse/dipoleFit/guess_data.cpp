@@ -46,8 +46,14 @@
 
 #include <fiff/fiff_stream.h>
 #include <fiff/fiff_tag.h>
+#include <fiff/fiff_dir_node.h>
 
 #include <QFile>
+#include <QHash>
+#include <QList>
+
+#include <math.h>
+#include <string.h>
 
 
 //*************************************************************************************************************
@@ -88,6 +94,8 @@ using namespace INVERSELIB;
 #define Y_16 1
 #define Z_16 2
 
+#define GUESS_CHUNK 1024      /* How many guesses are scanned with one matrix product */
+
 
 #define VEC_COPY_16(to,from) {\
     (to)[X_16] = (from)[X_16];\
@@ -195,8 +203,10 @@ void fromIntEigenMatrix_16(const Eigen::MatrixXi& from_mat, int **&to_mat)
 
 GuessData::GuessData()
 : rr(NULL)
-, guess_fwd(NULL)
 , nguess(0)
+, guess_fields(NULL)
+, guess_sing(NULL)
+, nchan_fields(0)
 {
 
 }
@@ -212,6 +222,11 @@ GuessData::GuessData()
 //*************************************************************************************************************
 
 GuessData::GuessData(const QString &guessname, const QString &guess_surfname, float mindist, float exclude, float grid, DipoleFitData *f)
+: rr(NULL)
+, nguess(0)
+, guess_fields(NULL)
+, guess_sing(NULL)
+, nchan_fields(0)
 {
     MneSourceSpaceOld* *sp = NULL;
     int            nsp = 0;
@@ -219,7 +234,6 @@ GuessData::GuessData(const QString &guessname, const QString &guess_surfname, fl
     int            k,p;
     float          guessrad = 0.080;
     MneSourceSpaceOld* guesses = NULL;
-    dipoleFitFuncs orig;
 
     if (!guessname.isEmpty()) {
         /*
@@ -271,31 +285,11 @@ GuessData::GuessData(const QString &guessname, const QString &guess_surfname, fl
             p++;
         }
     delete guesses; guesses = NULL;
-
-    fprintf(stderr,"Go through all guess source locations...");
-    this->guess_fwd = MALLOC_16(this->nguess,DipoleForward*);
-    for (k = 0; k < this->nguess; k++)
-        this->guess_fwd[k] = NULL;
     /*
         * Compute the guesses using the sphere model for speed
         */
-    orig = f->funcs;
-    if (f->fit_mag_dipoles)
-        f->funcs = f->mag_dipole_funcs;
-    else
-        f->funcs = f->sphere_funcs;
-
-    for (k = 0; k < this->nguess; k++) {
-        if ((this->guess_fwd[k] = DipoleFitData::dipole_forward_one(f,this->rr[k],NULL)) == NULL)
-            goto bad;
-#ifdef DEBUG
-        sing = this->guess_fwd[k]->sing;
-        printf("%f %f %f\n",sing[0],sing[1],sing[2]);
-#endif
-    }
-    f->funcs = orig;
-
-    fprintf(stderr,"[done %d sources]\n",p);
+    if (!this->compute_guess_fields(f))
+        goto bad;
 
     return;
 //    return res;
@@ -313,6 +307,11 @@ bad : {
 //*************************************************************************************************************
 
 GuessData::GuessData(const QString &guessname, const QString &guess_surfname, float mindist, float exclude, float grid, DipoleFitData *f, char *guess_save_name)
+: rr(NULL)
+, nguess(0)
+, guess_fields(NULL)
+, guess_sing(NULL)
+, nchan_fields(0)
 {
     MneSourceSpaceOld* *sp = NULL;
     int             nsp = 0;
@@ -391,10 +390,6 @@ GuessData::GuessData(const QString &guessname, const QString &guess_surfname, fl
     if(guesses)
         delete guesses;
     guesses = NULL;
-
-    this->guess_fwd = MALLOC_16(this->nguess,DipoleForward*);
-    for (k = 0; k < this->nguess; k++)
-        this->guess_fwd[k] = NULL;
     /*
         * Compute the guesses using the sphere model for speed
         */
@@ -419,11 +414,8 @@ bad : {
 GuessData::~GuessData()
 {
     FREE_CMATRIX_16(rr);
-    if (guess_fwd) {
-        for (int k = 0; k < nguess; k++)
-            delete guess_fwd[k];
-        FREE_16(guess_fwd);
-    }
+    FREE_CMATRIX_16(guess_fields);
+    FREE_16(guess_sing);
     return;
 }
 
@@ -433,6 +425,8 @@ GuessData::~GuessData()
 bool GuessData::compute_guess_fields(DipoleFitData* f)
 {
     dipoleFitFuncs orig = NULL;
+    DipoleForward* fwd  = NULL;
+    int            k,c;
 
     if (!f) {
         qCritical("Data missing in compute_guess_fields");
@@ -443,24 +437,332 @@ bool GuessData::compute_guess_fields(DipoleFitData* f)
         return false;
     }
     printf("Go through all guess source locations...");
+    /*
+     * The whitened field basis of all guesses is kept in one contiguous matrix
+     */
+    FREE_CMATRIX_16(this->guess_fields);
+    FREE_16(this->guess_sing);
+    this->nchan_fields = f->nmeg+f->neeg;
+    this->guess_fields = ALLOC_CMATRIX_16(3*this->nguess,this->nchan_fields);
+    this->guess_sing   = MALLOC_16(3*this->nguess,float);
+
     orig = f->funcs;
     if (f->fit_mag_dipoles)
         f->funcs = f->mag_dipole_funcs;
     else
         f->funcs = f->sphere_funcs;
-    for (int k = 0; k < this->nguess; k++) {
-        if ((this->guess_fwd[k] = DipoleFitData::dipole_forward_one(f,this->rr[k],this->guess_fwd[k])) == NULL){
+    for (k = 0; k < this->nguess; k++) {
+        if ((fwd = DipoleFitData::dipole_forward_one(f,this->rr[k],fwd)) == NULL){
             if (orig)
                 f->funcs = orig;
             return false;
         }
+        for (c = 0; c < 3; c++) {
+            memcpy(this->guess_fields[3*k+c],fwd->uu[c],this->nchan_fields*sizeof(float));
+            this->guess_sing[3*k+c] = fwd->sing[c];
+        }
 #ifdef DEBUG
-        sing = this->guess_fwd[k]->sing;
-        printf("%f %f %f\n",sing[0],sing[1],sing[2]);
+        printf("%f %f %f\n",fwd->sing[0],fwd->sing[1],fwd->sing[2]);
 #endif
     }
+    delete fwd;
     f->funcs = orig;
     printf("[done %d sources]\n",this->nguess);
 
     return true;
 }
+
+
+//*************************************************************************************************************
+
+int GuessData::find_best_guesses(float **B, int nB, int nch, float limit, int *best, float *good) const
+{
+    typedef Matrix<float,Dynamic,Dynamic,RowMajor> RowMajorMatrixXf;
+    MatrixXf Bt(nch,nB);
+    MatrixXf P;
+    VectorXd B2(nB);
+    double   Bm2,this_good,one;
+    int      start,n,k,g,j,c,ncomp;
+
+    if (!this->guess_fields || nch != this->nchan_fields) {
+        printf("Guess fields are not available for %d channels.",nch);
+        return FAIL;
+    }
+    for (j = 0; j < nB; j++) {
+        Bt.col(j) = Map<VectorXf>(B[j],nch);
+        B2[j]     = Bt.col(j).squaredNorm();
+        best[j]   = -1;
+        good[j]   = 0.0;
+    }
+    Map<const RowMajorMatrixXf> G(this->guess_fields[0],3*this->nguess,nch);
+    /*
+     * Project all data vectors onto a chunk of guess fields at a time
+     */
+    for (start = 0; start < this->nguess; start += GUESS_CHUNK) {
+        n = qMin(GUESS_CHUNK,this->nguess-start);
+        P.noalias() = G.middleRows(3*start,3*n)*Bt;
+        for (k = 0; k < n; k++) {
+            g = start + k;
+            ncomp = this->guess_sing[3*g+2]/this->guess_sing[3*g] > limit ? 3 : 2;
+            for (j = 0; j < nB; j++) {
+                for (c = 0, Bm2 = 0.0; c < ncomp; c++) {
+                    one = P(3*k+c,j);
+                    Bm2 = Bm2 + one*one;
+                }
+                this_good = 1.0 - (B2[j] - Bm2)/B2[j];
+                if (this_good > good[j]) {
+                    best[j] = g;
+                    good[j] = this_good;
+                }
+            }
+        }
+    }
+    for (j = 0; j < nB; j++)
+        if (best[j] < 0) {
+            printf("No reasonable initial guess found.");
+            return FAIL;
+        }
+    return OK;
+}
+
+
+//*************************************************************************************************************
+
+static double guess_subspace_corr(const GuessData* guess, int k, int j, float limit)
+/*
+ * Mean squared cosine of the principal angles between the field subspaces of two guesses
+ */
+{
+    int    nk = guess->guess_sing[3*k+2]/guess->guess_sing[3*k] > limit ? 3 : 2;
+    int    nj = guess->guess_sing[3*j+2]/guess->guess_sing[3*j] > limit ? 3 : 2;
+    double sum = 0.0,one;
+    int    a,b,p;
+
+    for (a = 0; a < nk; a++)
+        for (b = 0; b < nj; b++) {
+            for (p = 0, one = 0.0; p < guess->nchan_fields; p++)
+                one += guess->guess_fields[3*k+a][p]*guess->guess_fields[3*j+b][p];
+            sum += one*one;
+        }
+    return sum/qMax(nk,nj);
+}
+
+
+static qint64 guess_cell_key(int ix, int iy, int iz)
+{
+    return ((qint64)(ix & 0x1FFFFF) << 42) | ((qint64)(iy & 0x1FFFFF) << 21) | (qint64)(iz & 0x1FFFFF);
+}
+
+
+int GuessData::prune_guesses(float dist, float maxcorr, float limit)
+{
+    QHash<qint64, QList<int> > cells;       /* Accepted guesses sorted into cubic cells of size dist */
+    int   *keep = NULL;
+    int   nkeep = 0;
+    int   k,j,c,ix,iy,iz,dx,dy,dz;
+    float dd,diff;
+    bool  accept;
+
+    if (!this->guess_fields || this->nguess == 0 || dist <= 0.0 || maxcorr <= 0.0)
+        return 0;
+    keep = MALLOC_16(this->nguess,int);
+    for (k = 0; k < this->nguess; k++) {
+        ix = (int)floor(this->rr[k][X_16]/dist);
+        iy = (int)floor(this->rr[k][Y_16]/dist);
+        iz = (int)floor(this->rr[k][Z_16]/dist);
+        accept = true;
+        for (dx = -1; dx <= 1 && accept; dx++)
+            for (dy = -1; dy <= 1 && accept; dy++)
+                for (dz = -1; dz <= 1 && accept; dz++) {
+                    const QList<int> neighbors = cells.value(guess_cell_key(ix+dx,iy+dy,iz+dz));
+                    for (j = 0; j < neighbors.size(); j++) {
+                        for (c = 0, dd = 0.0; c < 3; c++) {
+                            diff = this->rr[k][c] - this->rr[neighbors[j]][c];
+                            dd += diff*diff;
+                        }
+                        if (dd < dist*dist && guess_subspace_corr(this,k,neighbors[j],limit) >= maxcorr) {
+                            accept = false;
+                            break;
+                        }
+                    }
+                }
+        if (accept) {
+            cells[guess_cell_key(ix,iy,iz)].append(k);
+            keep[nkeep++] = k;
+        }
+    }
+    /*
+     * Pack the accepted guesses to the beginning of the arrays
+     */
+    for (j = 0; j < nkeep; j++) {
+        k = keep[j];
+        if (k == j)
+            continue;
+        VEC_COPY_16(this->rr[j],this->rr[k]);
+        memcpy(this->guess_fields[3*j],this->guess_fields[3*k],3*this->nchan_fields*sizeof(float));
+        for (c = 0; c < 3; c++)
+            this->guess_sing[3*j+c] = this->guess_sing[3*k+c];
+    }
+    FREE_16(keep);
+    k = this->nguess - nkeep;
+    this->nguess = nkeep;
+    printf("Pruned %d redundant guesses, %d remaining.\n",k,nkeep);
+    return k;
+}
+
+
+//*************************************************************************************************************
+
+bool GuessData::save_guess_fields(const QString& name, DipoleFitData* f, const QString& guessname, const QString& guess_surfname,
+                                  float mindist, float exclude, float grid, float prune) const
+{
+    typedef Matrix<float,Dynamic,Dynamic,RowMajor> RowMajorMatrixXf;
+    QFile            file(name);
+    FiffStream::SPtr stream;
+    int              nch = this->nchan_fields;
+    float            params[4] = { grid, mindist, exclude, prune };
+
+    if (!this->guess_fields || this->nguess == 0) {
+        qCritical("No guess fields to save.");
+        return false;
+    }
+    if ((stream = FiffStream::start_file(file)).isNull())
+        return false;
+    stream->start_block(FIFFB_MNE_DIPOLE_GUESSES);
+    stream->write_int(FIFF_MNE_COORD_FRAME,&f->coord_frame);
+    stream->write_float(FIFF_MNE_DIPOLE_GUESS_PARAMS,params,4);
+    stream->write_string(FIFF_MNE_DIPOLE_GUESS_SOURCE,guessname);
+    stream->write_string(FIFF_MNE_DIPOLE_GUESS_SURF,guess_surfname);
+    stream->write_int(FIFF_MNE_SOURCE_SPACE_NPOINTS,&this->nguess);
+    stream->write_int(FIFF_NCHAN,&nch);
+    stream->write_name_list(FIFF_MNE_CH_NAME_LIST,f->ch_names);
+    stream->write_float_matrix(FIFF_MNE_SOURCE_SPACE_POINTS,Map<const RowMajorMatrixXf>(this->rr[0],this->nguess,3));
+    stream->write_float_matrix(FIFF_MNE_DIPOLE_GUESS_FIELDS,Map<const RowMajorMatrixXf>(this->guess_fields[0],3*this->nguess,nch));
+    stream->write_float(FIFF_MNE_DIPOLE_GUESS_SING,this->guess_sing,3*this->nguess);
+    stream->end_block(FIFFB_MNE_DIPOLE_GUESSES);
+    stream->end_file();
+    stream->device()->close();
+    printf("Wrote %d guess fields to %s\n",this->nguess,name.toUtf8().constData());
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool GuessData::read_guess_fields(const QString& name, DipoleFitData* f, const QString& guessname, const QString& guess_surfname,
+                                  float mindist, float exclude, float grid, float prune)
+{
+    float            params[4] = { grid, mindist, exclude, prune };
+    QFile            file(name);
+    FiffStream::SPtr stream(new FiffStream(&file));
+    QList<FiffDirNode::SPtr> nodes;
+    FiffDirNode::SPtr node;
+    FiffTag::SPtr    t_pTag;
+    int              coord_frame,np,nch,c;
+    QStringList      names;
+    MatrixXf         tmp_rr;            /* Stored transposed: 3 x np */
+    MatrixXf         tmp_fields;        /* Stored transposed: nch x 3*np */
+    VectorXf         tmp_sing;
+    DipoleForward*   fwd = NULL;
+    dipoleFitFuncs   orig;
+    float            rd[3];
+
+    if (!file.exists())
+        return false;
+    if (!stream->open())
+        return false;
+    nodes = stream->dirtree()->dir_tree_find(FIFFB_MNE_DIPOLE_GUESSES);
+    if (nodes.size() == 0) {
+        printf("No guess fields in %s\n",name.toUtf8().constData());
+        goto bad;
+    }
+    node = nodes[0];
+    if (!node->find_tag(stream, FIFF_MNE_COORD_FRAME, t_pTag))
+        goto bad;
+    coord_frame = *t_pTag->toInt();
+    /*
+     * The guess grid depends on these parameters, a grid created with different ones is not reused
+     */
+    if (!node->find_tag(stream, FIFF_MNE_DIPOLE_GUESS_PARAMS, t_pTag) || t_pTag->size() != 4*(int)sizeof(float)) {
+        printf("No guess grid parameters in %s\n",name.toUtf8().constData());
+        goto bad;
+    }
+    for (c = 0; c < 4; c++)
+        if (fabs(t_pTag->toFloat()[c] - params[c]) > 1e-6) {
+            printf("The guess fields in %s were created with different grid parameters.\n",name.toUtf8().constData());
+            goto bad;
+        }
+    if (!node->find_tag(stream, FIFF_MNE_DIPOLE_GUESS_SOURCE, t_pTag) || t_pTag->toString() != guessname ||
+            !node->find_tag(stream, FIFF_MNE_DIPOLE_GUESS_SURF, t_pTag) || t_pTag->toString() != guess_surfname) {
+        printf("The guess fields in %s were created from a different source space or surface.\n",name.toUtf8().constData());
+        goto bad;
+    }
+    if (!node->find_tag(stream, FIFF_MNE_SOURCE_SPACE_NPOINTS, t_pTag))
+        goto bad;
+    np = *t_pTag->toInt();
+    if (!node->find_tag(stream, FIFF_NCHAN, t_pTag))
+        goto bad;
+    nch = *t_pTag->toInt();
+    if (!node->find_tag(stream, FIFF_MNE_CH_NAME_LIST, t_pTag))
+        goto bad;
+    names = FiffStream::split_name_list(t_pTag->toString());
+    if (coord_frame != f->coord_frame || nch != f->nmeg+f->neeg || names != f->ch_names) {
+        printf("The guess fields in %s do not match the present channels or coordinate frame.\n",name.toUtf8().constData());
+        goto bad;
+    }
+    if (!node->find_tag(stream, FIFF_MNE_SOURCE_SPACE_POINTS, t_pTag))
+        goto bad;
+    tmp_rr = t_pTag->toFloatMatrix();
+    if (!node->find_tag(stream, FIFF_MNE_DIPOLE_GUESS_FIELDS, t_pTag))
+        goto bad;
+    tmp_fields = t_pTag->toFloatMatrix();
+    if (!node->find_tag(stream, FIFF_MNE_DIPOLE_GUESS_SING, t_pTag))
+        goto bad;
+    tmp_sing = Map<VectorXf>(t_pTag->toFloat(),t_pTag->size()/sizeof(float));
+    stream->device()->close();
+    if (np <= 0 || tmp_rr.rows() != 3 || tmp_rr.cols() != np ||
+            tmp_fields.rows() != nch || tmp_fields.cols() != 3*np || tmp_sing.size() != 3*np) {
+        printf("Inconsistent guess field data in %s\n",name.toUtf8().constData());
+        return false;
+    }
+    /*
+     * The fields also depend on the noise covariance, projection, and model:
+     * recompute the first one to make sure they are still valid
+     */
+    for (c = 0; c < 3; c++)
+        rd[c] = tmp_rr(c,0);
+    orig = f->funcs;
+    f->funcs = f->fit_mag_dipoles ? f->mag_dipole_funcs : f->sphere_funcs;
+    fwd = DipoleFitData::dipole_forward_one(f,rd,NULL);
+    f->funcs = orig;
+    if (!fwd)
+        return false;
+    for (c = 0; c < 3; c++)
+        if (fabs(fwd->sing[c] - tmp_sing[c]) > 1e-3*fwd->sing[0]) {
+            printf("The guess fields in %s were computed with a different setup.\n",name.toUtf8().constData());
+            delete fwd;
+            return false;
+        }
+    delete fwd;
+    /*
+     * Everything is fine, install the data
+     */
+    FREE_CMATRIX_16(this->rr);
+    FREE_CMATRIX_16(this->guess_fields);
+    FREE_16(this->guess_sing);
+    this->nguess       = np;
+    this->nchan_fields = nch;
+    this->rr           = ALLOC_CMATRIX_16(np,3);
+    fromFloatEigenMatrix_16(tmp_rr.transpose(),this->rr);
+    this->guess_fields = ALLOC_CMATRIX_16(3*np,nch);
+    memcpy(this->guess_fields[0],tmp_fields.data(),3*np*nch*sizeof(float));
+    this->guess_sing   = MALLOC_16(3*np,float);
+    memcpy(this->guess_sing,tmp_sing.data(),3*np*sizeof(float));
+    printf("Read %d guess fields from %s\n",np,name.toUtf8().constData());
+    return true;
+
+bad : {
+        stream->device()->close();
+        return false;
+    }
+}
@@ -144,10 +144,79 @@ public:
     */
     bool compute_guess_fields(DipoleFitData* f);
 
+    //=========================================================================================================
+    /**
+    * Find the guesses which best explain a batch of whitened data vectors.
+    * The projections onto all guess fields are computed with a single matrix product per chunk of guesses.
+    *
+    * @param[in] B      The projected and whitened data, one vector per row
+    * @param[in] nB     Number of data vectors
+    * @param[in] nch    Number of channels in each data vector
+    * @param[in] limit  Pseudoradial component omission limit
+    * @param[out] best  Index of the best guess for each data vector
+    * @param[out] good  Goodness of fit of the best guess for each data vector
+    *
+    * @return OK when a reasonable guess was found for all data vectors, FAIL otherwise
+    */
+    int find_best_guesses(float **B, int nB, int nch, float limit, int *best, float *good) const;
+
+    //=========================================================================================================
+    /**
+    * Remove guesses whose field subspace is practically identical to that of an already accepted neighbor.
+    *
+    * @param[in] dist       Only guesses closer than this to each other are compared
+    * @param[in] maxcorr    Remove a guess if its subspace correlation with an accepted neighbor is at least this
+    * @param[in] limit      Pseudoradial component omission limit
+    *
+    * @return The number of guesses removed
+    */
+    int prune_guesses(float dist, float maxcorr, float limit);
+
+    //=========================================================================================================
+    /**
+    * Save the guess locations and their whitened fields to a fif file together with the parameters
+    * the guess grid was created with.
+    *
+    * @param[in] name           Name of the file to write
+    * @param[in] f              The fitting data the fields were computed with
+    * @param[in] guessname      Source space file the guesses were read from (empty for a grid)
+    * @param[in] guess_surfname Surface file bounding the grid (empty for the inner skull)
+    * @param[in] mindist        Minimum allowed distance to the surface
+    * @param[in] exclude        Exclude points closer than this to the origin
+    * @param[in] grid           Grid spacing
+    * @param[in] prune          Subspace correlation limit used by prune_guesses (0 = not pruned)
+    *
+    * @return true when successful
+    */
+    bool save_guess_fields(const QString& name, DipoleFitData* f, const QString& guessname, const QString& guess_surfname,
+                           float mindist, float exclude, float grid, float prune) const;
+
+    //=========================================================================================================
+    /**
+    * Read guess locations and fields saved with save_guess_fields.
+    * The fields are accepted only if the grid parameters, the channels and the coordinate frame agree with
+    * the present setup and the field of the first guess recomputed with the present setup matches the stored one.
+    *
+    * @param[in] name           Name of the file to read
+    * @param[in] f              The fitting data to check against
+    * @param[in] guessname      Source space file the guesses should come from (empty for a grid)
+    * @param[in] guess_surfname Surface file bounding the grid (empty for the inner skull)
+    * @param[in] mindist        Minimum allowed distance to the surface
+    * @param[in] exclude        Exclude points closer than this to the origin
+    * @param[in] grid           Grid spacing
+    * @param[in] prune          Subspace correlation limit for prune_guesses (0 = not pruned)
+    *
+    * @return true when the fields were read and are valid for f
+    */
+    bool read_guess_fields(const QString& name, DipoleFitData* f, const QString& guessname, const QString& guess_surfname,
+                           float mindist, float exclude, float grid, float prune);
+
 public:
     float          **rr;            /**< These are the guess dipole locations */
-    DipoleForward** guess_fwd;      /**< Forward solutions for the guesses */
     int            nguess;          /**< How many sources */
+    float          **guess_fields;  /**< Whitened field basis of the guesses (3*nguess x nchan_fields, contiguous), three orthonormal rows per guess */
+    float          *guess_sing;     /**< Singular values of the guess fields, three per guess */
+    int            nchan_fields;    /**< Number of channels in guess_fields */
 
 // ### OLD STRUCT ###
 //    typedef struct {
@@ -60,6 +60,22 @@
 #include <Eigen/Core>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtConcurrent>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define MNE_KERNEL_BLOCK 256    /**< Number of sources whose current components are combined in one pass */
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // USED NAMESPACES
@@ -78,6 +94,9 @@ using namespace INVERSELIB;
 MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, const QString method)
 : m_inverseOperator(p_inverseOperator)
 , inverseSetup(false)
+, m_bFactoredKernel(false)
+, m_bFloatKernel(false)
+, m_bPickNormal(false)
 {
     this->setRegularization(lambda);
     this->setMethod(method);
@@ -88,6 +107,9 @@ MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lamb
 MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, bool dSPM, bool sLORETA)
 : m_inverseOperator(p_inverseOperator)
 , inverseSetup(false)
+, m_bFactoredKernel(false)
+, m_bFloatKernel(false)
+, m_bPickNormal(false)
 {
     this->setRegularization(lambda);
     this->setMethod(dSPM, sLORETA);
@@ -201,32 +223,14 @@ MNESourceEstimate MinimumNorm::calculateInverse(const MatrixXd &data, float tmin
         return MNESourceEstimate();
     }
 
-    MatrixXd sol = K * data; //apply imaging kernel
-
-    if (inv.source_ori == FIFFV_MNE_FREE_ORI)
-    {
-        printf("combining the current components...");
-        MatrixXd sol1(sol.rows()/3,sol.cols());
-        for(qint32 i = 0; i < sol.cols(); ++i)
-        {
-            VectorXd* tmp = MNEMath::combine_xyz(sol.block(0,i,sol.rows(),1));
-            sol1.block(0,i,sol.rows()/3,1) = tmp->cwiseSqrt();
-            delete tmp;
-        }
-        sol.resize(sol1.rows(),sol1.cols());
-        sol = sol1;
-    }
+    MatrixXd sol;
+    if(!applyKernel(data, sol))
+        return MNESourceEstimate();
 
     if (m_bdSPM)
-    {
         printf("(dSPM)...");
-        sol = inv.noisenorm*sol;
-    }
     else if (m_bsLORETA)
-    {
         printf("(sLORETA)...");
-        sol = inv.noisenorm*sol;
-    }
     printf("[done]\n");
 
     //Results
@@ -242,6 +246,180 @@ MNESourceEstimate MinimumNorm::calculateInverse(const MatrixXd &data, float tmin
 }
 
 
+//*************************************************************************************************************
+
+template<typename T>
+void MinimumNorm::applyKernelRows(const Matrix<T, Dynamic, Dynamic> &kernel,
+                                  const Matrix<T, Dynamic, Dynamic> &data,
+                                  qint32 nComp,
+                                  const Matrix<T, Dynamic, 1> &noiseNorm,
+                                  qint32 first,
+                                  qint32 last,
+                                  Matrix<T, Dynamic, Dynamic> &block,
+                                  Matrix<T, Dynamic, Dynamic> &sol)
+{
+    qint32 nSamples = data.cols();
+    bool bNoiseNorm = noiseNorm.size() == sol.rows();
+
+    if(nComp == 1)
+    {
+        sol.middleRows(first, last-first).noalias() = kernel.middleRows(first, last-first) * data;
+        if(bNoiseNorm)
+            sol.middleRows(first, last-first).array().colwise() *= noiseNorm.segment(first, last-first).array();
+        return;
+    }
+
+    //
+    //   Combine the current components block wise -> the full 3*nsources x nsamples solution is never stored
+    //
+    if(block.rows() != 3*MNE_KERNEL_BLOCK || block.cols() != nSamples)
+        block.resize(3*MNE_KERNEL_BLOCK, nSamples);
+
+    for(qint32 s = first; s < last; s += MNE_KERNEL_BLOCK)
+    {
+        qint32 n = last - s < MNE_KERNEL_BLOCK ? last - s : MNE_KERNEL_BLOCK;
+
+        block.topRows(3*n).noalias() = kernel.middleRows(3*s, 3*n) * data;
+
+        for(qint32 t = 0; t < nSamples; ++t)
+        {
+            for(qint32 i = 0; i < n; ++i)
+            {
+                T v = std::sqrt(block(3*i,t)*block(3*i,t)
+                                + block(3*i+1,t)*block(3*i+1,t)
+                                + block(3*i+2,t)*block(3*i+2,t));
+                sol(s+i,t) = bNoiseNorm ? noiseNorm[s+i]*v : v;
+            }
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+bool MinimumNorm::applyKernel(const MatrixXd &data, MatrixXd &sol) const
+{
+    if(!inverseSetup)
+    {
+        qWarning("Inverse not setup -> call doInverseSetup first!");
+        return false;
+    }
+
+    //
+    //   Factored kernel: project the data onto the rank of the inverse first
+    //
+    MatrixXd t_matProj;
+    const MatrixXd* t_pKernel = &K;
+    const MatrixXd* t_pData = &data;
+    if(m_bFactoredKernel)
+    {
+        t_matProj.noalias() = m_matKernelRight * data;
+        t_pKernel = &m_matKernelLeft;
+        t_pData = &t_matProj;
+    }
+
+    qint32 nComp = (inv.source_ori == FIFFV_MNE_FREE_ORI && !m_bPickNormal) ? 3 : 1;
+    qint32 nSources = t_pKernel->rows() / nComp;
+
+    if((m_bdSPM || m_bsLORETA) && m_vecNoiseNorm.size() != nSources)
+    {
+        qWarning("MinimumNorm::applyKernel - %d noise normalization factors do not match %d sources!", (int)m_vecNoiseNorm.size(), nSources);
+        return false;
+    }
+
+    sol.resize(nSources, data.cols());
+
+    MatrixXd t_matBlock;
+    applyKernelRows(*t_pKernel, *t_pData, nComp, m_vecNoiseNorm, 0, nSources, t_matBlock, sol);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool MinimumNorm::applyKernel(const MatrixXf &data, MatrixXf &sol, qint32 numThreads) const
+{
+    FloatKernelWorkspace t_workspace;
+    return applyKernel(data, sol, numThreads, t_workspace);
+}
+
+
+//*************************************************************************************************************
+
+bool MinimumNorm::applyKernel(const MatrixXf &data, MatrixXf &sol, qint32 numThreads, FloatKernelWorkspace &workspace) const
+{
+    if(!inverseSetup || !m_bFloatKernel)
+    {
+        qWarning("Float inverse not setup -> call setFloatKernel(true) and doInverseSetup first!");
+        return false;
+    }
+
+    const MatrixXf* t_pKernel = &m_matKernelFloat;
+    const MatrixXf* t_pData = &data;
+    if(m_bFactoredKernel)
+    {
+        workspace.matProj.noalias() = m_matKernelRightFloat * data;
+        t_pData = &workspace.matProj;
+    }
+
+    qint32 nComp = (inv.source_ori == FIFFV_MNE_FREE_ORI && !m_bPickNormal) ? 3 : 1;
+    qint32 nSources = t_pKernel->rows() / nComp;
+
+    if((m_bdSPM || m_bsLORETA) && m_vecNoiseNormFloat.size() != nSources)
+    {
+        qWarning("MinimumNorm::applyKernel - %d noise normalization factors do not match %d sources!", (int)m_vecNoiseNormFloat.size(), nSources);
+        return false;
+    }
+
+    sol.resize(nSources, data.cols());
+
+    if(numThreads <= 1 || nSources < 2*MNE_KERNEL_BLOCK)
+        numThreads = 1;
+
+    if(workspace.matBlocks.size() < numThreads)
+        workspace.matBlocks.resize(numThreads);
+
+    if(numThreads == 1)
+    {
+        applyKernelRows(*t_pKernel, *t_pData, nComp, m_vecNoiseNormFloat, 0, nSources, workspace.matBlocks[0], sol);
+        return true;
+    }
+
+    //
+    //   Split the source rows across the threads -> every job writes its own rows of sol
+    //
+    qint32 t_iRowsPerJob = (nSources + numThreads - 1) / numThreads;
+
+    QList<KernelRowJob> t_qListJobs;
+    for(qint32 first = 0; first < nSources; first += t_iRowsPerJob)
+    {
+        KernelRowJob job;
+        job.kernel = t_pKernel;
+        job.data = t_pData;
+        job.noiseNorm = &m_vecNoiseNormFloat;
+        job.nComp = nComp;
+        job.first = first;
+        job.last = first + t_iRowsPerJob < nSources ? first + t_iRowsPerJob : nSources;
+        job.block = &workspace.matBlocks[t_qListJobs.size()];
+        job.sol = &sol;
+        t_qListJobs.append(job);
+    }
+
+    QtConcurrent::blockingMap(t_qListJobs, applyKernelRowJob);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void MinimumNorm::applyKernelRowJob(KernelRowJob &job)
+{
+    applyKernelRows(*job.kernel, *job.data, job.nComp, *job.noiseNorm, job.first, job.last, *job.block, *job.sol);
+}
+
+
 //*************************************************************************************************************
 
 void MinimumNorm::doInverseSetup(qint32 nave, bool pick_normal)
@@ -251,10 +429,47 @@ void MinimumNorm::doInverseSetup(qint32 nave, bool pick_normal)
     //
     inv = m_inverseOperator.prepare_inverse_operator(nave, m_fLambda, m_bdSPM, m_bsLORETA);
 
+    //The regularization may have changed -> cached kernel factors are stale
+    inv.clear_kernel_cache();
+
     printf("Computing inverse...");
-    inv.assemble_kernel(label, m_sMethod, pick_normal, K, noise_norm, vertno);
+    if(m_bFactoredKernel)
+    {
+        K.resize(0,0);
+        inv.assemble_kernel_factors(label, m_sMethod, pick_normal, m_matKernelLeft, m_matKernelRight, noise_norm, vertno);
+
+        std::cout << "K " << m_matKernelLeft.rows() << " x " << m_matKernelLeft.cols() << " * " << m_matKernelRight.rows() << " x " << m_matKernelRight.cols() << std::endl;
+    }
+    else
+    {
+        m_matKernelLeft.resize(0,0);
+        m_matKernelRight.resize(0,0);
+        inv.assemble_kernel(label, m_sMethod, pick_normal, K, noise_norm, vertno);
+
+        std::cout << "K " << K.rows() << " x " << K.cols() << std::endl;
+    }
+
+    m_bPickNormal = pick_normal;
 
-    std::cout << "K " << K.rows() << " x " << K.cols() << std::endl;
+    //The noise normalization is diagonal
+    if(noise_norm.rows() > 0)
+        m_vecNoiseNorm = VectorXd(noise_norm.diagonal());
+    else
+        m_vecNoiseNorm.resize(0);
+
+    //Single precision copies for the real-time path
+    if(m_bFloatKernel)
+    {
+        m_matKernelFloat = m_bFactoredKernel ? m_matKernelLeft.cast<float>() : K.cast<float>();
+        m_matKernelRightFloat = m_matKernelRight.cast<float>();
+        m_vecNoiseNormFloat = m_vecNoiseNorm.cast<float>();
+    }
+    else
+    {
+        m_matKernelFloat.resize(0,0);
+        m_matKernelRightFloat.resize(0,0);
+        m_vecNoiseNormFloat.resize(0);
+    }
 
     inverseSetup = true;
 }
@@ -48,6 +48,7 @@
 #include <fs/label.h>
 
 #include <QSharedPointer>
+#include <QVector>
 
 
 //*************************************************************************************************************
@@ -85,6 +86,17 @@ public:
     typedef QSharedPointer<MinimumNorm> SPtr;             /**< Shared pointer type for MinimumNorm. */
     typedef QSharedPointer<const MinimumNorm> ConstSPtr;  /**< Const shared pointer type for MinimumNorm. */
 
+    //=========================================================================================================
+    /**
+    * Buffers of the single precision applyKernel. They are only reallocated when the block size or the number
+    * of threads changes.
+    */
+    struct FloatKernelWorkspace
+    {
+        MatrixXf matProj;               /**< Data projected by the right kernel factor */
+        QVector<MatrixXf> matBlocks;    /**< Current components of one kernel block, one buffer per thread */
+    };
+
     //=========================================================================================================
     /**
     * Constructs minimum norm inverse algorithm
@@ -127,8 +139,68 @@ public:
 
     virtual MNESourceEstimate calculateInverse(const MatrixXd &data, float tmin, float tstep) const;
 
+    //=========================================================================================================
+    /**
+    * Applies the imaging kernel to a data block. The xyz combination of free orientations and the dSPM/sLORETA
+    * noise normalization are done in the same pass over the kernel rows. sol is only reallocated when its size
+    * does not match, so a caller which reuses sol does not allocate per data block.
+    *
+    * @param[in] data       Data block (nchan x nsamples), channels picked as in the inverse operator.
+    * @param[out] sol       The source values (nsources x nsamples).
+    *
+    * @return true when successful, false otherwise
+    */
+    bool applyKernel(const MatrixXd &data, MatrixXd &sol) const;
+
+    //=========================================================================================================
+    /**
+    * Single precision version of applyKernel for the real-time path. Requires setFloatKernel(true) before
+    * doInverseSetup. The source rows are split across numThreads threads. The intermediate buffers are
+    * allocated per call, use the workspace version to reuse them across data blocks.
+    *
+    * @param[in] data       Data block (nchan x nsamples), channels picked as in the inverse operator.
+    * @param[out] sol       The source values (nsources x nsamples).
+    * @param[in] numThreads Number of threads the source rows are split across.
+    *
+    * @return true when successful, false otherwise
+    */
+    bool applyKernel(const MatrixXf &data, MatrixXf &sol, qint32 numThreads = 1) const;
+
+    //=========================================================================================================
+    /**
+    * Single precision applyKernel which keeps its intermediate buffers in a caller owned workspace. Apart from
+    * the small per call job list nothing is allocated as long as the block size stays the same.
+    *
+    * @param[in] data           Data block (nchan x nsamples), channels picked as in the inverse operator.
+    * @param[out] sol           The source values (nsources x nsamples).
+    * @param[in] numThreads     Number of threads the source rows are split across.
+    * @param[in, out] workspace The reused intermediate buffers.
+    *
+    * @return true when successful, false otherwise
+    */
+    bool applyKernel(const MatrixXf &data, MatrixXf &sol, qint32 numThreads, FloatKernelWorkspace &workspace) const;
+
     virtual void doInverseSetup(qint32 nave, bool pick_normal = false);
 
+    //=========================================================================================================
+    /**
+    * Keep the imaging kernel factored as K = K_left * K_right (inner dimension = rank of the regularized
+    * inverse, at most the number of channels) instead of assembling the dense kernel. Pays off when the rank is
+    * clearly smaller than the number of channels. Takes effect with the next doInverseSetup.
+    *
+    * @param[in] factored   Whether to keep the kernel factored.
+    */
+    inline void setFactoredKernel(bool factored);
+
+    //=========================================================================================================
+    /**
+    * Keep a single precision copy of the imaging kernel for the float applyKernel. Takes effect with the next
+    * doInverseSetup.
+    *
+    * @param[in] useFloat   Whether to prepare the single precision kernel.
+    */
+    inline void setFloatKernel(bool useFloat);
+
 
     virtual const char* getName() const;
 
@@ -167,9 +239,63 @@ public:
     */
     void setRegularization(float lambda);
 
+    //=========================================================================================================
+    /**
+    * Returns the dense imaging kernel. It is empty when the factored kernel is used.
+    *
+    * @return the imaging kernel
+    */
     inline MatrixXd& getKernel();
 
 private:
+    //=========================================================================================================
+    /**
+    * Rows of the kernel which are applied by one thread.
+    */
+    struct KernelRowJob
+    {
+        const MatrixXf* kernel;     /**< Kernel or left kernel factor */
+        const MatrixXf* data;       /**< Data or data projected by the right kernel factor */
+        const VectorXf* noiseNorm;  /**< Noise normalization diagonal */
+        qint32 nComp;               /**< Current components per source */
+        qint32 first;               /**< First source */
+        qint32 last;                /**< One past the last source */
+        MatrixXf* block;            /**< Current component buffer of this job */
+        MatrixXf* sol;              /**< Solution the rows are written to */
+    };
+
+    //=========================================================================================================
+    /**
+    * Applies the kernel rows of one job.
+    *
+    * @param[in, out] job   The job.
+    */
+    static void applyKernelRowJob(KernelRowJob &job);
+
+    //=========================================================================================================
+    /**
+    * Applies the kernel rows of the sources [first, last), combines the current components and applies the
+    * noise normalization.
+    *
+    * @param[in] kernel     Kernel (nsources*nComp x nchan) or left kernel factor.
+    * @param[in] data       Data or data projected by the right kernel factor.
+    * @param[in] nComp      Current components per source (1 or 3).
+    * @param[in] noiseNorm  Noise normalization diagonal, empty when not used.
+    * @param[in] first      First source.
+    * @param[in] last       One past the last source.
+    * @param[in, out] block Buffer for the current components of one kernel block, resized when needed.
+    * @param[out] sol       Solution with nsources rows, only the rows [first, last) are written.
+    */
+    template<typename T>
+    static void applyKernelRows(const Matrix<T, Dynamic, Dynamic> &kernel,
+                                const Matrix<T, Dynamic, Dynamic> &data,
+                                qint32 nComp,
+                                const Matrix<T, Dynamic, 1> &noiseNorm,
+                                qint32 first,
+                                qint32 last,
+                                Matrix<T, Dynamic, Dynamic> &block,
+                                Matrix<T, Dynamic, Dynamic> &sol);
+
     MNEInverseOperator m_inverseOperator;   /**< The inverse operator */
     float m_fLambda;                        /**< Regularization parameter */
     QString m_sMethod;                      /**< Selected method */
@@ -183,6 +309,16 @@ private:
     Label label;                            /**< The corresponding labels */
     MatrixXd K;                             /**< Imaging kernel */
 
+    bool m_bFactoredKernel;                 /**< Keep the kernel factored */
+    bool m_bFloatKernel;                    /**< Keep a single precision kernel */
+    bool m_bPickNormal;                     /**< Only the normal component was picked */
+    MatrixXd m_matKernelLeft;               /**< Left kernel factor (weighted eigen leads) */
+    MatrixXd m_matKernelRight;              /**< Right kernel factor (nrank x nchan) */
+    VectorXd m_vecNoiseNorm;                /**< Diagonal of the noise normalization, empty for MNE */
+    MatrixXf m_matKernelFloat;              /**< Single precision kernel or left kernel factor */
+    MatrixXf m_matKernelRightFloat;         /**< Single precision right kernel factor */
+    VectorXf m_vecNoiseNormFloat;           /**< Single precision noise normalization */
+
 };
 
 //*************************************************************************************************************
@@ -196,6 +332,22 @@ inline MatrixXd& MinimumNorm::getKernel()
 }
 
 
+//*************************************************************************************************************
+
+inline void MinimumNorm::setFactoredKernel(bool factored)
+{
+    m_bFactoredKernel = factored;
+}
+
+
+//*************************************************************************************************************
+
+inline void MinimumNorm::setFloatKernel(bool useFloat)
+{
+    m_bFloatKernel = useFloat;
+}
+
+
 //*************************************************************************************************************
 
 inline MNEInverseOperator& MinimumNorm::getPreparedInverseOperator()
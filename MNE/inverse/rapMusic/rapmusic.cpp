@@ -46,6 +46,15 @@
 #endif
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QList>
+#include <QtConcurrent>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // USED NAMESPACES
@@ -54,6 +63,116 @@
 using namespace INVERSELIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define PAIR_BLOCK_SIZE 128     /**< Number of grid points per block of the pair correlation scan */
+#define PAIR_RANK_RTOL  1e-6    /**< Singular values of a pair below PAIR_RANK_RTOL times the largest one are not resolved by the eigenvalues of G^T*G */
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Subspace correlation of one gain matrix pair G = [G_1 G_2] given K = G^T*G and Z = (G^T*U_B)*(G^T*U_B)^T.
+* With K = V*S^2*V^T the left singular vectors of G are U_A = G*V*S^-1, hence the correlation is the square root
+* of the largest eigenvalue of S^-1*V^T*Z*V*S^-1, restricted to the rank of G as in RapMusic::subcorr.
+*
+* The eigenvalues of K carry an absolute error of about eps*S_max^2, so the singular values of a rank deficient G,
+* e.g., of the pairs of a grid point with itself, come out at about sqrt(eps)*S_max instead of zero. Next to the
+* absolute cut of RapMusic::getRank, singular values below PAIR_RANK_RTOL*S_max are therefore treated as zero.
+*/
+static double pairSubcorr(const RapMusic::Matrix6T& p_matK, const RapMusic::Matrix6T& p_matZ)
+{
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, 6, 6> MatrixMax6T;
+
+    Eigen::SelfAdjointEigenSolver<RapMusic::Matrix6T> t_eigK(p_matK);
+
+    //Eigenvalues are in ascending order -> reverse to get the order of the singular values
+    RapMusic::Vector6T t_vecSing;
+    RapMusic::Matrix6T t_matV;
+    for(int k = 0; k < 6; ++k)
+    {
+        double t_dLambda = t_eigK.eigenvalues()(5-k);
+        t_vecSing(k) = t_dLambda > 0 ? sqrt(t_dLambda) : 0;
+        t_matV.col(k) = t_eigK.eigenvectors().col(5-k);
+    }
+
+    //Rank criterion of RapMusic::getRank, relative to the largest singular value as well
+    double t_dCut = qMax(0.00001, PAIR_RANK_RTOL*t_vecSing(0));
+    int t_iRank;
+    for(t_iRank = 5; t_iRank > 0; t_iRank--)
+        if (t_vecSing(t_iRank) > t_dCut)
+            break;
+    t_iRank++;
+
+    RapMusic::Matrix6T t_matT = t_matV.transpose()*p_matZ*t_matV;
+    MatrixMax6T t_matC = t_matT.topLeftCorner(t_iRank, t_iRank);
+    for(int a = 0; a < t_iRank; ++a)
+        for(int b = 0; b < t_iRank; ++b)
+            t_matC(a,b) /= t_vecSing(a)*t_vecSing(b);
+
+    Eigen::SelfAdjointEigenSolver<MatrixMax6T> t_eigC(t_matC, Eigen::EigenvaluesOnly);
+    double t_dMax = t_eigC.eigenvalues()(t_iRank-1);
+
+    return t_dMax > 0 ? sqrt(t_dMax) : 0;
+}
+
+
+//=============================================================================================================
+/**
+* Two blocks of grid points whose pair correlations are computed together
+*/
+class RapMusicPairBlock
+{
+public:
+    const RapMusic::MatrixXT* m_pMatProjLeadField;  /**< The projected Lead Field */
+    const RapMusic::MatrixXT* m_pMatH;              /**< Projected Lead Field times U_B (3*grid points x rank) */
+    const RapMusic::MatrixXT* m_pMatGramDiag;       /**< 3 x 3 diagonal blocks of G^T*G, side by side */
+    const RapMusic::MatrixXT* m_pMatCorDiag;        /**< 3 x 3 diagonal blocks of H*H^T, side by side */
+    int m_iNumPoints;                               /**< Number of grid points */
+    int m_iStart1, m_iNum1;                         /**< First block of grid points */
+    int m_iStart2, m_iNum2;                         /**< Second block of grid points (m_iStart2 >= m_iStart1) */
+    double* m_pRoh;                                 /**< The correlations, indexed like the pair index combinations */
+
+    void correlate()
+    {
+        RapMusic::MatrixXT t_matGram = m_pMatProjLeadField->middleCols(3*m_iStart1, 3*m_iNum1).transpose()
+                                       * m_pMatProjLeadField->middleCols(3*m_iStart2, 3*m_iNum2);
+        RapMusic::MatrixXT t_matCor = m_pMatH->middleRows(3*m_iStart1, 3*m_iNum1)
+                                      * m_pMatH->middleRows(3*m_iStart2, 3*m_iNum2).transpose();
+        RapMusic::Matrix6T t_matK, t_matZ;
+
+        for(int i = 0; i < m_iNum1; ++i)
+        {
+            int idx1 = m_iStart1 + i;
+            t_matK.block<3,3>(0,0) = m_pMatGramDiag->block<3,3>(0, 3*idx1);
+            t_matZ.block<3,3>(0,0) = m_pMatCorDiag->block<3,3>(0, 3*idx1);
+
+            for(int j = (m_iStart1 == m_iStart2 ? i : 0); j < m_iNum2; ++j)
+            {
+                int idx2 = m_iStart2 + j;
+                t_matK.block<3,3>(0,3) = t_matGram.block<3,3>(3*i, 3*j);
+                t_matK.block<3,3>(3,0) = t_matK.block<3,3>(0,3).transpose();
+                t_matK.block<3,3>(3,3) = m_pMatGramDiag->block<3,3>(0, 3*idx2);
+                t_matZ.block<3,3>(0,3) = t_matCor.block<3,3>(3*i, 3*j);
+                t_matZ.block<3,3>(3,0) = t_matZ.block<3,3>(0,3).transpose();
+                t_matZ.block<3,3>(3,3) = m_pMatCorDiag->block<3,3>(0, 3*idx2);
+
+                //Index of (idx1, idx2) in the pair index combinations -> inverse of RapMusic::getPointPair
+                int t_iIdx = idx1*m_iNumPoints - idx1*(idx1-1)/2 + (idx2-idx1);
+                m_pRoh[t_iIdx] = pairSubcorr(t_matK, t_matZ);
+            }
+        }
+    }
+};
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -70,6 +189,12 @@ RapMusic::RapMusic()
 , m_bIsInit(false)
 , m_iSamplesStcWindow(-1)
 , m_fStcOverlap(-1)
+, m_iStreamWindowSize(0)
+, m_iStreamRank(0)
+, m_iStreamNumIter(2)
+, m_iStreamWritePos(0)
+, m_iStreamNumSamples(0)
+, m_iStreamSinceRefresh(0)
 {
 }
 
@@ -87,6 +212,12 @@ RapMusic::RapMusic(MNEForwardSolution& p_pFwd, bool p_bSparsed, int p_iN, double
 , m_bIsInit(false)
 , m_iSamplesStcWindow(-1)
 , m_fStcOverlap(-1)
+, m_iStreamWindowSize(0)
+, m_iStreamRank(0)
+, m_iStreamNumIter(2)
+, m_iStreamWritePos(0)
+, m_iStreamNumSamples(0)
+, m_iStreamSinceRefresh(0)
 {
     //Init
     init(p_pFwd, p_bSparsed, p_iN, p_dThr);
@@ -237,22 +368,7 @@ MNESourceEstimate RapMusic::calculateInverse(const FiffEvoked &p_fiffEvoked, boo
         QList< DipolePair<double> > t_RapDipoles;
         calculateInverse(p_fiffEvoked.data, t_RapDipoles);
 
-        for(qint32 i = 0; i < t_RapDipoles.size(); ++i)
-        {
-            double dip1 = sqrt( pow(t_RapDipoles[i].m_Dipole1.phi_x(),2) +
-                                pow(t_RapDipoles[i].m_Dipole1.phi_y(),2) +
-                                pow(t_RapDipoles[i].m_Dipole1.phi_z(),2) ) * t_RapDipoles[i].m_vCorrelation;
-
-            double dip2 = sqrt( pow(t_RapDipoles[i].m_Dipole2.phi_x(),2) +
-                                pow(t_RapDipoles[i].m_Dipole2.phi_y(),2) +
-                                pow(t_RapDipoles[i].m_Dipole2.phi_z(),2) ) * t_RapDipoles[i].m_vCorrelation;
-
-            RowVectorXd dip1Time = RowVectorXd::Constant(p_fiffEvoked.data.cols(), dip1);
-            RowVectorXd dip2Time = RowVectorXd::Constant(p_fiffEvoked.data.cols(), dip2);
-
-            p_sourceEstimate.data.block(t_RapDipoles[i].m_iIdx1, 0, 1, p_fiffEvoked.data.cols()) = dip1Time;
-            p_sourceEstimate.data.block(t_RapDipoles[i].m_iIdx2, 0, 1, p_fiffEvoked.data.cols()) = dip2Time;
-        }
+        assignDipolePairs(t_RapDipoles, 0, p_fiffEvoked.data.cols(), p_sourceEstimate.data);
     }
     else
     {
@@ -296,23 +412,7 @@ MNESourceEstimate RapMusic::calculateInverse(const FiffEvoked &p_fiffEvoked, boo
             if(last)
                 stcWindowSize = p_sourceEstimate.data.cols() - curResultSample;
 
-            for(qint32 i = 0; i < t_RapDipoles.size(); ++i)
-            {
-                double dip1 = sqrt( pow(t_RapDipoles[i].m_Dipole1.phi_x(),2) +
-                                    pow(t_RapDipoles[i].m_Dipole1.phi_y(),2) +
-                                    pow(t_RapDipoles[i].m_Dipole1.phi_z(),2) ) * t_RapDipoles[i].m_vCorrelation;
-
-                double dip2 = sqrt( pow(t_RapDipoles[i].m_Dipole2.phi_x(),2) +
-                                    pow(t_RapDipoles[i].m_Dipole2.phi_y(),2) +
-                                    pow(t_RapDipoles[i].m_Dipole2.phi_z(),2) ) * t_RapDipoles[i].m_vCorrelation;
-
-                RowVectorXd dip1Time = RowVectorXd::Constant(stcWindowSize, dip1);
-                RowVectorXd dip2Time = RowVectorXd::Constant(stcWindowSize, dip2);
-
-                p_sourceEstimate.data.block(t_RapDipoles[i].m_iIdx1, curResultSample, 1, stcWindowSize) = dip1Time;
-                p_sourceEstimate.data.block(t_RapDipoles[i].m_iIdx2, curResultSample, 1, stcWindowSize) = dip2Time;
-
-            }
+            assignDipolePairs(t_RapDipoles, curResultSample, stcWindowSize, p_sourceEstimate.data);
 
             curResultSample += stcWindowSize;
 
@@ -343,38 +443,12 @@ MNESourceEstimate RapMusic::calculateInverse(const MatrixXd &data, float tmin, f
     //
     // Rap MUSIC Source estimate
     //
-    p_sourceEstimate.data = MatrixXd::Zero(m_ForwardSolution.nsource, data.cols());
-
-    //Results
-    p_sourceEstimate.vertices = VectorXi(m_ForwardSolution.src[0].vertno.size() + m_ForwardSolution.src[1].vertno.size());
-    p_sourceEstimate.vertices << m_ForwardSolution.src[0].vertno, m_ForwardSolution.src[1].vertno;
-
-    p_sourceEstimate.times = RowVectorXf::Zero(data.cols());
-    p_sourceEstimate.times[0] = tmin;
-    for(qint32 i = 1; i < p_sourceEstimate.times.size(); ++i)
-        p_sourceEstimate.times[i] = p_sourceEstimate.times[i-1] + tstep;
-    p_sourceEstimate.tmin = tmin;
-    p_sourceEstimate.tstep = tstep;
+    initSourceEstimate(data.cols(), tmin, tstep, p_sourceEstimate);
 
     QList< DipolePair<double> > t_RapDipoles;
     calculateInverse(data, t_RapDipoles);
 
-    for(qint32 i = 0; i < t_RapDipoles.size(); ++i)
-    {
-        double dip1 = sqrt( pow(t_RapDipoles[i].m_Dipole1.phi_x(),2) +
-                            pow(t_RapDipoles[i].m_Dipole1.phi_y(),2) +
-                            pow(t_RapDipoles[i].m_Dipole1.phi_z(),2) ) * t_RapDipoles[i].m_vCorrelation;
-
-        double dip2 = sqrt( pow(t_RapDipoles[i].m_Dipole2.phi_x(),2) +
-                            pow(t_RapDipoles[i].m_Dipole2.phi_y(),2) +
-                            pow(t_RapDipoles[i].m_Dipole2.phi_z(),2) ) * t_RapDipoles[i].m_vCorrelation;
-
-        RowVectorXd dip1Time = RowVectorXd::Constant(data.cols(), dip1);
-        RowVectorXd dip2Time = RowVectorXd::Constant(data.cols(), dip2);
-
-        p_sourceEstimate.data.block(t_RapDipoles[i].m_iIdx1, 0, 1, data.cols()) = dip1Time;
-        p_sourceEstimate.data.block(t_RapDipoles[i].m_iIdx2, 0, 1, data.cols()) = dip2Time;
-    }
+    assignDipolePairs(t_RapDipoles, 0, data.cols(), p_sourceEstimate.data);
 
     return p_sourceEstimate;
 }
@@ -415,9 +489,30 @@ MNESourceEstimate RapMusic::calculateInverse(const MatrixXd& p_matMeasurement, Q
     MatrixXT* t_pMatPhi_s = NULL;//(m_iNumChannels, m_iN < t_r ? m_iN : t_r);
     int t_r = calcPhi_s(/*(MatrixXT)*/p_matMeasurement, t_pMatPhi_s);
 
+    //Scan for the correlated sources
+    calcDipolePairs(*t_pMatPhi_s, t_r, p_RapDipoles);
+
+    end = clock();
+
+    float t_fElapsedTime = ( (float)(end-start) / (float)CLOCKS_PER_SEC ) * 1000.0f;
+    std::cout << "Total Time Elapsed: " << t_fElapsedTime << " ms" << std::endl << std::endl;
+
+    //garbage collecting
+    delete t_pMatPhi_s;
+
+    return p_SourceEstimate;
+}
+
+
+//*************************************************************************************************************
+
+void RapMusic::calcDipolePairs(const MatrixXT& p_matPhi_s, int p_iRank, QList< DipolePair<double> > &p_RapDipoles, bool p_bVerbose) const
+{
+    int t_r = p_iRank;
+
     int t_iMaxSearch = m_iN < t_r ? m_iN : t_r; //The smallest of Rank and Iterations
 
-    if (t_r < m_iN)
+    if (p_bVerbose && t_r < m_iN)
     {
         std::cout << "Warning: Rank " << t_r << " of the measurement data is smaller than the " << m_iN;
         std::cout << " sources to find." << std::endl;
@@ -450,18 +545,24 @@ MNESourceEstimate RapMusic::calculateInverse(const MatrixXd& p_matMeasurement, Q
 //    }
     p_RapDipoles.clear();
 
-    std::cout << "##### Calculation of RAP MUSIC started ######\n\n";
+    if(p_bVerbose)
+        std::cout << "##### Calculation of RAP MUSIC started ######\n\n";
 
-    MatrixXT t_matProj_Phi_s(t_matOrthProj.rows(), t_pMatPhi_s->cols());
+    MatrixXT t_matProj_Phi_s(t_matOrthProj.rows(), p_matPhi_s.cols());
     //new Version: Calculate projection before
     MatrixXT t_matProj_LeadField(m_ForwardSolution.sol->data.rows(), m_ForwardSolution.sol->data.cols());
+    //Factor Y of the orthogonal projector OrthProj = I - Y*A_k_1'
+    MatrixXT t_matOrthProjFactor;
 
     for(int r = 0; r < t_iMaxSearch ; ++r)
     {
-        t_matProj_Phi_s = t_matOrthProj*(*t_pMatPhi_s);
+        t_matProj_Phi_s = t_matOrthProj*p_matPhi_s;
 
-        //new Version: Calculating Projection before
-        t_matProj_LeadField = t_matOrthProj * m_ForwardSolution.sol->data;//Subtract the found sources from the current found source
+        //new Version: Calculating Projection before -> low rank update instead of the full m x m product
+        if(r == 0)
+            t_matProj_LeadField = m_ForwardSolution.sol->data;
+        else
+            t_matProj_LeadField = m_ForwardSolution.sol->data - t_matOrthProjFactor * (t_matA_k_1.adjoint() * m_ForwardSolution.sol->data);//Subtract the found sources from the current found source
 
         //###First Option###
         //Step 1: lt. Mosher 1998 -> Maybe tmp_Proj_Phi_S is already orthogonal -> so no SVD needed -> U_B = tmp_Proj_Phi_S;
@@ -478,28 +579,8 @@ MNESourceEstimate RapMusic::calculateInverse(const MatrixXd& p_matMeasurement, Q
         clock_t start_subcorr, end_subcorr;
         start_subcorr = clock();
 
-        //Multithreading correlation calculation
-        #ifdef _OPENMP
-        #pragma omp parallel num_threads(m_iMaxNumThreads)
-        #endif
-        {
-        #ifdef _OPENMP
-        #pragma omp for
-        #endif
-            for(int i = 0; i < m_iNumLeadFieldCombinations; i++)
-            {
-                //new Version: calculate matrix multiplication before
-                //Create Lead Field combinations -> It would be better to use a pointer construction, to increase performance
-                MatrixX6T t_matProj_G(t_matProj_LeadField.rows(),6);
-
-                int idx1 = m_ppPairIdxCombinations[i]->x1;
-                int idx2 = m_ppPairIdxCombinations[i]->x2;
-
-                RapMusic::getGainMatrixPair(t_matProj_LeadField, t_matProj_G, idx1, idx2);
-
-                t_vecRoh(i) = RapMusic::subcorr(t_matProj_G, t_matU_B);//t_vecRoh holds the correlations roh_k
-            }
-        }
+        //Multithreading correlation calculation of all pairs in blocks
+        calcPairCorrelations(t_matProj_LeadField, t_matU_B, t_vecRoh);//t_vecRoh holds the correlations roh_k
 
 
 //         if(r==0)
@@ -522,7 +603,8 @@ MNESourceEstimate RapMusic::calculateInverse(const MatrixXd& p_matMeasurement, Q
         end_subcorr = clock();
 
         float t_fSubcorrElapsedTime = ( (float)(end_subcorr-start_subcorr) / (float)CLOCKS_PER_SEC ) * 1000.0f;
-        std::cout << "Time Elapsed: " << t_fSubcorrElapsedTime << " ms" << std::endl;
+        if(p_bVerbose)
+            std::cout << "Time Elapsed: " << t_fSubcorrElapsedTime << " ms" << std::endl;
 
         //Find the maximum of correlation - can't put this in the for loop because it's running in different threads.
         double t_val_roh_k;
@@ -536,7 +618,8 @@ MNESourceEstimate RapMusic::calculateInverse(const MatrixXd& p_matMeasurement, Q
         int t_iIdx2 = m_ppPairIdxCombinations[t_iMaxIdx]->x2;
 
         // (Idx+1) because of MATLAB positions -> starting with 1 not with 0
-        std::cout << "Iteration: " << r+1 << " of " << t_iMaxSearch
+        if(p_bVerbose)
+            std::cout << "Iteration: " << r+1 << " of " << t_iMaxSearch
             << "; Correlation: " << t_val_roh_k<< "; Position (Idx+1): " << t_iIdx1+1 << " - " << t_iIdx2+1 <<"\n\n";
 
         //Calculations with the max correlated dipole pair G_k_1 -> ToDo Obsolet when taking direkt Projected Lead Field
@@ -559,8 +642,11 @@ MNESourceEstimate RapMusic::calculateInverse(const MatrixXd& p_matMeasurement, Q
         //Stop Searching when Correlation is smaller then the Threshold
         if (t_val_roh_k < m_dThreshold)
         {
-            std::cout << "Searching stopped, last correlation " << t_val_roh_k;
-            std::cout << " is smaller then the given threshold " << m_dThreshold << std::endl << std::endl;
+            if(p_bVerbose)
+            {
+                std::cout << "Searching stopped, last correlation " << t_val_roh_k;
+                std::cout << " is smaller then the given threshold " << m_dThreshold << std::endl << std::endl;
+            }
             break;
         }
 
@@ -568,23 +654,15 @@ MNESourceEstimate RapMusic::calculateInverse(const MatrixXd& p_matMeasurement, Q
         RapMusic::calcA_k_1(t_matG_k_1, t_vec_phi_k_1, r, t_matA_k_1);
 
         //Calculate new orthogonal Projector (Pi_k_1)
-        calcOrthProj(t_matA_k_1, t_matOrthProj);
+        calcOrthProjFactor(t_matA_k_1, t_matOrthProjFactor);
+        t_matOrthProj = MatrixXT::Identity(m_iNumChannels, m_iNumChannels) - t_matOrthProjFactor*t_matA_k_1.adjoint();
 
         //garbage collecting
         //ToDo
     }
 
-    std::cout << "##### Calculation of RAP MUSIC completed ######"<< std::endl << std::endl << std::endl;
-
-    end = clock();
-
-    float t_fElapsedTime = ( (float)(end-start) / (float)CLOCKS_PER_SEC ) * 1000.0f;
-    std::cout << "Total Time Elapsed: " << t_fElapsedTime << " ms" << std::endl << std::endl;
-
-    //garbage collecting
-    delete t_pMatPhi_s;
-
-    return p_SourceEstimate;
+    if(p_bVerbose)
+        std::cout << "##### Calculation of RAP MUSIC completed ######"<< std::endl << std::endl << std::endl;
 }
 
 
@@ -772,7 +850,21 @@ void RapMusic::calcA_k_1(   const MatrixX6T& p_matG_k_1,
 void RapMusic::calcOrthProj(const MatrixXT& p_matA_k_1, MatrixXT& p_matOrthProj) const
 {
     //Calculate OrthProj=I-A_k_1*(A_k_1'*A_k_1)^-1*A_k_1' //Wetterling -> A_k_1 = Gain
+    MatrixXT t_matY;
+    calcOrthProjFactor(p_matA_k_1, t_matY);
 
+    MatrixXT I(m_iNumChannels,m_iNumChannels);
+    I.setIdentity();
+
+    p_matOrthProj = I-t_matY*p_matA_k_1.adjoint(); //OrthProj=I-A_k_1*(A_k_1'*A_k_1)^-1*A_k_1';
+}
+
+
+//*************************************************************************************************************
+
+void RapMusic::calcOrthProjFactor(const MatrixXT& p_matA_k_1, MatrixXT& p_matY)
+{
+    //Calculate Y=A_k_1*(A_k_1'*A_k_1)^-1
     MatrixXT t_matA_k_1_tmp(p_matA_k_1.cols(), p_matA_k_1.cols());
     t_matA_k_1_tmp = p_matA_k_1.adjoint()*p_matA_k_1;//A_k_1'*A_k_1 = A_k_1_tmp -> A_k_1' has to be adjoint for complex
 
@@ -789,24 +881,51 @@ void RapMusic::calcOrthProj(const MatrixXT& p_matA_k_1, MatrixXT& p_matOrthProj)
 
     t_matA_k_1_tmp_inv.block(0,0,t_size,t_size) = t_matA_k_1_tmp.block(0,0,t_size,t_size).inverse();//(A_k_1_tmp)^-1 = A_k_1_tmp_inv
 
+    p_matY = p_matA_k_1*t_matA_k_1_tmp_inv;//(A_k_1*A_k_1_tmp_inv) = Y
+}
 
-    t_matA_k_1_tmp = MatrixXT::Zero(p_matA_k_1.rows(), p_matA_k_1.cols());
 
-    t_matA_k_1_tmp = p_matA_k_1*t_matA_k_1_tmp_inv;//(A_k_1*A_k_1_tmp_inv) = A_k_1_tmp
+//*************************************************************************************************************
 
+void RapMusic::calcPairCorrelations(const MatrixXT& p_matProj_LeadField, const MatrixXT& p_matU_B, VectorXT& p_vecRoh) const
+{
+    int t_iNumPoints = p_matProj_LeadField.cols()/3;
 
-    MatrixXT t_matA_k_1_tmp2(p_matA_k_1.rows(), p_matA_k_1.rows());
+    //Correlations of all projected Lead Field columns with the signal subspace
+    MatrixXT t_matH = p_matProj_LeadField.transpose()*p_matU_B;
 
-    t_matA_k_1_tmp2 = t_matA_k_1_tmp*p_matA_k_1.adjoint();//(A_k_1_tmp)*A_k_1' -> here A_k_1' is only transposed - it has to be adjoint
+    //Per grid point 3 x 3 blocks of G^T*G and H*H^T
+    MatrixXT t_matGramDiag(3, 3*t_iNumPoints);
+    MatrixXT t_matCorDiag(3, 3*t_iNumPoints);
+    for(int i = 0; i < t_iNumPoints; ++i)
+    {
+        t_matGramDiag.block(0,3*i,3,3) = p_matProj_LeadField.middleCols(3*i,3).transpose()*p_matProj_LeadField.middleCols(3*i,3);
+        t_matCorDiag.block(0,3*i,3,3) = t_matH.middleRows(3*i,3)*t_matH.middleRows(3*i,3).transpose();
+    }
 
+    p_vecRoh.resize(m_iNumLeadFieldCombinations);
 
-    MatrixXT I(m_iNumChannels,m_iNumChannels);
-    I.setIdentity();
-
-    p_matOrthProj = I-t_matA_k_1_tmp2; //OrthProj=I-A_k_1*(A_k_1'*A_k_1)^-1*A_k_1';
+    QList<RapMusicPairBlock> t_qListBlocks;
+    for(int i = 0; i < t_iNumPoints; i += PAIR_BLOCK_SIZE)
+    {
+        for(int j = i; j < t_iNumPoints; j += PAIR_BLOCK_SIZE)
+        {
+            RapMusicPairBlock t_block;
+            t_block.m_pMatProjLeadField = &p_matProj_LeadField;
+            t_block.m_pMatH = &t_matH;
+            t_block.m_pMatGramDiag = &t_matGramDiag;
+            t_block.m_pMatCorDiag = &t_matCorDiag;
+            t_block.m_iNumPoints = t_iNumPoints;
+            t_block.m_iStart1 = i;
+            t_block.m_iNum1 = qMin(PAIR_BLOCK_SIZE, t_iNumPoints-i);
+            t_block.m_iStart2 = j;
+            t_block.m_iNum2 = qMin(PAIR_BLOCK_SIZE, t_iNumPoints-j);
+            t_block.m_pRoh = p_vecRoh.data();
+            t_qListBlocks.append(t_block);
+        }
+    }
 
-    //garbage collecting
-    //ToDo
+    QtConcurrent::blockingMap(t_qListBlocks, &RapMusicPairBlock::correlate);
 }
 
 
@@ -900,6 +1019,46 @@ void RapMusic::insertSource(    int p_iDipoleIdx1, int p_iDipoleIdx2,
 }
 
 
+//*************************************************************************************************************
+
+void RapMusic::assignDipolePairs(const QList< DipolePair<double> > &p_RapDipoles, qint32 p_iStartSample, qint32 p_iNumSamples, MatrixXd &p_matSourceData)
+{
+    for(qint32 i = 0; i < p_RapDipoles.size(); ++i)
+    {
+        double dip1 = sqrt( pow(p_RapDipoles[i].m_Dipole1.phi_x(),2) +
+                            pow(p_RapDipoles[i].m_Dipole1.phi_y(),2) +
+                            pow(p_RapDipoles[i].m_Dipole1.phi_z(),2) ) * p_RapDipoles[i].m_vCorrelation;
+
+        double dip2 = sqrt( pow(p_RapDipoles[i].m_Dipole2.phi_x(),2) +
+                            pow(p_RapDipoles[i].m_Dipole2.phi_y(),2) +
+                            pow(p_RapDipoles[i].m_Dipole2.phi_z(),2) ) * p_RapDipoles[i].m_vCorrelation;
+
+        p_matSourceData.block(p_RapDipoles[i].m_iIdx1, p_iStartSample, 1, p_iNumSamples).setConstant(dip1);
+        p_matSourceData.block(p_RapDipoles[i].m_iIdx2, p_iStartSample, 1, p_iNumSamples).setConstant(dip2);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void RapMusic::initSourceEstimate(qint32 p_iNumSamples, float tmin, float tstep, MNESourceEstimate &p_sourceEstimate) const
+{
+    p_sourceEstimate.data = MatrixXd::Zero(m_ForwardSolution.nsource, p_iNumSamples);
+
+    //Results
+    p_sourceEstimate.vertices = VectorXi(m_ForwardSolution.src[0].vertno.size() + m_ForwardSolution.src[1].vertno.size());
+    p_sourceEstimate.vertices << m_ForwardSolution.src[0].vertno, m_ForwardSolution.src[1].vertno;
+
+    p_sourceEstimate.times = RowVectorXf::Zero(p_iNumSamples);
+    if(p_iNumSamples > 0)
+        p_sourceEstimate.times[0] = tmin;
+    for(qint32 i = 1; i < p_sourceEstimate.times.size(); ++i)
+        p_sourceEstimate.times[i] = p_sourceEstimate.times[i-1] + tstep;
+    p_sourceEstimate.tmin = tmin;
+    p_sourceEstimate.tstep = tstep;
+}
+
+
 //*************************************************************************************************************
 
 void RapMusic::setStcAttr(int p_iSampStcWin, float p_fStcOverlap)
@@ -907,3 +1066,127 @@ void RapMusic::setStcAttr(int p_iSampStcWin, float p_fStcOverlap)
     m_iSamplesStcWindow = p_iSampStcWin;
     m_fStcOverlap = p_fStcOverlap;
 }
+
+
+//*************************************************************************************************************
+
+void RapMusic::initStreaming(int p_iWindowSize, int p_iRank, int p_iNumIter)
+{
+    m_iStreamWindowSize = p_iWindowSize > 0 ? p_iWindowSize : 1;
+    m_iStreamRank = qBound(1, p_iRank, m_iNumChannels > 0 ? m_iNumChannels : 1);
+    m_iStreamNumIter = p_iNumIter > 0 ? p_iNumIter : 1;
+
+    m_iStreamWritePos = 0;
+    m_iStreamNumSamples = 0;
+    m_iStreamSinceRefresh = 0;
+
+    m_matStreamWindow = MatrixXT::Zero(m_iNumChannels, m_iStreamWindowSize);
+    m_matStreamCov = MatrixXT::Zero(m_iNumChannels, m_iNumChannels);
+    m_matStreamPhi_s.resize(0,0);
+    m_vecStreamSing.resize(0);
+}
+
+
+//*************************************************************************************************************
+
+bool RapMusic::appendStreamingData(const MatrixXd& p_matData)
+{
+    if(!m_bIsInit || m_iStreamWindowSize <= 0)
+    {
+        std::cout << "RAP MUSIC streaming wasn't initialized!";
+        return false;
+    }
+
+    if(p_matData.rows() != m_iNumChannels)
+    {
+        std::cout << "Lead Field channels do not fit to number of measurement channels!";
+        return false;
+    }
+
+    //Only the newest samples which fit into the window matter
+    int t_iStart = p_matData.cols() > m_iStreamWindowSize ? p_matData.cols() - m_iStreamWindowSize : 0;
+    int t_iNumNew = p_matData.cols() - t_iStart;
+    int t_iNumOld = qMax(0, m_iStreamNumSamples + t_iNumNew - m_iStreamWindowSize);
+
+    //Samples which leave the window
+    MatrixXT t_matOld(m_iNumChannels, t_iNumOld);
+    for(int i = 0; i < t_iNumOld; ++i)
+        t_matOld.col(i) = m_matStreamWindow.col((m_iStreamWritePos + i) % m_iStreamWindowSize);
+
+    for(int i = 0; i < t_iNumNew; ++i)
+    {
+        m_matStreamWindow.col(m_iStreamWritePos) = p_matData.col(t_iStart + i);
+        m_iStreamWritePos = (m_iStreamWritePos + 1) % m_iStreamWindowSize;
+    }
+    m_iStreamNumSamples = qMin(m_iStreamNumSamples + t_iNumNew, m_iStreamWindowSize);
+
+    //Update the window covariance F*F^T -> recompute it once per window to avoid a drift caused by rounding
+    m_iStreamSinceRefresh += t_iNumNew;
+    if(m_iStreamSinceRefresh >= m_iStreamWindowSize)
+    {
+        m_matStreamCov = makeSquareMat(m_matStreamWindow);
+        m_iStreamSinceRefresh = 0;
+    }
+    else
+    {
+        m_matStreamCov.noalias() += p_matData.rightCols(t_iNumNew)*p_matData.rightCols(t_iNumNew).transpose();
+        if(t_iNumOld > 0)
+            m_matStreamCov.noalias() -= t_matOld*t_matOld.transpose();
+    }
+
+    //Track the signal subspace
+    if(m_matStreamPhi_s.cols() != m_iStreamRank)
+    {
+        //Start with a full decomposition
+        Eigen::SelfAdjointEigenSolver<MatrixXT> t_eigCov(m_matStreamCov);
+
+        m_matStreamPhi_s = t_eigCov.eigenvectors().rightCols(m_iStreamRank).rowwise().reverse();
+        m_vecStreamSing = t_eigCov.eigenvalues().tail(m_iStreamRank).reverse().cwiseMax(0).cwiseSqrt();
+    }
+    else
+    {
+        //Orthogonal iterations starting with the previous subspace
+        MatrixXT t_matQ = m_matStreamPhi_s;
+        for(int i = 0; i < m_iStreamNumIter; ++i)
+        {
+            Eigen::HouseholderQR<MatrixXT> t_qr(m_matStreamCov*t_matQ);
+            t_matQ = t_qr.householderQ()*MatrixXT::Identity(m_iNumChannels, m_iStreamRank);
+        }
+
+        //Rayleigh-Ritz -> order the basis by the singular values
+        Eigen::SelfAdjointEigenSolver<MatrixXT> t_eigRitz(t_matQ.transpose()*m_matStreamCov*t_matQ);
+
+        m_matStreamPhi_s = t_matQ*t_eigRitz.eigenvectors().rowwise().reverse();
+        m_vecStreamSing = t_eigRitz.eigenvalues().reverse().cwiseMax(0).cwiseSqrt();
+    }
+
+    return m_iStreamNumSamples == m_iStreamWindowSize;
+}
+
+
+//*************************************************************************************************************
+
+MNESourceEstimate RapMusic::calculateStreamingInverse(int p_iNumSamples, float tmin, float tstep) const
+{
+    MNESourceEstimate p_sourceEstimate;
+
+    if(m_matStreamPhi_s.cols() == 0 || p_iNumSamples <= 0)
+        return p_sourceEstimate;
+
+    //
+    // Rap MUSIC Source estimate
+    //
+    initSourceEstimate(p_iNumSamples, tmin, tstep, p_sourceEstimate);
+
+    //Only the scan step is computed -> the signal subspace is already tracked. The rank follows calcPhi_s, which
+    //decomposes F*F^T instead of F if the window has more samples than channels -> compare the squares then
+    VectorXT t_vecSing = m_iStreamWindowSize > m_iNumChannels ? VectorXT(m_vecStreamSing.cwiseAbs2()) : m_vecStreamSing;
+    int t_r = getRank(MatrixXT(t_vecSing.asDiagonal()));
+
+    QList< DipolePair<double> > t_RapDipoles;
+    calcDipolePairs(m_matStreamPhi_s.leftCols(t_r), t_r, t_RapDipoles, false);
+
+    assignDipolePairs(t_RapDipoles, 0, p_iNumSamples, p_sourceEstimate.data);
+
+    return p_sourceEstimate;
+}
@@ -61,6 +61,8 @@
 #include <Eigen/Core>
 #include <Eigen/SVD>
 #include <Eigen/LU>
+#include <Eigen/Eigenvalues>
+#include <Eigen/QR>
 
 
 //*************************************************************************************************************
@@ -183,7 +185,63 @@ public:
     */
     void setStcAttr(int p_iSampStcWin, float p_fStcOverlap);
 
+    //=========================================================================================================
+    /**
+    * Initializes the streaming mode. Incoming samples are collected in a sliding window whose signal subspace
+    * is tracked incrementally: each update refines the previous subspace with a few orthogonal iterations on the
+    * window covariance instead of decomposing the whole window again.
+    *
+    * @param[in] p_iWindowSize  Number of samples of the sliding window.
+    * @param[in] p_iRank        Dimension of the tracked signal subspace.
+    * @param[in] p_iNumIter     Number of orthogonal iterations per update (default 2).
+    */
+    void initStreaming(int p_iWindowSize, int p_iRank, int p_iNumIter = 2);
+
+    //=========================================================================================================
+    /**
+    * Appends samples to the sliding window and updates the tracked signal subspace.
+    *
+    * @param[in] p_matData      The new samples (channels x samples).
+    * @return   true if the sliding window is filled, false otherwise.
+    */
+    bool appendStreamingData(const MatrixXd& p_matData);
+
+    //=========================================================================================================
+    /**
+    * Scans the tracked signal subspace for correlated sources. Only the scan is computed, the subspace is
+    * the one of the last appendStreamingData call.
+    *
+    * @param[in] p_iNumSamples  Number of samples of the returned source estimate, e.g., the samples appended
+    *                           since the last call.
+    * @param[in] tmin           Time of the first sample.
+    * @param[in] tstep          Time between two samples.
+    * @return   The source estimate with constant dipole pair amplitudes.
+    */
+    MNESourceEstimate calculateStreamingInverse(int p_iNumSamples, float tmin, float tstep) const;
+
 protected:
+    //=========================================================================================================
+    /**
+    * Scans the lead field for the correlated dipole pairs which explain the given signal subspace best.
+    *
+    * @param[in] p_matPhi_s     The signal subspace.
+    * @param[in] p_iRank        The rank of the measurement (named r lt. Mosher 1998, 1999).
+    * @param[out] p_RapDipoles  The found dipole pairs.
+    * @param[in] p_bVerbose     Whether the progress of the scan is printed.
+    */
+    void calcDipolePairs(const MatrixXT& p_matPhi_s, int p_iRank, QList< DipolePair<double> > &p_RapDipoles, bool p_bVerbose = true) const;
+
+    //=========================================================================================================
+    /**
+    * Sets up an empty source estimate over all sources of the forward solution.
+    *
+    * @param[in] p_iNumSamples      Number of samples.
+    * @param[in] tmin               Time of the first sample.
+    * @param[in] tstep              Time between two samples.
+    * @param[out] p_sourceEstimate  The source estimate to set up.
+    */
+    void initSourceEstimate(qint32 p_iNumSamples, float tmin, float tstep, MNESourceEstimate &p_sourceEstimate) const;
+
     //=========================================================================================================
     /**
     * Computes the signal subspace Phi_s out of the measurement F.
@@ -228,6 +286,19 @@ protected:
     */
     static double subcorr(MatrixX6T& p_matProj_G, const MatrixXT& p_matU_B, Vector6T& p_vec_phi_k_1);
 
+    //=========================================================================================================
+    /**
+    * Computes the subspace correlations of all gain matrix pairs with the projected signal subspace.
+    * Instead of decomposing each m x 6 pair, the 3 x 3 blocks of G^T*G and (G^T*U_B)*(G^T*U_B)^T are
+    * computed with dense matrix products for blocks of grid points, so that each pair only needs two 6 x 6
+    * eigenvalue decompositions. The blocks are processed concurrently. The result equals the one of subcorr.
+    *
+    * @param[in] p_matProj_LeadField    The projected Lead Field (m x 3*number of grid points).
+    * @param[in] p_matU_B               The matrix U is the subspace projection of the orthogonal projected Phi_s
+    * @param[out] p_vecRoh              The correlations, indexed like the pair index combinations.
+    */
+    void calcPairCorrelations(const MatrixXT& p_matProj_LeadField, const MatrixXT& p_matU_B, VectorXT& p_vecRoh) const;
+
     //=========================================================================================================
     /**
     * Calculates the accumulated manifold vectors A_{k1}
@@ -252,6 +323,16 @@ protected:
     */
     void calcOrthProj(const MatrixXT& p_matA_k_1, MatrixXT& p_matOrthProj) const;
 
+    //=========================================================================================================
+    /**
+    * Calculates the factor Y = A_k_1*(A_k_1'*A_k_1)^-1 of the orthogonal projector OrthProj = I - Y*A_k_1'.
+    * It allows to project the Lead Field with a low rank update instead of a full m x m product.
+    *
+    * @param[in] p_matA_k_1 The array of the manifold vectors.
+    * @param[out] p_matY    The factor of the projector.
+    */
+    static void calcOrthProjFactor(const MatrixXT& p_matA_k_1, MatrixXT& p_matY);
+
     //=========================================================================================================
     /**
     * Pre-Calculates the gain matrix index combinations to search for a two dipole independent topography
@@ -313,6 +394,17 @@ protected:
                         double p_valCor,
                         QList< DipolePair<double> > &p_RapDipoles);
 
+    //=========================================================================================================
+    /**
+    * Writes the amplitudes of the dipole pairs as constant time courses into a block of the source estimate data.
+    *
+    * @param[in] p_RapDipoles       The dipole pairs.
+    * @param[in] p_iStartSample     First column of the block.
+    * @param[in] p_iNumSamples      Number of columns of the block.
+    * @param[out] p_matSourceData   The source estimate data.
+    */
+    static void assignDipolePairs(const QList< DipolePair<double> > &p_RapDipoles, qint32 p_iStartSample, qint32 p_iNumSamples, MatrixXd &p_matSourceData);
+
     MNEForwardSolution m_ForwardSolution; /**< The Forward operator which should be scanned through*/
 
     int m_iN;               /**< Number of Sources to find*/
@@ -334,6 +426,18 @@ protected:
     int m_iSamplesStcWindow;    /**< Number of samples per localization window */
     float m_fStcOverlap;        /**< Percentage of localization window overlap */
 
+    //Streaming stuff
+    int m_iStreamWindowSize;        /**< Number of samples of the sliding window */
+    int m_iStreamRank;              /**< Dimension of the tracked signal subspace */
+    int m_iStreamNumIter;           /**< Orthogonal iterations per update */
+    int m_iStreamWritePos;          /**< Next column of the sliding window to write */
+    int m_iStreamNumSamples;        /**< Number of valid samples in the sliding window */
+    int m_iStreamSinceRefresh;      /**< Samples appended since the covariance was recomputed from the window */
+    MatrixXT m_matStreamWindow;     /**< Ring buffer of the sliding window (channels x window size) */
+    MatrixXT m_matStreamCov;        /**< Covariance F*F^T of the sliding window */
+    MatrixXT m_matStreamPhi_s;      /**< Tracked signal subspace */
+    VectorXT m_vecStreamSing;       /**< Singular values belonging to the tracked signal subspace */
+
     //=========================================================================================================
     /**
     * Returns the rank r of a singular value matrix based on non-zero singular values
@@ -89,6 +89,7 @@ SOURCES += \
     mne_sourcespace.cpp \
     mne_forwardsolution.cpp \
     mne_sourceestimate.cpp \
+    mne_sourceestimate_file.cpp \
     mne_hemisphere.cpp \
     mne_inverse_operator.cpp \
     mne_epoch_data.cpp \
@@ -128,6 +129,7 @@ HEADERS += \
     mne_hemisphere.h \
     mne_forwardsolution.h \
     mne_sourceestimate.h \
+    mne_sourceestimate_file.h \
     mne_inverse_operator.h \
     mne_epoch_data.h \
     mne_epoch_data_list.h \
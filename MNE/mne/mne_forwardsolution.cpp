@@ -72,6 +72,15 @@
 #include <QFuture>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QCryptographicHash>
+#include <QDir>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // USED NAMESPACES
@@ -82,6 +91,36 @@ using namespace UTILSLIB;
 using namespace FSLIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+// Bump when the clustering algorithm or the cache layout changes -> older cache files are not reused
+#define MNE_CLUSTER_CACHE_VERSION "mne_cluster_cache_2:kmeans_plus_5"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+static void hash_projs(QCryptographicHash& p_hash, const QList<FiffProj>& p_listProjs)
+{
+    qint32 nproj = p_listProjs.size();
+    p_hash.addData((const char*)&nproj, sizeof(qint32));
+    for(qint32 i = 0; i < p_listProjs.size(); ++i)
+    {
+        const FiffProj& proj = p_listProjs[i];
+        qint32 t_iKindActive[2] = { proj.kind, proj.active ? 1 : 0 };
+        p_hash.addData((const char*)t_iKindActive, sizeof(t_iKindActive));
+        p_hash.addData(proj.desc.toUtf8());
+        p_hash.addData(proj.data->col_names.join(":").toUtf8());
+        p_hash.addData((const char*)proj.data->data.data(), proj.data->data.size()*sizeof(double));
+    }
+}
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -176,7 +215,7 @@ void MNEForwardSolution::clear()
 
 //*************************************************************************************************************
 
-MNEForwardSolution MNEForwardSolution::cluster_forward_solution(const AnnotationSet &p_AnnotationSet, qint32 p_iClusterSize, MatrixXd& p_D, const FiffCov &p_pNoise_cov, const FiffInfo &p_pInfo, QString p_sMethod) const
+MNEForwardSolution MNEForwardSolution::cluster_forward_solution(const AnnotationSet &p_AnnotationSet, qint32 p_iClusterSize, MatrixXd& p_D, const FiffCov &p_pNoise_cov, const FiffInfo &p_pInfo, QString p_sMethod, const QString& p_sCacheDir) const
 {
     MNEForwardSolution p_fwdOut = MNEForwardSolution(*this);
 
@@ -193,6 +232,25 @@ MNEForwardSolution MNEForwardSolution::cluster_forward_solution(const Annotation
         return p_fwdOut;
     }
 
+    //
+    // Look up the cluster cache
+    //
+    QString t_sCacheKey;
+    QString t_sCacheFile;
+    if(!p_sCacheDir.isEmpty())
+    {
+        t_sCacheKey = this->cluster_cache_key(p_AnnotationSet, p_iClusterSize, p_pNoise_cov, p_pInfo, p_sMethod);
+        t_sCacheFile = QDir(p_sCacheDir).filePath(t_sCacheKey + QString("-clu-fwd.fif"));
+
+        if(read_cluster_cache(t_sCacheFile, t_sCacheKey, p_fwdOut))
+        {
+            printf("Read clustered forward solution from %s.\n", t_sCacheFile.toUtf8().constData());
+            this->compute_cluster_operator(p_fwdOut, p_D);
+            return p_fwdOut;
+        }
+        p_fwdOut = MNEForwardSolution(*this);
+    }
+
 //    for(qint32 h = 0; h < this->src.hemispheres.size(); ++h )//obj.sizeForwardSolution)
 //    {
 //        if(this->src[h]->vertno.rows() !=  t_listAnnotation[h]->getLabel()->rows())
@@ -485,62 +543,7 @@ MNEForwardSolution MNEForwardSolution::cluster_forward_solution(const Annotation
     //
     // Cluster operator D (sources x clusters)
     //
-    qint32 totalNumOfClust = 0;
-    for (qint32 h = 0; h < 2; ++h)
-        totalNumOfClust += p_fwdOut.src[h].cluster_info.clusterVertnos.size();
-
-    if(this->isFixedOrient())
-        p_D = MatrixXd::Zero(this->sol->data.cols(), totalNumOfClust);
-    else
-        p_D = MatrixXd::Zero(this->sol->data.cols(), totalNumOfClust*3);
-
-    QList<VectorXi> t_vertnos = this->src.get_vertno();
-
-//    qDebug() << "Size: " << t_vertnos[0].size()  << t_vertnos[1].size();
-//    qDebug() << "this->sol->data.cols(): " << this->sol->data.cols();
-
-    qint32 currentCluster = 0;
-    for (qint32 h = 0; h < 2; ++h)
-    {
-        int hemiOffset = h == 0 ? 0 : t_vertnos[0].size();
-        for(qint32 i = 0; i < p_fwdOut.src[h].cluster_info.clusterVertnos.size(); ++i)
-        {
-            VectorXi idx_sel;
-            MNEMath::intersect(t_vertnos[h], p_fwdOut.src[h].cluster_info.clusterVertnos[i], idx_sel);
-
-//            std::cout << "\nVertnos:\n" << t_vertnos[h] << std::endl;
-
-//            std::cout << "clusterVertnos[i]:\n" << p_fwdOut.src[h].cluster_info.clusterVertnos[i] << std::endl;
-
-            idx_sel.array() += hemiOffset;
-
-//            std::cout << "idx_sel]:\n" << idx_sel << std::endl;
-
-
-
-            double selectWeight = 1.0/idx_sel.size();
-            if(this->isFixedOrient())
-            {
-                for(qint32 j = 0; j < idx_sel.size(); ++j)
-                    p_D.col(currentCluster)[idx_sel(j)] = selectWeight;
-            }
-            else
-            {
-                qint32 clustOffset = currentCluster*3;
-                for(qint32 j = 0; j < idx_sel.size(); ++j)
-                {
-                    qint32 idx_sel_Offset = idx_sel(j)*3;
-                    //x
-                    p_D(idx_sel_Offset,clustOffset) = selectWeight;
-                    //y
-                    p_D(idx_sel_Offset+1, clustOffset+1) = selectWeight;
-                    //z
-                    p_D(idx_sel_Offset+2, clustOffset+2) = selectWeight;
-                }
-            }
-            ++currentCluster;
-        }
-    }
+    this->compute_cluster_operator(p_fwdOut, p_D);
 
 //    std::cout << "D:\n" << D.row(0) << std::endl << D.row(1) << std::endl << D.row(2) << std::endl << D.row(3) << std::endl << D.row(4) << std::endl << D.row(5) << std::endl;
 
@@ -704,10 +707,309 @@ MNEForwardSolution MNEForwardSolution::cluster_forward_solution(const Annotation
 
     p_fwdOut.nsource = p_fwdOut.sol->ncol/3;
 
+    if(!t_sCacheFile.isEmpty())
+    {
+        if(QDir().mkpath(p_sCacheDir) && write_cluster_cache(t_sCacheFile, t_sCacheKey, p_fwdOut))
+            printf("Wrote clustered forward solution to %s.\n", t_sCacheFile.toUtf8().constData());
+        else
+            printf("Warning: Could not write the cluster cache %s.\n", t_sCacheFile.toUtf8().constData());
+    }
+
     return p_fwdOut;
 }
 
 
+//*************************************************************************************************************
+
+QString MNEForwardSolution::cluster_cache_key(const AnnotationSet &p_AnnotationSet, qint32 p_iClusterSize, const FiffCov &p_pNoise_cov, const FiffInfo &p_pInfo, const QString& p_sMethod) const
+{
+    QCryptographicHash t_hash(QCryptographicHash::Sha1);
+
+    t_hash.addData(MNE_CLUSTER_CACHE_VERSION);
+
+    qint32 dims[3] = { (qint32)this->sol->data.rows(), (qint32)this->sol->data.cols(), p_iClusterSize };
+    t_hash.addData((const char*)dims, sizeof(dims));
+    t_hash.addData((const char*)this->sol->data.data(), this->sol->data.size()*sizeof(double));
+    t_hash.addData(p_sMethod.toUtf8());
+
+    for(qint32 h = 0; h < this->src.size(); ++h)
+    {
+        const VectorXi& vertno = this->src[h].vertno;
+        t_hash.addData((const char*)vertno.data(), vertno.size()*sizeof(qint32));
+
+        //
+        // Only the labels of the used vertices matter
+        //
+        const VectorXi annotLabelIds = p_AnnotationSet[h].getLabelIds();
+        VectorXi vertno_labeled(vertno.size());
+        for(qint32 i = 0; i < vertno.size(); ++i)
+            vertno_labeled[i] = annotLabelIds[vertno[i]];
+        t_hash.addData((const char*)vertno_labeled.data(), vertno_labeled.size()*sizeof(qint32));
+
+        Colortable t_Colortable = p_AnnotationSet[h].getColortable();
+        VectorXi label_ids = t_Colortable.getLabelIds();
+        t_hash.addData((const char*)label_ids.data(), label_ids.size()*sizeof(qint32));
+        t_hash.addData(t_Colortable.getNames().join(":").toUtf8());
+    }
+
+    //
+    // Whitening
+    //
+    if(!p_pNoise_cov.isEmpty() && !p_pInfo.isEmpty())
+    {
+        qint32 t_iDiag = p_pNoise_cov.diag ? 1 : 0;
+        t_hash.addData((const char*)&t_iDiag, sizeof(qint32));
+        t_hash.addData((const char*)p_pNoise_cov.data.data(), p_pNoise_cov.data.size()*sizeof(double));
+        t_hash.addData((const char*)p_pNoise_cov.eig.data(), p_pNoise_cov.eig.size()*sizeof(double));
+        t_hash.addData((const char*)p_pNoise_cov.eigvec.data(), p_pNoise_cov.eigvec.size()*sizeof(double));
+        t_hash.addData(p_pNoise_cov.names.join(":").toUtf8());
+        t_hash.addData(p_pNoise_cov.bads.join(":").toUtf8());
+        hash_projs(t_hash, p_pNoise_cov.projs);
+
+        t_hash.addData(p_pInfo.ch_names.join(":").toUtf8());
+        t_hash.addData(p_pInfo.bads.join(":").toUtf8());
+        for(qint32 i = 0; i < p_pInfo.chs.size(); ++i)
+            t_hash.addData((const char*)&p_pInfo.chs[i].kind, sizeof(fiff_int_t));
+        hash_projs(t_hash, p_pInfo.projs);
+    }
+
+    return QString(t_hash.result().toHex());
+}
+
+
+//*************************************************************************************************************
+
+void MNEForwardSolution::compute_cluster_operator(const MNEForwardSolution& p_fwdClustered, MatrixXd& p_D) const
+{
+    qint32 totalNumOfClust = 0;
+    for (qint32 h = 0; h < 2; ++h)
+        totalNumOfClust += p_fwdClustered.src[h].cluster_info.clusterVertnos.size();
+
+    if(this->isFixedOrient())
+        p_D = MatrixXd::Zero(this->sol->data.cols(), totalNumOfClust);
+    else
+        p_D = MatrixXd::Zero(this->sol->data.cols(), totalNumOfClust*3);
+
+    QList<VectorXi> t_vertnos = this->src.get_vertno();
+
+    qint32 currentCluster = 0;
+    for (qint32 h = 0; h < 2; ++h)
+    {
+        int hemiOffset = h == 0 ? 0 : t_vertnos[0].size();
+        for(qint32 i = 0; i < p_fwdClustered.src[h].cluster_info.clusterVertnos.size(); ++i)
+        {
+            VectorXi idx_sel;
+            MNEMath::intersect(t_vertnos[h], p_fwdClustered.src[h].cluster_info.clusterVertnos[i], idx_sel);
+
+            idx_sel.array() += hemiOffset;
+
+            double selectWeight = 1.0/idx_sel.size();
+            if(this->isFixedOrient())
+            {
+                for(qint32 j = 0; j < idx_sel.size(); ++j)
+                    p_D.col(currentCluster)[idx_sel(j)] = selectWeight;
+            }
+            else
+            {
+                qint32 clustOffset = currentCluster*3;
+                for(qint32 j = 0; j < idx_sel.size(); ++j)
+                {
+                    qint32 idx_sel_Offset = idx_sel(j)*3;
+                    //x
+                    p_D(idx_sel_Offset,clustOffset) = selectWeight;
+                    //y
+                    p_D(idx_sel_Offset+1, clustOffset+1) = selectWeight;
+                    //z
+                    p_D(idx_sel_Offset+2, clustOffset+2) = selectWeight;
+                }
+            }
+            ++currentCluster;
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+bool MNEForwardSolution::read_cluster_cache(const QString& p_sFileName, const QString& p_sKey, MNEForwardSolution& p_fwdOut)
+{
+    QFile            file(p_sFileName);
+    FiffStream::SPtr stream(new FiffStream(&file));
+    QList<FiffDirNode::SPtr> nodes;
+    QList<FiffDirNode::SPtr> hemis;
+    FiffDirNode::SPtr node;
+    FiffTag::SPtr    t_pTag;
+    qint32           nrow, ncol, nclust, ntotal, nsrc;
+    MatrixXd         data;
+    VectorXi         sizes;
+    VectorXi         vertnos;
+    VectorXf         rr;
+    VectorXd         dist;
+    QList<VectorXi>  t_listVertno;
+    QList<MNEClusterInfo> t_listClusterInfo;
+
+    if (!file.exists())
+        return false;
+    if (!stream->open())
+        return false;
+    nodes = stream->dirtree()->dir_tree_find(FIFFB_MNE_CLUSTER_CACHE);
+    if (nodes.size() == 0)
+        goto bad;
+    node = nodes[0];
+    if (!node->find_tag(stream, FIFF_MNE_CLUSTER_KEY, t_pTag) || t_pTag->toString() != p_sKey)
+        goto bad;
+    if (!node->find_tag(stream, FIFF_MNE_NROW, t_pTag))
+        goto bad;
+    nrow = *t_pTag->toInt();
+    if (!node->find_tag(stream, FIFF_MNE_NCOL, t_pTag))
+        goto bad;
+    ncol = *t_pTag->toInt();
+    if (!node->find_tag(stream, FIFF_MNE_CLUSTER_SOL, t_pTag) || t_pTag->size() != nrow*ncol*(qint32)sizeof(double))
+        goto bad;
+    data = Map<MatrixXd>(t_pTag->toDouble(), nrow, ncol);
+
+    hemis = node->dir_tree_find(FIFFB_MNE_CLUSTER_HEMI);
+    if (hemis.size() != p_fwdOut.src.size())
+        goto bad;
+    for (qint32 h = 0; h < hemis.size(); ++h) {
+        MNEClusterInfo info;
+        if (!hemis[h]->find_tag(stream, FIFF_MNE_CLUSTER_VERTNO, t_pTag))
+            goto bad;
+        t_listVertno.append(Map<VectorXi>(t_pTag->toInt(), t_pTag->size()/sizeof(qint32)));
+        if (!hemis[h]->find_tag(stream, FIFF_MNE_CLUSTER_SIZES, t_pTag))
+            goto bad;
+        sizes = Map<VectorXi>(t_pTag->toInt(), t_pTag->size()/sizeof(qint32));
+        nclust = sizes.size();
+        ntotal = sizes.sum();
+        if (nclust == 0)
+            goto bad;
+        if (!hemis[h]->find_tag(stream, FIFF_MNE_CLUSTER_LABEL_NAMES, t_pTag))
+            goto bad;
+        info.clusterLabelNames = FiffStream::split_name_list(t_pTag->toString());
+        if (!hemis[h]->find_tag(stream, FIFF_MNE_CLUSTER_LABEL_IDS, t_pTag) || t_pTag->size() != nclust*(qint32)sizeof(qint32))
+            goto bad;
+        for (qint32 i = 0; i < nclust; ++i)
+            info.clusterLabelIds.append(t_pTag->toInt()[i]);
+        if (!hemis[h]->find_tag(stream, FIFF_MNE_CLUSTER_CENTROID_VERTNO, t_pTag) || t_pTag->size() != nclust*(qint32)sizeof(qint32))
+            goto bad;
+        for (qint32 i = 0; i < nclust; ++i)
+            info.centroidVertno.append(t_pTag->toInt()[i]);
+        if (!hemis[h]->find_tag(stream, FIFF_MNE_CLUSTER_CENTROID_RR, t_pTag) || t_pTag->size() != 3*nclust*(qint32)sizeof(float))
+            goto bad;
+        for (qint32 i = 0; i < nclust; ++i)
+            info.centroidSource_rr.append(Map<Vector3f>(t_pTag->toFloat() + 3*i));
+        if (!hemis[h]->find_tag(stream, FIFF_MNE_CLUSTER_VERTNOS, t_pTag) || t_pTag->size() != ntotal*(qint32)sizeof(qint32))
+            goto bad;
+        vertnos = Map<VectorXi>(t_pTag->toInt(), ntotal);
+        if (!hemis[h]->find_tag(stream, FIFF_MNE_CLUSTER_RR, t_pTag) || t_pTag->size() != 3*ntotal*(qint32)sizeof(float))
+            goto bad;
+        rr = Map<VectorXf>(t_pTag->toFloat(), 3*ntotal);
+        if (!hemis[h]->find_tag(stream, FIFF_MNE_CLUSTER_DISTANCES, t_pTag) || t_pTag->size() != ntotal*(qint32)sizeof(double))
+            goto bad;
+        dist = Map<VectorXd>(t_pTag->toDouble(), ntotal);
+        if (info.clusterLabelNames.size() != nclust)
+            goto bad;
+        for (qint32 i = 0, offset = 0; i < nclust; offset += sizes[i], ++i) {
+            info.clusterVertnos.append(vertnos.segment(offset, sizes[i]));
+            info.clusterSource_rr.append(Map<Matrix<float,Dynamic,3,RowMajor> >(rr.data() + 3*offset, sizes[i], 3));
+            info.clusterDistances.append(dist.segment(offset, sizes[i]));
+        }
+        t_listClusterInfo.append(info);
+    }
+    stream->device()->close();
+
+    nsrc = 0;
+    for (qint32 h = 0; h < t_listVertno.size(); ++h)
+        nsrc += t_listVertno[h].size();
+    if (nrow != p_fwdOut.sol->data.rows() || ncol != 3*nsrc) {
+        printf("Inconsistent cluster cache %s\n", p_sFileName.toUtf8().constData());
+        return false;
+    }
+
+    //
+    // Put it all together
+    //
+    p_fwdOut.sol->data = data;
+    p_fwdOut.sol->ncol = ncol;
+    p_fwdOut.nsource = ncol/3;
+    for (qint32 h = 0; h < t_listVertno.size(); ++h) {
+        p_fwdOut.src[h].vertno = t_listVertno[h];
+        p_fwdOut.src[h].cluster_info = t_listClusterInfo[h];
+    }
+    return true;
+
+bad : {
+        stream->device()->close();
+        return false;
+    }
+}
+
+
+//*************************************************************************************************************
+
+bool MNEForwardSolution::write_cluster_cache(const QString& p_sFileName, const QString& p_sKey, const MNEForwardSolution& p_fwdClustered)
+{
+    QFile            file(p_sFileName);
+    FiffStream::SPtr stream;
+    qint32           nrow = p_fwdClustered.sol->data.rows();
+    qint32           ncol = p_fwdClustered.sol->data.cols();
+
+    if ((stream = FiffStream::start_file(file)).isNull())
+        return false;
+    stream->start_block(FIFFB_MNE_CLUSTER_CACHE);
+    stream->write_string(FIFF_MNE_CLUSTER_KEY, p_sKey);
+    stream->write_int(FIFF_MNE_NROW, &nrow);
+    stream->write_int(FIFF_MNE_NCOL, &ncol);
+    stream->write_double(FIFF_MNE_CLUSTER_SOL, p_fwdClustered.sol->data.data(), nrow*ncol);
+    for (qint32 h = 0; h < p_fwdClustered.src.size(); ++h) {
+        const MNEClusterInfo& info = p_fwdClustered.src[h].cluster_info;
+        qint32 nclust = info.clusterVertnos.size();
+        qint32 ntotal = 0;
+        VectorXi sizes(nclust);
+        VectorXi ids(nclust);
+        VectorXi centroids(nclust);
+        Matrix<float,Dynamic,3,RowMajor> centroid_rr(nclust, 3);
+        for (qint32 i = 0; i < nclust; ++i) {
+            sizes[i] = info.clusterVertnos[i].size();
+            ids[i] = info.clusterLabelIds[i];
+            centroids[i] = info.centroidVertno[i];
+            centroid_rr.row(i) = info.centroidSource_rr[i].transpose();
+            ntotal += sizes[i];
+        }
+        VectorXi vertnos(ntotal);
+        Matrix<float,Dynamic,3,RowMajor> rr(ntotal, 3);
+        VectorXd dist(ntotal);
+        for (qint32 i = 0, offset = 0; i < nclust; offset += sizes[i], ++i) {
+            vertnos.segment(offset, sizes[i]) = info.clusterVertnos[i];
+            rr.block(offset, 0, sizes[i], 3) = info.clusterSource_rr[i];
+            dist.segment(offset, sizes[i]) = info.clusterDistances[i];
+        }
+        stream->start_block(FIFFB_MNE_CLUSTER_HEMI);
+        stream->write_int(FIFF_MNE_CLUSTER_VERTNO, p_fwdClustered.src[h].vertno.data(), p_fwdClustered.src[h].vertno.size());
+        stream->write_int(FIFF_MNE_CLUSTER_SIZES, sizes.data(), nclust);
+        stream->write_name_list(FIFF_MNE_CLUSTER_LABEL_NAMES, QStringList(info.clusterLabelNames));
+        stream->write_int(FIFF_MNE_CLUSTER_LABEL_IDS, ids.data(), nclust);
+        stream->write_int(FIFF_MNE_CLUSTER_CENTROID_VERTNO, centroids.data(), nclust);
+        stream->write_float(FIFF_MNE_CLUSTER_CENTROID_RR, centroid_rr.data(), 3*nclust);
+        stream->write_int(FIFF_MNE_CLUSTER_VERTNOS, vertnos.data(), ntotal);
+        stream->write_float(FIFF_MNE_CLUSTER_RR, rr.data(), 3*ntotal);
+        stream->write_double(FIFF_MNE_CLUSTER_DISTANCES, dist.data(), ntotal);
+        stream->end_block(FIFFB_MNE_CLUSTER_HEMI);
+    }
+    stream->end_block(FIFFB_MNE_CLUSTER_CACHE);
+    stream->end_file();
+
+    bool t_bOk = stream->status() == QDataStream::Ok && file.error() == QFile::NoError;
+    stream->device()->close();
+    t_bOk = t_bOk && file.error() == QFile::NoError;
+
+    // A truncated cache file must not be found by the next run
+    if (!t_bOk)
+        file.remove();
+    return t_bOk;
+}
+
+
 //*************************************************************************************************************
 
 MNEForwardSolution MNEForwardSolution::reduce_forward_solution(qint32 p_iNumDipoles, MatrixXd& p_D) const
@@ -153,7 +153,7 @@ struct RegionData
         // Kmeans Reduction
         RegionDataOut p_RegionDataOut;
 
-        KMeans t_kMeans(t_sDistMeasure, QString("sample"), 5);
+        KMeans t_kMeans(t_sDistMeasure, QString("plus"), 5);
 
         if(bUseWhitened)
         {
@@ -257,10 +257,13 @@ public:
     * @param[in]    p_pNoise_cov
     * @param[in]    p_pInfo
     * @param[in]    p_sMethod           "cityblock" or "sqeuclidean"
+    * @param[in]    p_sCacheDir         Directory of the cluster cache; the result is read from and stored to
+    *                                   <p_sCacheDir>/<key>-clu-fwd.fif, where the key hashes all clustering inputs.
+    *                                   No caching if empty.
     *
     * @return clustered MNE forward solution
     */
-    MNEForwardSolution cluster_forward_solution(const AnnotationSet &p_AnnotationSet, qint32 p_iClusterSize, MatrixXd& p_D = defaultD, const FiffCov &p_pNoise_cov = defaultCov, const FiffInfo &p_pInfo = defaultInfo, QString p_sMethod = "cityblock") const;
+    MNEForwardSolution cluster_forward_solution(const AnnotationSet &p_AnnotationSet, qint32 p_iClusterSize, MatrixXd& p_D = defaultD, const FiffCov &p_pNoise_cov = defaultCov, const FiffInfo &p_pInfo = defaultInfo, QString p_sMethod = "cityblock", const QString& p_sCacheDir = QString()) const;
 
     //=========================================================================================================
     /**
@@ -497,6 +500,57 @@ private:
     */
     static bool read_one(FiffStream::SPtr& p_pStream, const FiffDirNode::SPtr& p_Node, MNEForwardSolution& one);
 
+    //=========================================================================================================
+    /**
+    * Hashes everything the result of cluster_forward_solution depends on: the cache version (clustering
+    * algorithm), the gain matrix, the source space vertices, the annotation restricted to these vertices, the
+    * cluster size, the method and the whitening (noise covariance incl. its projectors and eigen decomposition,
+    * channels, bads and projectors of the measurement info).
+    *
+    * @param[in] p_AnnotationSet    Annotation set containing the annotation of left & right hemisphere
+    * @param[in] p_iClusterSize     Maximal cluster size per roi
+    * @param[in] p_pNoise_cov       Noise covariance used for whitening
+    * @param[in] p_pInfo            Measurement info used for whitening
+    * @param[in] p_sMethod          "cityblock" or "sqeuclidean"
+    *
+    * @return the hexadecimal cache key
+    */
+    QString cluster_cache_key(const AnnotationSet &p_AnnotationSet, qint32 p_iClusterSize, const FiffCov &p_pNoise_cov, const FiffInfo &p_pInfo, const QString& p_sMethod) const;
+
+    //=========================================================================================================
+    /**
+    * Computes the cluster operator D (sources x clusters) which maps this forward solution to the clustered one.
+    *
+    * @param[in] p_fwdClustered     The clustered forward solution holding the cluster information
+    * @param[out] p_D               The cluster operator
+    */
+    void compute_cluster_operator(const MNEForwardSolution& p_fwdClustered, MatrixXd& p_D) const;
+
+    //=========================================================================================================
+    /**
+    * Reads a clustered forward solution from the cluster cache. p_fwdOut has to be a copy of the unclustered
+    * forward solution, its gain matrix and source space information are replaced.
+    *
+    * @param[in] p_sFileName        The cache file
+    * @param[in] p_sKey             The expected cache key
+    * @param[in, out] p_fwdOut      The clustered forward solution
+    *
+    * @return True if the cache was valid and read, false otherwise
+    */
+    static bool read_cluster_cache(const QString& p_sFileName, const QString& p_sKey, MNEForwardSolution& p_fwdOut);
+
+    //=========================================================================================================
+    /**
+    * Writes a clustered forward solution to the cluster cache.
+    *
+    * @param[in] p_sFileName        The cache file
+    * @param[in] p_sKey             The cache key
+    * @param[in] p_fwdClustered     The clustered forward solution
+    *
+    * @return True if succeeded, false otherwise
+    */
+    static bool write_cluster_cache(const QString& p_sFileName, const QString& p_sKey, const MNEForwardSolution& p_fwdClustered);
+
 public:
     FiffInfoBase info;                  /**< light weighted measurement info */
     fiff_int_t source_ori;              /**< Source orientation: fixed or free */
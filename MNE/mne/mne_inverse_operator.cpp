@@ -55,6 +55,7 @@
 // Qt INCLUDES
 //=============================================================================================================
 
+#include <QByteArray>
 #include <QFuture>
 #include <QtConcurrent>
 
@@ -148,6 +149,44 @@ MNEInverseOperator::MNEInverseOperator(const MNEInverseOperator &p_MNEInverseOpe
 }
 
 
+//*************************************************************************************************************
+
+MNEInverseOperator& MNEInverseOperator::operator=(const MNEInverseOperator &p_MNEInverseOperator)
+{
+    if(this == &p_MNEInverseOperator)
+        return *this;
+
+    info = p_MNEInverseOperator.info;
+    methods = p_MNEInverseOperator.methods;
+    source_ori = p_MNEInverseOperator.source_ori;
+    nsource = p_MNEInverseOperator.nsource;
+    nchan = p_MNEInverseOperator.nchan;
+    coord_frame = p_MNEInverseOperator.coord_frame;
+    source_nn = p_MNEInverseOperator.source_nn;
+    sing = p_MNEInverseOperator.sing;
+    eigen_leads_weighted = p_MNEInverseOperator.eigen_leads_weighted;
+    eigen_leads = p_MNEInverseOperator.eigen_leads;
+    eigen_fields = p_MNEInverseOperator.eigen_fields;
+    noise_cov = p_MNEInverseOperator.noise_cov;
+    source_cov = p_MNEInverseOperator.source_cov;
+    orient_prior = p_MNEInverseOperator.orient_prior;
+    depth_prior = p_MNEInverseOperator.depth_prior;
+    fmri_prior = p_MNEInverseOperator.fmri_prior;
+    src = p_MNEInverseOperator.src;
+    mri_head_t = p_MNEInverseOperator.mri_head_t;
+    nave = p_MNEInverseOperator.nave;
+    projs = p_MNEInverseOperator.projs;
+    proj = p_MNEInverseOperator.proj;
+    whitener = p_MNEInverseOperator.whitener;
+    reginv = p_MNEInverseOperator.reginv;
+    noisenorm = p_MNEInverseOperator.noisenorm;
+
+    clear_kernel_cache();
+
+    return *this;
+}
+
+
 //*************************************************************************************************************
 
 MNEInverseOperator::~MNEInverseOperator()
@@ -160,8 +199,48 @@ MNEInverseOperator::~MNEInverseOperator()
 
 bool MNEInverseOperator::assemble_kernel(const Label &label, QString method, bool pick_normal, MatrixXd &K, SparseMatrix<double> &noise_norm, QList<VectorXi> &vertno)
 {
-    MatrixXd t_eigen_leads = this->eigen_leads->data;
-    MatrixXd t_source_cov = this->source_cov->data;
+    MatrixXd t_K_left;
+    MatrixXd t_K_right;
+
+    if(!assemble_kernel_factors(label, method, pick_normal, t_K_left, t_K_right, noise_norm, vertno))
+        return false;
+
+    K = t_K_left*t_K_right;
+
+    //store assembled kernel
+    m_K = K;
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool MNEInverseOperator::assemble_kernel_factors(const Label &label, QString method, bool pick_normal, MatrixXd &K_left, MatrixXd &K_right, SparseMatrix<double> &noise_norm, QList<VectorXi> &vertno)
+{
+    //
+    //   Label restricted kernels are cached
+    //
+    QString t_sCacheKey;
+    if(!label.isEmpty())
+    {
+        //The key only narrows the search, the entry is verified against the full vertex list
+        uint t_iVertexHash = qHash(QByteArray::fromRawData(reinterpret_cast<const char*>(label.vertices.data()), label.vertices.size()*sizeof(int)));
+        t_sCacheKey = QString("%1_%2_%3_%4_%5_%6").arg(label.name).arg(label.hemi).arg(label.label_id)
+                .arg(label.vertices.size()).arg(t_iVertexHash).arg(method + (pick_normal ? "_normal" : ""));
+
+        QHash<QString, KernelCacheEntry>::const_iterator it = m_qHashKernelCache.constFind(t_sCacheKey);
+        if(it != m_qHashKernelCache.constEnd() && m_matKernelRight.size() > 0
+                && it->label_vertices.size() == label.vertices.size() && it->label_vertices == label.vertices)
+        {
+            K_left = it->K_left;
+            K_right = m_matKernelRight;
+            noise_norm = it->noise_norm;
+            vertno = it->vertno;
+            return true;
+        }
+    }
+
     if(method.compare("MNE") != 0)
         noise_norm = this->noisenorm;
 
@@ -170,56 +249,47 @@ bool MNEInverseOperator::assemble_kernel(const Label &label, QString method, boo
     typedef Eigen::Triplet<double> T;
     std::vector<T> tripletList;
 
+    qint32 nComp = this->source_ori == FIFFV_MNE_FREE_ORI ? 3 : 1;
+
+    //
+    //   Rows of the eigen leads which belong to the kernel -> the full eigen leads are never copied
+    //
+    VectorXi t_vecRowSel;
     if(!label.isEmpty())
     {
-        qDebug() << "ToDo: Label selection needs to be debugged - not done jet!";
         VectorXi src_sel;
         vertno = this->src.label_src_vertno_sel(label, src_sel);
 
         if(method.compare("MNE") != 0)
         {
+            //Index map: source -> position within the label
+            VectorXi t_vecSrcMap = VectorXi::Constant(noise_norm.rows() > noise_norm.cols() ? noise_norm.rows() : noise_norm.cols(), -1);
+            for(qint32 i = 0; i < src_sel.size(); ++i)
+                if(src_sel[i] < t_vecSrcMap.size())
+                    t_vecSrcMap[src_sel[i]] = i;
+
             tripletList.clear();
-            tripletList.reserve(noise_norm.nonZeros());
+            tripletList.reserve(src_sel.size());
 
             for (qint32 k = 0; k < noise_norm.outerSize(); ++k)
-            {
                 for (SparseMatrix<double>::InnerIterator it(noise_norm,k); it; ++it)
-                {
-                    //ToDo bad search - increase speed by using stl search
-                    qint32 row = -1;
-                    for(qint32 i = 0; i < src_sel.size(); ++i)
-                        if(src_sel[i] == it.row())
-                            row = i;
-                    if(row != -1)
-                        tripletList.push_back(T(it.row(), it.col(), it.value()));
-                }
-            }
+                    if(t_vecSrcMap[it.row()] != -1 && t_vecSrcMap[it.col()] != -1)
+                        tripletList.push_back(T(t_vecSrcMap[it.row()], t_vecSrcMap[it.col()], it.value()));
 
-            noise_norm = SparseMatrix<double>(src_sel.size(),noise_norm.cols());
+            noise_norm = SparseMatrix<double>(src_sel.size(),src_sel.size());
             noise_norm.setFromTriplets(tripletList.begin(), tripletList.end());
         }
 
-        if(this->source_ori == FIFFV_MNE_FREE_ORI)
-        {
-            VectorXi src_sel_new(src_sel.size()*3);
-
-            for(qint32 i = 0; i < src_sel.size(); ++i)
-            {
-                src_sel_new[i*3] = src_sel[i]*3;
-                src_sel_new[i*3+1] = src_sel[i]*3+1;
-                src_sel_new[i*3+2] = src_sel[i]*3+2;
-            }
-            src_sel = src_sel_new;
-        }
-
-
+        t_vecRowSel.resize(src_sel.size()*nComp);
         for(qint32 i = 0; i < src_sel.size(); ++i)
-        {
-            t_eigen_leads.row(i) = t_eigen_leads.row(src_sel[i]);
-            t_source_cov = t_source_cov.row(src_sel[i]);
-        }
-        t_eigen_leads.conservativeResize(src_sel.size(), t_eigen_leads.cols());
-        t_source_cov.conservativeResize(src_sel.size(), t_source_cov.cols());
+            for(qint32 j = 0; j < nComp; ++j)
+                t_vecRowSel[i*nComp+j] = src_sel[i]*nComp+j;
+    }
+    else
+    {
+        t_vecRowSel.resize(this->eigen_leads->data.rows());
+        for(qint32 i = 0; i < t_vecRowSel.size(); ++i)
+            t_vecRowSel[i] = i;
     }
 
     if(pick_normal)
@@ -239,30 +309,40 @@ bool MNEInverseOperator::assemble_kernel(const Label &label, QString method, boo
 
         // keep only the normal components
         qint32 count = 0;
-        for(qint32 i = 2; i < t_eigen_leads.rows(); i+=3)
+        for(qint32 i = 2; i < t_vecRowSel.size(); i+=3)
         {
-            t_eigen_leads.row(count) = t_eigen_leads.row(i);
+            t_vecRowSel[count] = t_vecRowSel[i];
             ++count;
         }
-        t_eigen_leads.conservativeResize(count, t_eigen_leads.cols());
-
-        count = 0;
-        for(qint32 i = 2; i < t_source_cov.rows(); i+=3)
-        {
-            t_source_cov.row(count) = t_source_cov.row(i);
-            ++count;
-        }
-        t_source_cov.conservativeResize(count, t_source_cov.cols());
+        t_vecRowSel.conservativeResize(count);
     }
 
-    tripletList.clear();
-    tripletList.reserve(reginv.rows());
+    //
+    //   Only the eigen components which survive the regularization contribute
+    //   -> K = (R^0.5 * eigen_leads)(:,sel) * (reginv(sel) * eigen_fields(sel,:) * whitener * proj)
+    //
+    qint32 t_iRank = 0;
     for(qint32 i = 0; i < reginv.rows(); ++i)
-        tripletList.push_back(T(i, i, reginv(i,0)));
-    SparseMatrix<double> t_reginv(reginv.rows(),reginv.rows());
-    t_reginv.setFromTriplets(tripletList.begin(), tripletList.end());
+        if(reginv(i) != 0)
+            ++t_iRank;
+
+    VectorXi t_vecCompSel(t_iRank);
+    t_iRank = 0;
+    for(qint32 i = 0; i < reginv.rows(); ++i)
+        if(reginv(i) != 0)
+            t_vecCompSel[t_iRank++] = i;
+
+    //The right factor does not depend on the label -> it is cached until clear_kernel_cache
+    if(m_matKernelRight.size() == 0)
+    {
+        MatrixXd t_matFields = eigen_fields->data*whitener*proj;
+
+        m_matKernelRight.resize(t_iRank, t_matFields.cols());
+        for(qint32 c = 0; c < t_iRank; ++c)
+            m_matKernelRight.row(c) = reginv(t_vecCompSel[c])*t_matFields.row(t_vecCompSel[c]);
+    }
+    K_right = m_matKernelRight;
 
-    MatrixXd trans = t_reginv*eigen_fields->data*whitener*proj;
     //
     //   Transformation into current distributions by weighting the eigenleads
     //   with the weights computed above
@@ -273,35 +353,51 @@ bool MNEInverseOperator::assemble_kernel(const Label &label, QString method, boo
         //     R^0.5 has been already factored in
         //
         printf("(eigenleads already weighted)...");
-        K = t_eigen_leads*trans;
     }
     else
     {
         //
         //     R^0.5 has to factored in
         //
-       printf("(eigenleads need to be weighted)...");
+        printf("(eigenleads need to be weighted)...");
+    }
 
-       std::vector<T> tripletList2;
-       tripletList2.reserve(t_source_cov.rows());
-       for(qint32 i = 0; i < t_source_cov.rows(); ++i)
-           tripletList2.push_back(T(i, i, sqrt(t_source_cov(i,0))));
-       SparseMatrix<double> t_sourceCov(t_source_cov.rows(),t_source_cov.rows());
-       t_sourceCov.setFromTriplets(tripletList2.begin(), tripletList2.end());
+    const MatrixXd& t_eigen_leads = this->eigen_leads->data;
+    K_left.resize(t_vecRowSel.size(), t_iRank);
+    for(qint32 c = 0; c < t_iRank; ++c)
+        for(qint32 i = 0; i < t_vecRowSel.size(); ++i)
+            K_left(i, c) = t_eigen_leads(t_vecRowSel[i], t_vecCompSel[c]);
 
-       K = t_sourceCov*t_eigen_leads*trans;
-    }
+    if (!eigen_leads_weighted)
+        for(qint32 i = 0; i < t_vecRowSel.size(); ++i)
+            K_left.row(i) *= sqrt(this->source_cov->data(t_vecRowSel[i],0));
 
     if(method.compare("MNE") == 0)
         noise_norm = SparseMatrix<double>();
 
-    //store assembled kernel
-    m_K = K;
+    if(!t_sCacheKey.isEmpty())
+    {
+        KernelCacheEntry t_entry;
+        t_entry.label_vertices = label.vertices;
+        t_entry.K_left = K_left;
+        t_entry.noise_norm = noise_norm;
+        t_entry.vertno = vertno;
+        m_qHashKernelCache.insert(t_sCacheKey, t_entry);
+    }
 
     return true;
 }
 
 
+//*************************************************************************************************************
+
+void MNEInverseOperator::clear_kernel_cache()
+{
+    m_qHashKernelCache.clear();
+    m_matKernelRight.resize(0,0);
+}
+
+
 //*************************************************************************************************************
 
 bool MNEInverseOperator::check_ch_names(const FiffInfo &info) const
@@ -1071,6 +1167,13 @@ MNEInverseOperator MNEInverseOperator::prepare_inverse_operator(qint32 nave ,flo
             //
             //   noise_norm = kron(sqrt(mne_combine_xyz(noise_norm)),ones(3,1));
         }
+        else
+        {
+            //
+            //   Fixed orientation: one factor per row of the eigen leads
+            //
+            noise_norm_new = noise_norm;
+        }
         VectorXd vOnes = VectorXd::Ones(noise_norm_new.size());
         VectorXd tmp = vOnes.cwiseQuotient(noise_norm_new.cwiseAbs());
 //        if(inv.noisenorm)
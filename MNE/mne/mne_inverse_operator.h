@@ -74,6 +74,7 @@
 //=============================================================================================================
 
 #include <QList>
+#include <QHash>
 
 
 //*************************************************************************************************************
@@ -146,7 +147,7 @@ struct RegionMT
         // Kmeans Reduction
         RegionMTOut p_RegionMTOut;
 
-        KMeans t_kMeans(t_sDistMeasure, QString("sample"), 5);
+        KMeans t_kMeans(t_sDistMeasure, QString("plus"), 5);
 
         t_kMeans.calculate(this->matRoiMT, this->nClusters, p_RegionMTOut.roiIdx, p_RegionMTOut.ctrs, p_RegionMTOut.sumd, p_RegionMTOut.D);
 
@@ -205,6 +206,16 @@ public:
     */
     MNEInverseOperator(const MNEInverseOperator &p_MNEInverseOperator);
 
+    //=========================================================================================================
+    /**
+    * Assignment operator. The kernel cache is not taken over, it belongs to the operator it was assembled from.
+    *
+    * @param[in] p_MNEInverseOperator   Inverse operator which should be assigned.
+    *
+    * @return this inverse operator
+    */
+    MNEInverseOperator& operator=(const MNEInverseOperator &p_MNEInverseOperator);
+
     //=========================================================================================================
     /**
     * Destroys the MNEInverseOperator.
@@ -230,6 +241,32 @@ public:
     */
     bool assemble_kernel(const Label &label, QString method, bool pick_normal, MatrixXd &K, SparseMatrix<double> &noise_norm, QList<VectorXi> &vertno);
 
+    //=========================================================================================================
+    /**
+    * Assembles the imaging kernel in its factored form K = K_left * K_right. The inner dimension is the
+    * number of eigen components which are not regularized away, i.e. it is at most the number of channels.
+    * The stored kernel (getKernel) is not updated. Label restricted factors are cached per label, method and
+    * pick_normal; the label independent right factor is shared by all labels.
+    *
+    * @param[in] label          labels.
+    * @param[in] method         The applied normals. ("MNE" | "dSPM" | "sLORETA")
+    * @param[in] pick_normal    Pick normals.
+    * @param[out] K_left        Weighted eigen leads (nsources*ncomp x rank).
+    * @param[out] K_right       Regularized eigen fields times whitener and projector (rank x nchan).
+    * @param[out] noise_norm    Noise normals.
+    * @param[out] vertno        Vertices of the hemispheres.
+    *
+    * @return true when successful, false otherwise
+    */
+    bool assemble_kernel_factors(const Label &label, QString method, bool pick_normal, MatrixXd &K_left, MatrixXd &K_right, SparseMatrix<double> &noise_norm, QList<VectorXi> &vertno);
+
+    //=========================================================================================================
+    /**
+    * Clears the cached kernel factors. Has to be called when members which enter the kernel (e.g. reginv,
+    * eigen_leads, whitener) are changed directly.
+    */
+    void clear_kernel_cache();
+
     //=========================================================================================================
     /**
     * Check that channels in inverse operator are measurements.
@@ -381,7 +418,21 @@ public:
     SparseMatrix<double> noisenorm;         /**< These are the noise-normalization factors */
 
 private:
+    //=========================================================================================================
+    /**
+    * Cached label restricted kernel factors.
+    */
+    struct KernelCacheEntry
+    {
+        VectorXi label_vertices;            /**< Vertices of the label the entry was assembled for */
+        MatrixXd K_left;                    /**< Weighted eigen leads of the label */
+        SparseMatrix<double> noise_norm;    /**< Noise normalization of the label */
+        QList<VectorXi> vertno;             /**< Vertices of the label */
+    };
+
     MatrixXd m_K;                           /**< Everytime a new kernel is assamebled a copy is stored here */
+    MatrixXd m_matKernelRight;              /**< Cached label independent right kernel factor */
+    QHash<QString, KernelCacheEntry> m_qHashKernelCache;  /**< Cached label restricted kernel factors */
 };
 
 //*************************************************************************************************************
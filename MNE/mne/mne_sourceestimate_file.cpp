@@ -0,0 +1,370 @@
+//=============================================================================================================
+/**
+* @file     mne_sourceestimate_file.cpp
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    MNESourceEstimateFile class implementation.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "mne_sourceestimate_file.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QDataStream>
+#include <QByteArray>
+#include <QtEndian>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <string.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace MNELIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+MNESourceEstimateView::MNESourceEstimateView(const MNESourceEstimateFile* p_pFile, qint32 start, qint32 n)
+: m_pFile(p_pFile)
+, m_iStart(start)
+, m_iN(n)
+{
+}
+
+
+//*************************************************************************************************************
+
+MNESourceEstimateView MNESourceEstimateView::reduce(qint32 start, qint32 n) const
+{
+    if(start < 0 || n < 0 || start + n > m_iN)
+    {
+        printf("Error: Samples %d to %d are out of the view range (%d samples).\n", start, start + n - 1, m_iN);
+        return MNESourceEstimateView(m_pFile, m_iStart, 0);
+    }
+    return MNESourceEstimateView(m_pFile, m_iStart + start, n);
+}
+
+
+//*************************************************************************************************************
+
+bool MNESourceEstimateView::readBlock(qint32 start, qint32 n, MatrixXd& p_matData) const
+{
+    if(!m_pFile || start < 0 || n < 0 || start + n > m_iN)
+        return false;
+    return m_pFile->readBlock(m_iStart + start, n, p_matData);
+}
+
+
+//*************************************************************************************************************
+
+MNESourceEstimate MNESourceEstimateView::toSourceEstimate() const
+{
+    MatrixXd t_matData;
+    if(!readBlock(0, m_iN, t_matData))
+        return MNESourceEstimate();
+    return MNESourceEstimate(t_matData, m_pFile->vertices(), this->tmin(), m_pFile->tstep());
+}
+
+
+//*************************************************************************************************************
+
+float MNESourceEstimateView::tmin() const
+{
+    return m_pFile ? m_pFile->tmin() + m_iStart*m_pFile->tstep() : 0;
+}
+
+
+//*************************************************************************************************************
+
+MNESourceEstimateFile::MNESourceEstimateFile(const QString& p_sFileName)
+: m_file(p_sFileName)
+, m_pMap(NULL)
+, m_bWritable(false)
+, m_iNumTimes(0)
+, m_fTmin(0)
+, m_fTstep(-1)
+{
+}
+
+
+//*************************************************************************************************************
+
+MNESourceEstimateFile::~MNESourceEstimateFile()
+{
+    close();
+}
+
+
+//*************************************************************************************************************
+
+bool MNESourceEstimateFile::create(const VectorXi& p_vertices, float p_tmin, float p_tstep)
+{
+    close();
+
+    if(!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate))
+    {
+        printf("Failed to create source estimate file %s!\n", m_file.fileName().toUtf8().constData());
+        return false;
+    }
+
+    QDataStream t_stream(&m_file);
+    t_stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    t_stream.setByteOrder(QDataStream::BigEndian);
+    t_stream.setVersion(QDataStream::Qt_5_0);
+
+    // start time and sampling rate in ms
+    t_stream << (float)1000*p_tmin;
+    t_stream << (float)1000*p_tstep;
+    // vertices
+    t_stream << (quint32)p_vertices.size();
+    for(qint32 i = 0; i < p_vertices.size(); ++i)
+        t_stream << (quint32)p_vertices[i];
+    // no time points yet
+    t_stream << (quint32)0;
+
+    if(t_stream.status() != QDataStream::Ok)
+    {
+        m_file.close();
+        return false;
+    }
+
+    m_vertices = p_vertices;
+    m_iNumTimes = 0;
+    m_fTmin = p_tmin;
+    m_fTstep = p_tstep;
+    m_bWritable = true;
+
+    return m_file.flush();
+}
+
+
+//*************************************************************************************************************
+
+bool MNESourceEstimateFile::open(QIODevice::OpenMode p_mode)
+{
+    close();
+
+    if(!m_file.open(p_mode))
+        return false;
+
+    QDataStream t_stream(&m_file);
+    t_stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    t_stream.setByteOrder(QDataStream::BigEndian);
+    t_stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 t_nVertices, t_nTimePts;
+    t_stream >> m_fTmin;
+    m_fTmin /= 1000;
+    t_stream >> m_fTstep;
+    m_fTstep /= 1000;
+    t_stream >> t_nVertices;
+    if(t_stream.status() != QDataStream::Ok || (qint64)t_nVertices*4 > m_file.size())
+    {
+        printf("Error: %s is not a source estimate file.\n", m_file.fileName().toUtf8().constData());
+        close();
+        return false;
+    }
+    m_vertices = VectorXi(t_nVertices);
+    for(quint32 i = 0; i < t_nVertices; ++i)
+        t_stream >> m_vertices[i];
+    t_stream >> t_nTimePts;
+    m_iNumTimes = t_nTimePts;
+
+    qint64 t_iSize = dataOffset() + (qint64)m_iNumTimes*m_vertices.size()*4;
+    if(t_stream.status() != QDataStream::Ok || m_file.size() < t_iSize)
+    {
+        printf("Error: Source estimate file %s is truncated.\n", m_file.fileName().toUtf8().constData());
+        close();
+        return false;
+    }
+
+    m_bWritable = (p_mode & QIODevice::WriteOnly) != 0;
+    if(m_bWritable)
+    {
+        // Drop the remains of an interrupted append
+        if(m_file.size() > t_iSize)
+            m_file.resize(t_iSize);
+    }
+    else
+        m_pMap = m_file.map(0, m_file.size());
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void MNESourceEstimateFile::close()
+{
+    if(m_pMap)
+    {
+        m_file.unmap(m_pMap);
+        m_pMap = NULL;
+    }
+    if(m_file.isOpen())
+        m_file.close();
+    m_bWritable = false;
+}
+
+
+//*************************************************************************************************************
+
+bool MNESourceEstimateFile::append(const MatrixXd& p_matData)
+{
+    if(!m_bWritable)
+    {
+        printf("Error: Source estimate file %s is not open for writing.\n", m_file.fileName().toUtf8().constData());
+        return false;
+    }
+    if(p_matData.rows() != m_vertices.size())
+    {
+        printf("Error: Data has %ld rows, the source estimate file %d vertices.\n", (long)p_matData.rows(), (int)m_vertices.size());
+        return false;
+    }
+
+    qint32 n = p_matData.cols();
+    QByteArray t_buf(4*n*m_vertices.size(), Qt::Uninitialized);
+    uchar* t_pBuf = (uchar*)t_buf.data();
+    for(qint32 t = 0; t < n; ++t)
+    {
+        for(qint32 i = 0; i < p_matData.rows(); ++i, t_pBuf += 4)
+        {
+            float value = (float)p_matData(i,t);
+            quint32 bits;
+            memcpy(&bits, &value, 4);
+            qToBigEndian(bits, t_pBuf);
+        }
+    }
+
+    if(!m_file.seek(dataOffset() + (qint64)m_iNumTimes*m_vertices.size()*4) || m_file.write(t_buf) != t_buf.size())
+        return false;
+    m_iNumTimes += n;
+
+    return writeNumTimes() && m_file.flush();
+}
+
+
+//*************************************************************************************************************
+
+bool MNESourceEstimateFile::append(const MNESourceEstimate& p_stc)
+{
+    if(p_stc.vertices.size() != m_vertices.size() || p_stc.vertices != m_vertices)
+    {
+        printf("Error: Vertices of the source estimate do not match the source estimate file.\n");
+        return false;
+    }
+    return append(p_stc.data);
+}
+
+
+//*************************************************************************************************************
+
+bool MNESourceEstimateFile::readBlock(qint32 start, qint32 n, MatrixXd& p_matData) const
+{
+    if(!m_file.isOpen() || start < 0 || n < 0 || start + n > m_iNumTimes)
+        return false;
+
+    qint32 nVert = m_vertices.size();
+    qint64 t_iOffset = dataOffset() + (qint64)start*nVert*4;
+    qint64 t_iBytes = (qint64)n*nVert*4;
+
+    QByteArray t_buf;
+    const uchar* t_pData;
+    if(m_pMap)
+        t_pData = m_pMap + t_iOffset;
+    else
+    {
+        if(!m_file.seek(t_iOffset))
+            return false;
+        t_buf = m_file.read(t_iBytes);
+        if(t_buf.size() != t_iBytes)
+            return false;
+        t_pData = (const uchar*)t_buf.constData();
+    }
+
+    // stc stores one time point after the other, i.e. column major
+    p_matData.resize(nVert, n);
+    double* t_pOut = p_matData.data();
+    for(qint64 i = 0; i < (qint64)n*nVert; ++i, t_pData += 4)
+    {
+        quint32 bits = qFromBigEndian<quint32>(t_pData);
+        float value;
+        memcpy(&value, &bits, 4);
+        t_pOut[i] = value;
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+MNESourceEstimateView MNESourceEstimateFile::reduce(qint32 start, qint32 n) const
+{
+    return view().reduce(start, n);
+}
+
+
+//*************************************************************************************************************
+
+MNESourceEstimateView MNESourceEstimateFile::view() const
+{
+    return MNESourceEstimateView(this, 0, m_iNumTimes);
+}
+
+
+//*************************************************************************************************************
+
+bool MNESourceEstimateFile::writeNumTimes()
+{
+    uchar t_count[4];
+    qToBigEndian((quint32)m_iNumTimes, t_count);
+    return m_file.seek(numTimesOffset()) && m_file.write((const char*)t_count, 4) == 4;
+}
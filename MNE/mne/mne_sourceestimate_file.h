@@ -0,0 +1,458 @@
+//=============================================================================================================
+/**
+* @file     mne_sourceestimate_file.h
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     MNESourceEstimateFile class declaration.
+*
+*/
+
+#ifndef MNESOURCEESTIMATEFILE_H
+#define MNESOURCEESTIMATEFILE_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "mne_global.h"
+#include "mne_sourceestimate.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QFile>
+#include <QString>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE MNELIB
+//=============================================================================================================
+
+namespace MNELIB
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// FORWARD DECLARATIONS
+//=============================================================================================================
+
+class MNESourceEstimateFile;
+
+
+//=============================================================================================================
+/**
+* A time range of a MNESourceEstimateFile. Views only hold the range; data is read from the file on request.
+*
+* @brief Time range view of an out-of-core source estimate
+*/
+class MNESHARED_EXPORT MNESourceEstimateView
+{
+public:
+    //=========================================================================================================
+    /**
+    * Constructs a view of n time points of p_pFile starting at start.
+    *
+    * @param[in] p_pFile    The source estimate file, has to outlive the view.
+    * @param[in] start      First time point of the view.
+    * @param[in] n          Number of time points.
+    */
+    MNESourceEstimateView(const MNESourceEstimateFile* p_pFile = NULL, qint32 start = 0, qint32 n = 0);
+
+    //=========================================================================================================
+    /**
+    * Reduces the view to selected samples. No data is read.
+    *
+    * @param[in] start  The start index relative to this view.
+    * @param[in] n      Number of samples.
+    *
+    * @return the reduced view
+    */
+    MNESourceEstimateView reduce(qint32 start, qint32 n) const;
+
+    //=========================================================================================================
+    /**
+    * Reads a block of the view.
+    *
+    * @param[in] start      The start index relative to this view.
+    * @param[in] n          Number of samples.
+    * @param[out] p_matData The data [n_dipoles x n].
+    *
+    * @return true if successful, false otherwise
+    */
+    bool readBlock(qint32 start, qint32 n, MatrixXd& p_matData) const;
+
+    //=========================================================================================================
+    /**
+    * Reads the whole view into memory.
+    *
+    * @return the source estimate of this view, empty if reading failed
+    */
+    MNESourceEstimate toSourceEstimate() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the first time point of the view in the file.
+    *
+    * @return the first time point
+    */
+    inline qint32 start() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of time points.
+    *
+    * @return the number of time points
+    */
+    inline qint32 numTimes() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the time of the first time point of the view.
+    *
+    * @return the start time
+    */
+    float tmin() const;
+
+private:
+    const MNESourceEstimateFile*    m_pFile;    /**< The viewed file. */
+    qint32                          m_iStart;   /**< First time point in the file. */
+    qint32                          m_iN;       /**< Number of time points. */
+};
+
+
+//=============================================================================================================
+/**
+* Source estimate kept in an stc file instead of memory. The stc layout stores all vertices of one time point
+* next to each other, so any time range is one contiguous region of the file: blocks are read by random access
+* (through a memory map when opened read only) and new time points are appended while the file stays a valid
+* stc file, readable by MNESourceEstimate::read.
+*
+* @brief Out-of-core source estimate
+*/
+class MNESHARED_EXPORT MNESourceEstimateFile
+{
+public:
+    typedef QSharedPointer<MNESourceEstimateFile> SPtr;             /**< Shared pointer type for MNESourceEstimateFile. */
+    typedef QSharedPointer<const MNESourceEstimateFile> ConstSPtr;  /**< Const shared pointer type for MNESourceEstimateFile. */
+
+    //=========================================================================================================
+    /**
+    * Constructs a source estimate file.
+    *
+    * @param[in] p_sFileName    The stc file.
+    */
+    explicit MNESourceEstimateFile(const QString& p_sFileName);
+
+    //=========================================================================================================
+    /**
+    * Destroys the source estimate file, the file is closed.
+    */
+    ~MNESourceEstimateFile();
+
+    //=========================================================================================================
+    /**
+    * Creates a new, empty stc file and opens it for appending. An existing file is truncated.
+    *
+    * @param[in] p_vertices The indices of the dipoles.
+    * @param[in] p_tmin     Time starting point.
+    * @param[in] p_tstep    Time step.
+    *
+    * @return true if successful, false otherwise
+    */
+    bool create(const VectorXi& p_vertices, float p_tmin, float p_tstep);
+
+    //=========================================================================================================
+    /**
+    * Opens an existing stc file. Only the header is read. Read only files are memory mapped if possible,
+    * ReadWrite allows appending.
+    *
+    * @param[in] p_mode     QIODevice::ReadOnly or QIODevice::ReadWrite
+    *
+    * @return true if successful, false otherwise
+    */
+    bool open(QIODevice::OpenMode p_mode = QIODevice::ReadOnly);
+
+    //=========================================================================================================
+    /**
+    * Closes the file.
+    */
+    void close();
+
+    //=========================================================================================================
+    /**
+    * Appends time points. The time count in the header is updated after every append, so the file is a
+    * complete stc file at any time.
+    *
+    * @param[in] p_matData  The data [n_dipoles x n_times].
+    *
+    * @return true if successful, false otherwise
+    */
+    bool append(const MatrixXd& p_matData);
+
+    //=========================================================================================================
+    /**
+    * Appends a source estimate; its vertices have to match the ones of the file.
+    *
+    * @param[in] p_stc      The source estimate to append.
+    *
+    * @return true if successful, false otherwise
+    */
+    bool append(const MNESourceEstimate& p_stc);
+
+    //=========================================================================================================
+    /**
+    * Reads a block of time points. Reading from a memory mapped file is thread safe.
+    *
+    * @param[in] start      The first time point.
+    * @param[in] n          Number of time points.
+    * @param[out] p_matData The data [n_dipoles x n].
+    *
+    * @return true if successful, false otherwise
+    */
+    bool readBlock(qint32 start, qint32 n, MatrixXd& p_matData) const;
+
+    //=========================================================================================================
+    /**
+    * Returns a view of the selected samples without reading any data.
+    *
+    * @param[in] start  The start index.
+    * @param[in] n      Number of samples.
+    *
+    * @return the view
+    */
+    MNESourceEstimateView reduce(qint32 start, qint32 n) const;
+
+    //=========================================================================================================
+    /**
+    * Returns a view of all samples without reading any data.
+    *
+    * @return the view
+    */
+    MNESourceEstimateView view() const;
+
+    //=========================================================================================================
+    /**
+    * Returns whether the file is open.
+    *
+    * @return true if open, false otherwise
+    */
+    inline bool isOpen() const;
+
+    //=========================================================================================================
+    /**
+    * Returns whether the file is memory mapped.
+    *
+    * @return true if mapped, false otherwise
+    */
+    inline bool isMapped() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the indices of the dipoles.
+    *
+    * @return the vertices
+    */
+    inline const VectorXi& vertices() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of dipoles.
+    *
+    * @return the number of dipoles
+    */
+    inline qint32 numVertices() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of time points in the file.
+    *
+    * @return the number of time points
+    */
+    inline qint32 numTimes() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the time starting point.
+    *
+    * @return the start time
+    */
+    inline float tmin() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the time step.
+    *
+    * @return the time step
+    */
+    inline float tstep() const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Byte offset of the time count in the header.
+    */
+    inline qint64 numTimesOffset() const;
+
+    //=========================================================================================================
+    /**
+    * Byte offset of the first sample.
+    */
+    inline qint64 dataOffset() const;
+
+    //=========================================================================================================
+    /**
+    * Writes the time count to the header.
+    */
+    bool writeNumTimes();
+
+    mutable QFile   m_file;         /**< The stc file. */
+    uchar*          m_pMap;         /**< Memory map of the whole file, NULL if not mapped. */
+    bool            m_bWritable;    /**< If append is allowed. */
+    VectorXi        m_vertices;     /**< The indices of the dipoles. */
+    qint32          m_iNumTimes;    /**< Number of time points in the file. */
+    float           m_fTmin;        /**< Time starting point. */
+    float           m_fTstep;       /**< Time step. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline qint32 MNESourceEstimateView::start() const
+{
+    return m_iStart;
+}
+
+
+//*************************************************************************************************************
+
+inline qint32 MNESourceEstimateView::numTimes() const
+{
+    return m_iN;
+}
+
+
+//*************************************************************************************************************
+
+inline bool MNESourceEstimateFile::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+
+//*************************************************************************************************************
+
+inline bool MNESourceEstimateFile::isMapped() const
+{
+    return m_pMap != NULL;
+}
+
+
+//*************************************************************************************************************
+
+inline const VectorXi& MNESourceEstimateFile::vertices() const
+{
+    return m_vertices;
+}
+
+
+//*************************************************************************************************************
+
+inline qint32 MNESourceEstimateFile::numVertices() const
+{
+    return m_vertices.size();
+}
+
+
+//*************************************************************************************************************
+
+inline qint32 MNESourceEstimateFile::numTimes() const
+{
+    return m_iNumTimes;
+}
+
+
+//*************************************************************************************************************
+
+inline float MNESourceEstimateFile::tmin() const
+{
+    return m_fTmin;
+}
+
+
+//*************************************************************************************************************
+
+inline float MNESourceEstimateFile::tstep() const
+{
+    return m_fTstep;
+}
+
+
+//*************************************************************************************************************
+
+inline qint64 MNESourceEstimateFile::numTimesOffset() const
+{
+    return 12 + 4*(qint64)m_vertices.size();
+}
+
+
+//*************************************************************************************************************
+
+inline qint64 MNESourceEstimateFile::dataOffset() const
+{
+    return numTimesOffset() + 4;
+}
+
+} //NAMESPACE
+
+#endif // MNESOURCEESTIMATEFILE_H
@@ -135,7 +135,7 @@ QList<VectorXi> MNESourceSpace::label_src_vertno_sel(const Label &p_label, Vecto
     else if (p_label.hemi == 1) //rh
     {
         VectorXi vertno_sel = MNEMath::intersect(vertno[1], p_label.vertices, src_sel);
-        src_sel.array() += p_label.vertices.size();
+        src_sel.array() += vertno[0].size();
         vertno[0] = VectorXi();
         vertno[1] = vertno_sel;
     }
@@ -189,7 +189,7 @@ void RtClient::run()
 
             emit rawBufferReceived(t_matRawBuffer);
         }
-        else if(FIFF_DATA_BUFFER == FIFF_BLOCK_END)
+        else if(kind == FIFF_BLOCK_END)
             m_bIsRunning = false;
 
         printf("[done]\n");
@@ -42,6 +42,15 @@
 
 #include "rtdataclient.h"
 #include <fiff/fiff_file.h>
+#include <fiff/fiff_constants.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtEndian>
 
 
 //*************************************************************************************************************
@@ -360,25 +369,100 @@ FiffInfo::SPtr RtDataClient::readInfo()
 
 void RtDataClient::readRawBuffer(qint32 p_nChannels, MatrixXf& data, fiff_int_t& kind)
 {
-//        data = [];
-
-    FiffStream t_fiffStream(this);
     //
-    // Find the start
+    // Read the tag header: kind, type, size, next (big endian)
     //
-    FiffTag::SPtr t_pTag;
+    qint32 t_header[4];
+    if(!readBlocking((char*)t_header, sizeof(t_header)))
+    {
+        kind = FIFF_BLOCK_END;
+        return;
+    }
+
+    kind = qFromBigEndian<qint32>(t_header[0]);
+    qint32 t_iSize = qFromBigEndian<qint32>(t_header[2]);
 
-    t_fiffStream.read_rt_tag(t_pTag);
+    if(kind == FIFF_DATA_BUFFER && p_nChannels > 0)
+    {
+        //
+        // Read the samples in place
+        //
+        qint32 nSamples = (t_iSize/4)/p_nChannels;
+        if(data.rows() != p_nChannels || data.cols() != nSamples)
+            data.resize(p_nChannels, nSamples);
 
-    kind = t_pTag->kind;
+        //A short read leaves a half filled buffer, it is reported like the end of the measurement
+        qint64 t_iDataSize = 4 * (qint64)p_nChannels * nSamples;
+        if(!readBlocking((char*)data.data(), t_iDataSize))
+        {
+            kind = FIFF_BLOCK_END;
+            return;
+        }
 
-    if(kind == FIFF_DATA_BUFFER)
+        //Skip a remainder which does not fill a whole sample
+        if(t_iSize > t_iDataSize)
+        {
+            m_blockRecv.resize(t_iSize - t_iDataSize);
+            if(!readBlocking(m_blockRecv.data(), t_iSize - t_iDataSize))
+            {
+                kind = FIFF_BLOCK_END;
+                return;
+            }
+        }
+
+        //Byte swap in place
+        quint32* t_pData = (quint32*)data.data();
+        const qint64 nel = (qint64)p_nChannels * nSamples;
+        for(qint64 i = 0; i < nel; ++i)
+            t_pData[i] = qFromBigEndian<quint32>(t_pData[i]);
+    }
+    else
     {
-        qint32 nSamples = (t_pTag->size()/4)/p_nChannels;
-        data = MatrixXf(Map< MatrixXf >(t_pTag->toFloat(), p_nChannels, nSamples));
+        //
+        // Other tags go to the reused receive buffer
+        //
+        m_blockRecv.resize(t_iSize);
+        if(!readBlocking(m_blockRecv.data(), t_iSize))
+        {
+            kind = FIFF_BLOCK_END;
+            return;
+        }
+
+        if(kind == FIFF_MNE_RT_DATA_BUFFER_ENCODED)
+        {
+            //Only a valid buffer is handed out as raw buffer, otherwise the encoded kind is left to be skipped
+            if(!FiffDataBufferCodec::decode(m_blockRecv.constData(), t_iSize, data))
+                printf("RtDataClient::readRawBuffer - Could not decode the raw buffer.\n");
+            else if(data.rows() != p_nChannels)
+                printf("RtDataClient::readRawBuffer - Received %d channels, expected %d.\n", (int)data.rows(), p_nChannels);
+            else
+                kind = FIFF_DATA_BUFFER;
+        }
     }
-//        else
-//            data = tag.data;
+}
+
+
+//*************************************************************************************************************
+
+bool RtDataClient::readBlocking(char* p_pData, qint64 p_iSize)
+{
+    qint64 t_iRead = 0;
+    while(t_iRead < p_iSize)
+    {
+        if(this->bytesAvailable() <= 0 && !this->waitForReadyRead(10))
+        {
+            if(this->state() != QAbstractSocket::ConnectedState)
+                return false;
+            continue;
+        }
+
+        qint64 t_iChunk = this->read(p_pData + t_iRead, p_iSize - t_iRead);
+        if(t_iChunk < 0)
+            return false;
+        t_iRead += t_iChunk;
+    }
+
+    return true;
 }
 
 
@@ -390,3 +474,13 @@ void RtDataClient::setClientAlias(const QString &p_sAlias)
     t_fiffStream.write_rt_command(2, p_sAlias);//MNE_RT.MNE_RT_SET_CLIENT_ALIAS, alias);
     this->flush();
 }
+
+
+//*************************************************************************************************************
+
+void RtDataClient::setDataEncoding(FiffDataBufferCodec::Encoding p_encoding)
+{
+    FiffStream t_fiffStream(this);
+    t_fiffStream.write_rt_command(3, QString::number(p_encoding));//MNE_RT.MNE_RT_SET_DATA_ENCODING, encoding);
+    this->flush();
+}
@@ -54,6 +54,7 @@
 #include <fiff/fiff_stream.h>
 #include <fiff/fiff_info.h>
 #include <fiff/fiff_tag.h>
+#include <fiff/fiff_data_buffer_codec.h>
 
 
 //*************************************************************************************************************
@@ -62,6 +63,7 @@
 //=============================================================================================================
 
 #include <QSharedPointer>
+#include <QByteArray>
 #include <QString>
 #include <QTcpSocket>
 
@@ -138,10 +140,15 @@ public:
 
     //=========================================================================================================
     /**
-    * Reads fiff measurement information of a data the connection
+    * Reads a raw buffer from the data connection. Compactly encoded buffers are decoded and reported with kind
+    * FIFF_DATA_BUFFER, or keep their FIFF_MNE_RT_DATA_BUFFER_ENCODED kind if they are invalid or do not match
+    * p_nChannels. If the connection breaks while reading, kind is FIFF_BLOCK_END, as for the end of the
+    * measurement, and data must not be used.
+    * The samples are read directly into data and byte swapped in place. data is only resized if the number of
+    * channels or samples changed, so reusing the same matrix avoids any per buffer allocation.
     *
     * @param[in] p_nChannels    Number of channels to reshape the received data
-    * @param[out] data          The read data - ToDo change this to raw buffer data object
+    * @param[in, out] data      The read data. Reused if it already has the right size.
     * @param[out] kind          Data kind
     */
     void readRawBuffer(qint32 p_nChannels, MatrixXf& data, fiff_int_t& kind);
@@ -154,8 +161,29 @@ public:
     */
     void setClientAlias(const QString &p_sAlias);
 
+    //=========================================================================================================
+    /**
+    * Requests the encoding in which mne_rt_server sends the raw buffers to this client.
+    * Int16 and Int24 are lossy, DeltaBitpack is lossless.
+    *
+    * @param[in] p_encoding     The raw buffer encoding
+    */
+    void setDataEncoding(FiffDataBufferCodec::Encoding p_encoding);
+
 private:
-    qint32 m_clientID;  /**< Corresponding client id of the data client at mne_rt_server */
+    //=========================================================================================================
+    /**
+    * Blocks until p_iSize bytes were read from the connection.
+    *
+    * @param[out] p_pData   Destination of the read bytes
+    * @param[in] p_iSize    Number of bytes to read
+    *
+    * @return true if succeeded, false if the connection was lost
+    */
+    bool readBlocking(char* p_pData, qint64 p_iSize);
+
+    qint32 m_clientID;          /**< Corresponding client id of the data client at mne_rt_server */
+    QByteArray m_blockRecv;     /**< Reused receive buffer for tags which are not read in place */
 
 signals:
     
@@ -59,6 +59,16 @@
 //=============================================================================================================
 
 #include <QDebug>
+#include <QList>
+#include <QtConcurrent>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define KMEANS_BLOCK 2048   /**< Minimal number of points per thread when the distances are split across threads */
 
 
 //*************************************************************************************************************
@@ -74,13 +84,19 @@ using namespace UTILSLIB;
 // DEFINE MEMBER METHODS
 //=============================================================================================================
 
-KMeans::KMeans(QString distance, QString start, qint32 replicates, QString emptyact, bool online, qint32 maxit)
+KMeans::KMeans(QString distance, QString start, qint32 replicates, QString emptyact, bool online, qint32 maxit, qint32 numThreads, double tol)
 : m_sDistance(distance)
 , m_sStart(start)
 , m_iReps(replicates)
 , m_sEmptyact(emptyact)
 , m_iMaxit(maxit)
 , m_bOnline(online)
+, m_iNumThreads(numThreads)
+, m_dTol(tol)
+, m_bFixedSeed(false)
+, m_iSeed(0)
+, m_iRandState(1)
+, m_bTolReached(false)
 , emptyErrCnt(0)
 , iter(0)
 , k(0)
@@ -92,6 +108,9 @@ KMeans::KMeans(QString distance, QString start, qint32 replicates, QString empty
     // Assume one replicate
     if (m_iReps < 1)
         m_iReps = 1;
+
+    if (m_iNumThreads < 1)
+        m_iNumThreads = 1;
 }
 
 
@@ -102,8 +121,9 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
     if (kClusters < 1)
         return false;
 
-    //Init random generator
-    srand ( time(NULL) );
+    //Init random generator -> the replicates derive their sequences from this seed
+    if (!m_bFixedSeed)
+        m_iSeed = (quint32)time(NULL);
 
 // n points in p dimensional space
     k = kClusters;
@@ -152,15 +172,13 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
         Xmaxs = X.colwise().maxCoeff();
     }
 
+    // Squared norms of the points for the matrix product based squared euclidean distance
+    if (m_sDistance.compare("sqeuclidean") == 0)
+        m_vecXSqNorm = X.rowwise().squaredNorm();
+
     //
     // Done with input argument processing, begin clustering
     //
-    if (m_bOnline)
-    {
-        Del = MatrixXd(n,k);
-        Del.fill(std::numeric_limits<double>::quiet_NaN());// reassignment criterion
-    }
-
     double totsumDBest = std::numeric_limits<double>::max();
     emptyErrCnt = 0;
 
@@ -169,115 +187,66 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
     VectorXd sumDBest;
     MatrixXd Dbest;
 
-    for(qint32 rep = 0; rep < m_iReps; ++rep)
+    if (m_iNumThreads > 1 && m_iReps > 1)
     {
-        if (m_sStart.compare("uniform") == 0)
-        {
-            C = MatrixXd::Zero(k,p);
-            for(qint32 i = 0; i < k; ++i)
-                for(qint32 j = 0; j < p; ++j)
-                    C(i,j) = unifrnd(Xmins[j], Xmaxs[j]);
-            // For 'cosine' and 'correlation', these are uniform inside a subset
-            // of the unit hypersphere.  Still need to center them for
-            // 'correlation'.  (Re)normalization for 'cosine'/'correlation' is
-            // done at each iteration.
-            if (m_sDistance.compare("correlation") == 0)
-                C.array() -= (C.array().rowwise().sum()/p).replicate(1, p).array();
-        }
-        else if (m_sStart.compare("sample") == 0)
+        //
+        // Replicates are independent -> run them in parallel, each one on its own copy of the algorithm state
+        //
+        QList<KMeansReplicate> t_qListReps;
+        for(qint32 rep = 0; rep < m_iReps; ++rep)
         {
-            C = MatrixXd::Zero(k,p);
-            for(qint32 i = 0; i < k; ++i)
-                C.block(i,0,1,p) = X.block(rand() % n, 0, 1, p);
-            // DEBUG
-//            C.block(0,0,1,p) = X.block(2, 0, 1, p);
-//            C.block(1,0,1,p) = X.block(7, 0, 1, p);
-//            C.block(2,0,1,p) = X.block(17, 0, 1, p);
+            KMeansReplicate t_rep;
+            t_rep.kMeans = *this;
+            t_rep.kMeans.m_iNumThreads = 1;
+            t_rep.X = &X;
+            t_rep.Xmins = &Xmins;
+            t_rep.Xmaxs = &Xmaxs;
+            t_rep.rep = rep;
+            t_rep.ok = false;
+            t_qListReps.append(t_rep);
         }
-    //    else if (start.compare("cluster") == 0)
-    //    {
-    //        Xsubset = X(randsample(n,floor(.1*n)),:);
-    //        [dum, C] = kmeans(Xsubset, k, varargin{:}, 'start','sample', 'replicates',1);
-    //    }
-    //    else if (start.compare("numeric") == 0)
-    //    {
-    //        C = CC(:,:,rep);
-    //    }
-
-        // Compute the distance from every point to each cluster centroid and the
-        // initial assignment of points to clusters
-        D = distfun(X, C);//, 0);
-        idx = VectorXi::Zero(D.rows());
-        d = VectorXd::Zero(D.rows());
 
-        for(qint32 i = 0; i < D.rows(); ++i)
-            d[i] = D.row(i).minCoeff(&idx[i]);
+        QtConcurrent::blockingMap(t_qListReps, runReplicateJob);
 
-        m = VectorXi::Zero(k);
-        for(qint32 i = 0; i < k; ++i)
-            for (qint32 j = 0; j < idx.rows(); ++j)
-                if(idx[j] == i)
-                    ++ m[i];
-
-        try // catch empty cluster errors and move on to next rep
+        for(qint32 rep = 0; rep < t_qListReps.size(); ++rep)
         {
-            // Begin phase one:  batch reassignments
-            bool converged = batchUpdate(X, C, idx);
-
-            // Begin phase two:  single reassignments
-            if (m_bOnline)
-                converged = onlineUpdate(X, C, idx);
-
-            if (!converged)
-                printf("Failed To Converge during replicate %d\n", rep);
-
-            // Calculate cluster-wise sums of distances
-            VectorXi nonempties = VectorXi::Zero(m.rows());
-            quint32 count = 0;
-            for(qint32 i = 0; i < m.rows(); ++i)
+            if(!t_qListReps[rep].ok)
             {
-                if(m[i] > 0)
-                {
-                    nonempties[i] = 1;
-                    ++count;
-                }
-            }
-            MatrixXd C_tmp(count,C.cols());
-            count = 0;
-            for(qint32 i = 0; i < nonempties.rows(); ++i)
-            {
-                if(nonempties[i])
-                {
-                    C_tmp.row(count) = C.row(i);
-                    ++count;
-                }
+                ++emptyErrCnt;
+                continue;
             }
 
-            MatrixXd D_tmp = distfun(X, C_tmp);//, iter);
-            count = 0;
-            for(qint32 i = 0; i < nonempties.rows(); ++i)
+            // Save the best solution so far
+            if (t_qListReps[rep].totsumD < totsumDBest)
             {
-                if(nonempties[i])
-                {
-                    D.col(i) = D_tmp.col(count);
-                    C.row(i) = C_tmp.row(count);
-                    ++count;
-                }
+                totsumDBest = t_qListReps[rep].totsumD;
+                idxBest = t_qListReps[rep].idx;
+                Cbest = t_qListReps[rep].C;
+                sumDBest = t_qListReps[rep].sumD;
+                Dbest = t_qListReps[rep].D;
             }
+        }
 
-            d = VectorXd::Zero(n);
-            for(qint32 i = 0; i < n; ++i)
-                d[i] += D.array()(idx[i]*n+i);//Colum Major
-
-            sumD = VectorXd::Zero(k);
-            for(qint32 i = 0; i < k; ++i)
-                for (qint32 j = 0; j < idx.rows(); ++j)
-                    if(idx[j] == i)
-                        sumD[i] += d[j];
+        if (emptyErrCnt == m_iReps)
+            return false;
+    }
+    else
+    {
+        for(qint32 rep = 0; rep < m_iReps; ++rep)
+        {
+            if(!runReplicate(X, Xmins, Xmaxs, rep, idx, C, sumD, D))
+            {
+                // If an empty cluster error occurred in one of multiple replicates,
+                // move on to next replicate. Error only when all replicates fail.
+                if (m_iReps == 1)
+                    return false;
 
-            totsumD = sumD.array().sum();
+                emptyErrCnt = emptyErrCnt + 1;
+                if (emptyErrCnt == m_iReps)
+                    return false;
 
-//            printf("%d iterations, total sum of distances = %f\n", iter, totsumD);
+                continue;
+            }
 
             // Save the best solution so far
             if (totsumD < totsumDBest)
@@ -288,31 +257,8 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
                 sumDBest = sumD;
                 Dbest = D;
             }
-        }
-        catch (int e)
-        {
-            if(e == 0)
-            {
-                // If an empty cluster error occurred in one of multiple replicates, catch
-                // it, warn, and move on to next replicate.  Error only when all replicates
-                // fail.  Rethrow an other kind of error.
-                if (m_iReps == 1)
-                    return false;
-                else
-                {
-                    emptyErrCnt = emptyErrCnt + 1;
-//                    printf("Replicate %d terminated: empty cluster created at iteration %d.\n", rep, iter);
-                    if (emptyErrCnt == m_iReps)
-                    {
-//                        error(message('EmptyClusterAllReps'));
-                        return false;
-                    }
-
-                }
-            }
-        } // catch
-
-    } // replicates
+        } // replicates
+    }
 
     // Return the best solution
     idx = idxBest;
@@ -327,6 +273,169 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
 }
 
 
+//*************************************************************************************************************
+
+void KMeans::runReplicateJob(KMeansReplicate& job)
+{
+    job.ok = job.kMeans.runReplicate(*job.X, *job.Xmins, *job.Xmaxs, job.rep, job.idx, job.C, job.sumD, job.D);
+    job.totsumD = job.kMeans.totsumD;
+}
+
+
+//*************************************************************************************************************
+
+bool KMeans::runReplicate(const MatrixXd& X, const RowVectorXd& Xmins, const RowVectorXd& Xmaxs, qint32 rep,
+                          VectorXi& idx, MatrixXd& C, VectorXd& sumD, MatrixXd& D)
+{
+    // Replicates must not share a random generator, they may run in parallel
+    seedReplicate(rep);
+    m_bTolReached = false;
+
+    if (m_bOnline)
+    {
+        Del = MatrixXd(n,k);
+        Del.fill(std::numeric_limits<double>::quiet_NaN());// reassignment criterion
+    }
+
+    if (m_sStart.compare("uniform") == 0)
+    {
+        C = MatrixXd::Zero(k,p);
+        for(qint32 i = 0; i < k; ++i)
+            for(qint32 j = 0; j < p; ++j)
+                C(i,j) = unifrnd(Xmins[j], Xmaxs[j]);
+        // For 'cosine' and 'correlation', these are uniform inside a subset
+        // of the unit hypersphere.  Still need to center them for
+        // 'correlation'.  (Re)normalization for 'cosine'/'correlation' is
+        // done at each iteration.
+        if (m_sDistance.compare("correlation") == 0)
+            C.array() -= (C.array().rowwise().sum()/p).replicate(1, p).array();
+    }
+    else if (m_sStart.compare("sample") == 0)
+    {
+        C = MatrixXd::Zero(k,p);
+        for(qint32 i = 0; i < k; ++i)
+            C.block(i,0,1,p) = X.block(randInt(n), 0, 1, p);
+    }
+    else if (m_sStart.compare("plus") == 0)
+    {
+        // k-means++: the next centroid is drawn with a probability proportional to the squared distance to
+        // the closest centroid chosen so far
+        C = MatrixXd::Zero(k,p);
+        C.row(0) = X.row(randInt(n));
+
+        VectorXd minD = distfun(X, C.topRows(1)).col(0);
+        for(qint32 i = 1; i < k; ++i)
+        {
+            VectorXd weights = m_sDistance.compare("sqeuclidean") == 0 ? minD : VectorXd(minD.array().square());
+            double total = weights.sum();
+
+            qint32 next = 0;
+            if (total > 0)
+            {
+                double r = total * randUniform();
+                double acc = weights[0];
+                while (acc <= r && next < n-1)
+                    acc += weights[++next];
+            }
+            else
+                next = randInt(n);
+
+            C.row(i) = X.row(next);
+            if (i < k-1)
+                minD = minD.cwiseMin(distfun(X, C.row(i)).col(0));
+        }
+    }
+//    else if (start.compare("cluster") == 0)
+//    {
+//        Xsubset = X(randsample(n,floor(.1*n)),:);
+//        [dum, C] = kmeans(Xsubset, k, varargin{:}, 'start','sample', 'replicates',1);
+//    }
+//    else if (start.compare("numeric") == 0)
+//    {
+//        C = CC(:,:,rep);
+//    }
+
+    // Compute the distance from every point to each cluster centroid and the
+    // initial assignment of points to clusters
+    D = distfun(X, C);//, 0);
+    idx = VectorXi::Zero(D.rows());
+    d = VectorXd::Zero(D.rows());
+
+    for(qint32 i = 0; i < D.rows(); ++i)
+        d[i] = D.row(i).minCoeff(&idx[i]);
+
+    m = VectorXi::Zero(k);
+    for (qint32 j = 0; j < idx.rows(); ++j)
+        ++ m[idx[j]];
+
+    try // catch empty cluster errors and move on to next rep
+    {
+        // Begin phase one:  batch reassignments
+        bool converged = batchUpdate(X, C, idx);
+
+        // Begin phase two:  single reassignments, not when the batch phase already reached the tolerance
+        if (m_bOnline && !m_bTolReached)
+            converged = onlineUpdate(X, C, idx);
+
+        if (!converged)
+            printf("Failed To Converge during replicate %d\n", rep);
+
+        // Calculate cluster-wise sums of distances
+        VectorXi nonempties = VectorXi::Zero(m.rows());
+        quint32 count = 0;
+        for(qint32 i = 0; i < m.rows(); ++i)
+        {
+            if(m[i] > 0)
+            {
+                nonempties[i] = 1;
+                ++count;
+            }
+        }
+        MatrixXd C_tmp(count,C.cols());
+        count = 0;
+        for(qint32 i = 0; i < nonempties.rows(); ++i)
+        {
+            if(nonempties[i])
+            {
+                C_tmp.row(count) = C.row(i);
+                ++count;
+            }
+        }
+
+        MatrixXd D_tmp = distfun(X, C_tmp);//, iter);
+        count = 0;
+        for(qint32 i = 0; i < nonempties.rows(); ++i)
+        {
+            if(nonempties[i])
+            {
+                D.col(i) = D_tmp.col(count);
+                C.row(i) = C_tmp.row(count);
+                ++count;
+            }
+        }
+
+        d = VectorXd::Zero(n);
+        for(qint32 i = 0; i < n; ++i)
+            d[i] += D.array()(idx[i]*n+i);//Colum Major
+
+        sumD = VectorXd::Zero(k);
+        for (qint32 j = 0; j < idx.rows(); ++j)
+            sumD[idx[j]] += d[j];
+
+        totsumD = sumD.array().sum();
+
+//        printf("%d iterations, total sum of distances = %f\n", iter, totsumD);
+    }
+    catch (int e)
+    {
+        if(e == 0)
+            return false;
+    } // catch
+
+    return true;
+}
+
+
 //*************************************************************************************************************
 
 bool KMeans::batchUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
@@ -440,6 +549,14 @@ bool KMeans::batchUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
             break;
         }
 
+        // Early exit when the objective improves less than the relative tolerance
+        if (m_dTol > 0 && prevtotsumD < std::numeric_limits<double>::max() && (prevtotsumD - totsumD) <= m_dTol * totsumD)
+        {
+            converged = true;
+            m_bTolReached = true;
+            break;
+        }
+
 //        printf("%6d\t%6d\t%8d\t%12g\n",iter,1,moved.rows(),totsumD);
         if (iter >= m_iMaxit)
             break;
@@ -626,7 +743,10 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
 
                 Del.col(i) = ((double)m[i] / ((double)m[i] + sgn.cast<double>().array()));
 
-                Del.col(i).array() *= (X - C.row(i).replicate(n,1)).array().pow(2).rowwise().sum().array();
+                // ||x||^2 + ||c||^2 - 2 x*c instead of forming X - C(i)
+                VectorXd t_vecDist = m_vecXSqNorm - 2.0 * X * C.row(i).transpose();
+                t_vecDist.array() += C.row(i).squaredNorm();
+                Del.col(i).array() *= t_vecDist.array().max(0.0);
             }
         }
         else if (m_sDistance.compare("cityblock") == 0)
@@ -881,31 +1001,55 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
 
 //*************************************************************************************************************
 //DISTFUN Calculate point to cluster centroid distances.
-MatrixXd KMeans::distfun(const MatrixXd& X, MatrixXd& C)//, qint32 iter)
+MatrixXd KMeans::distfun(const MatrixXd& X, const MatrixXd& C)//, qint32 iter)
 {
     MatrixXd D = MatrixXd::Zero(n,C.rows());
     qint32 nclusts = C.rows();
 
     if (m_sDistance.compare("sqeuclidean") == 0)
     {
-        for(qint32 i = 0; i < nclusts; ++i)
+        // ||x||^2 + ||c||^2 - 2 X*C^T -> one matrix product
+        RowVectorXd t_vecCSqNorm = C.rowwise().squaredNorm().transpose();
+
+        if (m_iNumThreads > 1 && n >= 2*KMEANS_BLOCK)
         {
-            D.col(i) = (X.col(0).array() - C(i,0)).pow(2);
+            qint32 t_iRowsPerJob = (n + m_iNumThreads - 1) / m_iNumThreads;
+            if (t_iRowsPerJob < KMEANS_BLOCK)
+                t_iRowsPerJob = KMEANS_BLOCK;
+
+            QList<KMeansDistBlock> t_qListBlocks;
+            for(qint32 first = 0; first < n; first += t_iRowsPerJob)
+            {
+                KMeansDistBlock t_block;
+                t_block.X = &X;
+                t_block.C = &C;
+                t_block.xSqNorm = &m_vecXSqNorm;
+                t_block.cSqNorm = &t_vecCSqNorm;
+                t_block.first = first;
+                t_block.rows = first + t_iRowsPerJob < n ? t_iRowsPerJob : n - first;
+                t_block.D = &D;
+                t_qListBlocks.append(t_block);
+            }
 
-            for(qint32 j = 1; j < p; ++j)
-                D.col(i) = D.col(i).array() + (X.col(j).array() - C(i,j)).pow(2);
+            QtConcurrent::blockingMap(t_qListBlocks, sqeuclideanBlock);
+        }
+        else
+        {
+            KMeansDistBlock t_block;
+            t_block.X = &X;
+            t_block.C = &C;
+            t_block.xSqNorm = &m_vecXSqNorm;
+            t_block.cSqNorm = &t_vecCSqNorm;
+            t_block.first = 0;
+            t_block.rows = n;
+            t_block.D = &D;
+            sqeuclideanBlock(t_block);
         }
     }
     else if (m_sDistance.compare("cityblock") == 0)
     {
         for(qint32 i = 0; i < nclusts; ++i)
-        {
-            D.col(i) = (X.col(0).array() - C(i,0)).array().abs();
-            for(qint32 j = 1; j < p; ++j)
-            {
-                D.col(i).array() += (X.col(j).array() - C(i,j)).array().abs();
-            }
-        }
+            D.col(i) = (X.rowwise() - C.row(i)).cwiseAbs().rowwise().sum();
     }
     else if (m_sDistance.compare("cosine") == 0 || m_sDistance.compare("correlation") == 0)
     {
@@ -936,6 +1080,21 @@ MatrixXd KMeans::distfun(const MatrixXd& X, MatrixXd& C)//, qint32 iter)
 } // function
 
 
+//*************************************************************************************************************
+
+void KMeans::sqeuclideanBlock(KMeansDistBlock& block)
+{
+    MatrixXd& D = *block.D;
+
+    D.middleRows(block.first, block.rows).noalias() = -2.0 * block.X->middleRows(block.first, block.rows) * block.C->transpose();
+    D.middleRows(block.first, block.rows).colwise() += block.xSqNorm->segment(block.first, block.rows);
+    D.middleRows(block.first, block.rows).rowwise() += *block.cSqNorm;
+
+    // Rounding can produce small negative values
+    D.middleRows(block.first, block.rows) = D.middleRows(block.first, block.rows).cwiseMax(0.0);
+}
+
+
 //*************************************************************************************************************
 //GCENTROIDS Centroids and counts stratified by group.
 void KMeans::gcentroids(const MatrixXd& X, const VectorXi& index, const VectorXi& clusts,
@@ -946,6 +1105,31 @@ void KMeans::gcentroids(const MatrixXd& X, const VectorXi& index, const VectorXi
     centroids.fill(std::numeric_limits<double>::quiet_NaN());
     counts = VectorXi::Zero(num);
 
+    if(m_sDistance.compare("sqeuclidean") == 0 || m_sDistance.compare("cosine") == 0 || m_sDistance.compare("correlation") == 0)
+    {
+        // Mean of the members -> one pass over the points instead of one per cluster
+        VectorXi t_vecPos = VectorXi::Constant(k, -1);
+        for(qint32 i = 0; i < num; ++i)
+            t_vecPos[clusts[i]] = i;
+
+        MatrixXd t_matSums = MatrixXd::Zero(num,p);
+        for(qint32 j = 0; j < index.rows(); ++j)
+        {
+            qint32 pos = t_vecPos[index[j]];
+            if(pos >= 0)
+            {
+                t_matSums.row(pos) += X.row(j);
+                ++counts[pos];
+            }
+        }
+
+        for(qint32 i = 0; i < num; ++i)
+            if(counts[i] > 0)
+                centroids.row(i) = t_matSums.row(i) / counts[i]; // unnormalized for cosine and correlation
+
+        return;
+    }
+
     VectorXi members;
 
     qint32 c;
@@ -1027,7 +1211,59 @@ double KMeans::unifrnd(double a, double b)
     double mu = a2+b2;
     double sig = b2-a2;
 
-    double r = mu + sig * (2.0* (rand() % 1000)/1000 -1.0);
+    double r = mu + sig * (2.0*randUniform() - 1.0);
 
     return r;
 }
+
+
+//*************************************************************************************************************
+
+void KMeans::setSeed(quint32 seed)
+{
+    m_bFixedSeed = true;
+    m_iSeed = seed;
+}
+
+
+//*************************************************************************************************************
+
+void KMeans::seedReplicate(qint32 rep)
+{
+    // Scramble seed and replicate number (murmur3 finalizer) -> neighbouring replicates get unrelated sequences
+    quint32 h = m_iSeed ^ ((quint32)rep * 0x9E3779B9u);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+
+    m_iRandState = h != 0 ? h : 0x2545F491u; // xorshift must not start at 0
+}
+
+
+//*************************************************************************************************************
+
+quint32 KMeans::nextRand()
+{
+    m_iRandState ^= m_iRandState << 13;
+    m_iRandState ^= m_iRandState >> 17;
+    m_iRandState ^= m_iRandState << 5;
+    return m_iRandState;
+}
+
+
+//*************************************************************************************************************
+
+qint32 KMeans::randInt(qint32 n)
+{
+    return (qint32)(randUniform() * n);
+}
+
+
+//*************************************************************************************************************
+
+double KMeans::randUniform()
+{
+    return nextRand() / 4294967296.0;
+}
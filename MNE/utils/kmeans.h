@@ -77,6 +77,14 @@ namespace UTILSLIB
 
 using namespace Eigen;
 
+
+//*************************************************************************************************************
+//=============================================================================================================
+// FORWARD DECLARATIONS
+//=============================================================================================================
+
+struct KMeansReplicate;
+
 //=============================================================================================================
 /**
 * K-Means Clustering
@@ -98,13 +106,17 @@ public:
     * Constructs a KMeans algorithm object.
     *
     * @param[in] distance   (optional) K-Means distance measure: "sqeuclidean" (default), "cityblock" , "cosine", "correlation", "hamming"
-    * @param[in] start      (optional) Cluster initialization: "sample" (default), "uniform", "cluster"
+    * @param[in] start      (optional) Cluster initialization: "sample" (default), "uniform", "plus" (k-means++), "cluster"
     * @param[in] replicates (optional) Number of K-Means replicates, which are generated. Best is returned.
     * @param[in] emptyact   (optional) What happens if a cluster wents empty: "error" (default), "drop", "singleton"
     * @param[in] online     (optional) If centroids should be updated during iterations: true (default), false
     * @param[in] maxit      (optional) maximal number of iterations per replicate; 100 by default
+    * @param[in] numThreads (optional) Number of threads; replicates run in parallel, a single replicate splits the
+    *                       squared euclidean distances across the threads. 1 by default
+    * @param[in] tol        (optional) Batch iterations stop when the total sum of distances improves by less than
+    *                       tol relative to it; 0 (run until no point moves) by default
     */
-    explicit KMeans(QString distance = QString("sqeuclidean") , QString start = QString("sample"), qint32 replicates = 1, QString emptyact = QString("error"), bool online = true, qint32 maxit = 100);
+    explicit KMeans(QString distance = QString("sqeuclidean") , QString start = QString("sample"), qint32 replicates = 1, QString emptyact = QString("error"), bool online = true, qint32 maxit = 100, qint32 numThreads = 1, double tol = 0.0);
 
     //=========================================================================================================
     /**
@@ -119,8 +131,67 @@ public:
     */
     bool calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C, VectorXd& sumD, MatrixXd& D);
 
+    //=========================================================================================================
+    /**
+    * Sets a fixed seed for the random initialization. Every replicate derives its own random sequence from the
+    * seed and its replicate number, so the result does not depend on the number of threads. Without a fixed
+    * seed calculate seeds from the current time.
+    *
+    * @param[in] seed   The seed.
+    */
+    void setSeed(quint32 seed);
+
 
 private:
+    //=========================================================================================================
+    /**
+    * Rows of the squared euclidean distance matrix which are computed by one thread.
+    */
+    struct KMeansDistBlock
+    {
+        const MatrixXd* X;          /**< Input data */
+        const MatrixXd* C;          /**< Cluster centroids */
+        const VectorXd* xSqNorm;    /**< Squared norms of the points */
+        const RowVectorXd* cSqNorm; /**< Squared norms of the centroids */
+        qint32 first;               /**< First point */
+        qint32 rows;                /**< Number of points */
+        MatrixXd* D;                /**< Distances the rows are written to */
+    };
+
+    //=========================================================================================================
+    /**
+    * Runs one replicate: initialization, batch and online phase.
+    *
+    * @param[in] X          Input data (rows = points; cols = p dimensional space)
+    * @param[in] Xmins      Minima of the input data (only used by the uniform start)
+    * @param[in] Xmaxs      Maxima of the input data (only used by the uniform start)
+    * @param[in] rep        Replicate number
+    * @param[out] idx       The cluster indeces to which cluster the input points belong to
+    * @param[out] C         Cluster centroids k x p
+    * @param[out] sumD      Summation of the distances to the centroid within one cluster
+    * @param[out] D         Cluster distances to the centroid
+    *
+    * @return true if successful, false if the replicate failed with an empty cluster
+    */
+    bool runReplicate(const MatrixXd& X, const RowVectorXd& Xmins, const RowVectorXd& Xmaxs, qint32 rep,
+                      VectorXi& idx, MatrixXd& C, VectorXd& sumD, MatrixXd& D);
+
+    //=========================================================================================================
+    /**
+    * Runs one replicate of a parallel calculation.
+    *
+    * @param[in, out] job   The replicate.
+    */
+    static void runReplicateJob(KMeansReplicate& job);
+
+    //=========================================================================================================
+    /**
+    * Computes a block of squared euclidean distances as ||x||^2 + ||c||^2 - 2 X*C^T.
+    *
+    * @param[in, out] block The block.
+    */
+    static void sqeuclideanBlock(KMeansDistBlock& block);
+
     //=========================================================================================================
     /**
     * Calculate point to cluster centroid distances.
@@ -130,7 +201,7 @@ private:
     *
     * @return Cluster centroid distances
     */
-    MatrixXd distfun(const MatrixXd& X, MatrixXd& C);//, qint32 iter);
+    MatrixXd distfun(const MatrixXd& X, const MatrixXd& C);//, qint32 iter);
 
     //=========================================================================================================
     /**
@@ -181,6 +252,40 @@ private:
     */
     double unifrnd(double a, double b);
 
+    //=========================================================================================================
+    /**
+    * Seeds the random sequence of one replicate.
+    *
+    * @param[in] rep    Replicate number
+    */
+    void seedReplicate(qint32 rep);
+
+    //=========================================================================================================
+    /**
+    * Next number of the random sequence of the current replicate (xorshift).
+    *
+    * @return random number
+    */
+    quint32 nextRand();
+
+    //=========================================================================================================
+    /**
+    * Uniform random integer in [0, n)
+    *
+    * @param[in] n      upper boundary (exclusive)
+    *
+    * @return random number
+    */
+    qint32 randInt(qint32 n);
+
+    //=========================================================================================================
+    /**
+    * Uniform random number in [0, 1)
+    *
+    * @return random number
+    */
+    double randUniform();
+
 
     QString m_sDistance;    /**< Distance measurement to use: "sqeuclidean" (default), "cityblock" , "cosine", "correlation", "hamming". */
     QString m_sStart;       /**< Initialization to use: "sample" (default), "uniform", "cluster". */
@@ -188,6 +293,12 @@ private:
     QString m_sEmptyact;    /**< What should be done if a cluster wents empty: "error" (default), "drop", "singleton" */
     qint32 m_iMaxit;        /**< Maximal number of iterations per replicate */
     bool m_bOnline;         /**< If online update should be performed */
+    qint32 m_iNumThreads;   /**< Number of threads */
+    double m_dTol;          /**< Relative tolerance of the batch phase early exit */
+    bool m_bFixedSeed;      /**< If the seed was set by setSeed */
+    quint32 m_iSeed;        /**< Seed of the current calculation */
+    quint32 m_iRandState;   /**< State of the random sequence of the current replicate */
+    bool m_bTolReached;     /**< If the batch phase stopped on the tolerance -> the online phase is skipped */
 
     qint32 emptyErrCnt;     /**< Counts the occurence of empty errors */
 
@@ -205,7 +316,28 @@ private:
     double prevtotsumD;     /**< Sum of centroid distances of the previous iteration */
 
     VectorXi previdx;       /**< Previous point cluster indeces */
+    VectorXd m_vecXSqNorm;  /**< Squared norms of the points (sqeuclidean only) */
+
+};
+
 
+//=============================================================================================================
+/**
+* One replicate of a parallel K-Means calculation
+*/
+struct KMeansReplicate
+{
+    KMeans kMeans;              /**< Algorithm state of this replicate */
+    const MatrixXd* X;          /**< Input data */
+    const RowVectorXd* Xmins;   /**< Minima of the input data */
+    const RowVectorXd* Xmaxs;   /**< Maxima of the input data */
+    qint32 rep;                 /**< Replicate number */
+    bool ok;                    /**< If the replicate was successful */
+    double totsumD;             /**< Total sum of distances */
+    VectorXi idx;               /**< Cluster indeces */
+    MatrixXd C;                 /**< Cluster centroids */
+    VectorXd sumD;              /**< Cluster-wise sums of distances */
+    MatrixXd D;                 /**< Distances to the centroids */
 };
 
 } // NAMESPACE
@@ -41,6 +41,8 @@
 #include "fiffproducer.h"
 #include "fiffsimulator.h"
 
+#include <fiff/fiff_tag.h>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -49,6 +51,7 @@
 
 #include <QDebug>
 #include <QFile>
+#include <QSharedPointer>
 
 
 //*************************************************************************************************************
@@ -59,6 +62,86 @@
 using namespace FIFFSIMULATORPLUGIN;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+/**
+* Reads the samples p_iFrom ... p_iTo of a raw file into the columns starting at p_iCol of a float buffer. The
+* buffers are calibrated and converted tag by tag straight into the float buffer. Only files with projectors or
+* compensators go through FiffRawData::read_raw_segment and its double matrix.
+*
+* @param[in] p_raw          The raw file.
+* @param[in] p_iFrom        First sample to read.
+* @param[in] p_iTo          Last sample to read.
+* @param[out] p_matBuffer   The float buffer, at least p_raw.info.nchan rows.
+* @param[in] p_iCol         First column of p_matBuffer to fill.
+*
+* @return true if succeeded, false otherwise.
+*/
+static bool read_raw_segment_float(FiffRawData& p_raw, fiff_int_t p_iFrom, fiff_int_t p_iTo, MatrixXf& p_matBuffer, fiff_int_t p_iCol)
+{
+    qint32 nchan = p_raw.info.nchan;
+
+    if(p_raw.proj.size() > 0 || p_raw.comp.kind != -1)
+    {
+        MatrixXd data, times;
+        if(!p_raw.read_raw_segment(data, times, p_iFrom, p_iTo))
+            return false;
+        p_matBuffer.block(0, p_iCol, nchan, p_iTo - p_iFrom + 1) = data.cast<float>();
+        return true;
+    }
+
+    FiffStream::SPtr fid = p_raw.file;
+    if(!fid->device()->isOpen() && !fid->device()->open(QIODevice::ReadOnly))
+    {
+        printf("Cannot open file %s\n", p_raw.info.filename.toUtf8().constData());
+        return false;
+    }
+
+    VectorXf t_vecCals = p_raw.cals.transpose().cast<float>();
+
+    FiffTag::SPtr t_pTag;
+    for(qint32 k = 0; k < p_raw.rawdir.size(); ++k)
+    {
+        const FiffRawDir& t_rawDir = p_raw.rawdir[k];
+        if(t_rawDir.last < p_iFrom)
+            continue;
+        if(t_rawDir.first > p_iTo)
+            break;
+
+        //Picked samples of this buffer and their destination
+        fiff_int_t first_pick = qMax(p_iFrom - t_rawDir.first, 0);
+        fiff_int_t picksamp = qMin(p_iTo, t_rawDir.last) - t_rawDir.first - first_pick + 1;
+        Block<MatrixXf> t_block = p_matBuffer.block(0, p_iCol + t_rawDir.first + first_pick - p_iFrom, nchan, picksamp);
+
+        if(t_rawDir.ent->kind == -1)
+        {
+            //Skip is translated to zeros
+            t_block.setZero();
+            continue;
+        }
+
+        fid->read_tag(t_pTag, t_rawDir.ent->pos);
+
+        if(t_pTag->type == FIFFT_DAU_PACK16)
+            t_block = t_vecCals.asDiagonal() * Map<MatrixDau16>(t_pTag->toDauPack16(), nchan, t_rawDir.nsamp).middleCols(first_pick, picksamp).cast<float>();
+        else if(t_pTag->type == FIFFT_INT)
+            t_block = t_vecCals.asDiagonal() * Map<MatrixXi>(t_pTag->toInt(), nchan, t_rawDir.nsamp).middleCols(first_pick, picksamp).cast<float>();
+        else if(t_pTag->type == FIFFT_FLOAT)
+            t_block = t_vecCals.asDiagonal() * Map<MatrixXf>(t_pTag->toFloat(), nchan, t_rawDir.nsamp).middleCols(first_pick, picksamp);
+        else
+        {
+            printf("Data Storage Format not known jet!! Type: %d\n", t_pTag->type);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -87,6 +170,11 @@ FiffProducer::~FiffProducer()
 bool FiffProducer::stop()
 {
     m_bIsRunning = false;
+
+    // leave a push which is blocked by a full ring
+    if(m_pFiffSimulator->m_pRawMatrixBuffer)
+        m_pFiffSimulator->m_pRawMatrixBuffer->releaseFromPush();
+
     QThread::wait();
 
     return true;
@@ -104,96 +192,117 @@ void FiffProducer::run()
     FiffStream::SPtr p_pStream(new FiffStream(&t_File));
     m_pFiffSimulator->m_RawInfo.file = p_pStream;
 
+    qint32 nchan = m_pFiffSimulator->m_RawInfo.info.nchan;
+
     //
-    //   Set up the reading parameters
+    //   Open the remaining files of the playlist - only files which match the channel count and the
+    //   sampling rate of the first file can be appended to its stream
     //
-    fiff_int_t from = m_pFiffSimulator->m_RawInfo.first_samp;
-    fiff_int_t to = m_pFiffSimulator->m_RawInfo.last_samp;
-//    float quantum_sec = (float)uiSamplePeriod/1000000.0f; //read and write in 10 sec junks
-    fiff_int_t quantum = m_pFiffSimulator->m_uiBufferSampleSize;//ceil(quantum_sec*m_pFiffSimulator->m_pRawInfo->info.sfreq);
+    QList<FiffRawData> t_qListRawData;
+    t_qListRawData.append(m_pFiffSimulator->m_RawInfo);
 
-    qDebug() << "quantum " << quantum;
+    QList<QSharedPointer<QFile> > t_qListFiles;
+    for(qint32 i = 1; i < m_pFiffSimulator->m_slPlaylist.size(); ++i)
+    {
+        QSharedPointer<QFile> t_pFile(new QFile(m_pFiffSimulator->m_slPlaylist[i]));
+        FiffRawData t_raw;
+
+        if(!FiffStream::setup_read_raw(*t_pFile, t_raw))
+        {
+            printf("Skipping %s - not able to read raw info\n", m_pFiffSimulator->m_slPlaylist[i].toUtf8().constData());
+            continue;
+        }
+
+        //The buffers are announced with the info of the first file: same channels in the same order with the same calibration
+        if(t_raw.info.nchan != nchan || t_raw.info.sfreq != m_pFiffSimulator->m_TrueSamplingRate
+                || t_raw.info.ch_names != m_pFiffSimulator->m_RawInfo.info.ch_names
+                || t_raw.cals != m_pFiffSimulator->m_RawInfo.cals)
+        {
+            printf("Skipping %s - channels, calibration or sampling rate differ from %s\n", m_pFiffSimulator->m_slPlaylist[i].toUtf8().constData(), m_pFiffSimulator->m_RawInfo.info.filename.toUtf8().constData());
+            continue;
+        }
+
+        t_qListFiles.append(t_pFile);
+        t_qListRawData.append(t_raw);
+    }
+
+    qint32 t_iCurrentFile = 0;
 
     //
-    //   To read the whole file at once set
-    //
-    //quantum     = to - from + 1;
+    //   Set up the reading parameters
     //
+    fiff_int_t from = t_qListRawData[t_iCurrentFile].first_samp;
+    fiff_int_t to = t_qListRawData[t_iCurrentFile].last_samp;
+//    float quantum_sec = (float)uiSamplePeriod/1000000.0f; //read and write in 10 sec junks
+    fiff_int_t quantum = m_pFiffSimulator->m_uiBufferSampleSize;//ceil(quantum_sec*m_pFiffSimulator->m_pRawInfo->info.sfreq);
+
     //
     //   Read and write all the data
     //
 
     fiff_int_t first, last;
-    MatrixXd data;
-    MatrixXd times;
 
     first = from;
 
-//    //Calibration - Is taken care of during read_raw_segment(...) later in the code
-//    qint32 nchan = m_pFiffSimulator->m_RawInfo.info.nchan;
-//    MatrixXd cals(1,nchan);
-//    SparseMatrix<double> inv_calsMat(nchan, nchan);
-//    for(qint32 i = 0; i < nchan; ++i)
-//        inv_calsMat.insert(i, i) = 1.0f/m_pFiffSimulator->m_RawInfo.info.chs[i].cal;
+    //
+    // The producer only decodes ahead into the simulator's ring of float buffers - pacing is done by the
+    // simulator thread, so file access and conversion never delay the emission of a buffer
+    //
+    qint32 t_iReplication = m_pFiffSimulator->m_iChannelReplication;
+    MatrixXf t_matBuffer(nchan*t_iReplication, quantum);
 
-    //Not good cause production time is not accurate
-    //loading and thread sleep is longer than thread sleep time - better to have a extra loading thread
-    // ToDo restructure this producer as laoding buffer --> and thread sleep to simulator buffer
-    fiff_int_t t_iDiff;
-    bool t_bRestart = false;
+    fiff_int_t t_iCol;
+    fiff_int_t t_iNumCols;
 
     while(m_bIsRunning)
     {
-        last = first+quantum-1;
-        if (last > to)
-        {
-            t_iDiff = last - to;
-            t_bRestart = true;
+        t_iCol = 0;
 
-            last = to;
-        }
-
-        if (!m_pFiffSimulator->m_RawInfo.read_raw_segment(data,times,first,last))
+        // fill the reused float buffer - at the end of a file the remaining samples are read from the next playlist file
+        while(t_iCol < quantum)
         {
-            printf("error during read_raw_segment\n");
-        }
-
-        MatrixXf tmp = data.cast<float>();//(inv_calsMat*data).cast<float>();
-
-        if(t_bRestart)
-        {
-            //
-            // Case end of Simulation: restart file from the beginning and read remaining bytes
-            //
-            printf("### RESTART Simulation File ###\r\n");
-
-            first = from;
-            last = first+t_iDiff-1;
+            t_iNumCols = quantum - t_iCol;
+            last = first + t_iNumCols - 1;
+            if (last > to)
+            {
+                last = to;
+                t_iNumCols = last - first + 1;
+            }
 
-            if (!m_pFiffSimulator->m_RawInfo.read_raw_segment(data,times,first,last))
+            if (!read_raw_segment_float(t_qListRawData[t_iCurrentFile], first, last, t_matBuffer, t_iCol))
             {
                 printf("error during read_raw_segment\n");
+                t_matBuffer.block(0,t_iCol,nchan,t_iNumCols).setZero();
             }
 
-            MatrixXf tmp2 = data.cast<float>();//(inv_calsMat*data).cast<float>();
+            t_iCol += t_iNumCols;
+            first = last + 1;
 
-            MatrixXf tmp3(tmp.rows(), tmp.cols()+tmp2.cols());
-
-            tmp3.block(0,0,tmp.rows(),tmp.cols()) = tmp;
-            tmp3.block(0,tmp.cols(),tmp.rows(),tmp2.cols()) = tmp2;
-
-            tmp = tmp3;
-
-            t_bRestart = false;
-            first += t_iDiff;
-        }
-        else
-        {
-            first += quantum;
+            if(first > to)
+            {
+                //
+                // Case end of file: continue with the next file of the playlist, restart with the first one after the last
+                //
+                t_iCurrentFile = (t_iCurrentFile + 1) % t_qListRawData.size();
+
+                if(t_iCurrentFile == 0)
+                    printf("### RESTART Simulation File ###\r\n");
+                else
+                    printf("### NEXT Simulation File %s ###\r\n", t_qListRawData[t_iCurrentFile].info.filename.toUtf8().constData());
+
+                from = t_qListRawData[t_iCurrentFile].first_samp;
+                to = t_qListRawData[t_iCurrentFile].last_samp;
+                first = from;
+            }
         }
 
+        // emulate a system with more channels by repeating the channel block
+        for(qint32 k = 1; k < t_iReplication; ++k)
+            t_matBuffer.middleRows(k*nchan, nchan) = t_matBuffer.topRows(nchan);
+
         // call blocks until there is free space in the buffer
-        m_pFiffSimulator->m_pRawMatrixBuffer->push(&tmp);
+        if(m_bIsRunning)
+            m_pFiffSimulator->m_pRawMatrixBuffer->push(&t_matBuffer);
     }
 
     // close datastream in this thread
@@ -82,7 +82,8 @@ class FiffSimulator;
 /**
 * DECLARE CLASS FiffProducer
 *
-* @brief The FiffProducer class provides a ECG data producer for a given sampling rate.
+* @brief The FiffProducer class is the loader of the FiffSimulator. It decodes the simulation file ahead into the
+* simulator's ring of float buffers, while the FiffSimulator thread paces their emission.
 */
 class FiffProducer : public QThread
 {
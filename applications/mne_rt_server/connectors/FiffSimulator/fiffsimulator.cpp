@@ -77,6 +77,8 @@
 #include <QtCore/QtPlugin>
 #include <QFile>
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
 #include <QDebug>
 
 
@@ -89,6 +91,17 @@ using namespace FIFFSIMULATORPLUGIN;
 using namespace FIFFLIB;
 using namespace MNELIB;
 
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define FIFF_SIMULATOR_PREFETCH_BUFFERS     32      /**< Number of buffers the loader decodes ahead. */
+#define FIFF_SIMULATOR_MAX_LAG_BUFFERS      10      /**< Lag in buffers after which the pacing schedule is reset instead of catching up. */
+#define FIFF_SIMULATOR_MAX_REPLICATION      64      /**< Maximal channel replication factor. */
+#define FIFF_SIMULATOR_MAX_IN_FLIGHT        8       /**< Emitted buffers which are not yet forwarded by the server. */
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER CONSTANTS
@@ -99,6 +112,11 @@ const QString FiffSimulator::Commands::GETBUFSIZE   = "getbufsize";
 const QString FiffSimulator::Commands::ACCEL        = "accel";
 const QString FiffSimulator::Commands::GETACCEL     = "getaccel";
 const QString FiffSimulator::Commands::SIMFILE      = "simfile";
+const QString FiffSimulator::Commands::GETJITTER    = "getjitter";
+const QString FiffSimulator::Commands::PLAYLIST     = "playlist";
+const QString FiffSimulator::Commands::GETPLAYLIST  = "getplaylist";
+const QString FiffSimulator::Commands::REPLICATE    = "replicate";
+const QString FiffSimulator::Commands::GETREPLICATE = "getreplicate";
 
 
 //*************************************************************************************************************
@@ -109,12 +127,21 @@ const QString FiffSimulator::Commands::SIMFILE      = "simfile";
 FiffSimulator::FiffSimulator()
 : m_pFiffProducer(new FiffProducer(this))
 , m_sResourceDataPath(QString("%1/MNE-sample-data/MEG/sample/sample_audvis_raw.fif").arg(QCoreApplication::applicationDirPath()))
+, m_iChannelReplication(1)
 , m_uiBufferSampleSize(100)//(4)
 , m_AccelerationFactor(1.0)
 , m_TrueSamplingRate(0.0)
 , m_pRawMatrixBuffer(NULL)
 , m_bIsRunning(false)
+, m_qInFlightBuffers(FIFF_SIMULATOR_MAX_IN_FLIGHT)
 {
+    m_jitterStats.iNumBuffers = 0;
+    m_jitterStats.iLastJitterUs = 0;
+    m_jitterStats.dMeanJitterUs = 0.0;
+    m_jitterStats.iMaxJitterUs = 0;
+    m_jitterStats.iNumResyncs = 0;
+
+    this->readConfig();
     this->init();
 }
 
@@ -195,9 +222,11 @@ void FiffSimulator::comAccel(Command p_command)
 {
     //ToDO JSON
 
-    float t_uiAccel = p_command.pValues()[0].toFloat();
+    bool t_bOk = false;
+    float t_uiAccel = p_command.pValues()[0].toFloat(&t_bOk);
 
-    if(t_uiAccel > 0)
+    // a factor of 0 streams as fast as the loader decodes
+    if(t_bOk && t_uiAccel >= 0)
     {
 
             bool t_bWasRunning = m_bIsRunning;
@@ -209,7 +238,7 @@ void FiffSimulator::comAccel(Command p_command)
             }
 
             m_AccelerationFactor = t_uiAccel;
-            m_RawInfo.info.sfreq = m_AccelerationFactor * m_TrueSamplingRate;
+            m_RawInfo.info.sfreq = m_AccelerationFactor > 0 ? m_AccelerationFactor * m_TrueSamplingRate : m_TrueSamplingRate;
 
             if(t_bWasRunning)
                 this->start();
@@ -258,13 +287,18 @@ void FiffSimulator::comSimfile(Command p_command)
 
     if(t_file.exists())
     {
+        // the loader and the pacing thread use the raw info and the ring buffer which are replaced
+        m_pFiffProducer->stop();
+        this->stop();
+
         m_sResourceDataPath = p_command.pValues()[0].toString();
         m_RawInfo = FiffRawData();
 
         if (this->readRawInfo())
         {
-            m_pFiffProducer->stop();
-            this->stop();
+            m_slPlaylist = QStringList() << m_sResourceDataPath;
+
+            emit remitMeasInfo(-1, currentInfo());
 
             m_commandManager[Commands::SIMFILE].reply("New simulation file set succefully.\r\n");
         }
@@ -272,6 +306,8 @@ void FiffSimulator::comSimfile(Command p_command)
         {
             qDebug() << "Didn't set new file";
             m_sResourceDataPath = t_sResourceDataPathOld;
+            m_RawInfo = FiffRawData();
+            this->readRawInfo();
 
             m_commandManager[Commands::SIMFILE].reply("Simulation file not set.\r\n");
         }
@@ -285,6 +321,179 @@ void FiffSimulator::comSimfile(Command p_command)
 }
 
 
+//*************************************************************************************************************
+
+void FiffSimulator::comGetJitter(Command p_command)
+{
+    JitterStats t_stats = getJitterStats();
+
+    bool t_bCommandIsJson = p_command.isJson();
+    if(t_bCommandIsJson)
+    {
+        //
+        //create JSON help object
+        //
+        QJsonObject t_qJsonObjectRoot;
+        t_qJsonObjectRoot.insert("buffers", QJsonValue((double)t_stats.iNumBuffers));
+        t_qJsonObjectRoot.insert("last_us", QJsonValue((double)t_stats.iLastJitterUs));
+        t_qJsonObjectRoot.insert("mean_us", QJsonValue(t_stats.dMeanJitterUs));
+        t_qJsonObjectRoot.insert("max_us", QJsonValue((double)t_stats.iMaxJitterUs));
+        t_qJsonObjectRoot.insert("resyncs", QJsonValue((double)t_stats.iNumResyncs));
+        QJsonDocument p_qJsonDocument(t_qJsonObjectRoot);
+
+        m_commandManager[Commands::GETJITTER].reply(p_qJsonDocument.toJson());
+    }
+    else
+    {
+        QString str = QString("\tbuffers %1; jitter last %2 us, mean %3 us, max %4 us; resyncs %5\r\n\n")
+                .arg(t_stats.iNumBuffers)
+                .arg(t_stats.iLastJitterUs)
+                .arg(t_stats.dMeanJitterUs, 0, 'f', 1)
+                .arg(t_stats.iMaxJitterUs)
+                .arg(t_stats.iNumResyncs);
+        m_commandManager[Commands::GETJITTER].reply(str);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffSimulator::comPlaylist(Command p_command)
+{
+    //
+    // ';' separated list of simulation files
+    //
+    QStringList t_slFiles = p_command.pValues()[0].toString().split(";", QString::SkipEmptyParts);
+
+    QStringList t_slPlaylist;
+    for(qint32 i = 0; i < t_slFiles.size(); ++i)
+    {
+        if(QFile::exists(t_slFiles[i].trimmed()))
+            t_slPlaylist << t_slFiles[i].trimmed();
+        else
+            qDebug() << "File" << t_slFiles[i] << "does not exist on server!";
+    }
+
+    if(t_slPlaylist.isEmpty())
+    {
+        m_commandManager[Commands::PLAYLIST].reply("Playlist not set.\r\n");
+        return;
+    }
+
+    QString t_sResourceDataPathOld = m_sResourceDataPath;
+
+    // the loader and the pacing thread use the raw info and the ring buffer which are replaced
+    m_pFiffProducer->stop();
+    this->stop();
+
+    m_sResourceDataPath = t_slPlaylist[0];
+    m_RawInfo = FiffRawData();
+
+    if (this->readRawInfo())
+    {
+        m_slPlaylist = t_slPlaylist;
+
+        emit remitMeasInfo(-1, currentInfo());
+
+        QString str = QString("\tSet playlist of %1 files\r\n\n").arg(m_slPlaylist.size());
+        m_commandManager[Commands::PLAYLIST].reply(str);
+    }
+    else
+    {
+        m_sResourceDataPath = t_sResourceDataPathOld;
+        m_RawInfo = FiffRawData();
+        this->readRawInfo();
+
+        m_commandManager[Commands::PLAYLIST].reply("Playlist not set.\r\n");
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffSimulator::comGetPlaylist(Command p_command)
+{
+    bool t_bCommandIsJson = p_command.isJson();
+    if(t_bCommandIsJson)
+    {
+        //
+        //create JSON help object
+        //
+        QJsonObject t_qJsonObjectRoot;
+        t_qJsonObjectRoot.insert(Commands::PLAYLIST, QJsonValue(QJsonArray::fromStringList(m_slPlaylist)));
+        QJsonDocument p_qJsonDocument(t_qJsonObjectRoot);
+
+        m_commandManager[Commands::GETPLAYLIST].reply(p_qJsonDocument.toJson());
+    }
+    else
+    {
+        QString str;
+        for(qint32 i = 0; i < m_slPlaylist.size(); ++i)
+            str.append(QString("\t%1\r\n").arg(m_slPlaylist[i]));
+        str.append("\n");
+        m_commandManager[Commands::GETPLAYLIST].reply(str);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffSimulator::comReplicate(Command p_command)
+{
+    qint32 t_iReplication = p_command.pValues()[0].toInt();
+
+    if(t_iReplication > 0 && t_iReplication <= FIFF_SIMULATOR_MAX_REPLICATION)
+    {
+        bool t_bWasRunning = m_bIsRunning;
+
+        if(m_bIsRunning)
+        {
+            m_pFiffProducer->stop();
+            this->stop();
+        }
+
+        m_iChannelReplication = t_iReplication;
+
+        // the buffers of running measurements do not match their measurement info anymore
+        if(!m_RawInfo.isEmpty())
+            emit remitMeasInfo(-1, currentInfo());
+
+        if(t_bWasRunning)
+            this->start();
+
+        QString str = QString("\tSet channel replication to %1 (%2 channels)\r\n\n").arg(t_iReplication).arg(m_RawInfo.info.nchan*t_iReplication);
+
+        m_commandManager[Commands::REPLICATE].reply(str);
+    }
+    else
+        m_commandManager[Commands::REPLICATE].reply("Channel replication not set\r\n");
+}
+
+
+//*************************************************************************************************************
+
+void FiffSimulator::comGetReplicate(Command p_command)
+{
+    bool t_bCommandIsJson = p_command.isJson();
+    if(t_bCommandIsJson)
+    {
+        //
+        //create JSON help object
+        //
+        QJsonObject t_qJsonObjectRoot;
+        t_qJsonObjectRoot.insert(Commands::REPLICATE, QJsonValue((double)m_iChannelReplication));
+        QJsonDocument p_qJsonDocument(t_qJsonObjectRoot);
+
+        m_commandManager[Commands::GETREPLICATE].reply(p_qJsonDocument.toJson());
+    }
+    else
+    {
+        QString str = QString("\t%1\r\n\n").arg(m_iChannelReplication);
+        m_commandManager[Commands::GETREPLICATE].reply(str);
+    }
+}
+
+
 //*************************************************************************************************************
 
 void FiffSimulator::connectCommandManager()
@@ -295,6 +504,11 @@ void FiffSimulator::connectCommandManager()
     QObject::connect(&m_commandManager[Commands::ACCEL], &Command::executed, this, &FiffSimulator::comAccel);
     QObject::connect(&m_commandManager[Commands::GETACCEL], &Command::executed, this, &FiffSimulator::comGetAccel);
     QObject::connect(&m_commandManager[Commands::SIMFILE], &Command::executed, this, &FiffSimulator::comSimfile);
+    QObject::connect(&m_commandManager[Commands::GETJITTER], &Command::executed, this, &FiffSimulator::comGetJitter);
+    QObject::connect(&m_commandManager[Commands::PLAYLIST], &Command::executed, this, &FiffSimulator::comPlaylist);
+    QObject::connect(&m_commandManager[Commands::GETPLAYLIST], &Command::executed, this, &FiffSimulator::comGetPlaylist);
+    QObject::connect(&m_commandManager[Commands::REPLICATE], &Command::executed, this, &FiffSimulator::comReplicate);
+    QObject::connect(&m_commandManager[Commands::GETREPLICATE], &Command::executed, this, &FiffSimulator::comGetReplicate);
 }
 
 
@@ -316,21 +530,25 @@ const char* FiffSimulator::getName() const
 
 //*************************************************************************************************************
 
-void FiffSimulator::init()
+void FiffSimulator::readConfig()
 {
     //
-    // Read cfg file
+    // Read cfg file - every valid simFile entry is appended to the playlist
     //
+    QStringList t_slPlaylist;
+
     QFile t_qFile(QString("%1/mne_rt_server_plugins/FiffSimulation.cfg").arg(QCoreApplication::applicationDirPath()));
     if (t_qFile.open(QIODevice::ReadOnly | QIODevice::Text))
     {
         QTextStream in(&t_qFile);
         QString key = "simFile = ";
+        QString keyAccel = "accel = ";
+        QString keyReplicate = "replicate = ";
         while (!in.atEnd()) {
             QString line = in.readLine();
             if(line.contains(key, Qt::CaseInsensitive))
             {
-                qint32 idx = line.indexOf(key);
+                qint32 idx = line.indexOf(key, 0, Qt::CaseInsensitive);
                 idx += key.size();
 
                 QString sFileName = line.mid(idx, line.size()-idx);
@@ -339,21 +557,51 @@ void FiffSimulator::init()
 
                 if (t_qFileMeas.open(QIODevice::ReadOnly))
                 {
-                    m_sResourceDataPath = sFileName;
+                    t_slPlaylist << sFileName;
                     std::cout << "\tLoad simulation file: " << sFileName.toUtf8().constData() << std::endl;
                     t_qFileMeas.close();
                 }
             }
+            else if(line.contains(keyAccel, Qt::CaseInsensitive))
+            {
+                qint32 idx = line.indexOf(keyAccel, 0, Qt::CaseInsensitive) + keyAccel.size();
+
+                bool t_bOk = false;
+                float t_fAccel = line.mid(idx).trimmed().toFloat(&t_bOk);
+                if(t_bOk && t_fAccel >= 0)
+                    m_AccelerationFactor = t_fAccel;
+            }
+            else if(line.contains(keyReplicate, Qt::CaseInsensitive))
+            {
+                qint32 idx = line.indexOf(keyReplicate, 0, Qt::CaseInsensitive) + keyReplicate.size();
+
+                qint32 t_iReplication = line.mid(idx).trimmed().toInt();
+                if(t_iReplication > 0 && t_iReplication <= FIFF_SIMULATOR_MAX_REPLICATION)
+                    m_iChannelReplication = t_iReplication;
+            }
         }
         t_qFile.close();
     }
 
+    if(!t_slPlaylist.isEmpty())
+        m_sResourceDataPath = t_slPlaylist[0];
+    else
+        t_slPlaylist << m_sResourceDataPath;
+
+    m_slPlaylist = t_slPlaylist;
+}
+
+
+//*************************************************************************************************************
+
+void FiffSimulator::init()
+{
     if(m_pRawMatrixBuffer)
         delete m_pRawMatrixBuffer;
     m_pRawMatrixBuffer = NULL;
 
     if(!m_RawInfo.isEmpty())
-        m_pRawMatrixBuffer = new RawMatrixBuffer(RAW_BUFFFER_SIZE, m_RawInfo.info.nchan, this->m_uiBufferSampleSize);
+        m_pRawMatrixBuffer = new RawMatrixBuffer(FIFF_SIMULATOR_PREFETCH_BUFFERS, m_RawInfo.info.nchan*m_iChannelReplication, this->m_uiBufferSampleSize);
 }
 
 
@@ -378,12 +626,34 @@ bool FiffSimulator::stop()
 {
     this->m_pFiffProducer->stop();
     m_bIsRunning = false;
+
+    // leave a pop which waits for the stopped loader
+    if(m_pRawMatrixBuffer)
+        m_pRawMatrixBuffer->releaseFromPop();
+
     QThread::wait();
 
     return true;
 }
 
 
+//*************************************************************************************************************
+
+FiffSimulator::JitterStats FiffSimulator::getJitterStats()
+{
+    QMutexLocker locker(&m_qJitterMutex);
+    return m_jitterStats;
+}
+
+
+//*************************************************************************************************************
+
+void FiffSimulator::releaseInFlightBuffer()
+{
+    m_qInFlightBuffers.release();
+}
+
+
 //*************************************************************************************************************
 
 void FiffSimulator::info(qint32 ID)
@@ -393,7 +663,49 @@ void FiffSimulator::info(qint32 ID)
         readRawInfo();
 
     if(!m_RawInfo.isEmpty())
-        emit remitMeasInfo(ID, m_RawInfo.info);
+        emit remitMeasInfo(ID, currentInfo());
+}
+
+
+//*************************************************************************************************************
+
+FiffInfo FiffSimulator::currentInfo() const
+{
+    return m_iChannelReplication > 1 ? replicatedInfo() : m_RawInfo.info;
+}
+
+
+//*************************************************************************************************************
+
+FiffInfo FiffSimulator::replicatedInfo() const
+{
+    FiffInfo t_info = m_RawInfo.info;
+
+    qint32 nchan = m_RawInfo.info.nchan;
+
+    for(qint32 k = 1; k < m_iChannelReplication; ++k)
+    {
+        // channel names are limited to 15 characters by the fiff format
+        QString t_sSuffix = QString("_%1").arg(k);
+
+        for(qint32 i = 0; i < nchan; ++i)
+        {
+            FiffChInfo t_chInfo = m_RawInfo.info.chs[i];
+            t_chInfo.ch_name = t_chInfo.ch_name.left(15 - t_sSuffix.size()) + t_sSuffix;
+            t_chInfo.scanNo += k*nchan;
+            t_chInfo.logNo += k*nchan;
+
+            t_info.chs.append(t_chInfo);
+            t_info.ch_names.append(t_chInfo.ch_name);
+
+            if(m_RawInfo.info.bads.contains(m_RawInfo.info.chs[i].ch_name))
+                t_info.bads.append(t_chInfo.ch_name);
+        }
+    }
+
+    t_info.nchan = nchan*m_iChannelReplication;
+
+    return t_info;
 }
 
 
@@ -411,11 +723,13 @@ bool FiffSimulator::readRawInfo()
         {
             printf("Error: Not able to read raw info!\n");
             m_RawInfo.clear();
+            mutex.unlock();
             return false;
         }
 
         m_TrueSamplingRate = m_RawInfo.info.sfreq;
-        m_RawInfo.info.sfreq *= m_AccelerationFactor;
+        if(m_AccelerationFactor > 0)
+            m_RawInfo.info.sfreq *= m_AccelerationFactor;
 
 //        bool in_samples = false;
 //
@@ -505,7 +819,7 @@ bool FiffSimulator::readRawInfo()
         //
         if(m_pRawMatrixBuffer)
             delete m_pRawMatrixBuffer;
-        m_pRawMatrixBuffer = new RawMatrixBuffer(10, m_RawInfo.info.nchan, m_uiBufferSampleSize);
+        m_pRawMatrixBuffer = new RawMatrixBuffer(FIFF_SIMULATOR_PREFETCH_BUFFERS, m_RawInfo.info.nchan*m_iChannelReplication, m_uiBufferSampleSize);
 
         mutex.unlock();
     }
@@ -520,20 +834,88 @@ void FiffSimulator::run()
 {
     m_bIsRunning = true;
 
-    float t_fSamplingFrequency = m_RawInfo.info.sfreq;
-    float t_fBuffSampleSize = (float)m_uiBufferSampleSize;
+    double t_dSamplingFrequency = m_RawInfo.info.sfreq;
+    double t_dBuffSampleSize = (double)m_uiBufferSampleSize;
+
+    // buffer period in nanoseconds at the (accelerated) sampling rate
+    double t_dBufferPeriodNs = (t_dBuffSampleSize/t_dSamplingFrequency)*1000000000.0;
+    qint64 t_iMaxLagNs = (qint64)(FIFF_SIMULATOR_MAX_LAG_BUFFERS*t_dBufferPeriodNs);
+    bool t_bUnpaced = m_AccelerationFactor <= 0;
 
-    quint32 uiSamplePeriod = (unsigned int) ((t_fBuffSampleSize/t_fSamplingFrequency)*1000000.0f);
+    m_qJitterMutex.lock();
+    m_jitterStats.iNumBuffers = 0;
+    m_jitterStats.iLastJitterUs = 0;
+    m_jitterStats.dMeanJitterUs = 0.0;
+    m_jitterStats.iMaxJitterUs = 0;
+    m_jitterStats.iNumResyncs = 0;
+    m_qJitterMutex.unlock();
+
+    //
+    // Emission times are scheduled on the monotonic clock relative to the schedule start, so that sleep
+    // inaccuracies and the emission itself do not accumulate as drift
+    //
+    QElapsedTimer t_qTimer;
+    t_qTimer.start();
 
-//    quint32 count = 0;
+    qint64 t_iScheduleStartNs = 0;
+    qint64 t_iBufferCount = 0;
+    qint64 t_iDeadlineNs, t_iNowNs, t_iJitterUs;
 
     while(m_bIsRunning)
     {
+        // the buffers are queued to the server thread, without a budget an unpaced playback floods its event queue
+        if(!m_qInFlightBuffers.tryAcquire(1, 10))
+            continue;
+
+        // the loader decodes ahead, so this pop normally returns immediately
         QSharedPointer<Eigen::MatrixXf> t_pRawBuffer(new Eigen::MatrixXf(m_pRawMatrixBuffer->pop()));
-//        ++count;
-//        printf("%d raw buffer (%d x %d) generated\r\n", count, t_pRawBuffer->rows(), t_pRawBuffer->cols());
+
+        if(!m_bIsRunning)
+        {
+            m_qInFlightBuffers.release();
+            break;
+        }
+
+        t_iDeadlineNs = t_iScheduleStartNs + (qint64)(t_iBufferCount*t_dBufferPeriodNs);
+
+        t_iNowNs = t_qTimer.nsecsElapsed();
+
+        // as fast as possible playback - every buffer is due as soon as the loader delivers it
+        if(t_bUnpaced)
+            t_iDeadlineNs = t_iNowNs;
+
+        if(t_iNowNs < t_iDeadlineNs)
+        {
+            usleep((unsigned long)((t_iDeadlineNs - t_iNowNs)/1000));
+            t_iNowNs = t_qTimer.nsecsElapsed();
+        }
 
         emit remitRawBuffer(t_pRawBuffer);
-        usleep(uiSamplePeriod);
+
+        // queued behind the forwarding of the buffer, so the budget is returned once the server has it
+        QMetaObject::invokeMethod(this, "releaseInFlightBuffer", Qt::QueuedConnection);
+
+        t_iJitterUs = (t_iNowNs - t_iDeadlineNs)/1000;
+
+        m_qJitterMutex.lock();
+        ++m_jitterStats.iNumBuffers;
+        m_jitterStats.iLastJitterUs = t_iJitterUs;
+        m_jitterStats.dMeanJitterUs += (t_iJitterUs - m_jitterStats.dMeanJitterUs)/m_jitterStats.iNumBuffers;
+        if(t_iJitterUs > m_jitterStats.iMaxJitterUs)
+            m_jitterStats.iMaxJitterUs = t_iJitterUs;
+        m_qJitterMutex.unlock();
+
+        ++t_iBufferCount;
+
+        // after a long stall restart the schedule instead of emitting a burst of buffers to catch up
+        if(t_iNowNs - t_iDeadlineNs > t_iMaxLagNs)
+        {
+            t_iScheduleStartNs = t_iNowNs;
+            t_iBufferCount = 1;
+
+            m_qJitterMutex.lock();
+            ++m_jitterStats.iNumResyncs;
+            m_qJitterMutex.unlock();
+        }
     }
 }
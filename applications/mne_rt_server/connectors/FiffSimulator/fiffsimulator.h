@@ -60,7 +60,9 @@
 //=============================================================================================================
 
 #include <QString>
+#include <QStringList>
 #include <QMutex>
+#include <QSemaphore>
 
 
 //*************************************************************************************************************
@@ -111,6 +113,25 @@ public:
         static const QString ACCEL;
         static const QString GETACCEL;
         static const QString SIMFILE;
+        static const QString GETJITTER;
+        static const QString PLAYLIST;
+        static const QString GETPLAYLIST;
+        static const QString REPLICATE;
+        static const QString GETREPLICATE;
+    };
+
+    //=========================================================================================================
+    /**
+    * Timing statistics of the pacing thread. The jitter is the delay of an emitted buffer relative to its
+    * scheduled emission time.
+    */
+    struct JitterStats
+    {
+        qint64  iNumBuffers;        /**< Number of emitted buffers since start. */
+        qint64  iLastJitterUs;      /**< Jitter of the last emitted buffer in microseconds. */
+        double  dMeanJitterUs;      /**< Mean jitter in microseconds. */
+        qint64  iMaxJitterUs;       /**< Maximal jitter in microseconds. */
+        qint64  iNumResyncs;        /**< Number of times the schedule was reset because the emission fell too far behind. */
     };
 
     //=========================================================================================================
@@ -137,6 +158,21 @@ public:
 
     virtual bool stop();
 
+    //=========================================================================================================
+    /**
+    * Returns the timing statistics of the pacing thread.
+    *
+    * @return the jitter statistics since the last start.
+    */
+    JitterStats getJitterStats();
+
+private slots:
+    //=========================================================================================================
+    /**
+    * Returns one buffer to the in-flight budget. run() queues it behind every emitted buffer.
+    */
+    void releaseInFlightBuffer();
+
 protected:
     virtual void run();
 
@@ -183,6 +219,46 @@ private:
     */
     void comSimfile(Command p_command);
 
+    //=========================================================================================================
+    /**
+    * Returns the jitter statistics of the pacing thread
+    *
+    * @param[in] p_command  The jitter statistics command.
+    */
+    void comGetJitter(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Sets the playlist of fiff simulation files
+    *
+    * @param[in] p_command  The playlist command.
+    */
+    void comPlaylist(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Returns the playlist of fiff simulation files
+    *
+    * @param[in] p_command  The playlist command.
+    */
+    void comGetPlaylist(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Sets the channel replication factor
+    *
+    * @param[in] p_command  The channel replication command.
+    */
+    void comReplicate(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Returns the channel replication factor
+    *
+    * @param[in] p_command  The channel replication command.
+    */
+    void comGetReplicate(Command p_command);
+
     //////////
 
     //=========================================================================================================
@@ -191,6 +267,28 @@ private:
     */
     void init();
 
+    //=========================================================================================================
+    /**
+    * Reads the simulation files, the acceleration factor and the channel replication from FiffSimulation.cfg.
+    */
+    void readConfig();
+
+    //=========================================================================================================
+    /**
+    * Returns the measurement info with the channels repeated m_iChannelReplication times.
+    *
+    * @return the replicated measurement info.
+    */
+    FiffInfo replicatedInfo() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the measurement info of the streamed buffers, replicated if m_iChannelReplication > 1.
+    *
+    * @return the measurement info.
+    */
+    FiffInfo currentInfo() const;
+
     bool readRawInfo();
 
     QMutex mutex;
@@ -198,13 +296,20 @@ private:
     FiffProducer*   m_pFiffProducer;        /**< Holds the DataProducer.*/
     FiffRawData     m_RawInfo;              /**< Holds the fiff raw measurement information. */
     QString         m_sResourceDataPath;    /**< Holds the path to the Fiff resource simulation file directory.*/
+    QStringList     m_slPlaylist;           /**< Files which are streamed one after the other, the first one is m_sResourceDataPath. */
+    qint32          m_iChannelReplication;  /**< Number of times the channels are replicated to emulate systems with more channels. */
     quint32         m_uiBufferSampleSize;   /**< Sample size of the buffer */
-    float           m_AccelerationFactor;   /**< Acceleration factor to simulate different sampling rates. */
+    float           m_AccelerationFactor;   /**< Acceleration factor to simulate different sampling rates. 0 streams as fast as possible. */
     float           m_TrueSamplingRate;     /**< The true sampling rate of the fif file. */
 
     RawMatrixBuffer* m_pRawMatrixBuffer;    /**< The Circular Raw Matrix Buffer. */
 
     bool            m_bIsRunning;
+
+    QMutex          m_qJitterMutex;         /**< Guards the jitter statistics. */
+    JitterStats     m_jitterStats;          /**< Timing statistics of the pacing thread. */
+
+    QSemaphore      m_qInFlightBuffers;     /**< Budget of emitted buffers which are not yet forwarded by the server. */
 };
 
 } // NAMESPACE
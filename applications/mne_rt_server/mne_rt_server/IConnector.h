@@ -215,6 +215,7 @@ public:
     virtual void info(qint32 ID) = 0;
 
 signals:
+    // ID -1 replaces the measurement info of all clients which receive raw buffers
     void remitMeasInfo(qint32, FIFFLIB::FiffInfo);
 
     void remitRawBuffer(QSharedPointer<Eigen::MatrixXf>);
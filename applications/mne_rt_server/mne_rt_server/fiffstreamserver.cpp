@@ -44,6 +44,16 @@
 #include "mne_rt_server.h"
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// Fiff INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_constants.h>
+#include <fiff/fiff_stream.h>
+#include <fiff/fiff_data_buffer_codec.h>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // STL INCLUDES
@@ -61,6 +71,14 @@ using namespace RTSERVER;
 using namespace FIFFLIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define FIFF_STREAM_REPLAY_LENGTH_MS    10000       /**< Default length of the replay ring. */
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -69,8 +87,10 @@ using namespace FIFFLIB;
 FiffStreamServer::FiffStreamServer(QObject *parent)
 : QTcpServer(parent)
 , m_iNextClientId(0)
+, m_iReplayLengthMs(FIFF_STREAM_REPLAY_LENGTH_MS)
+, m_fReplaySFreq(0.0f)
 {
-
+    m_qReplayTimer.start();
 }
 
 
@@ -102,6 +122,89 @@ void FiffStreamServer::comClist(Command p_command)
 }
 
 
+//*************************************************************************************************************
+
+void FiffStreamServer::comCqueue(Command p_command)
+{
+    qint32 t_id = -1;
+    QString t_sOutput("");
+    QString t_sAlias(p_command.pValues()[0].toString());
+    t_sOutput.append(parseToId(t_sAlias,t_id));
+
+    QString t_sPolicy = p_command.pValues()[1].toString();
+    qint32 t_iSize = p_command.pValues()[2].toInt();
+
+    FiffStreamThread::SendQueuePolicy t_policy = FiffStreamThread::SendQueueDropOldest;
+    bool t_bValid = true;
+    if(t_sPolicy.compare("block", Qt::CaseInsensitive) == 0)
+        t_policy = FiffStreamThread::SendQueueBlock;
+    else if(t_sPolicy.compare("drop-oldest", Qt::CaseInsensitive) == 0)
+        t_policy = FiffStreamThread::SendQueueDropOldest;
+    else if(t_sPolicy.compare("decimate", Qt::CaseInsensitive) == 0)
+        t_policy = FiffStreamThread::SendQueueDecimate;
+    else
+        t_bValid = false;
+
+    if(!t_bValid)
+    {
+        t_sOutput.append(QString("	unknown policy '%1', use block, drop-oldest or decimate\r\n\n").arg(t_sPolicy));
+    }
+    else if(t_id != -1)
+    {
+        m_qClientList[t_id]->setSendQueue(t_iSize, t_policy);
+
+        QString str = QString("	FiffStreamClient (ID: %1) queues up to %2 raw buffers, policy %3\r\n\n").arg(t_id).arg(t_iSize).arg(t_sPolicy);
+        t_sOutput.append(str);
+    }
+    qobject_cast<MNERTServer*>(this->parent())->getCommandManager()["cqueue"].reply(t_sOutput);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::comCstats(Command p_command)
+{
+    //ToDo JSON
+    QString t_sOutput("");
+    t_sOutput.append("\tID\tAlias\tQueue\tPolicy\tSent\tDropped\tLatency last/mean/max [ms]\r\n");
+    QMap<qint32, FiffStreamThread*>::iterator i;
+    for (i = this->m_qClientList.begin(); i != this->m_qClientList.end(); ++i)
+    {
+        FiffStreamThread::SendQueueStats t_stats = i.value()->getSendQueueStats();
+
+        QString t_sPolicy;
+        switch(t_stats.policy)
+        {
+            case FiffStreamThread::SendQueueBlock:
+                t_sPolicy = "block";
+                break;
+            case FiffStreamThread::SendQueueDecimate:
+                t_sPolicy = "decimate";
+                break;
+            default:
+                t_sPolicy = "drop-oldest";
+        }
+
+        QString str = QString("\t%1\t%2\t%3/%4\t%5\t%6\t%7\t%8/%9/%10\r\n")
+                .arg(i.key())
+                .arg(i.value()->getAlias())
+                .arg(t_stats.iQueueDepth)
+                .arg(t_stats.iMaxQueueDepth)
+                .arg(t_sPolicy)
+                .arg(t_stats.iSentBuffers)
+                .arg(t_stats.iDroppedBuffers)
+                .arg(t_stats.dLastLatencyMs, 0, 'f', 2)
+                .arg(t_stats.dMeanLatencyMs, 0, 'f', 2)
+                .arg(t_stats.dMaxLatencyMs, 0, 'f', 2);
+        t_sOutput.append(str);
+    }
+    t_sOutput.append("\n");
+    qobject_cast<MNERTServer*>(this->parent())->getCommandManager()["cstats"].reply(t_sOutput);
+
+    Q_UNUSED(p_command);
+}
+
+
 //*************************************************************************************************************
 
 void FiffStreamServer::comMeasinfo(Command p_command)
@@ -166,6 +269,10 @@ void FiffStreamServer::comStop(Command p_command)
 void FiffStreamServer::comStopAll(Command p_command)
 {
     emit stopMeasFiffStreamClient(-1);
+
+    //The acquisition ends, don't replay its buffers into the next one
+    m_qReplayRing.clear();
+
     QString str = QString("\tstop all FiffStreamClients from receiving raw buffers\r\n\n");
     qobject_cast<MNERTServer*>(this->parent())->getCommandManager()["stop-all"].reply(str);
 
@@ -173,6 +280,80 @@ void FiffStreamServer::comStopAll(Command p_command)
 }
 
 
+//*************************************************************************************************************
+
+void FiffStreamServer::comReplaylen(Command p_command)
+{
+    double t_dSeconds = p_command.pValues()[0].toDouble();
+
+    m_iReplayLengthMs = t_dSeconds > 0 ? (qint64)(t_dSeconds * 1000.0) : 0;
+    trimReplayRing();
+
+    QString str = m_iReplayLengthMs > 0
+            ? QString("\tkeep the raw buffers of the last %1 s for replay\r\n\n").arg(m_iReplayLengthMs / 1000.0)
+            : QString("\treplay disabled\r\n\n");
+    qobject_cast<MNERTServer*>(this->parent())->getCommandManager()["replaylen"].reply(str);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::comStartreplay(Command p_command)
+{
+    qint32 t_id = -1;
+    QString t_sOutput("");
+    QString t_sAlias(p_command.pValues()[0].toString());
+    t_sOutput.append(parseToId(t_sAlias,t_id));
+
+    double t_dSeconds = p_command.pValues()[1].toDouble();
+
+    if(t_id != -1 && m_qClientList.contains(t_id))
+    {
+        if(m_qClientList[t_id]->isSendingRawBuffer())
+        {
+            //The client already has the buffers of the ring, replaying them would duplicate them
+            QString str = QString("\tFiffStreamClient (ID: %1) already receives raw buffers, nothing replayed\r\n\n").arg(t_id);
+            t_sOutput.append(str);
+        }
+        else
+        {
+            //Writes the start block to the client, the replay has to follow it
+            emit startMeasFiffStreamClient(t_id);
+
+            trimReplayRing();
+
+            qint64 t_iFromMs = m_qReplayTimer.elapsed() - (qint64)(t_dSeconds * 1000.0);
+            QList<QSharedPointer<Eigen::MatrixXf> > t_qListBuffers;
+            for(qint32 i = 0; i < m_qReplayRing.size(); ++i)
+                if(m_qReplayRing[i].iTimestampMs >= t_iFromMs)
+                    t_qListBuffers.append(m_qReplayRing[i].pMatRawData);
+
+            qint32 t_iReplayed = m_qClientList[t_id]->replayRawBuffers(t_qListBuffers);
+
+            QString str = QString("\tFiffStreamClient (ID: %1) is now set to accept raw buffers, replaying %2 of %3 buffers\r\n\n").arg(t_id).arg(t_iReplayed).arg(t_qListBuffers.size());
+            t_sOutput.append(str);
+        }
+    }
+    qobject_cast<MNERTServer*>(this->parent())->getCommandManager()["startreplay"].reply(t_sOutput);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::trimReplayRing()
+{
+    if(m_iReplayLengthMs <= 0)
+    {
+        m_qReplayRing.clear();
+        return;
+    }
+
+    qint64 t_iOldestMs = m_qReplayTimer.elapsed() - m_iReplayLengthMs;
+    while(!m_qReplayRing.isEmpty() && m_qReplayRing.first().iTimestampMs < t_iOldestMs)
+        m_qReplayRing.removeFirst();
+}
+
+
 //*************************************************************************************************************
 
 void FiffStreamServer::connectCommands()
@@ -181,10 +362,14 @@ void FiffStreamServer::connectCommands()
     MNERTServer* t_pMNERTServer = qobject_cast<MNERTServer*> (this->parent());
 
     QObject::connect(&t_pMNERTServer->getCommandManager()["clist"], &Command::executed, this, &FiffStreamServer::comClist);
+    QObject::connect(&t_pMNERTServer->getCommandManager()["cqueue"], &Command::executed, this, &FiffStreamServer::comCqueue);
+    QObject::connect(&t_pMNERTServer->getCommandManager()["cstats"], &Command::executed, this, &FiffStreamServer::comCstats);
     QObject::connect(&t_pMNERTServer->getCommandManager()["measinfo"], &Command::executed, this, &FiffStreamServer::comMeasinfo);
     QObject::connect(&t_pMNERTServer->getCommandManager()["start"], &Command::executed, this, &FiffStreamServer::comStart);
     QObject::connect(&t_pMNERTServer->getCommandManager()["stop"], &Command::executed, this, &FiffStreamServer::comStop);
     QObject::connect(&t_pMNERTServer->getCommandManager()["stop-all"], &Command::executed, this, &FiffStreamServer::comStopAll);
+    QObject::connect(&t_pMNERTServer->getCommandManager()["replaylen"], &Command::executed, this, &FiffStreamServer::comReplaylen);
+    QObject::connect(&t_pMNERTServer->getCommandManager()["startreplay"], &Command::executed, this, &FiffStreamServer::comStartreplay);
 
 //    t_pMNERTServer->getCommandManager().connectSlot(QString("clist"), this, &FiffStreamServer::comClist);
 //    t_pMNERTServer->getCommandManager().connectSlot(QString("measinfo"), this, &FiffStreamServer::comMeasinfo);
@@ -368,15 +553,60 @@ QByteArray FiffStreamServer::parseToId(QString& p_sRawId, qint32& p_iParsedId)
 
 void FiffStreamServer::forwardMeasInfo(qint32 ID, const FiffInfo& p_fiffInfo)
 {
+    //Buffers of another measurement must not be replayed with this info
+    if(p_fiffInfo.ch_names != m_qListReplayChNames || p_fiffInfo.sfreq != m_fReplaySFreq)
+    {
+        m_qReplayRing.clear();
+        m_qListReplayChNames = p_fiffInfo.ch_names;
+        m_fReplaySFreq = p_fiffInfo.sfreq;
+    }
+
     emit remitMeasInfo(ID, p_fiffInfo);
 }
 
 
 //*************************************************************************************************************
-//ToDo increase preformance --> try inline
+
 void FiffStreamServer::forwardRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData)
 {
-    emit remitRawBuffer(m_pMatRawData);
+    //
+    // Keep it for late joining clients. The ring only references the buffer, it is encoded when it is replayed.
+    //
+    if(m_iReplayLengthMs > 0)
+    {
+        //The channel count changed without a new measurement info
+        if(!m_qReplayRing.isEmpty() && m_qReplayRing.last().pMatRawData->rows() != m_pMatRawData->rows())
+            m_qReplayRing.clear();
+
+        ReplayBlock t_replayBlock;
+        t_replayBlock.pMatRawData = m_pMatRawData;
+        t_replayBlock.iTimestampMs = m_qReplayTimer.elapsed();
+        m_qReplayRing.append(t_replayBlock);
+
+        trimReplayRing();
+    }
+
+    if(m_qClientList.isEmpty())
+        return;
+
+    //Serialize only once per encoding in use, the clients share the implicitly shared blocks
+    QVector<bool> t_vecNeeded(FiffDataBufferCodec::NumEncodings, false);
+
+    QMap<qint32, FiffStreamThread*>::iterator i;
+    for (i = this->m_qClientList.begin(); i != this->m_qClientList.end(); ++i)
+        t_vecNeeded[i.value()->getDataEncoding()] = true;
+
+    QVector<QByteArray> t_vecBlocks(FiffDataBufferCodec::NumEncodings);
+    for(qint32 e = 0; e < FiffDataBufferCodec::NumEncodings; ++e)
+    {
+        if(!t_vecNeeded[e])
+            continue;
+
+        FiffStream t_FiffStreamOut(&t_vecBlocks[e], QIODevice::WriteOnly);
+        FiffDataBufferCodec::writeToStream(&t_FiffStreamOut, *m_pMatRawData, (FiffDataBufferCodec::Encoding)e);
+    }
+
+    emit remitRawBuffer(t_vecBlocks);
 }
 
 
@@ -52,6 +52,10 @@
 
 #include <QStringList>
 #include <QTcpServer>
+#include <QList>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QVector>
 
 
 //*************************************************************************************************************
@@ -123,6 +127,13 @@ public:
 
 //public slots: --> in Qt 5 not anymore declared as slot
     void forwardMeasInfo(qint32 ID, const FiffInfo& p_fiffInfo);
+
+    //=========================================================================================================
+    /**
+    * Serializes the raw buffer once per encoding used by the clients and hands the shared byte blocks to all clients.
+    *
+    * @param[in] m_pMatRawData  The raw buffer to broadcast.
+    */
     void forwardRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData);
 
 signals:
@@ -132,7 +143,7 @@ signals:
     void stopMeasFiffStreamClient(qint32 ID);
 
     void remitMeasInfo(qint32 ID, const FIFFLIB::FiffInfo& p_fiffInfo);
-    void remitRawBuffer(QSharedPointer<Eigen::MatrixXf>);
+    void remitRawBuffer(const QVector<QByteArray>& p_vecBlocks);
 
     void closeFiffStreamServer();
 
@@ -149,6 +160,22 @@ private:
     */
     void comClist(Command p_command);
 
+    //=========================================================================================================
+    /**
+    * Configures the send queue of a fiff data client
+    *
+    * @param[in] p_command  The client queue command.
+    */
+    void comCqueue(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Fiff data client send queue statistics
+    *
+    * @param[in] p_command  The client statistics command.
+    */
+    void comCstats(Command p_command);
+
     //=========================================================================================================
     /**
     * specifies to which client to send the requested fiff info
@@ -181,11 +208,48 @@ private:
     */
     void comStopAll(Command p_command);
 
+    //=========================================================================================================
+    /**
+    * Sets the length of the replay ring
+    *
+    * @param[in] p_command  The replay length command.
+    */
+    void comReplaylen(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Starts a fiff data client with the buffers of the last seconds from the replay ring
+    *
+    * @param[in] p_command  The start replay command.
+    */
+    void comStartreplay(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Removes all blocks older than the replay length from the replay ring.
+    */
+    void trimReplayRing();
+
     QByteArray parseToId(QString& p_sRawId, qint32& p_iParsedId);
 
+    //=========================================================================================================
+    /**
+    * An encoded raw buffer kept for late joining clients.
+    */
+    struct ReplayBlock {
+        QSharedPointer<Eigen::MatrixXf> pMatRawData;    /**< The raw buffer, encoded only when it is replayed. */
+        qint64 iTimestampMs;                            /**< Time of arrival in ms of m_qReplayTimer. */
+    };
+
     QMap<qint32, FiffStreamThread*> m_qClientList;
     qint32                          m_iNextClientId;
 
+    QList<ReplayBlock>              m_qReplayRing;      /**< The raw buffers of the last m_iReplayLengthMs, oldest first. */
+    qint64                          m_iReplayLengthMs;  /**< Length of the replay ring in ms, 0 disables it. */
+    QElapsedTimer                   m_qReplayTimer;     /**< Clock for the replay ring time stamps. */
+    QStringList                     m_qListReplayChNames;   /**< Channels of the measurement the replay ring belongs to. */
+    float                           m_fReplaySFreq;         /**< Sampling frequency of the measurement the replay ring belongs to. */
+
 };
 
 
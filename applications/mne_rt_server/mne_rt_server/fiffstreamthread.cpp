@@ -52,6 +52,7 @@
 #include <utils/ioutils.h>
 #include <fiff/fiff_constants.h>
 #include <fiff/fiff_tag.h>
+#include <fiff/fiff_data_buffer_codec.h>
 
 
 //*************************************************************************************************************
@@ -72,6 +73,17 @@ using namespace RTSERVER;
 using namespace FIFFLIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define FIFF_STREAM_MAX_QUEUED_BUFFERS      64                  /**< Default maximal number of queued raw buffers per client. */
+#define FIFF_STREAM_SOCKET_BUFFER_LIMIT     (4*1024*1024)       /**< Only move new blocks to the socket while less bytes are pending. */
+#define FIFF_STREAM_BLOCK_TIMEOUT_MS        20                  /**< Maximal wait of the broadcast for a full send queue (SendQueueBlock). */
+#define FIFF_STREAM_MAX_IN_FLIGHT_BUFFERS   256                 /**< Only move new blocks to the socket while less raw buffers are pending. */
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -82,9 +94,20 @@ FiffStreamThread::FiffStreamThread(qint32 id, int socketDescriptor, QObject *par
 , m_iDataClientId(id)
 , m_sDataClientAlias(QString(""))
 , m_iSocketDescriptor(socketDescriptor)
+, m_iQueuedRawBuffers(0)
+, m_iMaxQueuedRawBuffers(FIFF_STREAM_MAX_QUEUED_BUFFERS)
+, m_sendQueuePolicy(SendQueueDropOldest)
+, m_bSendQueueStalled(false)
+, m_iSentRawBuffers(0)
+, m_iDroppedRawBuffers(0)
+, m_dLastLatencyMs(0.0)
+, m_dSumLatencyMs(0.0)
+, m_dMaxLatencyMs(0.0)
+, m_iDataEncoding(FiffDataBufferCodec::Float32)
 , m_bIsSendingRawBuffer(false)
 , m_bIsRunning(false)
 {
+    m_qLatencyTimer.start();
 }
 
 
@@ -108,12 +131,22 @@ void FiffStreamThread::startMeas(qint32 ID)
 {
     if(ID == m_iDataClientId)
     {
+        //A second start must not send a second start block
+        if(isSendingRawBuffer())
+            return;
+
         qDebug() << "Activate raw buffer sending.";
 
+        QByteArray t_block;
+        {
+            // ToDo send start meas
+            FiffStream t_FiffStreamOut(&t_block, QIODevice::WriteOnly);
+            t_FiffStreamOut.start_block(FIFFB_RAW_DATA);
+        }
+
+        enqueueBlock(t_block);
+
         m_qMutex.lock();
-        // ToDo send start meas
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
-        t_FiffStreamOut.start_block(FIFFB_RAW_DATA);
         m_bIsSendingRawBuffer = true;
         m_qMutex.unlock();
     }
@@ -129,11 +162,17 @@ void FiffStreamThread::stopMeas(qint32 ID)
     {
         qDebug() << "stop raw buffer sending.";
 
+        QByteArray t_block;
+        {
+            FiffStream t_FiffStreamOut(&t_block, QIODevice::WriteOnly);
+            t_FiffStreamOut.end_block(FIFFB_RAW_DATA);
+        }
+
         m_qMutex.lock();
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
-        t_FiffStreamOut.end_block(FIFFB_RAW_DATA);
         m_bIsSendingRawBuffer = false;
         m_qMutex.unlock();
+
+        enqueueBlock(t_block);
     }
 }
 
@@ -164,6 +203,25 @@ void FiffStreamThread::parseCommand(FiffTag::SPtr p_pTag)
             printf("FiffStreamClient (ID %d): send client ID %d\r\n\n", m_iDataClientId, m_iDataClientId);
             writeClientId();
         }
+        else if(t_iCmd == MNE_RT_SET_DATA_ENCODING)
+        {
+            //
+            // Set raw buffer encoding
+            //
+            bool t_bOk = false;
+            qint32 t_iEncoding = QString(p_pTag->mid(4, p_pTag->size()-4)).toInt(&t_bOk);
+            if(t_bOk && t_iEncoding >= 0 && t_iEncoding < FiffDataBufferCodec::NumEncodings)
+            {
+                m_qMutex.lock();
+                m_iDataEncoding = t_iEncoding;
+                m_qMutex.unlock();
+                printf("FiffStreamClient (ID %d): new data encoding = %d\r\n\n", m_iDataClientId, t_iEncoding);
+            }
+            else
+            {
+                printf("FiffStreamClient (ID %d): unknown data encoding\r\n\n", m_iDataClientId);
+            }
+        }
         else
         {
             printf("FiffStreamClient (ID %d): unknown command\r\n\n", m_iDataClientId);
@@ -178,24 +236,222 @@ void FiffStreamThread::parseCommand(FiffTag::SPtr p_pTag)
 
 //*************************************************************************************************************
 
-void FiffStreamThread::sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData)
+void FiffStreamThread::sendRawBuffer(const QVector<QByteArray>& p_vecBlocks)
 {
+    m_qMutex.lock();
     if(m_bIsSendingRawBuffer)
     {
-//        qDebug() << "Send RawBuffer to client";
+        //The encoding might have changed after the server encoded the buffer, every encoding can be decoded
+        qint32 t_iBlock = m_iDataEncoding;
+        for(qint32 e = 0; e < p_vecBlocks.size() && p_vecBlocks[t_iBlock].isEmpty(); ++e)
+            t_iBlock = e;
+
+        if(m_iQueuedRawBuffers >= m_iMaxQueuedRawBuffers)
+            makeRoomInSendQueue();
+
+        //No serialization here, the block was encoded once by the server and is only referenced
+        SendBlock t_sendBlock;
+        t_sendBlock.data = p_vecBlocks[t_iBlock];
+        t_sendBlock.bIsRawBuffer = true;
+        t_sendBlock.iTimestampNs = m_qLatencyTimer.nsecsElapsed();
+
+        m_qSendQueue.append(t_sendBlock);
+        ++m_iQueuedRawBuffers;
+    }
+    m_qMutex.unlock();
+}
 
-        m_qMutex.lock();
 
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
-        t_FiffStreamOut.write_float(FIFF_DATA_BUFFER,m_pMatRawData->data(),m_pMatRawData->rows()*m_pMatRawData->cols());
+//*************************************************************************************************************
+
+void FiffStreamThread::enqueueBlock(const QByteArray& p_block, bool p_bIsRawBuffer)
+{
+    SendBlock t_sendBlock;
+    t_sendBlock.data = p_block;
+    t_sendBlock.bIsRawBuffer = p_bIsRawBuffer;
+    t_sendBlock.iTimestampNs = m_qLatencyTimer.nsecsElapsed();
+
+    m_qMutex.lock();
+    m_qSendQueue.append(t_sendBlock);
+    if(p_bIsRawBuffer)
+        ++m_iQueuedRawBuffers;
+    m_qMutex.unlock();
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamThread::makeRoomInSendQueue()
+{
+    switch(m_sendQueuePolicy)
+    {
+        case SendQueueBlock:
+        {
+            //
+            // Lossless as long as the client keeps up. The broadcast runs on the server thread for all clients,
+            // so the wait is bounded: a client which does not drain its queue in time is marked as stalled and
+            // falls back to dropping the oldest buffer until its queue drained again.
+            //
+            if(!m_bSendQueueStalled)
+            {
+                QElapsedTimer t_timer;
+                t_timer.start();
+                qint64 t_iRemainingMs = FIFF_STREAM_BLOCK_TIMEOUT_MS;
+                while(m_iQueuedRawBuffers >= m_iMaxQueuedRawBuffers && m_bIsRunning && t_iRemainingMs > 0)
+                {
+                    m_qQueueNotFull.wait(&m_qMutex, t_iRemainingMs);
+                    t_iRemainingMs = FIFF_STREAM_BLOCK_TIMEOUT_MS - t_timer.elapsed();
+                }
+
+                if(m_iQueuedRawBuffers < m_iMaxQueuedRawBuffers || !m_bIsRunning)
+                    break;
+
+                m_bSendQueueStalled = true;
+                printf("FiffStreamClient (ID %d): client stalled, dropping raw buffers\r\n", m_iDataClientId);
+            }
 
+            for(qint32 i = 0; i < m_qSendQueue.size(); ++i)
+            {
+                if(m_qSendQueue[i].bIsRawBuffer)
+                {
+                    m_qSendQueue.removeAt(i);
+                    --m_iQueuedRawBuffers;
+                    ++m_iDroppedRawBuffers;
+                    break;
+                }
+            }
+            break;
+        }
+        case SendQueueDecimate:
+        {
+            bool t_bDrop = true;
+            qint32 i = 0;
+            while(i < m_qSendQueue.size())
+            {
+                if(m_qSendQueue[i].bIsRawBuffer)
+                {
+                    if(t_bDrop)
+                    {
+                        m_qSendQueue.removeAt(i);
+                        --m_iQueuedRawBuffers;
+                        ++m_iDroppedRawBuffers;
+                        t_bDrop = false;
+                        continue;
+                    }
+                    t_bDrop = true;
+                }
+                ++i;
+            }
+            break;
+        }
+        case SendQueueDropOldest:
+        default:
+        {
+            for(qint32 i = 0; i < m_qSendQueue.size(); ++i)
+            {
+                if(m_qSendQueue[i].bIsRawBuffer)
+                {
+                    m_qSendQueue.removeAt(i);
+                    --m_iQueuedRawBuffers;
+                    ++m_iDroppedRawBuffers;
+                    break;
+                }
+            }
+            break;
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamThread::setSendQueue(qint32 p_iMaxQueueDepth, SendQueuePolicy p_policy)
+{
+    m_qMutex.lock();
+    m_iMaxQueuedRawBuffers = p_iMaxQueueDepth > 0 ? p_iMaxQueueDepth : 1;
+    m_sendQueuePolicy = p_policy;
+
+    //Apply the new limit to what is already queued
+    if(m_sendQueuePolicy != SendQueueBlock)
+    {
+        while(m_iQueuedRawBuffers > m_iMaxQueuedRawBuffers)
+            makeRoomInSendQueue();
+    }
+
+    m_qQueueNotFull.wakeAll();
+    m_qMutex.unlock();
+}
+
+
+//*************************************************************************************************************
+
+bool FiffStreamThread::isSendingRawBuffer()
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_bIsSendingRawBuffer;
+}
+
+
+//*************************************************************************************************************
+
+qint32 FiffStreamThread::replayRawBuffers(const QList<QSharedPointer<Eigen::MatrixXf> >& p_qListBuffers)
+{
+    m_qMutex.lock();
+    if(!m_bIsSendingRawBuffer)
+    {
         m_qMutex.unlock();
+        return 0;
+    }
 
+    //Only the newest buffers which fit into the send queue are replayed
+    qint32 t_iFree = m_iMaxQueuedRawBuffers - m_iQueuedRawBuffers;
+    qint32 t_iFirst = p_qListBuffers.size() > t_iFree ? p_qListBuffers.size() - t_iFree : 0;
+    m_iDroppedRawBuffers += t_iFirst;
+    FiffDataBufferCodec::Encoding t_encoding = (FiffDataBufferCodec::Encoding)m_iDataEncoding;
+    m_qMutex.unlock();
+
+    //Encode outside of the mutex, the client thread keeps sending meanwhile
+    QList<SendBlock> t_qListReplay;
+    qint64 t_iTimestampNs = m_qLatencyTimer.nsecsElapsed();
+    for(qint32 i = t_iFirst; i < p_qListBuffers.size(); ++i)
+    {
+        SendBlock t_sendBlock;
+        {
+            FiffStream t_FiffStreamOut(&t_sendBlock.data, QIODevice::WriteOnly);
+            FiffDataBufferCodec::writeToStream(&t_FiffStreamOut, *p_qListBuffers[i], t_encoding);
+        }
+        t_sendBlock.bIsRawBuffer = true;
+        t_sendBlock.iTimestampNs = t_iTimestampNs;
+        t_qListReplay.append(t_sendBlock);
     }
-//    else
-//    {
-//        qDebug() << "Send RawBuffer is not activated";
-//    }
+
+    m_qMutex.lock();
+    m_qSendQueue.append(t_qListReplay);
+    m_iQueuedRawBuffers += t_qListReplay.size();
+    m_qMutex.unlock();
+
+    return t_qListReplay.size();
+}
+
+
+//*************************************************************************************************************
+
+FiffStreamThread::SendQueueStats FiffStreamThread::getSendQueueStats()
+{
+    SendQueueStats t_stats;
+
+    m_qMutex.lock();
+    t_stats.iQueueDepth = m_iQueuedRawBuffers;
+    t_stats.iMaxQueueDepth = m_iMaxQueuedRawBuffers;
+    t_stats.policy = m_sendQueuePolicy;
+    t_stats.iSentBuffers = m_iSentRawBuffers;
+    t_stats.iDroppedBuffers = m_iDroppedRawBuffers;
+    t_stats.dLastLatencyMs = m_dLastLatencyMs;
+    t_stats.dMeanLatencyMs = m_iSentRawBuffers > 0 ? m_dSumLatencyMs / m_iSentRawBuffers : 0.0;
+    t_stats.dMaxLatencyMs = m_dMaxLatencyMs;
+    m_qMutex.unlock();
+
+    return t_stats;
 }
 
 
@@ -223,11 +479,23 @@ void FiffStreamThread::sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawDa
 
 void FiffStreamThread::sendMeasurementInfo(qint32 ID, const FiffInfo& p_fiffInfo)
 {
-    if(ID == m_iDataClientId)
+    //
+    // A measurement info for all clients (ID -1) replaces the one of the running measurement: its raw data block is
+    // closed before the new info, the clients have to start again. Idle clients ask for the info themselves.
+    //
+    if(ID == -1)
     {
-        m_qMutex.lock();
+        if(!isSendingRawBuffer())
+            return;
 
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
+        stopMeas(m_iDataClientId);
+        ID = m_iDataClientId;
+    }
+
+    if(ID == m_iDataClientId)
+    {
+        QByteArray t_block;
+        FiffStream t_FiffStreamOut(&t_block, QIODevice::WriteOnly);
 
 //        qint32 init_info[2];
 //        init_info[0] = FIFF_MNE_RT_CLIENT_ID;
@@ -238,20 +506,36 @@ void FiffStreamThread::sendMeasurementInfo(qint32 ID, const FiffInfo& p_fiffInfo
 //FiffStream::start_writing_raw
 
         p_fiffInfo.writeToStream(&t_FiffStreamOut);
-        m_qMutex.unlock();
+        enqueueBlock(t_block);
 
-//        qDebug() << "MeasInfo Blocksize: " << m_qSendBlock.size();
+//        qDebug() << "MeasInfo Blocksize: " << t_block.size();
     }
 }
 
 
+//*************************************************************************************************************
+
+qint32 FiffStreamThread::getDataEncoding()
+{
+    m_qMutex.lock();
+    qint32 t_iEncoding = m_iDataEncoding;
+    m_qMutex.unlock();
+
+    return t_iEncoding;
+}
+
+
 //*************************************************************************************************************
 
 void FiffStreamThread::writeClientId()
 {
-    FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
+    QByteArray t_block;
+    {
+        FiffStream t_FiffStreamOut(&t_block, QIODevice::WriteOnly);
+        t_FiffStreamOut.write_int(FIFF_MNE_RT_CLIENT_ID, &m_iDataClientId);
+    }
 
-    t_FiffStreamOut.write_int(FIFF_MNE_RT_CLIENT_ID, &m_iDataClientId);
+    enqueueBlock(t_block);
 }
 
 
@@ -311,6 +595,11 @@ void FiffStreamThread::run()
 
     QTcpSocket t_qTcpSocket;
     if (!t_qTcpSocket.setSocketDescriptor(m_iSocketDescriptor)) {
+        m_qMutex.lock();
+        m_bIsRunning = false;
+        m_qQueueNotFull.wakeAll();
+        m_qMutex.unlock();
+
         emit error(t_qTcpSocket.error());
         return;
     }
@@ -324,32 +613,59 @@ void FiffStreamThread::run()
 
     FiffStream t_FiffStreamIn(&t_qTcpSocket);
 
-//    int i = 0;
+    QList<SendBlock> t_qSendQueue;
+    QList<QPair<qint64, qint64> > t_qInFlightBuffers;  // (end of the raw buffer in the written byte stream, enqueue time)
+    qint64 t_iBytesWritten = 0;                         // bytes handed to the socket since the connection was accepted
+
     while(t_qTcpSocket.state() != QAbstractSocket::UnconnectedState && m_bIsRunning)
     {
         //
-        // Write available data
+        // Write available data. New blocks are only taken while the socket backlog is small, so a slow client
+        // backs up in its bounded send queue instead of the unbounded socket buffer.
         //
-        m_qMutex.lock();
-        qint32 t_iBlockSize = m_qSendBlock.size();
-//        qDebug() << "data available" << t_iBlockSize;
-        if(t_iBlockSize > 0)
+        if(t_qTcpSocket.bytesToWrite() < FIFF_STREAM_SOCKET_BUFFER_LIMIT
+                && t_qInFlightBuffers.size() < FIFF_STREAM_MAX_IN_FLIGHT_BUFFERS)
         {
-            qint32 t_iBytesWritten = t_qTcpSocket.write(m_qSendBlock);
-//            qDebug() << ++i<< "[wrote bytes] " << t_iBytesWritten;
-            t_qTcpSocket.waitForBytesWritten();
-            if(t_iBytesWritten == t_iBlockSize)
+            m_qMutex.lock();
+            t_qSendQueue.swap(m_qSendQueue);
+            m_iQueuedRawBuffers = 0;
+            m_bSendQueueStalled = false;
+            m_qQueueNotFull.wakeAll();
+            m_qMutex.unlock();
+
+            for(qint32 i = 0; i < t_qSendQueue.size(); ++i)
             {
-                m_qSendBlock.clear();
+                t_iBytesWritten += qMax(t_qTcpSocket.write(t_qSendQueue[i].data), (qint64)0);
+                if(t_qSendQueue[i].bIsRawBuffer)
+                    t_qInFlightBuffers.append(qMakePair(t_iBytesWritten, t_qSendQueue[i].iTimestampNs));
             }
-            else
+            t_qSendQueue.clear();
+        }
+
+        if(t_qTcpSocket.bytesToWrite() > 0)
+            t_qTcpSocket.waitForBytesWritten(10);
+
+        //
+        // Latency: from enqueueing to handing the last byte of the raw buffer to the operating system. A buffer
+        // is retired as soon as the socket backlog moved past its end, even if the backlog never runs empty.
+        //
+        qint64 t_iBytesFlushed = t_iBytesWritten - t_qTcpSocket.bytesToWrite();
+        if(!t_qInFlightBuffers.isEmpty() && t_qInFlightBuffers.first().first <= t_iBytesFlushed)
+        {
+            qint64 t_iNowNs = m_qLatencyTimer.nsecsElapsed();
+
+            m_qMutex.lock();
+            while(!t_qInFlightBuffers.isEmpty() && t_qInFlightBuffers.first().first <= t_iBytesFlushed)
             {
-                //we have to store bytes which were not written to the socket, due to writing limit
-                //m_qSendBlock = m_qSendBlock.mid(t_iBytesWritten, t_iBlockSize-t_iBytesWritten);
-                m_qSendBlock.remove(0,t_iBytesWritten); //higher performance then mid
+                m_dLastLatencyMs = (t_iNowNs - t_qInFlightBuffers.first().second) / 1.0e6;
+                m_dSumLatencyMs += m_dLastLatencyMs;
+                if(m_dLastLatencyMs > m_dMaxLatencyMs)
+                    m_dMaxLatencyMs = m_dLastLatencyMs;
+                ++m_iSentRawBuffers;
+                t_qInFlightBuffers.removeFirst();
             }
+            m_qMutex.unlock();
         }
-        m_qMutex.unlock();
 
         //
         // Read: Wait 10ms for incomming tag header, read and continue
@@ -381,6 +697,12 @@ void FiffStreamThread::run()
         }
     }
 
+    //Release a server waiting for room in the send queue
+    m_qMutex.lock();
+    m_bIsRunning = false;
+    m_qQueueNotFull.wakeAll();
+    m_qMutex.unlock();
+
     t_qTcpSocket.disconnectFromHost();
     if(t_qTcpSocket.state() != QAbstractSocket::UnconnectedState)
         t_qTcpSocket.waitForDisconnected();
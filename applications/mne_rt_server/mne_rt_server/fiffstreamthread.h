@@ -54,6 +54,11 @@
 #include <QTcpSocket>
 #include <QMutex>
 #include <QSharedPointer>
+#include <QByteArray>
+#include <QList>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QVector>
 
 
 //*************************************************************************************************************
@@ -81,6 +86,31 @@ class FiffStreamThread : public QThread
 {
     Q_OBJECT
 public:
+    //=========================================================================================================
+    /**
+    * What to do with a new raw buffer when the send queue of a client is full.
+    */
+    enum SendQueuePolicy {
+        SendQueueBlock,         /**< Wait a bounded time until the client has room again, then drop the oldest. */
+        SendQueueDropOldest,    /**< Drop the oldest queued raw buffer. */
+        SendQueueDecimate       /**< Drop every second queued raw buffer. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Send queue statistics of one client.
+    */
+    struct SendQueueStats {
+        qint32 iQueueDepth;             /**< Number of raw buffers currently queued. */
+        qint32 iMaxQueueDepth;          /**< Maximal number of queued raw buffers. */
+        SendQueuePolicy policy;         /**< The policy applied when the queue is full. */
+        quint64 iSentBuffers;           /**< Number of raw buffers written to the socket. */
+        quint64 iDroppedBuffers;        /**< Number of raw buffers dropped by the policy. */
+        double dLastLatencyMs;          /**< Latency from enqueueing to the socket flush of the last raw buffer in ms. */
+        double dMeanLatencyMs;          /**< Mean latency in ms. */
+        double dMaxLatencyMs;           /**< Maximal latency in ms. */
+    };
+
     FiffStreamThread(qint32 id, int socketDescriptor, QObject *parent);
 
     ~FiffStreamThread();
@@ -98,19 +128,89 @@ public:
 
     void writeClientId();
 
+    //=========================================================================================================
+    /**
+    * Returns the raw buffer encoding requested by the client (FiffDataBufferCodec::Encoding).
+    *
+    * @return the raw buffer encoding.
+    */
+    qint32 getDataEncoding();
+
+    //=========================================================================================================
+    /**
+    * Configures the raw buffer send queue.
+    *
+    * @param[in] p_iMaxQueueDepth   Maximal number of queued raw buffers (at least 1).
+    * @param[in] p_policy           The policy applied when the queue is full.
+    */
+    void setSendQueue(qint32 p_iMaxQueueDepth, SendQueuePolicy p_policy);
+
+    //=========================================================================================================
+    /**
+    * Returns the current send queue statistics.
+    *
+    * @return the send queue statistics.
+    */
+    SendQueueStats getSendQueueStats();
+
+    //=========================================================================================================
+    /**
+    * Returns whether raw buffer sending is activated.
+    *
+    * @return true if the client receives raw buffers.
+    */
+    bool isSendingRawBuffer();
+
+    //=========================================================================================================
+    /**
+    * Encodes previously broadcasted raw buffers in the client's encoding and queues them right after the start
+    * block, if raw buffer sending is activated. The replay counts against the send queue bound: if it does not
+    * fit, the oldest replayed buffers are dropped.
+    *
+    * @param[in] p_qListBuffers The raw buffers, oldest first.
+    *
+    * @return the number of queued raw buffers.
+    */
+    qint32 replayRawBuffers(const QList<QSharedPointer<Eigen::MatrixXf> >& p_qListBuffers);
+
 //    void sendData(QTcpSocket& p_qTcpSocket);
 
 signals:
     void error(QTcpSocket::SocketError socketError);
 
 private:
+    //=========================================================================================================
+    /**
+    * A serialized block waiting in the send queue.
+    */
+    struct SendBlock {
+        QByteArray data;        /**< The serialized tag(s). Raw buffer blocks are shared between all clients. */
+        bool bIsRawBuffer;      /**< Whether the block is a raw buffer and may be dropped. */
+        qint64 iTimestampNs;    /**< Time of enqueueing in ns of m_qLatencyTimer. */
+    };
+
     qint32 m_iDataClientId;
     QString m_sDataClientAlias;
 
     int m_iSocketDescriptor;
 
     QMutex m_qMutex;
-    QByteArray m_qSendBlock;
+    QWaitCondition m_qQueueNotFull;     /**< Signaled when raw buffers were taken from the send queue. */
+    QList<SendBlock> m_qSendQueue;      /**< Serialized blocks waiting to be written to the socket. */
+
+    qint32 m_iQueuedRawBuffers;         /**< Number of raw buffers in m_qSendQueue. */
+    qint32 m_iMaxQueuedRawBuffers;      /**< Maximal number of raw buffers in m_qSendQueue. */
+    SendQueuePolicy m_sendQueuePolicy;  /**< The policy applied when the send queue is full. */
+    bool m_bSendQueueStalled;           /**< The client did not drain its queue in time -> SendQueueBlock drops until it does. */
+
+    QElapsedTimer m_qLatencyTimer;      /**< Common clock for enqueue and flush timestamps. */
+    quint64 m_iSentRawBuffers;          /**< Number of raw buffers written to the socket. */
+    quint64 m_iDroppedRawBuffers;       /**< Number of raw buffers dropped by the send queue policy. */
+    double m_dLastLatencyMs;            /**< Latency of the last flushed raw buffer in ms. */
+    double m_dSumLatencyMs;             /**< Sum of all latencies in ms. */
+    double m_dMaxLatencyMs;             /**< Maximal latency in ms. */
+
+    qint32 m_iDataEncoding;             /**< The raw buffer encoding requested by the client (FiffDataBufferCodec::Encoding). */
 
     bool m_bIsSendingRawBuffer;
 
@@ -122,7 +222,31 @@ private:
 
     void sendMeasurementInfo(qint32 ID, const FiffInfo& p_fiffInfo);
 
-    void sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData);
+    //=========================================================================================================
+    /**
+    * Queues the already serialized raw buffer block in the client's encoding for sending, if raw buffer sending
+    * is activated. If the queue is full the send queue policy is applied.
+    *
+    * @param[in] p_vecBlocks    The raw buffer serialized per encoding, empty if no client uses the encoding.
+    *                           Shared with all other clients.
+    */
+    void sendRawBuffer(const QVector<QByteArray>& p_vecBlocks);
+
+    //=========================================================================================================
+    /**
+    * Appends a serialized block to the send queue. Control blocks are never dropped.
+    *
+    * @param[in] p_block        The block to send.
+    * @param[in] p_bIsRawBuffer Whether the block is a raw buffer. Default is false.
+    */
+    void enqueueBlock(const QByteArray& p_block, bool p_bIsRawBuffer = false);
+
+    //=========================================================================================================
+    /**
+    * Drops queued raw buffers according to m_sendQueuePolicy until there is room for a new one. The mutex must be locked.
+    */
+    void makeRoomInSendQueue();
+
     //void readToBuffer1();
 //    void readProc(QTcpSocket& p_qTcpSocket);
 };
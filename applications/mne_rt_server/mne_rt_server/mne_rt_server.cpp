@@ -324,6 +324,27 @@ void MNERTServer::init()
             "           \"description\": \"Closes mne_rt_server.\","
             "           \"parameters\": {}"
             "        },"
+            "       \"cqueue\": {"
+            "           \"description\": \"Configures the raw buffer send queue of the specified FiffStreamClient.\","
+            "           \"parameters\": {"
+            "               \"id\": {"
+            "                   \"description\": \"ID/Alias\","
+            "                   \"type\": \"QString\" "
+            "               },"
+            "               \"policy\": {"
+            "                   \"description\": \"Policy when the queue is full: block (bounded wait, then drop-oldest), drop-oldest or decimate\","
+            "                   \"type\": \"QString\" "
+            "               },"
+            "               \"size\": {"
+            "                   \"description\": \"Maximal number of queued raw buffers\","
+            "                   \"type\": \"int\" "
+            "               }"
+            "           }"
+            "        },"
+            "       \"cstats\": {"
+            "           \"description\": \"Prints and sends queue depth, dropped buffers and latency of all FiffStreamClients.\","
+            "           \"parameters\": {}"
+            "        },"
             "       \"conlist\": {"
             "           \"description\": \"Prints and sends all available connectors.\","
             "           \"parameters\": {}"
@@ -341,6 +362,15 @@ void MNERTServer::init()
             "               }"
             "           }"
             "       },"
+            "       \"replaylen\": {"
+            "           \"description\": \"Sets how many seconds of raw buffers are kept for late joining FiffStreamClients, 0 disables replay.\","
+            "           \"parameters\": {"
+            "               \"seconds\": {"
+            "                   \"description\": \"Replay length in seconds\","
+            "                   \"type\": \"double\" "
+            "               }"
+            "           }"
+            "        },"
             "       \"selcon\": {"
             "           \"description\": \"Selects a new connector, if a measurement is running it will be stopped.\","
             "           \"parameters\": {"
@@ -359,6 +389,19 @@ void MNERTServer::init()
             "               }"
             "           }"
             "        },"
+            "       \"startreplay\": {"
+            "           \"description\": \"Adds specified FiffStreamClient to raw data buffer receivers, starting with the buffers of the last seconds. The connector is not touched.\","
+            "           \"parameters\": {"
+            "               \"id\": {"
+            "                   \"description\": \"ID/Alias\","
+            "                   \"type\": \"QString\" "
+            "               },"
+            "               \"seconds\": {"
+            "                   \"description\": \"Seconds to replay\","
+            "                   \"type\": \"double\" "
+            "               }"
+            "           }"
+            "        },"
             "       \"stop\": {"
             "           \"description\": \"Removes specified FiffStreamClient from raw data buffer receivers.\","
             "           \"parameters\": {"
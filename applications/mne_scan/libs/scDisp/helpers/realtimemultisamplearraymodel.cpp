@@ -402,7 +402,7 @@ void RealTimeMultiSampleArrayModel::setSamplingInfo(float sps, int T)
 
 //*************************************************************************************************************
 
-void RealTimeMultiSampleArrayModel::addData(const QList<MatrixXd> &data)
+void RealTimeMultiSampleArrayModel::addData(const QList<MeasurementBlock::ConstSPtr> &data)
 {
     //SSP
     bool doProj = m_bProjActivated && m_matDataRaw.cols() > 0 && m_matDataRaw.rows() == m_matProj.cols() ? true : false;
@@ -415,8 +415,10 @@ void RealTimeMultiSampleArrayModel::addData(const QList<MatrixXd> &data)
 
     //Copy new data into the global data matrix
     for(qint32 b = 0; b < data.size(); ++b) {
-        int nCol = data.at(b).cols();
-        int nRow = data.at(b).rows();
+        const MatrixXd& t_matBlock = data.at(b)->toDouble();
+
+        int nCol = t_matBlock.cols();
+        int nRow = t_matBlock.rows();
 
         if(nRow != m_matDataRaw.rows()) {
             std::cout<<"incoming data does not match internal data row size. Returning..."<<std::endl;
@@ -439,19 +441,19 @@ void RealTimeMultiSampleArrayModel::addData(const QList<MatrixXd> &data)
             if(doComp) {
                 if(doProj) {
                     //Comp + Proj
-                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = m_matSparseProjCompMult * data.at(b).block(0,0,nRow,m_iResidual);
+                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = m_matSparseProjCompMult * t_matBlock.block(0,0,nRow,m_iResidual);
                 } else {
                     //Comp
-                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = m_matSparseCompMult * data.at(b).block(0,0,nRow,m_iResidual);
+                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = m_matSparseCompMult * t_matBlock.block(0,0,nRow,m_iResidual);
                 }
             } else {
                 if(doProj)
                 {
                     //Proj
-                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = m_matSparseProjMult * data.at(b).block(0,0,nRow,m_iResidual);
+                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = m_matSparseProjMult * t_matBlock.block(0,0,nRow,m_iResidual);
                 } else {
                     //None - Raw
-                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = data.at(b).block(0,0,nRow,m_iResidual);
+                    m_matDataRaw.block(0, m_iCurrentSample, nRow, m_iResidual) = t_matBlock.block(0,0,nRow,m_iResidual);
                 }
             }
 
@@ -482,18 +484,18 @@ void RealTimeMultiSampleArrayModel::addData(const QList<MatrixXd> &data)
         if(doComp) {
             if(doProj) {
                 //Comp + Proj
-                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = m_matSparseProjCompMult * data.at(b);
+                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = m_matSparseProjCompMult * t_matBlock;
             } else {
                 //Comp
-                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = m_matSparseCompMult * data.at(b);
+                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = m_matSparseCompMult * t_matBlock;
             }
         } else {
             if(doProj) {
                 //Proj
-                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = m_matSparseProjMult * data.at(b);
+                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = m_matSparseProjMult * t_matBlock;
             } else {
                 //None - Raw
-                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = data.at(b);
+                m_matDataRaw.block(0, m_iCurrentSample, nRow, nCol) = t_matBlock;
             }
         }
 
@@ -530,8 +532,8 @@ void RealTimeMultiSampleArrayModel::addData(const QList<MatrixXd> &data)
         if(m_bTriggerDetectionActive) {
             int iOldDetectedTriggers = m_qMapDetectedTrigger[m_iCurrentTriggerChIndex].size();
 
-            QList<QPair<int,double> > qMapDetectedTrigger = DetectTrigger::detectTriggerFlanksMax(data.at(b), m_iCurrentTriggerChIndex, m_iCurrentSample-nCol, m_dTriggerThreshold, true);
-            //QList<QPair<int,double> > qMapDetectedTrigger = DetectTrigger::detectTriggerFlanksGrad(data.at(b), m_iCurrentTriggerChIndex, m_iCurrentSample-nCol, m_dTriggerThreshold, false, "Rising");
+            QList<QPair<int,double> > qMapDetectedTrigger = DetectTrigger::detectTriggerFlanksMax(t_matBlock, m_iCurrentTriggerChIndex, m_iCurrentSample-nCol, m_dTriggerThreshold, true);
+            //QList<QPair<int,double> > qMapDetectedTrigger = DetectTrigger::detectTriggerFlanksGrad(t_matBlock, m_iCurrentTriggerChIndex, m_iCurrentSample-nCol, m_dTriggerThreshold, false, "Rising");
 
             //Append results to already found triggers
             m_qMapDetectedTrigger[m_iCurrentTriggerChIndex].append(qMapDetectedTrigger);
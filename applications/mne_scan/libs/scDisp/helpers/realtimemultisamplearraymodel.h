@@ -43,6 +43,7 @@
 //=============================================================================================================
 
 #include <scMeas/realtimesamplearraychinfo.h>
+#include <scMeas/measurementblock.h>
 #include <fiff/fiff_types.h>
 #include <fiff/fiff_info.h>
 
@@ -193,11 +194,12 @@ public:
 
     //=========================================================================================================
     /**
-    * Adds multiple time points (QVector) for a channel set (VectorXd)
+    * Adds multiple time points (QVector) for a channel set (VectorXd). The blocks are shared with the producer,
+    * double precision blocks are read in place.
     *
     * @param[in] data       data to add (Time points of channel samples)
     */
-    void addData(const QList<MatrixXd> &data);
+    void addData(const QList<MeasurementBlock::ConstSPtr> &data);
 
     //=========================================================================================================
     /**
@@ -228,13 +228,13 @@ void RealTimeMultiSampleArrayWidget::update(SCMEASLIB::NewMeasurement::SPtr)
 
             m_fSamplingRate = m_pRTMSA->getSamplingRate();
 
-            m_iMaxFilterTapSize = m_pRTMSA->getMultiSampleArray().at(m_pRTMSA->getMultiSampleArray().size()-1).cols();
+            m_iMaxFilterTapSize = m_pRTMSA->getMultiSampleBlocks().last()->cols();
 
             init();
         }
     }
     else
-        m_pRTMSAModel->addData(m_pRTMSA->getMultiSampleArray());
+        m_pRTMSAModel->addData(m_pRTMSA->getMultiSampleBlocks());
 }
 
 
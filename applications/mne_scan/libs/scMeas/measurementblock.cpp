@@ -0,0 +1,148 @@
+//=============================================================================================================
+/**
+* @file     measurementblock.cpp
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Contains the implementation of the MeasurementBlock class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "measurementblock.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QMutexLocker>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace SCMEASLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+MeasurementBlock::MeasurementBlock(bool bSinglePrecision)
+: m_bSinglePrecision(bSinglePrecision)
+, m_bIsConverted(false)
+{
+}
+
+
+//*************************************************************************************************************
+
+MeasurementBlock::ConstSPtr MeasurementBlock::create(const MatrixXd& mat, bool bSinglePrecision)
+{
+    MeasurementBlock* t_pBlock = new MeasurementBlock(bSinglePrecision);
+
+    if(bSinglePrecision)
+        t_pBlock->m_matDataFloat = mat.cast<float>();
+    else
+        t_pBlock->m_matData = mat;
+
+    return ConstSPtr(t_pBlock);
+}
+
+
+//*************************************************************************************************************
+
+MeasurementBlock::ConstSPtr MeasurementBlock::create(const MatrixXf& mat)
+{
+    MeasurementBlock* t_pBlock = new MeasurementBlock(true);
+    t_pBlock->m_matDataFloat = mat;
+
+    return ConstSPtr(t_pBlock);
+}
+
+
+//*************************************************************************************************************
+
+MeasurementBlock::ConstSPtr MeasurementBlock::adopt(MatrixXd& mat)
+{
+    MeasurementBlock* t_pBlock = new MeasurementBlock(false);
+    t_pBlock->m_matData.swap(mat);
+
+    return ConstSPtr(t_pBlock);
+}
+
+
+//*************************************************************************************************************
+
+MeasurementBlock::ConstSPtr MeasurementBlock::adopt(MatrixXf& mat)
+{
+    MeasurementBlock* t_pBlock = new MeasurementBlock(true);
+    t_pBlock->m_matDataFloat.swap(mat);
+
+    return ConstSPtr(t_pBlock);
+}
+
+
+//*************************************************************************************************************
+
+const MatrixXd& MeasurementBlock::toDouble() const
+{
+    if(!m_bSinglePrecision)
+        return m_matData;
+
+    // the conversion is written once and never changed afterwards, so the reference stays valid without the lock
+    QMutexLocker locker(&m_qConversionMutex);
+    if(!m_bIsConverted)
+    {
+        m_matDataConverted = m_matDataFloat.cast<double>();
+        m_bIsConverted = true;
+    }
+
+    return m_matDataConverted;
+}
+
+
+//*************************************************************************************************************
+
+const MatrixXf& MeasurementBlock::toFloat(MatrixXf& matBuffer) const
+{
+    if(m_bSinglePrecision)
+        return m_matDataFloat;
+
+    matBuffer = m_matData.cast<float>();
+    return matBuffer;
+}
@@ -0,0 +1,256 @@
+//=============================================================================================================
+/**
+* @file     measurementblock.h
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* @brief    Contains the declaration of the MeasurementBlock class.
+*
+*/
+
+#ifndef MEASUREMENTBLOCK_H
+#define MEASUREMENTBLOCK_H
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "scmeas_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QMutex>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE SCMEASLIB
+//=============================================================================================================
+
+namespace SCMEASLIB
+{
+
+
+//=========================================================================================================
+/**
+* A measurement block holds one data block (channels x samples) which is passed through the plugin graph.
+* Blocks are immutable and reference counted, so the producer, the displays and all algorithm plugins share
+* the very same memory instead of copying the block per consumer. The samples are stored either in double
+* or in single precision.
+*
+* @brief Immutable, shared data block of a measurement.
+*/
+class SCMEASSHARED_EXPORT MeasurementBlock
+{
+public:
+    typedef QSharedPointer<MeasurementBlock> SPtr;               /**< Shared pointer type for MeasurementBlock. */
+    typedef QSharedPointer<const MeasurementBlock> ConstSPtr;    /**< Const shared pointer type for MeasurementBlock. */
+
+    //=========================================================================================================
+    /**
+    * Creates a block by copying the given matrix.
+    *
+    * @param [in] mat               the data block (channels x samples).
+    * @param [in] bSinglePrecision  whether the block is stored in single precision.
+    *
+    * @return the new block.
+    */
+    static ConstSPtr create(const Eigen::MatrixXd& mat, bool bSinglePrecision = false);
+
+    //=========================================================================================================
+    /**
+    * Creates a single precision block by copying the given matrix.
+    *
+    * @param [in] mat   the data block (channels x samples).
+    *
+    * @return the new block.
+    */
+    static ConstSPtr create(const Eigen::MatrixXf& mat);
+
+    //=========================================================================================================
+    /**
+    * Creates a block which takes over the memory of the given matrix without copying it. The matrix is empty
+    * afterwards.
+    *
+    * @param [in, out] mat  the data block (channels x samples).
+    *
+    * @return the new block.
+    */
+    static ConstSPtr adopt(Eigen::MatrixXd& mat);
+
+    //=========================================================================================================
+    /**
+    * Creates a single precision block which takes over the memory of the given matrix without copying it. The
+    * matrix is empty afterwards.
+    *
+    * @param [in, out] mat  the data block (channels x samples).
+    *
+    * @return the new block.
+    */
+    static ConstSPtr adopt(Eigen::MatrixXf& mat);
+
+    //=========================================================================================================
+    /**
+    * Returns whether the samples are stored in single precision.
+    *
+    * @return true if the samples are stored in single precision, false if in double precision.
+    */
+    inline bool isSinglePrecision() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of channels.
+    *
+    * @return the number of rows.
+    */
+    inline Eigen::Index rows() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of samples.
+    *
+    * @return the number of columns.
+    */
+    inline Eigen::Index cols() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the stored double precision samples. Empty if the block is stored in single precision, use
+    * toDouble() instead.
+    *
+    * @return the double precision samples.
+    */
+    inline const Eigen::MatrixXd& data() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the single precision samples. Empty if the block is stored in double precision.
+    *
+    * @return the single precision samples.
+    */
+    inline const Eigen::MatrixXf& dataFloat() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the samples in double precision. The stored samples are returned without a copy if they are in
+    * double precision. Single precision samples are converted by the first caller only and the conversion is
+    * kept in the block, so the displays and all plugins which still process double precision share it. The
+    * conversion lives as long as the block.
+    *
+    * @return the double precision samples.
+    */
+    const Eigen::MatrixXd& toDouble() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the samples in single precision. The stored samples are returned without a copy if they are in
+    * single precision, otherwise they are converted into the given buffer, which is returned.
+    *
+    * @param [in, out] matBuffer    conversion buffer, reused by the caller to avoid reallocations.
+    *
+    * @return the single precision samples.
+    */
+    const Eigen::MatrixXf& toFloat(Eigen::MatrixXf& matBuffer) const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Constructs an empty MeasurementBlock. Blocks are only created by create() and adopt().
+    *
+    * @param [in] bSinglePrecision  whether the block is stored in single precision.
+    */
+    explicit MeasurementBlock(bool bSinglePrecision);
+
+    Eigen::MatrixXd     m_matData;              /**< Double precision samples.*/
+    Eigen::MatrixXf     m_matDataFloat;         /**< Single precision samples.*/
+    bool                m_bSinglePrecision;     /**< Whether the samples are stored in single precision.*/
+
+    mutable Eigen::MatrixXd m_matDataConverted; /**< Double precision conversion of the single precision samples.*/
+    mutable bool        m_bIsConverted;         /**< Whether m_matDataConverted was created.*/
+    mutable QMutex      m_qConversionMutex;     /**< Guards the double precision conversion.*/
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline bool MeasurementBlock::isSinglePrecision() const
+{
+    return m_bSinglePrecision;
+}
+
+
+//*************************************************************************************************************
+
+inline Eigen::Index MeasurementBlock::rows() const
+{
+    return m_bSinglePrecision ? m_matDataFloat.rows() : m_matData.rows();
+}
+
+
+//*************************************************************************************************************
+
+inline Eigen::Index MeasurementBlock::cols() const
+{
+    return m_bSinglePrecision ? m_matDataFloat.cols() : m_matData.cols();
+}
+
+
+//*************************************************************************************************************
+
+inline const Eigen::MatrixXd& MeasurementBlock::data() const
+{
+    return m_matData;
+}
+
+
+//*************************************************************************************************************
+
+inline const Eigen::MatrixXf& MeasurementBlock::dataFloat() const
+{
+    return m_matDataFloat;
+}
+
+} // NAMESPACE
+
+#endif // MEASUREMENTBLOCK_H
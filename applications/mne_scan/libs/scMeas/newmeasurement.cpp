@@ -41,6 +41,14 @@
 #include "newmeasurement.h"
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QElapsedTimer>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // USED NAMESPACES
@@ -49,6 +57,22 @@
 using namespace SCMEASLIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+namespace
+{
+    QElapsedTimer startedClock()
+    {
+        QElapsedTimer t_qTimer;
+        t_qTimer.start();
+        return t_qTimer;
+    }
+}
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -58,6 +82,10 @@ NewMeasurement::NewMeasurement(int type, QObject *parent)
 : QObject(parent)
 , m_iMetaTypeId(type)
 , m_bVisibility(true)
+, m_iPendingAcqTimeNs(-1)
+, m_iAcqTimeNs(0)
+, m_iEmitTimeNs(0)
+, m_uiSequenceNumber(0)
 {
 //    qWarning() << "QMetaType" << type;
 }
@@ -69,3 +97,27 @@ NewMeasurement::~NewMeasurement()
 {
 
 }
+
+
+//*************************************************************************************************************
+
+void NewMeasurement::stampBlock()
+{
+    qint64 t_iNowNs = monotonicTimeNs();
+
+    QMutexLocker locker(&m_qMutex);
+    ++m_uiSequenceNumber;
+    m_iAcqTimeNs = m_iPendingAcqTimeNs >= 0 ? m_iPendingAcqTimeNs : t_iNowNs;
+    m_iEmitTimeNs = t_iNowNs;
+    m_iPendingAcqTimeNs = -1;
+}
+
+
+//*************************************************************************************************************
+
+qint64 NewMeasurement::monotonicTimeNs()
+{
+    // started on first use and shared by all plugins of the process
+    static const QElapsedTimer s_qMonotonicClock = startedClock();
+    return s_qMonotonicClock.nsecsElapsed();
+}
@@ -125,6 +125,55 @@ public:
     */
     inline int type() const;
 
+    //=========================================================================================================
+    /**
+    * Sets the acquisition time of the next block. Sensor plugins which know when their data were acquired and
+    * algorithm plugins which forward the time of their input block call this before setting the new value.
+    * Blocks without an acquisition time are stamped when they are emitted.
+    *
+    * @param[in] iTimeNs    the acquisition time on the monotonicTimeNs() clock.
+    */
+    inline void setAcquisitionTime(qint64 iTimeNs);
+
+    //=========================================================================================================
+    /**
+    * Returns the acquisition time of the current block.
+    *
+    * @return the acquisition time on the monotonicTimeNs() clock.
+    */
+    inline qint64 getAcquisitionTime() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the sequence number of the current block.
+    *
+    * @return the sequence number, starting with 1 for the first block.
+    */
+    inline quint64 getSequenceNumber() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the time the current block was emitted.
+    *
+    * @return the emission time on the monotonicTimeNs() clock.
+    */
+    inline qint64 getEmitTime() const;
+
+    //=========================================================================================================
+    /**
+    * Advances the sequence number and stamps the current block with its acquisition and emission time.
+    * Called by the output connector for each emitted block.
+    */
+    void stampBlock();
+
+    //=========================================================================================================
+    /**
+    * Returns the time of the process wide monotonic clock all measurement times refer to.
+    *
+    * @return the time in nanoseconds.
+    */
+    static qint64 monotonicTimeNs();
+
 signals:
     void notify();
 
@@ -142,6 +191,11 @@ private:
     int     m_iMetaTypeId;      /**< QMetaType id of the Measurement */
     QString m_qString_Name;     /**< Name of the Measurement */
     bool    m_bVisibility;      /**< Visibility status */
+
+    qint64  m_iPendingAcqTimeNs;    /**< Acquisition time of the next block, -1 if not set */
+    qint64  m_iAcqTimeNs;           /**< Acquisition time of the current block */
+    qint64  m_iEmitTimeNs;          /**< Emission time of the current block */
+    quint64 m_uiSequenceNumber;     /**< Sequence number of the current block */
 };
 
 
@@ -201,6 +255,42 @@ inline int NewMeasurement::type() const
     return m_iMetaTypeId;
 }
 
+
+//*************************************************************************************************************
+
+inline void NewMeasurement::setAcquisitionTime(qint64 iTimeNs)
+{
+    QMutexLocker locker(&m_qMutex);
+    m_iPendingAcqTimeNs = iTimeNs;
+}
+
+
+//*************************************************************************************************************
+
+inline qint64 NewMeasurement::getAcquisitionTime() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_iAcqTimeNs;
+}
+
+
+//*************************************************************************************************************
+
+inline quint64 NewMeasurement::getSequenceNumber() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_uiSequenceNumber;
+}
+
+
+//*************************************************************************************************************
+
+inline qint64 NewMeasurement::getEmitTime() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_iEmitTimeNs;
+}
+
 } //NAMESPACE
 
 Q_DECLARE_METATYPE(SCMEASLIB::NewMeasurement::SPtr)
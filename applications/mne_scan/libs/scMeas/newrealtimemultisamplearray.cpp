@@ -69,6 +69,7 @@ NewRealTimeMultiSampleArray::NewRealTimeMultiSampleArray(QObject *parent)
 , m_dSamplingRate(0)
 , m_iMultiArraySize(10)
 , m_bChInfoIsInit(false)
+, m_bSinglePrecision(false)
 {
     m_slDisplayFlag << "compensators" << "projections" << "filter" << "view" << "triggerdetection" << "scaling" << "sphara" << "colors";
 }
@@ -236,6 +237,25 @@ void NewRealTimeMultiSampleArray::initFromFiffInfo(FiffInfo::SPtr &p_pFiffInfo)
 }
 
 
+//*************************************************************************************************************
+
+const QList< MatrixXd >& NewRealTimeMultiSampleArray::getMultiSampleArray()
+{
+    QMutexLocker locker(&m_qMutex);
+
+    //Create the list only once per notify, all consumers share it. Single precision blocks are converted once
+    //per block, the conversion is shared with the displays.
+    if(m_matSamples.size() != m_qListBlocks.size())
+    {
+        m_matSamples.clear();
+        for(qint32 i = 0; i < m_qListBlocks.size(); ++i)
+            m_matSamples.append(m_qListBlocks[i]->toDouble());
+    }
+
+    return m_matSamples;
+}
+
+
 //*************************************************************************************************************
 
 void NewRealTimeMultiSampleArray::setValue(const MatrixXd& mat)
@@ -243,10 +263,21 @@ void NewRealTimeMultiSampleArray::setValue(const MatrixXd& mat)
     if(!m_bChInfoIsInit)
         return;
 
+    setValue(MeasurementBlock::create(mat, isSinglePrecision()));
+}
+
+
+//*************************************************************************************************************
+
+void NewRealTimeMultiSampleArray::setValue(const MeasurementBlock::ConstSPtr& pBlock)
+{
+    if(!m_bChInfoIsInit || !pBlock)
+        return;
+
     m_qMutex.lock();
     //check vector size
-    if(mat.rows() != m_qListChInfo.size())
-        qCritical() << "Error Occured in RealTimeMultiSampleArrayNew::setVector: Vector size does not match the number of channels! ";
+    if(pBlock->rows() != m_qListChInfo.size())
+        qCritical() << "Error Occured in RealTimeMultiSampleArrayNew::setValue: Block size does not match the number of channels! ";
 
     //ToDo
 //    //Check if maximum exceeded //ToDo speed this up
@@ -257,13 +288,15 @@ void NewRealTimeMultiSampleArray::setValue(const MatrixXd& mat)
 //    }
 
     //Store
-    m_matSamples.push_back(mat);
+    m_qListBlocks.push_back(pBlock);
+    bool t_bNotify = m_qListBlocks.size() >= m_iMultiArraySize;
 
     m_qMutex.unlock();
-    if(m_matSamples.size() >= m_iMultiArraySize)
+    if(t_bNotify)
     {
         emit notify();
         m_qMutex.lock();
+        m_qListBlocks.clear();
         m_matSamples.clear();
         m_qMutex.unlock();
     }
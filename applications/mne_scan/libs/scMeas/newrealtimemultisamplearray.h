@@ -45,6 +45,7 @@
 #include "scmeas_global.h"
 #include "newmeasurement.h"
 #include "realtimesamplearraychinfo.h"
+#include "measurementblock.h"
 
 #include <fiff/fiff_info.h>
 
@@ -223,20 +224,55 @@ public:
 
     //=========================================================================================================
     /**
-    * Returns the gathered multi sample array.
+    * Sets whether blocks attached by setValue(const MatrixXd&) are stored in single precision.
+    *
+    * @param [in] bSinglePrecision  true to store new blocks in single precision.
+    */
+    inline void setSinglePrecision(bool bSinglePrecision);
+
+    //=========================================================================================================
+    /**
+    * Returns whether blocks attached by setValue(const MatrixXd&) are stored in single precision.
+    *
+    * @return true if new blocks are stored in single precision.
+    */
+    inline bool isSinglePrecision() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the gathered blocks. The blocks are shared with the producer and all other consumers, no sample
+    * is copied.
+    *
+    * @return the current blocks.
+    */
+    inline QList<MeasurementBlock::ConstSPtr> getMultiSampleBlocks() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the gathered multi sample array. The double precision copy is created once per notify on the first
+    * call and shared by all consumers which still use this interface. It costs one extra copy of every block,
+    * so the plugins use getMultiSampleBlocks() and MeasurementBlock::toDouble() instead.
     *
     * @return the current multi sample array.
     */
-    inline const QList< MatrixXd >& getMultiSampleArray();
+    const QList< MatrixXd >& getMultiSampleArray();
 
     //=========================================================================================================
     /**
-    * Attaches a value to the sample array list.
+    * Attaches a value to the sample array list. The value is copied into a new block.
     *
     * @param [in] mat   the value which is attached to the sample array list.
     */
     virtual void setValue(const MatrixXd& mat);
 
+    //=========================================================================================================
+    /**
+    * Attaches a block to the sample array list without copying it.
+    *
+    * @param [in] pBlock    the block which is attached to the sample array list.
+    */
+    virtual void setValue(const MeasurementBlock::ConstSPtr& pBlock);
+
     //=========================================================================================================
     /**
     * Attaches a value to the sample array vector.
@@ -255,7 +291,9 @@ private:
     double                      m_dSamplingRate;    /**< Sampling rate of the RealTimeSampleArray.*/
 //    MatrixXd                    m_vecValue;         /**< The current attached sample vector.*/
     qint32                      m_iMultiArraySize; /**< Sample size of the multi sample array.*/
-    QList< MatrixXd >           m_matSamples;       /**< The multi sample array.*/
+    QList<MeasurementBlock::ConstSPtr> m_qListBlocks; /**< The gathered blocks.*/
+    QList< MatrixXd >           m_matSamples;       /**< Double precision copy of m_qListBlocks, created on demand by getMultiSampleArray().*/
+    bool                        m_bSinglePrecision; /**< If new blocks are stored in single precision.*/
     QList<RealTimeSampleArrayChInfo> m_qListChInfo; /**< Channel info list.*/
     bool                        m_bChInfoIsInit;    /**< If channel info is initialized.*/
 };
@@ -269,6 +307,7 @@ private:
 inline void NewRealTimeMultiSampleArray::clear()
 {
     QMutexLocker locker(&m_qMutex);
+    m_qListBlocks.clear();
     m_matSamples.clear();
 }
 
@@ -387,9 +426,28 @@ qint32 NewRealTimeMultiSampleArray::getMultiArraySize() const
 
 //*************************************************************************************************************
 
-inline const QList< MatrixXd >& NewRealTimeMultiSampleArray::getMultiSampleArray()
+inline void NewRealTimeMultiSampleArray::setSinglePrecision(bool bSinglePrecision)
+{
+    QMutexLocker locker(&m_qMutex);
+    m_bSinglePrecision = bSinglePrecision;
+}
+
+
+//*************************************************************************************************************
+
+inline bool NewRealTimeMultiSampleArray::isSinglePrecision() const
 {
-    return m_matSamples;
+    QMutexLocker locker(&m_qMutex);
+    return m_bSinglePrecision;
+}
+
+
+//*************************************************************************************************************
+
+inline QList<MeasurementBlock::ConstSPtr> NewRealTimeMultiSampleArray::getMultiSampleBlocks() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_qListBlocks;
 }
 
 } // NAMESPACE
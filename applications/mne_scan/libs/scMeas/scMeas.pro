@@ -90,7 +90,8 @@ SOURCES += \
     realtimeevoked.cpp \
     realtimeevokedset.cpp \
     realtimecov.cpp \
-    frequencyspectrum.cpp
+    frequencyspectrum.cpp \
+    measurementblock.cpp
 
 
 HEADERS += \
@@ -106,7 +107,8 @@ HEADERS += \
     realtimeevoked.h \
     realtimeevokedset.h \
     realtimecov.h \
-    frequencyspectrum.h
+    frequencyspectrum.h \
+    measurementblock.h
 
 
 INCLUDEPATH += $${EIGEN_INCLUDE_DIR}
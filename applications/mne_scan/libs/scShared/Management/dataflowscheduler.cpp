@@ -0,0 +1,281 @@
+//=============================================================================================================
+/**
+* @file     dataflowscheduler.cpp
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Contains the implementation of the DataflowScheduler class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "dataflowscheduler.h"
+#include "latencyregistry.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QThread>
+#include <QMutexLocker>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace SCSHAREDLIB;
+using namespace SCMEASLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE SCSHAREDLIB
+//=============================================================================================================
+
+namespace SCSHAREDLIB
+{
+
+//=============================================================================================================
+/**
+* Worker thread of the DataflowScheduler.
+*/
+class DataflowWorker : public QThread
+{
+public:
+    DataflowWorker(DataflowScheduler* pScheduler)
+    : m_pScheduler(pScheduler)
+    {
+    }
+
+protected:
+    virtual void run()
+    {
+        m_pScheduler->work();
+    }
+
+private:
+    DataflowScheduler* m_pScheduler;    /**< The scheduler the worker belongs to. */
+};
+
+} // NAMESPACE
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+DataflowScheduler* DataflowScheduler::instance()
+{
+    static DataflowScheduler s_scheduler(QThread::idealThreadCount() > 0 ? QThread::idealThreadCount() : 2);
+    return &s_scheduler;
+}
+
+
+//*************************************************************************************************************
+
+DataflowScheduler::DataflowScheduler(int iNumThreads)
+: m_iNextStepId(0)
+, m_bIsRunning(true)
+{
+    for(int i = 0; i < iNumThreads; ++i)
+    {
+        DataflowWorker* t_pWorker = new DataflowWorker(this);
+        m_qListWorkers.append(t_pWorker);
+        t_pWorker->start();
+    }
+}
+
+
+//*************************************************************************************************************
+
+DataflowScheduler::~DataflowScheduler()
+{
+    m_qMutex.lock();
+    m_bIsRunning = false;
+    m_qStepReady.wakeAll();
+    m_qMutex.unlock();
+
+    for(int i = 0; i < m_qListWorkers.size(); ++i)
+    {
+        m_qListWorkers[i]->wait();
+        delete m_qListWorkers[i];
+    }
+}
+
+
+//*************************************************************************************************************
+
+qint32 DataflowScheduler::registerStep(const QString &sName, const Step &step)
+{
+    QMutexLocker locker(&m_qMutex);
+
+    StepEntry t_entry;
+    t_entry.sName = sName;
+    t_entry.step = step;
+    t_entry.bQueued = false;
+    t_entry.bRunning = false;
+    t_entry.bRetrigger = false;
+    t_entry.bUnregistered = false;
+
+    qint32 t_iStepId = m_iNextStepId++;
+    m_qMapSteps.insert(t_iStepId, t_entry);
+
+    return t_iStepId;
+}
+
+
+//*************************************************************************************************************
+
+void DataflowScheduler::unregisterStep(qint32 iStepId, const Step &onDrained)
+{
+    QMutexLocker locker(&m_qMutex);
+
+    QMap<qint32, StepEntry>::iterator it = m_qMapSteps.find(iStepId);
+    if(it == m_qMapSteps.end())
+        return;
+
+    if(it.value().bRunning)
+    {
+        // the worker removes the step and calls onDrained when the running execution returned
+        it.value().bRetrigger = false;
+        it.value().bUnregistered = true;
+        it.value().onDrained = onDrained;
+        return;
+    }
+
+    // a queued id of a removed step is skipped by the workers
+    m_qMapSteps.erase(it);
+
+    locker.unlock();
+
+    if(onDrained)
+        onDrained();
+}
+
+
+//*************************************************************************************************************
+
+void DataflowScheduler::trigger(qint32 iStepId)
+{
+    QMutexLocker locker(&m_qMutex);
+
+    QMap<qint32, StepEntry>::iterator it = m_qMapSteps.find(iStepId);
+    if(it == m_qMapSteps.end() || it.value().bUnregistered)
+        return;
+
+    if(it.value().bRunning)
+    {
+        // the step may have missed the new data - run it again when it returned
+        it.value().bRetrigger = true;
+    }
+    else if(!it.value().bQueued)
+    {
+        it.value().bQueued = true;
+        m_qQueueReady.enqueue(iStepId);
+        m_qStepReady.wakeOne();
+    }
+}
+
+
+//*************************************************************************************************************
+
+int DataflowScheduler::numThreads() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_qListWorkers.size();
+}
+
+
+//*************************************************************************************************************
+
+void DataflowScheduler::work()
+{
+    QMutexLocker locker(&m_qMutex);
+
+    while(m_bIsRunning)
+    {
+        if(m_qQueueReady.isEmpty())
+        {
+            m_qStepReady.wait(&m_qMutex);
+            continue;
+        }
+
+        qint32 t_iStepId = m_qQueueReady.dequeue();
+
+        QMap<qint32, StepEntry>::iterator it = m_qMapSteps.find(t_iStepId);
+        if(it == m_qMapSteps.end())
+            continue;
+
+        it.value().bQueued = false;
+        it.value().bRunning = true;
+        Step t_step = it.value().step;
+        QString t_sName = it.value().sName;
+
+        locker.unlock();
+
+        qint64 t_iStartNs = NewMeasurement::monotonicTimeNs();
+        t_step();
+        LatencyRegistry::recordProcessing(t_sName, NewMeasurement::monotonicTimeNs() - t_iStartNs);
+
+        locker.relock();
+
+        it = m_qMapSteps.find(t_iStepId);
+        if(it != m_qMapSteps.end())
+        {
+            it.value().bRunning = false;
+
+            if(it.value().bUnregistered)
+            {
+                Step t_onDrained = it.value().onDrained;
+                m_qMapSteps.erase(it);
+
+                if(t_onDrained)
+                {
+                    locker.unlock();
+                    t_onDrained();
+                    locker.relock();
+                }
+            }
+            else if(it.value().bRetrigger)
+            {
+                it.value().bRetrigger = false;
+                it.value().bQueued = true;
+                m_qQueueReady.enqueue(t_iStepId);
+                m_qStepReady.wakeOne();
+            }
+        }
+    }
+}
@@ -0,0 +1,191 @@
+//=============================================================================================================
+/**
+* @file     dataflowscheduler.h
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Contains the declaration of the DataflowScheduler class.
+*
+*/
+
+#ifndef DATAFLOWSCHEDULER_H
+#define DATAFLOWSCHEDULER_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../scshared_global.h"
+
+#include <functional>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QString>
+#include <QMap>
+#include <QList>
+#include <QQueue>
+#include <QMutex>
+#include <QWaitCondition>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// FORWARD DECLARATIONS
+//=============================================================================================================
+
+class QThread;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE SCSHAREDLIB
+//=============================================================================================================
+
+namespace SCSHAREDLIB
+{
+
+class DataflowWorker;
+
+
+//=========================================================================================================
+/**
+* The DataflowScheduler runs the processing steps of the plugins on a shared pool of worker threads. A plugin
+* registers its processing step once and triggers it whenever new data arrive at its inputs. A triggered step
+* is executed exactly once more, no matter how often it was triggered meanwhile, so a step should process all
+* data which are available when it runs. Steps without data do not occupy a thread, and a step never runs
+* concurrently with itself.
+*
+* @brief Event driven scheduler for the processing steps of the plugins.
+*/
+class SCSHAREDSHARED_EXPORT DataflowScheduler
+{
+    friend class DataflowWorker;
+
+public:
+    typedef std::function<void()> Step;     /**< A processing step. */
+
+    //=========================================================================================================
+    /**
+    * Returns the scheduler shared by all plugins of the process. It runs QThread::idealThreadCount() workers.
+    *
+    * @return the scheduler.
+    */
+    static DataflowScheduler* instance();
+
+    //=========================================================================================================
+    /**
+    * Destroys the DataflowScheduler and stops its workers.
+    */
+    ~DataflowScheduler();
+
+    //=========================================================================================================
+    /**
+    * Registers a processing step.
+    *
+    * @param[in] sName      name of the step, used to report its processing time to the LatencyRegistry.
+    * @param[in] step       the processing step.
+    *
+    * @return the id of the step.
+    */
+    qint32 registerStep(const QString &sName, const Step &step);
+
+    //=========================================================================================================
+    /**
+    * Unregisters a processing step. The step is not triggered anymore. Returns immediately - a running execution
+    * of the step is not waited for, since its outputs may wait for the calling thread. onDrained is called as
+    * soon as the step will not be executed anymore: right away if the step is idle, otherwise by the worker
+    * when the running execution returned.
+    *
+    * @param[in] iStepId    the id of the step.
+    * @param[in] onDrained  called once the step is drained, may be empty.
+    */
+    void unregisterStep(qint32 iStepId, const Step &onDrained = Step());
+
+    //=========================================================================================================
+    /**
+    * Schedules the execution of a step. Unknown ids are ignored.
+    *
+    * @param[in] iStepId    the id of the step.
+    */
+    void trigger(qint32 iStepId);
+
+    //=========================================================================================================
+    /**
+    * Returns the number of worker threads.
+    *
+    * @return the number of worker threads.
+    */
+    int numThreads() const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Constructs a DataflowScheduler and starts its workers.
+    *
+    * @param[in] iNumThreads    number of worker threads.
+    */
+    explicit DataflowScheduler(int iNumThreads);
+
+    //=========================================================================================================
+    /**
+    * The loop of a worker thread. Waits for triggered steps and executes them.
+    */
+    void work();
+
+    //=========================================================================================================
+    /**
+    * A registered step and its scheduling state.
+    */
+    struct StepEntry
+    {
+        QString sName;          /**< Name of the step. */
+        Step    step;           /**< The processing step. */
+        bool    bQueued;        /**< Whether the step waits in the ready queue. */
+        bool    bRunning;       /**< Whether the step is executed right now. */
+        bool    bRetrigger;     /**< Whether the step was triggered while it was running. */
+        bool    bUnregistered;  /**< Whether the step was unregistered while it was running. */
+        Step    onDrained;      /**< Called when the unregistered step returned. */
+    };
+
+    mutable QMutex              m_qMutex;               /**< Guards the scheduling state. */
+    QWaitCondition              m_qStepReady;           /**< Wakes a worker when a step was queued. */
+    QMap<qint32, StepEntry>     m_qMapSteps;            /**< The registered steps. */
+    QQueue<qint32>              m_qQueueReady;          /**< Ids of the triggered steps in trigger order. */
+    QList<QThread*>             m_qListWorkers;         /**< The worker threads. */
+    qint32                      m_iNextStepId;          /**< Id of the next registered step. */
+    bool                        m_bIsRunning;           /**< Whether the workers are running. */
+};
+
+} // NAMESPACE
+
+#endif // DATAFLOWSCHEDULER_H
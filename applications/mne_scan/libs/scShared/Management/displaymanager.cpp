@@ -39,6 +39,7 @@
 //=============================================================================================================
 
 #include "displaymanager.h"
+#include "latencyregistry.h"
 
 
 #include <scDisp/realtimesamplearraywidget.h>
@@ -96,6 +97,34 @@ using namespace SCDISPLIB;
 using namespace SCMEASLIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+/**
+* Connects a display widget to an output connector. The block is recorded to the LatencyRegistry in the same
+* blocking call, once the widget has taken it, so the stamp of the block can not change meanwhile.
+*
+* @param[in] pOutputConnector   The output connector.
+* @param[in] pWidget            The display widget.
+* @param[in] sStage             The stage name of the display.
+*/
+static void connectDisplay(PluginOutputConnector* pOutputConnector, NewMeasurementWidget* pWidget, const QString& sStage)
+{
+    QObject::connect(pOutputConnector, &PluginOutputConnector::notify,
+                     pWidget, [pWidget, sStage](NewMeasurement::SPtr pMeasurement) {
+        qint64 t_iStartNs = NewMeasurement::monotonicTimeNs();
+
+        pWidget->update(pMeasurement);
+
+        LatencyRegistry::recordBlock(sStage, pMeasurement.data(), pMeasurement->getAcquisitionTime(), pMeasurement->getSequenceNumber());
+        LatencyRegistry::recordQueueWait(sStage, t_iStartNs - pMeasurement->getEmitTime());
+        LatencyRegistry::recordProcessing(sStage, NewMeasurement::monotonicTimeNs() - t_iStartNs);
+    }, Qt::BlockingQueuedConnection);
+}
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -128,6 +157,8 @@ QWidget* DisplayManager::show(IPlugin::OutputConnectorList &outputConnectorList,
 
     foreach (QSharedPointer< PluginOutputConnector > pPluginOutputConnector, outputConnectorList)
     {
+        QString t_sStage = QString("Display - %1").arg(pPluginOutputConnector->getStageName());
+
         if(pPluginOutputConnector.dynamicCast< PluginOutputData<NewRealTimeSampleArray> >())
         {
             QSharedPointer<NewRealTimeSampleArray>* pRealTimeSampleArray = &pPluginOutputConnector.dynamicCast< PluginOutputData<NewRealTimeSampleArray> >()->data();
@@ -136,8 +167,7 @@ QWidget* DisplayManager::show(IPlugin::OutputConnectorList &outputConnectorList,
             qListActions.append(rtsaWidget->getDisplayActions());
             qListWidgets.append(rtsaWidget->getDisplayWidgets());
 
-            connect(pPluginOutputConnector.data(), &PluginOutputConnector::notify,
-                    rtsaWidget, &RealTimeSampleArrayWidget::update, Qt::BlockingQueuedConnection);
+            connectDisplay(pPluginOutputConnector.data(), rtsaWidget, t_sStage);
 
             vboxLayout->addWidget(rtsaWidget);
             rtsaWidget->init();
@@ -150,8 +180,7 @@ QWidget* DisplayManager::show(IPlugin::OutputConnectorList &outputConnectorList,
             qListActions.append(rtmsaWidget->getDisplayActions());
             qListWidgets.append(rtmsaWidget->getDisplayWidgets());
 
-            connect(pPluginOutputConnector.data(), &PluginOutputConnector::notify,
-                    rtmsaWidget, &RealTimeMultiSampleArrayWidget::update, Qt::BlockingQueuedConnection);
+            connectDisplay(pPluginOutputConnector.data(), rtmsaWidget, t_sStage);
 
             vboxLayout->addWidget(rtmsaWidget);
             rtmsaWidget->init();
@@ -164,8 +193,7 @@ QWidget* DisplayManager::show(IPlugin::OutputConnectorList &outputConnectorList,
             qListActions.append(rtseWidget->getDisplayActions());
             qListWidgets.append(rtseWidget->getDisplayWidgets());
 
-            connect(pPluginOutputConnector.data(), &PluginOutputConnector::notify,
-                    rtseWidget, &RealTimeSourceEstimateWidget::update, Qt::BlockingQueuedConnection);
+            connectDisplay(pPluginOutputConnector.data(), rtseWidget, t_sStage);
 
             vboxLayout->addWidget(rtseWidget);
             rtseWidget->init();
@@ -178,8 +206,7 @@ QWidget* DisplayManager::show(IPlugin::OutputConnectorList &outputConnectorList,
             qListActions.append(rtseWidget->getDisplayActions());
             qListWidgets.append(rtseWidget->getDisplayWidgets());
 
-            connect(pPluginOutputConnector.data(), &PluginOutputConnector::notify,
-                    rtseWidget, &RealTimeConnectivityEstimateWidget::update, Qt::BlockingQueuedConnection);
+            connectDisplay(pPluginOutputConnector.data(), rtseWidget, t_sStage);
 
             vboxLayout->addWidget(rtseWidget);
             rtseWidget->init();
@@ -193,8 +220,7 @@ QWidget* DisplayManager::show(IPlugin::OutputConnectorList &outputConnectorList,
             qListActions.append(rteWidget->getDisplayActions());
             qListWidgets.append(rteWidget->getDisplayWidgets());
 
-            connect(pPluginOutputConnector.data(), &PluginOutputConnector::notify,
-                    rteWidget, &RealTimeEvokedWidget::update, Qt::BlockingQueuedConnection);
+            connectDisplay(pPluginOutputConnector.data(), rteWidget, t_sStage);
 
             vboxLayout->addWidget(rteWidget);
             rteWidget->init();
@@ -208,8 +234,7 @@ QWidget* DisplayManager::show(IPlugin::OutputConnectorList &outputConnectorList,
             qListActions.append(rtesWidget->getDisplayActions());
             qListWidgets.append(rtesWidget->getDisplayWidgets());
 
-            connect(pPluginOutputConnector.data(), &PluginOutputConnector::notify,
-                    rtesWidget, &RealTimeEvokedSetWidget::update, Qt::BlockingQueuedConnection);
+            connectDisplay(pPluginOutputConnector.data(), rtesWidget, t_sStage);
 
             vboxLayout->addWidget(rtesWidget);
             rtesWidget->init();
@@ -223,8 +248,7 @@ QWidget* DisplayManager::show(IPlugin::OutputConnectorList &outputConnectorList,
             qListActions.append(rtcWidget->getDisplayActions());
             qListWidgets.append(rtcWidget->getDisplayWidgets());
 
-            connect(pPluginOutputConnector.data(), &PluginOutputConnector::notify,
-                    rtcWidget, &RealTimeCovWidget::update, Qt::BlockingQueuedConnection);
+            connectDisplay(pPluginOutputConnector.data(), rtcWidget, t_sStage);
 
             vboxLayout->addWidget(rtcWidget);
             rtcWidget->init();
@@ -238,8 +262,7 @@ QWidget* DisplayManager::show(IPlugin::OutputConnectorList &outputConnectorList,
             qListActions.append(fsWidget->getDisplayActions());
             qListWidgets.append(fsWidget->getDisplayWidgets());
 
-            connect(pPluginOutputConnector.data(), &PluginOutputConnector::notify,
-                    fsWidget, &FrequencySpectrumWidget::update, Qt::BlockingQueuedConnection);
+            connectDisplay(pPluginOutputConnector.data(), fsWidget, t_sStage);
 
             vboxLayout->addWidget(fsWidget);
             fsWidget->init();
@@ -0,0 +1,221 @@
+//=============================================================================================================
+/**
+* @file     latencyregistry.cpp
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Contains the implementation of the LatencyRegistry class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "latencyregistry.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QMutexLocker>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace SCSHAREDLIB;
+using namespace SCMEASLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+QMutex LatencyRegistry::s_qMutex;
+QMap<QString, LatencyRegistry::StageStats> LatencyRegistry::s_qMapStats;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+void LatencyRegistry::recordBlock(const QString &sStage, const void* pSource, qint64 iAcqTimeNs, quint64 uiSequence)
+{
+    qint64 t_iLatencyUs = (NewMeasurement::monotonicTimeNs() - iAcqTimeNs)/1000;
+
+    QMutexLocker locker(&s_qMutex);
+    StageStats& t_stats = stage(sStage);
+
+    // a gap in the sequence numbers of one source means that its blocks never reached this stage
+    QHash<const void*, quint64>::iterator it = t_stats.qHashLastSequence.find(pSource);
+    if(it == t_stats.qHashLastSequence.end())
+        t_stats.qHashLastSequence.insert(pSource, uiSequence);
+    else
+    {
+        if(uiSequence > it.value() + 1)
+            t_stats.iNumDrops += uiSequence - it.value() - 1;
+        it.value() = uiSequence;
+    }
+
+    ++t_stats.iNumBlocks;
+    t_stats.iLastLatencyUs = t_iLatencyUs;
+    t_stats.dMeanLatencyUs += (t_iLatencyUs - t_stats.dMeanLatencyUs)/t_stats.iNumBlocks;
+    if(t_iLatencyUs > t_stats.iMaxLatencyUs)
+        t_stats.iMaxLatencyUs = t_iLatencyUs;
+}
+
+
+//*************************************************************************************************************
+
+void LatencyRegistry::recordQueueWait(const QString &sStage, qint64 iWaitNs)
+{
+    qint64 t_iWaitUs = iWaitNs/1000;
+
+    QMutexLocker locker(&s_qMutex);
+    StageStats& t_stats = stage(sStage);
+
+    ++t_stats.iNumQueueWaits;
+    t_stats.dMeanQueueWaitUs += (t_iWaitUs - t_stats.dMeanQueueWaitUs)/t_stats.iNumQueueWaits;
+    if(t_iWaitUs > t_stats.iMaxQueueWaitUs)
+        t_stats.iMaxQueueWaitUs = t_iWaitUs;
+}
+
+
+//*************************************************************************************************************
+
+void LatencyRegistry::recordProcessing(const QString &sStage, qint64 iProcessingNs)
+{
+    qint64 t_iProcessingUs = iProcessingNs/1000;
+
+    QMutexLocker locker(&s_qMutex);
+    StageStats& t_stats = stage(sStage);
+
+    ++t_stats.iNumProcessings;
+    t_stats.dMeanProcessingUs += (t_iProcessingUs - t_stats.dMeanProcessingUs)/t_stats.iNumProcessings;
+    if(t_iProcessingUs > t_stats.iMaxProcessingUs)
+        t_stats.iMaxProcessingUs = t_iProcessingUs;
+}
+
+
+//*************************************************************************************************************
+
+void LatencyRegistry::recordDrop(const QString &sStage, qint64 iNumDrops)
+{
+    QMutexLocker locker(&s_qMutex);
+    stage(sStage).iNumDrops += iNumDrops;
+}
+
+
+//*************************************************************************************************************
+
+QMap<QString, LatencyRegistry::StageStats> LatencyRegistry::getStats()
+{
+    QMutexLocker locker(&s_qMutex);
+    return s_qMapStats;
+}
+
+
+//*************************************************************************************************************
+
+void LatencyRegistry::reset()
+{
+    QMutexLocker locker(&s_qMutex);
+    s_qMapStats.clear();
+}
+
+
+//*************************************************************************************************************
+
+QString LatencyRegistry::dump()
+{
+    QMap<QString, StageStats> t_qMapStats = getStats();
+
+    QString t_sDump = QString("%1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+            .arg("Stage", -40)
+            .arg("Blocks", 8)
+            .arg("Lat mean", 10)
+            .arg("Lat max", 10)
+            .arg("Wait mean", 10)
+            .arg("Wait max", 10)
+            .arg("Proc mean", 10)
+            .arg("Proc max", 10)
+            .arg("Drops", 8);
+
+    QMap<QString, StageStats>::const_iterator it;
+    for(it = t_qMapStats.constBegin(); it != t_qMapStats.constEnd(); ++it)
+    {
+        const StageStats& t_stats = it.value();
+        t_sDump.append(QString("%1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+                       .arg(it.key().left(40), -40)
+                       .arg(t_stats.iNumBlocks, 8)
+                       .arg(t_stats.dMeanLatencyUs/1000.0, 10, 'f', 2)
+                       .arg(t_stats.iMaxLatencyUs/1000.0, 10, 'f', 2)
+                       .arg(t_stats.dMeanQueueWaitUs/1000.0, 10, 'f', 2)
+                       .arg(t_stats.iMaxQueueWaitUs/1000.0, 10, 'f', 2)
+                       .arg(t_stats.dMeanProcessingUs/1000.0, 10, 'f', 2)
+                       .arg(t_stats.iMaxProcessingUs/1000.0, 10, 'f', 2)
+                       .arg(t_stats.iNumDrops, 8));
+    }
+
+    return t_sDump;
+}
+
+
+//*************************************************************************************************************
+
+LatencyRegistry::StageStats& LatencyRegistry::stage(const QString &sStage)
+{
+    QMap<QString, StageStats>::iterator it = s_qMapStats.find(sStage);
+
+    if(it == s_qMapStats.end())
+    {
+        StageStats t_stats;
+        t_stats.iNumBlocks = 0;
+        t_stats.iLastLatencyUs = 0;
+        t_stats.dMeanLatencyUs = 0.0;
+        t_stats.iMaxLatencyUs = 0;
+        t_stats.iNumQueueWaits = 0;
+        t_stats.dMeanQueueWaitUs = 0.0;
+        t_stats.iMaxQueueWaitUs = 0;
+        t_stats.iNumProcessings = 0;
+        t_stats.dMeanProcessingUs = 0.0;
+        t_stats.iMaxProcessingUs = 0;
+        t_stats.iNumDrops = 0;
+
+        it = s_qMapStats.insert(sStage, t_stats);
+    }
+
+    return it.value();
+}
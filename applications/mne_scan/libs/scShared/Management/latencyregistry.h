@@ -0,0 +1,177 @@
+//=============================================================================================================
+/**
+* @file     latencyregistry.h
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Contains the declaration of the LatencyRegistry class.
+*
+*/
+
+#ifndef LATENCYREGISTRY_H
+#define LATENCYREGISTRY_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../scshared_global.h"
+
+#include <scMeas/newmeasurement.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QString>
+#include <QMap>
+#include <QHash>
+#include <QMutex>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE SCSHAREDLIB
+//=============================================================================================================
+
+namespace SCSHAREDLIB
+{
+
+
+//=========================================================================================================
+/**
+* The LatencyRegistry collects timing statistics of the stages of the plugin graph. A stage is a plugin
+* connector, a display or any step a plugin reports itself. The latency of a stage is the time between the
+* acquisition of a block and the moment it passes the stage, all times are taken from
+* SCMEASLIB::NewMeasurement::monotonicTimeNs().
+*
+* @brief In-process registry of per stage latency, queue wait, processing time and drop counters.
+*/
+class SCSHAREDSHARED_EXPORT LatencyRegistry
+{
+public:
+    //=========================================================================================================
+    /**
+    * Statistics of one stage, all times in microseconds.
+    */
+    struct StageStats
+    {
+        qint64  iNumBlocks;         /**< Number of blocks which passed the stage. */
+        QHash<const void*, quint64> qHashLastSequence;  /**< Sequence number of the last block per emitting measurement. */
+        qint64  iLastLatencyUs;     /**< Latency of the last block. */
+        double  dMeanLatencyUs;     /**< Mean latency. */
+        qint64  iMaxLatencyUs;      /**< Maximal latency. */
+        qint64  iNumQueueWaits;     /**< Number of queue wait samples. */
+        double  dMeanQueueWaitUs;   /**< Mean time a block waited in front of the stage. */
+        qint64  iMaxQueueWaitUs;    /**< Maximal queue wait. */
+        qint64  iNumProcessings;    /**< Number of processing time samples. */
+        double  dMeanProcessingUs;  /**< Mean processing time of the stage. */
+        qint64  iMaxProcessingUs;   /**< Maximal processing time. */
+        qint64  iNumDrops;          /**< Number of dropped blocks. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Records that a block passed a stage. Drops are counted per source, a stage can be fed by several outputs.
+    *
+    * @param[in] sStage         the stage name.
+    * @param[in] pSource        the measurement which emitted the block.
+    * @param[in] iAcqTimeNs     acquisition time of the block.
+    * @param[in] uiSequence     sequence number of the block in its source.
+    */
+    static void recordBlock(const QString &sStage, const void* pSource, qint64 iAcqTimeNs, quint64 uiSequence);
+
+    //=========================================================================================================
+    /**
+    * Records the time a block waited in a queue in front of a stage.
+    *
+    * @param[in] sStage         the stage name.
+    * @param[in] iWaitNs        the queue wait.
+    */
+    static void recordQueueWait(const QString &sStage, qint64 iWaitNs);
+
+    //=========================================================================================================
+    /**
+    * Records the processing time a stage spent on one block.
+    *
+    * @param[in] sStage         the stage name.
+    * @param[in] iProcessingNs  the processing time.
+    */
+    static void recordProcessing(const QString &sStage, qint64 iProcessingNs);
+
+    //=========================================================================================================
+    /**
+    * Records blocks which were dropped by a stage.
+    *
+    * @param[in] sStage         the stage name.
+    * @param[in] iNumDrops      number of dropped blocks.
+    */
+    static void recordDrop(const QString &sStage, qint64 iNumDrops = 1);
+
+    //=========================================================================================================
+    /**
+    * Returns a copy of the statistics of all stages.
+    *
+    * @return the statistics mapped by the stage names.
+    */
+    static QMap<QString, StageStats> getStats();
+
+    //=========================================================================================================
+    /**
+    * Clears the statistics of all stages.
+    */
+    static void reset();
+
+    //=========================================================================================================
+    /**
+    * Returns the statistics of all stages as a text table, in milliseconds.
+    *
+    * @return the statistics table.
+    */
+    static QString dump();
+
+private:
+    //=========================================================================================================
+    /**
+    * Returns the statistics of the stage, creates them if they do not exist. The registry mutex has to be locked.
+    *
+    * @param[in] sStage         the stage name.
+    *
+    * @return the statistics of the stage.
+    */
+    static StageStats& stage(const QString &sStage);
+
+    static QMutex                       s_qMutex;       /**< Guards the statistics. */
+    static QMap<QString, StageStats>    s_qMapStats;    /**< The statistics mapped by the stage names. */
+};
+
+} // NAMESPACE
+
+#endif // LATENCYREGISTRY_H
@@ -60,5 +60,6 @@ PluginConnector::PluginConnector(IPlugin *parent, const QString &name, const QSt
 , m_pPlugin(parent)
 , m_sName(name)
 , m_sDescription(descr)
+, m_sStageName(QString("%1: %2").arg(parent ? parent->getName() : QString()).arg(name))
 {
 }
@@ -125,6 +125,15 @@ public:
      */
     inline QString getName() const;
 
+    //=========================================================================================================
+    /**
+     * Returns the name under which the connector is reported to the LatencyRegistry. It is built once by the
+     * constructor, it is read for every block.
+     *
+     * @return the plugin name followed by the connector name
+     */
+    inline QString getStageName() const;
+
 signals:
 
 
@@ -139,6 +148,7 @@ protected:
 private:
     QString m_sName;        /**< Connection name */
     QString m_sDescription; /**< Connection description */
+    QString m_sStageName;   /**< Name of the connector in the LatencyRegistry */
 
 };
 
@@ -152,6 +162,14 @@ QString PluginConnector::getName() const
     return m_sName;
 }
 
+
+//*************************************************************************************************************
+
+QString PluginConnector::getStageName() const
+{
+    return m_sStageName;
+}
+
 } // NAMESPACE
 
 #endif // PLUGINCONNECTOR_H
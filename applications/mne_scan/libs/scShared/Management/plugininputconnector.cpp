@@ -40,6 +40,7 @@
 
 #include "plugininputconnector.h"
 #include "../Interfaces/IPlugin.h"
+#include "latencyregistry.h"
 
 
 //*************************************************************************************************************
@@ -81,5 +82,14 @@ bool PluginInputConnector::isOutputConnector() const
 
 void PluginInputConnector::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
 {
+    qint64 t_iStartNs = SCMEASLIB::NewMeasurement::monotonicTimeNs();
+    QString t_sStage = getStageName();
+
+    // the sender blocks until this slot returns, so the block stamp can not change meanwhile
+    LatencyRegistry::recordBlock(t_sStage, pMeasurement.data(), pMeasurement->getAcquisitionTime(), pMeasurement->getSequenceNumber());
+    LatencyRegistry::recordQueueWait(t_sStage, t_iStartNs - pMeasurement->getEmitTime());
+
     emit notify(pMeasurement);
+
+    LatencyRegistry::recordProcessing(t_sStage, SCMEASLIB::NewMeasurement::monotonicTimeNs() - t_iStartNs);
 }
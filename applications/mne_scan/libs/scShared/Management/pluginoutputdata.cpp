@@ -43,6 +43,7 @@
 //=============================================================================================================
 
 #include "pluginoutputdata.h"
+#include "latencyregistry.h"
 
 #include <scMeas/newmeasurement.h>
 
@@ -90,6 +91,10 @@ PluginOutputData<T>::PluginOutputData(IPlugin *parent, const QString &name, cons
 template <class T>
 void PluginOutputData<T>::update()
 {
+    m_pMeasurement->stampBlock();
+
+    LatencyRegistry::recordBlock(getStageName(), m_pMeasurement.data(), m_pMeasurement->getAcquisitionTime(), m_pMeasurement->getSequenceNumber());
+
     emit notify(qSharedPointerDynamicCast<SCMEASLIB::NewMeasurement>(m_pMeasurement));
 }
 
@@ -88,7 +88,9 @@ SOURCES += \
     Management/pluginconnectorconnection.cpp \
     Management/pluginconnectorconnectionwidget.cpp \
     Management/pluginscenemanager.cpp \
-    Management/displaymanager.cpp
+    Management/displaymanager.cpp \
+    Management/latencyregistry.cpp \
+    Management/dataflowscheduler.cpp
 
 HEADERS += \
     scshared_global.h \
@@ -105,7 +107,9 @@ HEADERS += \
     Management/pluginconnectorconnection.h \
     Management/pluginconnectorconnectionwidget.h \
     Management/pluginscenemanager.h \
-    Management/displaymanager.h
+    Management/displaymanager.h \
+    Management/latencyregistry.h \
+    Management/dataflowscheduler.h
 
 
 INCLUDEPATH += $${EIGEN_INCLUDE_DIR}
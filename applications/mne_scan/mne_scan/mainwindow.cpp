@@ -41,6 +41,7 @@
 #include <scShared/Management/pluginmanager.h>
 #include <scShared/Management/pluginscenemanager.h>
 #include <scShared/Management/displaymanager.h>
+#include <scShared/Management/latencyregistry.h>
 
 //GUI
 #include "mainwindow.h"
@@ -398,6 +399,10 @@ void MainWindow::createActions()
     else {
         m_pActionMaxLgLv->setChecked(true);}
 
+    m_pActionLatencyStats = new QAction(tr("Latency &Statistics"), this);
+    m_pActionLatencyStats->setStatusTip(tr("Writes the latency statistics of all plugin stages to the log"));
+    connect(m_pActionLatencyStats, &QAction::triggered, this, &MainWindow::showLatencyStatistics);
+
     //Help QMenu
     m_pActionHelpContents = new QAction(tr("Help &Contents"), this);
     m_pActionHelpContents->setShortcuts(QKeySequence::HelpContents);
@@ -457,6 +462,7 @@ void MainWindow::createMenus()
     m_pMenuLgLv->addAction(m_pActionMinLgLv);
     m_pMenuLgLv->addAction(m_pActionNormLgLv);
     m_pMenuLgLv->addAction(m_pActionMaxLgLv);
+    m_pMenuView->addAction(m_pActionLatencyStats);
     m_pMenuView->addSeparator();
 
     menuBar()->addSeparator();
@@ -688,6 +694,8 @@ void MainWindow::startMeasurement()
 {
     writeToLog(tr("Starting real-time measurement..."), _LogKndMessage, _LogLvMin);
 
+    SCSHAREDLIB::LatencyRegistry::reset();
+
     if(!m_pPluginSceneManager->startPlugins())
     {
         QMessageBox::information(0, tr("MNE Scan - Start"), QString(QObject::tr("Not able to start at least one sensor plugin!")), QMessageBox::Ok);
@@ -782,6 +790,14 @@ void MainWindow::toggleDisplayMax()
 }
 
 
+//*************************************************************************************************************
+
+void MainWindow::showLatencyStatistics()
+{
+    writeToLog(QString("<pre>%1</pre>").arg(SCSHAREDLIB::LatencyRegistry::dump().toHtmlEscaped()), _LogKndMessage, _LogLvMin);
+}
+
+
 //*************************************************************************************************************
 
 void MainWindow::uiSetupRunningState(bool state)
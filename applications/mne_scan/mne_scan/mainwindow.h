@@ -212,6 +212,8 @@ private:
     QAction*                            m_pActionNormLgLv;          /**< set normal log level */
     QAction*                            m_pActionMaxLgLv;           /**< set maximal log level */
 
+    QAction*                            m_pActionLatencyStats;      /**< write latency statistics to the log */
+
     QAction*                            m_pActionHelpContents;      /**< open help contents */
     QAction*                            m_pActionAbout;             /**< show about dialog */
 
@@ -286,6 +288,8 @@ private:
     void zoomOut();                     /**< Implements zoom out of runWidget.*/
     void toggleDisplayMax();            /**< Implements show full screen mode of runWidget.*/
 
+    void showLatencyStatistics();       /**< Writes the latency statistics of the plugin graph to the log.*/
+
     void updateTime();                  /**< Updates m_pTime and is called through timeout() of m_pTimer.*/
 
 };
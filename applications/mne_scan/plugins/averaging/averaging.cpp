@@ -268,7 +268,7 @@ void Averaging::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
     if(pRTMSA) {
         //Check if buffer initialized
         if(!m_pAveragingBuffer) {
-            m_pAveragingBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(64, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleArray()[0].cols()));
+            m_pAveragingBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(64, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleBlocks()[0]->cols()));
         }
 
         //Fiff information
@@ -291,9 +291,11 @@ void Averaging::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
 
         if(m_bProcessData)
         {
-            for(qint32 i = 0; i < pRTMSA->getMultiSampleArray().size(); ++i)
+            QList<MeasurementBlock::ConstSPtr> t_qListBlocks = pRTMSA->getMultiSampleBlocks();
+
+            for(qint32 i = 0; i < t_qListBlocks.size(); ++i)
             {
-                MatrixXd t_mat = pRTMSA->getMultiSampleArray()[i];
+                MatrixXd t_mat = t_qListBlocks.at(i)->toDouble();
 
 #ifdef DEBUG_AVERAGING
                 qsrand(time(NULL)+m_iTestCount);
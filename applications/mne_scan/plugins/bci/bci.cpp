@@ -408,10 +408,11 @@ void BCI::updateSensor(XMEASLIB::NewMeasurement::SPtr pMeasurement)
         // Only process data when fiff info has been initialised in run() method
         if(m_bProcessData)
         {
-            MatrixXd t_mat(pRTMSA->getNumChannels(), pRTMSA->getMultiArraySize());
+            QList<SCMEASLIB::MeasurementBlock::ConstSPtr> t_qListBlocks = pRTMSA->getMultiSampleBlocks();
+            MatrixXd t_mat(pRTMSA->getNumChannels(), t_qListBlocks.size());
 
-            for(unsigned char i = 0; i < pRTMSA->getMultiArraySize(); ++i)
-                t_mat.col(i) = pRTMSA->getMultiSampleArray()[i];
+            for(qint32 i = 0; i < t_qListBlocks.size(); ++i)
+                t_mat.col(i) = t_qListBlocks.at(i)->toDouble();
 
             m_pBCIBuffer_Sensor->push(&t_mat);
         }
@@ -219,7 +219,7 @@ void Covariance::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
     {
         //Check if buffer initialized
         if(!m_pCovarianceBuffer)
-            m_pCovarianceBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(64, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleArray()[0].cols()));
+            m_pCovarianceBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(64, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleBlocks()[0]->cols()));
 
         //Fiff information
         if(!m_pFiffInfo)
@@ -231,12 +231,12 @@ void Covariance::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
 
         if(m_bProcessData)
         {
-            MatrixXd t_mat;
+            //The blocks are shared with the producer, double precision blocks are pushed without a copy
+            QList<MeasurementBlock::ConstSPtr> t_qListBlocks = pRTMSA->getMultiSampleBlocks();
 
-            for(qint32 i = 0; i < pRTMSA->getMultiArraySize(); ++i)
+            for(qint32 i = 0; i < t_qListBlocks.size(); ++i)
             {
-                t_mat = pRTMSA->getMultiSampleArray()[i];
-                m_pCovarianceBuffer->push(&t_mat);
+                m_pCovarianceBuffer->push(&t_qListBlocks.at(i)->toDouble());
             }
         }
     }
@@ -199,7 +199,7 @@ void Epidetect::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
     if(pRTMSA) {
         //Check if buffer initialized
         if(!m_pEpidetectBuffer) {
-            m_pEpidetectBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(64, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleArray()[0].cols()));
+            m_pEpidetectBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(64, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleBlocks()[0]->cols()));
         }
 
         //Fiff information
@@ -212,11 +212,11 @@ void Epidetect::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
             m_pEpidetectOutput->data()->setVisibility(true);
         }
 
-        MatrixXd t_mat;
+        //The blocks are shared with the producer, double precision blocks are pushed without a copy
+        QList<MeasurementBlock::ConstSPtr> t_qListBlocks = pRTMSA->getMultiSampleBlocks();
 
-        for(unsigned char i = 0; i < pRTMSA->getMultiArraySize(); ++i) {
-            t_mat = pRTMSA->getMultiSampleArray()[i];
-            m_pEpidetectBuffer->push(&t_mat);
+        for(qint32 i = 0; i < t_qListBlocks.size(); ++i) {
+            m_pEpidetectBuffer->push(&t_qListBlocks.at(i)->toDouble());
         }
     }
 }
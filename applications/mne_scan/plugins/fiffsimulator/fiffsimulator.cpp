@@ -182,6 +182,10 @@ bool FiffSimulator::start()
         m_bIsRunning = true;
         m_qMutex.unlock();
 
+        m_qAcqTimeMutex.lock();
+        m_qQueueAcqTimeNs.clear();
+        m_qAcqTimeMutex.unlock();
+
         // Start threads
         QThread::start();
 
@@ -267,10 +271,22 @@ void FiffSimulator::run()
                 break;
         }
         //pop matrix
-        m_matValue = m_pRawMatrixBuffer_In->pop();
+        Eigen::MatrixXf t_matValue = m_pRawMatrixBuffer_In->pop();
+
+        //the block is acquired when the producer received it
+        m_qAcqTimeMutex.lock();
+        if(!m_qQueueAcqTimeNs.isEmpty())
+            m_pRTMSA_FiffSimulator->data()->setAcquisitionTime(m_qQueueAcqTimeNs.dequeue());
+        m_qAcqTimeMutex.unlock();
+
+        //emit values - the block takes over the popped single precision samples and is shared by all consumers
+        MeasurementBlock::ConstSPtr t_pBlock = MeasurementBlock::adopt(t_matValue);
 
-        //emit values
-        m_pRTMSA_FiffSimulator->data()->setValue(m_matValue.cast<double>());
+        m_qMutex.lock();
+        m_pCurrentBlock = t_pBlock;
+        m_qMutex.unlock();
+
+        m_pRTMSA_FiffSimulator->data()->setValue(t_pBlock);
     }
 }
 
@@ -453,7 +469,11 @@ void FiffSimulator::showHPIDialog()
 
 void FiffSimulator::sendHPIData()
 {
-    if(m_pFiffInfo && m_pHPIWidget) {
+    m_qMutex.lock();
+    MeasurementBlock::ConstSPtr t_pBlock = m_pCurrentBlock;
+    m_qMutex.unlock();
+
+    if(m_pFiffInfo && m_pHPIWidget && t_pBlock) {
         Eigen::MatrixXd matProj;
         m_pFiffInfo->make_projector(matProj);
 
@@ -467,9 +487,9 @@ void FiffSimulator::sendHPIData()
         m_pFiffInfo->make_compensator(0, 101, newComp);//Do this always from 0 since we always read new raw data, we never actually perform a multiplication on already existing data
         Eigen::MatrixXd matComp = newComp.data->data;
 
-        m_pHPIWidget->setData(matProj * matComp * m_matValue.cast<double>());
+        m_pHPIWidget->setData(matProj * matComp * t_pBlock->dataFloat().cast<double>());
 
-        //m_pHPIWidget->setData(m_matValue.cast<double>());
+        //m_pHPIWidget->setData(t_pBlock->dataFloat().cast<double>());
     }
 }
 
@@ -47,6 +47,7 @@
 #include <scShared/Interfaces/ISensor.h>
 #include <generics/circularmatrixbuffer.h>
 #include <rtClient/rtcmdclient.h>
+#include <scMeas/measurementblock.h>
 
 
 //*************************************************************************************************************
@@ -56,6 +57,7 @@
 
 #include <QtWidgets>
 #include <QVector>
+#include <QQueue>
 #include <QTimer>
 
 
@@ -219,6 +221,8 @@ protected:
 
     QSharedPointer<FiffSimulatorProducer>       m_pFiffSimulatorProducer;   /**< Holds the FiffSimulatorProducer.*/
     QSharedPointer<IOBUFFER::RawMatrixBuffer>   m_pRawMatrixBuffer_In;      /**< Holds incoming raw data. */
+    QQueue<qint64>                              m_qQueueAcqTimeNs;          /**< Arrival times of the buffers in m_pRawMatrixBuffer_In. */
+    QMutex                                      m_qAcqTimeMutex;            /**< Guards m_qQueueAcqTimeNs. */
     QSharedPointer<FIFFLIB::FiffInfo>           m_pFiffInfo;                /**< Fiff measurement info.*/
     QSharedPointer<RTCLIENTLIB::RtCmdClient>    m_pRtCmdClient;             /**< The command client.*/
     QSharedPointer<SCDISPLIB::HPIWidget>        m_pHPIWidget;               /**< HPI widget. */
@@ -234,7 +238,7 @@ protected:
     qint32                  m_iActiveConnectorId;           /**< The active connector.*/
     qint32                  m_iBufferSize;                  /**< The raw data buffer size.*/
 
-    Eigen::MatrixXf         m_matValue;                     /**< The current data block.*/
+    SCMEASLIB::MeasurementBlock::ConstSPtr m_pCurrentBlock; /**< The current data block, shared with the consumers.*/
 
     QMap<qint32, QString>   m_qMapConnectors;               /**< Connector map.*/
 
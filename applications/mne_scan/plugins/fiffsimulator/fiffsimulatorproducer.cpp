@@ -41,6 +41,8 @@
 #include "fiffsimulatorproducer.h"
 #include "fiffsimulator.h"
 
+#include <scMeas/newmeasurement.h>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -229,10 +231,17 @@ void FiffSimulatorProducer::run()
             {
                 to += t_matRawBuffer.cols();
                 from += t_matRawBuffer.cols();
+
+                m_pFiffSimulator->m_qAcqTimeMutex.lock();
+                m_pFiffSimulator->m_qQueueAcqTimeNs.enqueue(SCMEASLIB::NewMeasurement::monotonicTimeNs());
+                m_pFiffSimulator->m_qAcqTimeMutex.unlock();
+
                 m_pFiffSimulator->m_pRawMatrixBuffer_In->push(&t_matRawBuffer);
             }
-            else if(FIFF_DATA_BUFFER == FIFF_BLOCK_END)
+            else if(kind == FIFF_BLOCK_END)
                 m_bFlagMeasuring = false;
         }
+        else
+            msleep(10);
     }
 }
@@ -42,6 +42,9 @@
 
 #include "FormFiles/mnesetupwidget.h"
 
+#include <scShared/Management/latencyregistry.h>
+#include <scShared/Management/dataflowscheduler.h>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -51,6 +54,15 @@
 #include <QtCore/QtPlugin>
 #include <QtConcurrent>
 #include <QDebug>
+#include <QStandardPaths>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define MNE_MAX_QUEUED_BLOCKS 64     /**< Maximal number of queued raw blocks, older blocks are dropped. */
 
 
 //*************************************************************************************************************
@@ -61,6 +73,7 @@
 using namespace MNEPlugin;
 using namespace FIFFLIB;
 using namespace SCMEASLIB;
+using namespace SCSHAREDLIB;
 
 
 //*************************************************************************************************************
@@ -82,6 +95,11 @@ MNE::MNE()
 , m_iNumAverages(1)
 , m_iDownSample(6)
 , m_sAvrType("4")
+, m_iNumThreads(QThread::idealThreadCount())
+, m_iProcessingStep(-1)
+, m_bStepDraining(false)
+, m_bStartPending(false)
+, m_iSkipCount(0)
 {
 
 }
@@ -91,7 +109,8 @@ MNE::MNE()
 
 MNE::~MNE()
 {
-    if(this->isRunning())
+    // The processing step holds a strong reference while it runs, so it is not running anymore here
+    if(this->isRunning() || m_bIsRunning)
         stop();
 }
 
@@ -100,7 +119,8 @@ MNE::~MNE()
 
 QSharedPointer<IPlugin> MNE::clone() const
 {
-    QSharedPointer<MNE> pMNEClone(new MNE());
+    QSharedPointer<MNE> pMNEClone(new MNE(), &MNE::deletePlugin);
+    pMNEClone->m_pSelf = pMNEClone;
     return pMNEClone;
 }
 
@@ -113,6 +133,7 @@ QSharedPointer<IPlugin> MNE::clone() const
 void MNE::init()
 {
     // Inits
+    m_sInverseStage = QString("%1: inverse").arg(getName());
     m_pFwd = MNEForwardSolution::SPtr(new MNEForwardSolution(m_qFileFwdSolution));
     m_pAnnotationSet = AnnotationSet::SPtr(new AnnotationSet(m_sAtlasDir+"/lh.aparc.a2009s.annot", m_sAtlasDir+"/rh.aparc.a2009s.annot"));
     m_pSurfaceSet = SurfaceSet::SPtr(new SurfaceSet(m_sSurfaceDir+"/lh.orig", m_sSurfaceDir+"/rh.orig"));
@@ -258,7 +279,9 @@ void MNE::doClustering()
 
     m_qMutex.lock();
     m_bFinishedClustering = false;
-    m_pClusteredFwd = MNEForwardSolution::SPtr(new MNEForwardSolution(m_pFwd->cluster_forward_solution(*m_pAnnotationSet.data(), 40)));
+    MatrixXd D;
+    QString t_sCacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    m_pClusteredFwd = MNEForwardSolution::SPtr(new MNEForwardSolution(m_pFwd->cluster_forward_solution(*m_pAnnotationSet.data(), 40, D, FiffCov(), FiffInfo(), "cityblock", t_sCacheDir)));
     //m_pClusteredFwd = m_pFwd;
     m_pRTSEOutput->data()->setFwdSolution(m_pClusteredFwd);
 
@@ -289,14 +312,22 @@ bool MNE::start()
     if(this->isRunning())
         QThread::wait();
 
-    if(m_bFinishedClustering)
+    if(!m_bFinishedClustering)
+        return false;
+
+    // The processing step of the last measurement must not run concurrently with the new one. Instead of
+    // waiting for it, the start is completed by onProcessingStepDrained().
+    QMutexLocker locker(&m_qMutex);
+    if(m_bStepDraining)
     {
-        m_bIsRunning = true;
-        QThread::start();
+        m_bStartPending = true;
         return true;
     }
-    else
-        return false;
+    locker.unlock();
+
+    m_bIsRunning = true;
+    QThread::start();
+    return true;
 }
 
 
@@ -304,15 +335,41 @@ bool MNE::start()
 
 bool MNE::stop()
 {
+    m_qMutex.lock();
     m_bIsRunning = false;
+    m_bStartPending = false;
+    qint32 t_iProcessingStep = m_iProcessingStep;
+    m_iProcessingStep = -1;
+    if(t_iProcessingStep >= 0)
+        m_bStepDraining = true;
+    m_qFiffInfoCondition.wakeAll();
+    m_qMutex.unlock();
+
+    // Does not wait for a running processing step. Its output may block on this thread, so the step
+    // returns on its own as soon as it sees m_bIsRunning cleared and the scheduler reports it drained.
+    if(t_iProcessingStep >= 0)
+    {
+        QWeakPointer<MNE> t_pSelf = m_pSelf;
+        DataflowScheduler::instance()->unregisterStep(t_iProcessingStep, [t_pSelf]() {
+            QSharedPointer<MNE> t_pMNE = t_pSelf.toStrongRef();
+            if(t_pMNE)
+                QMetaObject::invokeMethod(t_pMNE.data(), "onProcessingStepDrained", Qt::QueuedConnection);
+        });
+    }
 
-    if(m_pRtInvOp->isRunning())
+    // run() returns quickly once it was woken up - afterwards m_pRtInvOp is not assigned anymore
+    QThread::wait();
+
+    if(m_pRtInvOp && m_pRtInvOp->isRunning())
         m_pRtInvOp->stop();
 
+    m_qMutex.lock();
+
     if(m_bProcessData) // Only clear if buffers have been initialised
     {
         m_qVecFiffEvoked.clear();
         m_qVecFiffCov.clear();
+        m_qQueueBlocks.clear();
     }
 
     m_qListCovChNames.clear();
@@ -322,6 +379,8 @@ bool MNE::stop()
 
     m_bReceiveData = false;
 
+    m_qMutex.unlock();
+
     return true;
 }
 
@@ -365,10 +424,6 @@ void MNE::updateRTMSA(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
     QSharedPointer<NewRealTimeMultiSampleArray> pRTMSA = pMeasurement.dynamicCast<NewRealTimeMultiSampleArray>();
 
     if(pRTMSA && m_bReceiveData) {
-        //Check if buffer initialized
-        if(!m_pMatrixDataBuffer)
-            m_pMatrixDataBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(64, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleArray()[0].cols()));
-
         //Fiff Information of the evoked
         if(!m_pFiffInfoInput) {
             //qDebug()<<"MNE::updateRTMSA - Creating m_pFiffInfoInput";
@@ -378,13 +433,33 @@ void MNE::updateRTMSA(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
 
         if(m_bProcessData)
         {
-            for(qint32 i = 0; i < pRTMSA->getMultiSampleArray().size(); ++i)
-            {
-                MatrixXd t_mat = pRTMSA->getMultiSampleArray()[i];
+            //The blocks are shared with the producer and the other consumers, only the pointers are queued
+            QList<MeasurementBlock::ConstSPtr> t_qListBlocks = pRTMSA->getMultiSampleBlocks();
+            qint32 t_iNumDropped = 0;
 
-                m_pMatrixDataBuffer->push(&t_mat);
+            m_qMutex.lock();
+            for(qint32 i = 0; i < t_qListBlocks.size(); ++i)
+            {
+                QueuedBlock t_block;
+                t_block.pBlock = t_qListBlocks[i];
+                t_block.iAcqTimeNs = pRTMSA->getAcquisitionTime();
+                t_block.iEnqueueTimeNs = NewMeasurement::monotonicTimeNs();
+                m_qQueueBlocks.enqueue(t_block);
+            }
+            while(m_qQueueBlocks.size() > MNE_MAX_QUEUED_BLOCKS)
+            {
+                m_qQueueBlocks.dequeue();
+                ++t_iNumDropped;
             }
+            m_qMutex.unlock();
+
+            if(t_iNumDropped > 0)
+                LatencyRegistry::recordDrop(m_sInverseStage, t_iNumDropped);
+
+            triggerProcessing();
         }
+        else
+            triggerProcessing();
     }
 }
 
@@ -408,6 +483,8 @@ void MNE::updateRTC(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
             m_qVecFiffCov.push_back(pRTC->getValue()->pick_channels(m_qListPickChannels));
             m_qMutex.unlock();
         }
+
+        triggerProcessing();
     }
 }
 
@@ -441,6 +518,9 @@ void MNE::updateRTE(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
                 }
             }
         }
+
+        locker.unlock();
+        triggerProcessing();
     }
 }
 
@@ -457,14 +537,17 @@ void MNE::updateInvOp(MNEInverseOperator::SPtr p_pInvOp)
 
     QString method("dSPM"); //"MNE" | "dSPM" | "sLORETA"
 
-    m_qMutex.lock();
-
-    m_pMinimumNorm = MinimumNorm::SPtr(new MinimumNorm(*m_pInvOp.data(), lambda2, method));
+    MinimumNorm::SPtr t_pMinimumNorm = MinimumNorm::SPtr(new MinimumNorm(*m_pInvOp.data(), lambda2, method));
 
     //
-    //   Set up the inverse according to the parameters
+    //   Set up the inverse according to the parameters -> the raw data path uses the single precision kernel
     //
-    m_pMinimumNorm->doInverseSetup(m_iNumAverages,false);
+    t_pMinimumNorm->setFloatKernel(true);
+    t_pMinimumNorm->doInverseSetup(m_iNumAverages,false);
+
+    //Swap in the completely set up estimator -> run() works on its own reference
+    m_qMutex.lock();
+    m_pMinimumNorm = t_pMinimumNorm;
     m_qMutex.unlock();
 }
 
@@ -481,17 +564,18 @@ void MNE::run()
     m_qMutex.unlock();
 
     //
-    // Read Fiff Info
+    // Read Fiff Info - retried whenever new data arrive at the inputs
     //
     while(true)
     {
-        {
-            QMutexLocker locker(&m_qMutex);
-            if(m_pFiffInfo)
-                break;
-        }
         calcFiffInfo();
-        msleep(10);// Wait for fiff Info
+
+        QMutexLocker locker(&m_qMutex);
+        if(m_pFiffInfo)
+            break;
+        if(!m_bIsRunning)
+            return;
+        m_qFiffInfoCondition.wait(&m_qMutex);
     }
 
     //qDebug() << "m_pClusteredFwd->info.ch_names" << m_pClusteredFwd->info.ch_names;
@@ -510,12 +594,7 @@ void MNE::run()
     //
     m_pRtInvOp->start();
 
-    //
-    // start processing data
-    //
-    m_bProcessData = true;
-
-    qint32 skip_count = 0;
+    m_iSkipCount = 0;
 
 //    //
 //    // TEMP INV LOADING START
@@ -544,82 +623,179 @@ void MNE::run()
 //    // TEMP INV LOADING END
 //    //
 
-    while(m_bIsRunning)
+    //
+    // start processing data - the dataflow scheduler runs the processing step whenever new data arrive
+    //
+    // the step keeps the plugin alive while it runs, so the plugin is never destroyed under a running step
+    QWeakPointer<MNE> t_pSelf = m_pSelf;
+    m_qMutex.lock();
+    if(m_bIsRunning)
+        m_iProcessingStep = DataflowScheduler::instance()->registerStep(QString("%1: dataflow step").arg(getName()), [t_pSelf]() {
+            QSharedPointer<MNE> t_pMNE = t_pSelf.toStrongRef();
+            if(t_pMNE)
+                t_pMNE->processData();
+        });
+    m_bProcessData = true;
+    m_qMutex.unlock();
+}
+
+
+//*************************************************************************************************************
+
+void MNE::processData()
+{
+    //
+    // Noise covariances
+    //
+    m_qMutex.lock();
+    while(m_bIsRunning && !m_qVecFiffCov.isEmpty())
+    {
+        m_pRtInvOp->appendNoiseCov(m_qVecFiffCov[0]);
+        m_qVecFiffCov.pop_front();
+    }
+    m_qMutex.unlock();
+
+    //
+    // Raw data
+    //
+    while(true)
     {
         m_qMutex.lock();
-        qint32 t_covSize = m_qVecFiffCov.size();
-        m_qMutex.unlock();
-        if(t_covSize > 0)
+        if(!m_bIsRunning || m_qQueueBlocks.isEmpty())
         {
-            m_qMutex.lock();
-            m_pRtInvOp->appendNoiseCov(m_qVecFiffCov[0]);
-            m_qVecFiffCov.pop_front();
             m_qMutex.unlock();
+            break;
         }
-
-        m_qMutex.lock();
-        qint32 t_evokedSize = m_qVecFiffEvoked.size();
+        QueuedBlock t_block = m_qQueueBlocks.dequeue();
+        MinimumNorm::SPtr t_pMinimumNorm = m_pMinimumNorm;
         m_qMutex.unlock();
 
-        if(m_pMatrixDataBuffer)
-        {
-            //qDebug()<<"MNE::run - Processing RTMSA data";
-            if(m_pMinimumNorm && ((skip_count % m_iDownSample) == 0))
-            {
-                MatrixXd rawSegment = m_pMatrixDataBuffer->pop();
-
-                float tmin = 1 / m_pFiffInfo->sfreq;
-                float tstep = 1 / m_pFiffInfo->sfreq;
+        //qDebug()<<"MNE::run - Processing RTMSA data";
+        qint64 t_iStartNs = NewMeasurement::monotonicTimeNs();
 
-                m_qMutex.lock();
+        LatencyRegistry::recordQueueWait(m_sInverseStage, t_iStartNs - t_block.iEnqueueTimeNs);
 
-                //TODO: Add picking here. See evoked part as input.
-                MNESourceEstimate sourceEstimate = m_pMinimumNorm->calculateInverse(rawSegment, tmin, tstep);
+        if(t_pMinimumNorm && ((m_iSkipCount % m_iDownSample) == 0))
+        {
+            float tmin = 1 / m_pFiffInfo->sfreq;
+            float tstep = 1 / m_pFiffInfo->sfreq;
 
-                m_qMutex.unlock();
+            //TODO: Add picking here. See evoked part as input.
+            //Single precision blocks are read in place, double precision blocks are converted into m_matDataFloat
+            const MatrixXf& t_matData = t_block.pBlock->toFloat(m_matDataFloat);
 
-                m_pRTSEOutput->data()->setValue(sourceEstimate);
-            }
-            else
+            //The kernel is applied outside of the plugin mutex
+            if(t_pMinimumNorm->applyKernel(t_matData, m_matSolFloat, m_iNumThreads, m_kernelWorkspace))
             {
-                m_qMutex.lock();
-                m_qVecFiffEvoked.pop_front();
-                m_qMutex.unlock();
+                updateSourceEstimate(t_pMinimumNorm->getPreparedInverseOperator(), tmin, tstep);
+
+                LatencyRegistry::recordProcessing(m_sInverseStage, NewMeasurement::monotonicTimeNs() - t_iStartNs);
+
+                //The source estimate inherits the acquisition time of the sensor block
+                m_pRTSEOutput->data()->setAcquisitionTime(t_block.iAcqTimeNs);
+                m_pRTSEOutput->data()->setValue(m_sourceEstimate);
             }
-            ++skip_count;
         }
+        ++m_iSkipCount;
+    }
 
-        if(t_evokedSize > 0)
+    //
+    // Evoked data
+    //
+    while(true)
+    {
+        m_qMutex.lock();
+        if(!m_bIsRunning || m_qVecFiffEvoked.isEmpty())
         {
-            qDebug() << "MNE::run - Processing RTE data - t_evokedSize" << t_evokedSize;
-            if(m_pMinimumNorm && ((skip_count % m_iDownSample) == 0))
-            {
-                m_qMutex.lock();
-                FiffEvoked t_fiffEvoked = m_qVecFiffEvoked[0];
-                qDebug()<<"MNE::run - t_fiffEvoked.data.rows()"<<t_fiffEvoked.data.rows();
-                m_qVecFiffEvoked.pop_front();
-                m_qMutex.unlock();
-
-                float tmin = ((float)t_fiffEvoked.first) / t_fiffEvoked.info.sfreq;
-                float tstep = 1/t_fiffEvoked.info.sfreq;
+            m_qMutex.unlock();
+            break;
+        }
+        FiffEvoked t_fiffEvoked = m_qVecFiffEvoked[0];
+        m_qVecFiffEvoked.pop_front();
+        MinimumNorm::SPtr t_pMinimumNorm = m_pMinimumNorm;
+        MNEInverseOperator::SPtr t_pInvOp = m_pInvOp;
+        m_qMutex.unlock();
 
-                m_qMutex.lock();
+        qDebug() << "MNE::processData - Processing RTE data";
+        if(t_pMinimumNorm && ((m_iSkipCount % m_iDownSample) == 0))
+        {
+            qDebug()<<"MNE::processData - t_fiffEvoked.data.rows()"<<t_fiffEvoked.data.rows();
 
-                t_fiffEvoked = t_fiffEvoked.pick_channels(m_pInvOp->noise_cov->names);
+            float tmin = ((float)t_fiffEvoked.first) / t_fiffEvoked.info.sfreq;
+            float tstep = 1/t_fiffEvoked.info.sfreq;
 
-                MNESourceEstimate sourceEstimate = m_pMinimumNorm->calculateInverse(t_fiffEvoked.data, tmin, tstep);
+            t_fiffEvoked = t_fiffEvoked.pick_channels(t_pInvOp->noise_cov->names);
 
-                m_qMutex.unlock();
+            MNESourceEstimate sourceEstimate = t_pMinimumNorm->calculateInverse(t_fiffEvoked.data, tmin, tstep);
 
-                m_pRTSEOutput->data()->setValue(sourceEstimate);
-            }
-            else
-            {
-                m_qMutex.lock();
-                m_qVecFiffEvoked.pop_front();
-                m_qMutex.unlock();
-            }
-            ++skip_count;
+            m_pRTSEOutput->data()->setValue(sourceEstimate);
         }
+        ++m_iSkipCount;
     }
 }
+
+
+//*************************************************************************************************************
+
+void MNE::onProcessingStepDrained()
+{
+    m_qMutex.lock();
+    m_bStepDraining = false;
+    bool t_bStart = m_bStartPending;
+    m_bStartPending = false;
+    m_qMutex.unlock();
+
+    if(t_bStart)
+    {
+        m_bIsRunning = true;
+        QThread::start();
+    }
+}
+
+
+//*************************************************************************************************************
+
+void MNE::deletePlugin(MNE* pMNE)
+{
+    // the last reference may be released by the processing step on a worker thread
+    if(QThread::currentThread() == pMNE->thread())
+        delete pMNE;
+    else
+        pMNE->deleteLater();
+}
+
+
+//*************************************************************************************************************
+
+void MNE::triggerProcessing()
+{
+    QMutexLocker locker(&m_qMutex);
+
+    if(m_iProcessingStep >= 0)
+        DataflowScheduler::instance()->trigger(m_iProcessingStep);
+    else
+        m_qFiffInfoCondition.wakeAll(); // the inputs changed while run() waits for the fiff info
+}
+
+
+//*************************************************************************************************************
+
+void MNE::updateSourceEstimate(const MNEInverseOperator &p_invOp, float tmin, float tstep)
+{
+    //Reuse the preallocated estimate -> memory is only reallocated when the block size changes
+    if(m_sourceEstimate.vertices.size() != p_invOp.src[0].vertno.size() + p_invOp.src[1].vertno.size())
+    {
+        m_sourceEstimate.vertices = VectorXi(p_invOp.src[0].vertno.size() + p_invOp.src[1].vertno.size());
+        m_sourceEstimate.vertices << p_invOp.src[0].vertno, p_invOp.src[1].vertno;
+    }
+
+    //MNESourceEstimate is double precision -> the solution is converted once per block into the existing storage
+    m_sourceEstimate.data = m_matSolFloat.cast<double>();
+
+    m_sourceEstimate.times.resize(m_matSolFloat.cols());
+    for(qint32 i = 0; i < m_sourceEstimate.times.size(); ++i)
+        m_sourceEstimate.times[i] = tmin + i*tstep;
+
+    m_sourceEstimate.tmin = tmin;
+    m_sourceEstimate.tstep = tstep;
+}
@@ -69,6 +69,7 @@
 
 #include <QtWidgets>
 #include <QFile>
+#include <QWaitCondition>
 
 
 //*************************************************************************************************************
@@ -191,6 +192,29 @@ public:
     */
     void updateInvOp(MNEInverseOperator::SPtr p_pInvOp);
 
+    //=========================================================================================================
+    /**
+    * Writes the current single precision solution into the preallocated output estimate.
+    *
+    * @param[in] p_invOp    The prepared inverse operator the solution belongs to.
+    * @param[in] tmin       Time of the first sample.
+    * @param[in] tstep      Time between two samples.
+    */
+    void updateSourceEstimate(const MNEInverseOperator &p_invOp, float tmin, float tstep);
+
+    //=========================================================================================================
+    /**
+    * The processing step which is run by the DataflowScheduler. Processes all data which are queued at the inputs.
+    */
+    void processData();
+
+    //=========================================================================================================
+    /**
+    * Schedules the processing step after new data arrived at an input. As long as run() waits for the fiff
+    * information, it is woken up instead.
+    */
+    void triggerProcessing();
+
 signals:
     //=========================================================================================================
     /**
@@ -207,16 +231,43 @@ signals:
 protected:
     virtual void run();
 
+private slots:
+    //=========================================================================================================
+    /**
+    * Called when the processing step which was unregistered by stop() returned. Completes a start which was
+    * requested meanwhile.
+    */
+    void onProcessingStepDrained();
+
 private:
+    //=========================================================================================================
+    /**
+    * Deleter of the cloned plugins. Deletes the plugin on its own thread.
+    *
+    * @param[in] pMNE   the plugin to delete.
+    */
+    static void deletePlugin(MNE* pMNE);
+
+    //=========================================================================================================
+    /**
+    * A raw data block which is queued for the inverse.
+    */
+    struct QueuedBlock {
+        MeasurementBlock::ConstSPtr pBlock;         /**< The data block, shared with the producer.*/
+        qint64                      iAcqTimeNs;     /**< Acquisition time of the block.*/
+        qint64                      iEnqueueTimeNs; /**< Time at which the block was queued.*/
+    };
+
     PluginInputData<NewRealTimeMultiSampleArray>::SPtr      m_pRTMSAInput;          /**< The RealTimeMultiSampleArray input.*/
     PluginInputData<RealTimeEvokedSet>::SPtr                m_pRTESInput;            /**< The RealTimeEvoked input.*/
     PluginInputData<RealTimeCov>::SPtr                      m_pRTCInput;            /**< The RealTimeCov input.*/
 
     PluginOutputData<RealTimeSourceEstimate>::SPtr          m_pRTSEOutput;          /**< The RealTimeSourceEstimate output.*/
 
-    CircularMatrixBuffer<double>::SPtr                      m_pMatrixDataBuffer;    /**< Holds incoming RealTimeMultiSampleArray data.*/
+    QQueue<QueuedBlock>                                     m_qQueueBlocks;         /**< Holds incoming RealTimeMultiSampleArray blocks.*/
 
     QMutex m_qMutex;
+    QWaitCondition m_qFiffInfoCondition;    /**< Wakes run() when new data arrived while it waits for the fiff information.*/
 
     QVector<FiffEvoked> m_qVecFiffEvoked;
     qint32 m_iNumAverages;
@@ -254,6 +305,19 @@ private:
 
     QString                     m_sAvrType;         /**< The average type */
 
+    qint32                      m_iNumThreads;      /**< Number of threads the source rows are split across */
+    MatrixXf                    m_matDataFloat;     /**< Conversion buffer for double precision data blocks */
+    MatrixXf                    m_matSolFloat;      /**< Single precision solution block */
+    MinimumNorm::FloatKernelWorkspace m_kernelWorkspace; /**< Intermediate buffers of the float kernel application */
+    QString                     m_sInverseStage;    /**< Name of the inverse step in the LatencyRegistry */
+    MNESourceEstimate           m_sourceEstimate;   /**< Preallocated output estimate */
+
+    qint32                      m_iProcessingStep;  /**< Id of the processing step at the DataflowScheduler, -1 if not registered */
+    bool                        m_bStepDraining;    /**< If an unregistered processing step may still run */
+    bool                        m_bStartPending;    /**< If start() waits for the draining processing step */
+    QWeakPointer<MNE>           m_pSelf;            /**< The plugin itself, set by clone(). The plugins of the scene are always clones. */
+    qint32                      m_iSkipCount;       /**< Counts the processed blocks for the down sampling */
+
 //    RealTimeSourceEstimate::SPtr m_pRTSE_MNE; /**< Source Estimate output channel. */
 };
 
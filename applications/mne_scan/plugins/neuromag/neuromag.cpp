@@ -318,6 +318,10 @@ bool Neuromag::start()
         // Buffer
         m_pRawMatrixBuffer_In = QSharedPointer<RawMatrixBuffer>(new RawMatrixBuffer(8,m_pFiffInfo->nchan,m_iBufferSize));
 
+        m_qAcqTimeMutex.lock();
+        m_qQueueAcqTimeNs.clear();
+        m_qAcqTimeMutex.unlock();
+
         m_bIsRunning = true;
 
         // Start threads
@@ -441,7 +445,21 @@ void Neuromag::run()
         //pop matrix
         matValue = m_pRawMatrixBuffer_In->pop();
 
-        //emit values
-        m_pRTMSA_Neuromag->data()->setValue(matValue.cast<double>());
+        //the block is acquired when the producer received it
+        m_qAcqTimeMutex.lock();
+        if(!m_qQueueAcqTimeNs.isEmpty())
+            m_pRTMSA_Neuromag->data()->setAcquisitionTime(m_qQueueAcqTimeNs.dequeue());
+        m_qAcqTimeMutex.unlock();
+
+        //emit values - the block takes over the samples, so they are not copied again for the consumers
+        if(m_pRTMSA_Neuromag->data()->isSinglePrecision())
+        {
+            m_pRTMSA_Neuromag->data()->setValue(MeasurementBlock::adopt(matValue));
+        }
+        else
+        {
+            MatrixXd t_matValue = matValue.cast<double>();
+            m_pRTMSA_Neuromag->data()->setValue(MeasurementBlock::adopt(t_matValue));
+        }
     }
 }
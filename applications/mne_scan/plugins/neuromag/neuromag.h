@@ -73,6 +73,7 @@
 
 #include <QtWidgets>
 #include <QVector>
+#include <QQueue>
 #include <QTimer>
 
 
@@ -249,6 +250,8 @@ private:
     QTimer m_cmdConnectionTimer;                            /**< Timer for convinient command client connection. When timer times out a connection is tried to be established. */
 
     QSharedPointer<RawMatrixBuffer> m_pRawMatrixBuffer_In;  /**< Holds incoming raw data. */
+    QQueue<qint64>                  m_qQueueAcqTimeNs;      /**< Arrival times of the buffers in m_pRawMatrixBuffer_In. */
+    QMutex                          m_qAcqTimeMutex;        /**< Guards m_qQueueAcqTimeNs. */
 
     bool                            m_bIsRunning;           /**< Whether FiffSimulator is running.*/
 
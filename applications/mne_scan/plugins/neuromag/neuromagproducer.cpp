@@ -41,6 +41,8 @@
 #include "neuromagproducer.h"
 #include "neuromag.h"
 
+#include <scMeas/newmeasurement.h>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -215,10 +217,16 @@ void NeuromagProducer::run()
                 to += t_matRawBuffer.cols();
                 from += t_matRawBuffer.cols();
 
+                m_pNeuromag->m_qAcqTimeMutex.lock();
+                m_pNeuromag->m_qQueueAcqTimeNs.enqueue(SCMEASLIB::NewMeasurement::monotonicTimeNs());
+                m_pNeuromag->m_qAcqTimeMutex.unlock();
+
                 m_pNeuromag->m_pRawMatrixBuffer_In->push(&t_matRawBuffer);
             }
-            else if(FIFF_DATA_BUFFER == FIFF_BLOCK_END)
+            else if(kind == FIFF_BLOCK_END)
                 m_bFlagMeasuring = false;
         }
+        else
+            msleep(10);
     }
 }
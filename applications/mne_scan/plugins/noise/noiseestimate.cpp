@@ -254,7 +254,7 @@ void NoiseEstimate::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
         m_qMutex.lock();
         if(!m_pBuffer)
         {
-            m_pBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(8, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleArray()[0].cols()));
+            m_pBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(8, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleBlocks()[0]->cols()));
         }
 
         //Fiff information
@@ -267,12 +267,12 @@ void NoiseEstimate::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
 
         if(m_bProcessData)
         {
-            MatrixXd t_mat;
+            //The blocks are shared with the producer, double precision blocks are pushed without a copy
+            QList<MeasurementBlock::ConstSPtr> t_qListBlocks = pRTMSA->getMultiSampleBlocks();
 
-            for(qint32 i = 0; i < pRTMSA->getMultiArraySize(); ++i)
+            for(qint32 i = 0; i < t_qListBlocks.size(); ++i)
             {
-                t_mat = pRTMSA->getMultiSampleArray()[i];
-                m_pBuffer->push(&t_mat);
+                m_pBuffer->push(&t_qListBlocks.at(i)->toDouble());
             }
         }
     }
@@ -250,7 +250,7 @@ void NoiseReduction::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
     if(m_pRTMSA) {
         //Check if buffer initialized
         if(!m_pNoiseReductionBuffer) {
-            m_pNoiseReductionBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(64, m_pRTMSA->getNumChannels(), m_pRTMSA->getMultiSampleArray()[0].cols()));
+            m_pNoiseReductionBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(64, m_pRTMSA->getNumChannels(), m_pRTMSA->getMultiSampleBlocks()[0]->cols()));
         }
 
         //Fiff information
@@ -278,15 +278,15 @@ void NoiseReduction::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
             m_pNoiseReductionOutput->data()->setVisibility(true);            
 
             //Init the filter
-            m_iMaxFilterTapSize = m_pRTMSA->getMultiSampleArray().at(m_pRTMSA->getMultiSampleArray().size()-1).cols();
+            m_iMaxFilterTapSize = m_pRTMSA->getMultiSampleBlocks().last()->cols();
             initFilter();
         }
 
-        MatrixXd t_mat;
+        //The blocks are shared with the producer, double precision blocks are pushed without a copy
+        QList<MeasurementBlock::ConstSPtr> t_qListBlocks = m_pRTMSA->getMultiSampleBlocks();
 
-        for(unsigned char i = 0; i < m_pRTMSA->getMultiArraySize(); ++i) {
-            t_mat = m_pRTMSA->getMultiSampleArray()[i];
-            m_pNoiseReductionBuffer->push(&t_mat);
+        for(qint32 i = 0; i < t_qListBlocks.size(); ++i) {
+            m_pNoiseReductionBuffer->push(&t_qListBlocks.at(i)->toDouble());
         }
     }
 }
@@ -91,6 +91,14 @@ RapMusicToolboxSetupWidget::RapMusicToolboxSetupWidget(RapMusicToolbox* toolbox,
     else
         ui.m_qLabel_surfaceStat->setText("loaded");
 
+    ui.m_qSpinBox_StreamWindowSize->setValue(m_pRapMusicToolbox->m_iStreamWindowSize);
+    ui.m_qSpinBox_StreamRank->setValue(m_pRapMusicToolbox->m_iStreamRank);
+    ui.m_qSpinBox_StreamCadence->setValue(m_pRapMusicToolbox->m_iStreamCadence);
+
+    connect(ui.m_qSpinBox_StreamWindowSize, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &RapMusicToolboxSetupWidget::streamingSettingsChanged);
+    connect(ui.m_qSpinBox_StreamRank, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &RapMusicToolboxSetupWidget::streamingSettingsChanged);
+    connect(ui.m_qSpinBox_StreamCadence, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &RapMusicToolboxSetupWidget::streamingSettingsChanged);
+
     connect(ui.m_qPushButton_About, &QPushButton::released, this, &RapMusicToolboxSetupWidget::showAboutDialog);
     connect(ui.m_qPushButton_FwdFileDialog, &QPushButton::released, this, &RapMusicToolboxSetupWidget::showFwdFileDialog);
     connect(ui.m_qPushButton_AtlasDirDialog, &QPushButton::released, this, &RapMusicToolboxSetupWidget::showAtlasDirDialog);
@@ -134,6 +142,16 @@ void RapMusicToolboxSetupWidget::clusteringTriggered()
 }
 
 
+//*************************************************************************************************************
+
+void RapMusicToolboxSetupWidget::streamingSettingsChanged()
+{
+    m_pRapMusicToolbox->setStreamingSettings(ui.m_qSpinBox_StreamWindowSize->value(),
+                                             ui.m_qSpinBox_StreamRank->value(),
+                                             ui.m_qSpinBox_StreamCadence->value());
+}
+
+
 //*************************************************************************************************************
 
 void RapMusicToolboxSetupWidget::showAboutDialog()
@@ -125,6 +125,12 @@ private:
     */
     void clusteringTriggered();
 
+    //=========================================================================================================
+    /**
+    * Passes the streaming window, rank and cadence to the RapMusicToolbox
+    */
+    void streamingSettingsChanged();
+
     //=========================================================================================================
     /**
     * Shows the About Dialogs
@@ -51,6 +51,8 @@
 #include <QtCore/QtPlugin>
 #include <QtConcurrent>
 #include <QDebug>
+#include <QStandardPaths>
+#include <QSettings>
 
 
 //*************************************************************************************************************
@@ -78,6 +80,9 @@ RapMusicToolbox::RapMusicToolbox()
 , m_sSurfaceDir("./MNE-sample-data/subjects/sample/surf")
 , m_iNumAverages(10)
 , m_iDownSample(4)
+, m_iStreamWindowSize(300)
+, m_iStreamRank(6)
+, m_iStreamCadence(50)
 {
 
 }
@@ -108,6 +113,14 @@ QSharedPointer<IPlugin> RapMusicToolbox::clone() const
 
 void RapMusicToolbox::init()
 {
+    //
+    // Load Settings
+    //
+    QSettings settings;
+    m_iStreamWindowSize = settings.value(QString("Plugin/%1/streamWindowSize").arg(this->getName()), 300).toInt();
+    m_iStreamRank = settings.value(QString("Plugin/%1/streamRank").arg(this->getName()), 6).toInt();
+    m_iStreamCadence = settings.value(QString("Plugin/%1/streamCadence").arg(this->getName()), 50).toInt();
+
     // Inits
     m_pFwd = MNEForwardSolution::SPtr(new MNEForwardSolution(m_qFileFwdSolution));
     m_pAnnotationSet = AnnotationSet::SPtr(new AnnotationSet(m_sAtlasDir+"/lh.aparc.a2009s.annot", m_sAtlasDir+"/rh.aparc.a2009s.annot"));
@@ -118,6 +131,10 @@ void RapMusicToolbox::init()
     connect(m_pRTEInput.data(), &PluginInputConnector::notify, this, &RapMusicToolbox::updateRTE, Qt::DirectConnection);
     m_inputConnectors.append(m_pRTEInput);
 
+    m_pRTMSAInput = PluginInputData<NewRealTimeMultiSampleArray>::create(this, "RapMusic Toolbox RTMSA In", "RapMusic Toolbox real-time multi sample array input data");
+    connect(m_pRTMSAInput.data(), &PluginInputConnector::notify, this, &RapMusicToolbox::updateRTMSA, Qt::DirectConnection);
+    m_inputConnectors.append(m_pRTMSAInput);
+
     // Output
     m_pRTSEOutput = PluginOutputData<RealTimeSourceEstimate>::create(this, "MNEOut", "RapMusic Toolbox output data");
     m_outputConnectors.append(m_pRTSEOutput);
@@ -136,7 +153,24 @@ void RapMusicToolbox::init()
 
 void RapMusicToolbox::unload()
 {
+    //
+    // Store Settings
+    //
+    QSettings settings;
+    settings.setValue(QString("Plugin/%1/streamWindowSize").arg(this->getName()), m_iStreamWindowSize);
+    settings.setValue(QString("Plugin/%1/streamRank").arg(this->getName()), m_iStreamRank);
+    settings.setValue(QString("Plugin/%1/streamCadence").arg(this->getName()), m_iStreamCadence);
+}
+
+
+//*************************************************************************************************************
 
+void RapMusicToolbox::setStreamingSettings(qint32 iWindowSize, qint32 iRank, qint32 iCadence)
+{
+    QMutexLocker locker(&m_qMutex);
+    m_iStreamWindowSize = iWindowSize;
+    m_iStreamRank = qMin(iRank, iWindowSize);
+    m_iStreamCadence = iCadence;
 }
 
 
@@ -160,6 +194,29 @@ void RapMusicToolbox::calcFiffInfo()
 
         m_pFiffInfo = QSharedPointer<FiffInfo>(new FiffInfo(m_pFiffInfoEvoked->pick_info(sel)));
     }
+    else if(m_pFiffInfoInput && m_pFiffInfoForward)
+    {
+        qDebug() << "Fiff Infos available";
+
+        //Pick the raw data rows in the channel order of the forward solution
+        m_qListPickChannels.clear();
+        QList<qint32> t_qListSel;
+        foreach (const QString &ch, m_pFiffInfoForward->ch_names)
+        {
+            qint32 idx = m_pFiffInfoInput->ch_names.indexOf(ch);
+            if(idx >= 0)
+            {
+                m_qListPickChannels << ch;
+                t_qListSel << idx;
+            }
+        }
+
+        m_vecPickSel = RowVectorXi(t_qListSel.size());
+        for(qint32 i = 0; i < t_qListSel.size(); ++i)
+            m_vecPickSel[i] = t_qListSel[i];
+
+        m_pFiffInfo = QSharedPointer<FiffInfo>(new FiffInfo(m_pFiffInfoInput->pick_info(m_vecPickSel)));
+    }
 
 }
 
@@ -172,7 +229,9 @@ void RapMusicToolbox::doClustering()
 
     m_qMutex.lock();
     m_bFinishedClustering = false;
-    m_pClusteredFwd = MNEForwardSolution::SPtr(new MNEForwardSolution(m_pFwd->cluster_forward_solution(*m_pAnnotationSet.data(), 40)));
+    MatrixXd D;
+    QString t_sCacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    m_pClusteredFwd = MNEForwardSolution::SPtr(new MNEForwardSolution(m_pFwd->cluster_forward_solution(*m_pAnnotationSet.data(), 40, D, FiffCov(), FiffInfo(), "cityblock", t_sCacheDir)));
     m_qMutex.unlock();
 
     finishedClustering();
@@ -215,12 +274,20 @@ bool RapMusicToolbox::start()
 
 bool RapMusicToolbox::stop()
 {
+    m_qMutex.lock();
+    m_bIsRunning = false;
+    CircularMatrixBuffer<double>::SPtr t_pMatrixDataBuffer = m_pMatrixDataBuffer;
+    m_qMutex.unlock();
+
+    //Unblock a streaming run which waits for new samples
+    if(t_pMatrixDataBuffer)
+        t_pMatrixDataBuffer->releaseFromPop();
+
     //Check if the thread is already or still running. This can happen if the start button is pressed immediately after the stop button was pressed. In this case the stopping process is not finished yet but the start process is initiated.
     if(this->isRunning())
         QThread::wait();
 
     m_qMutex.lock();
-    m_bIsRunning = false;
 
     if(m_bProcessData) // Only clear if buffers have been initialised
         m_qVecFiffEvoked.clear();
@@ -230,6 +297,9 @@ bool RapMusicToolbox::stop()
 
     m_bReceiveData = false;
 
+    if(m_pMatrixDataBuffer)
+        m_pMatrixDataBuffer->clear();
+
     m_qMutex.unlock();
 
     return true;
@@ -288,6 +358,39 @@ void RapMusicToolbox::updateRTE(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
 }
 
 
+//*************************************************************************************************************
+
+void RapMusicToolbox::updateRTMSA(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
+{
+    QSharedPointer<NewRealTimeMultiSampleArray> pRTMSA = pMeasurement.dynamicCast<NewRealTimeMultiSampleArray>();
+
+    if(pRTMSA && m_bReceiveData)
+    {
+        {
+            QMutexLocker locker(&m_qMutex);
+
+            //Check if buffer initialized
+            if(!m_pMatrixDataBuffer)
+                m_pMatrixDataBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(64, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleBlocks()[0]->cols()));
+
+            //Fiff Information of the raw data
+            if(!m_pFiffInfoInput)
+                m_pFiffInfoInput = pRTMSA->info();
+        }
+
+        if(m_bProcessData)
+        {
+            QList<MeasurementBlock::ConstSPtr> t_qListBlocks = pRTMSA->getMultiSampleBlocks();
+
+            for(qint32 i = 0; i < t_qListBlocks.size(); ++i)
+            {
+                m_pMatrixDataBuffer->push(&t_qListBlocks.at(i)->toDouble());
+            }
+        }
+    }
+}
+
+
 //*************************************************************************************************************
 
 void RapMusicToolbox::run()
@@ -315,17 +418,24 @@ void RapMusicToolbox::run()
         msleep(10);// Wait for fiff Info
     }
 
-    m_pPwlRapMusic.reset();
+    m_pRapMusic.reset();
 
-    m_pPwlRapMusic = RapMusic::SPtr(new RapMusic(*m_pClusteredFwd, false, numDipolePairs));
+    m_pRapMusic = RapMusic::SPtr(new RapMusic(*m_pClusteredFwd, false, numDipolePairs));
 
     //
     // start processing data
     //
     m_qMutex.lock();
     m_bProcessData = true;
+    bool t_bStreaming = m_pFiffInfoInput && !m_pFiffInfoEvoked;
     m_qMutex.unlock();
 
+    if(t_bStreaming)
+    {
+        runStreaming();
+        return;
+    }
+
     qint32 skip_count = 0;
     while(true)
     {
@@ -341,17 +451,17 @@ void RapMusicToolbox::run()
 
         if(t_evokedSize > 0)
         {
-            if(m_pPwlRapMusic && ((skip_count % 10) == 0))
+            if(m_pRapMusic && ((skip_count % 10) == 0))
             {
                 m_qMutex.lock();
                 FiffEvoked t_fiffEvoked = m_qVecFiffEvoked[0];
-                m_pPwlRapMusic->setStcAttr(t_fiffEvoked.data.cols()/4.0,0.0);
+                m_pRapMusic->setStcAttr(t_fiffEvoked.data.cols()/4.0,0.0);
                 m_qVecFiffEvoked.pop_front();
                 m_qMutex.unlock();
 
                 qDebug() << "m_pRapMusic->calculateInverse";
 
-                MNESourceEstimate sourceEstimate = m_pPwlRapMusic->calculateInverse(t_fiffEvoked);
+                MNESourceEstimate sourceEstimate = m_pRapMusic->calculateInverse(t_fiffEvoked);
                 m_pRTSEOutput->data()->setValue(sourceEstimate);
             }
             else
@@ -364,3 +474,57 @@ void RapMusicToolbox::run()
         }
     }
 }
+
+
+//*************************************************************************************************************
+
+void RapMusicToolbox::runStreaming()
+{
+    m_qMutex.lock();
+    qint32 t_iStreamCadence = m_iStreamCadence;
+    CircularMatrixBuffer<double>::SPtr t_pMatrixDataBuffer = m_pMatrixDataBuffer;
+    m_pRapMusic->initStreaming(m_iStreamWindowSize, m_iStreamRank);
+    m_qMutex.unlock();
+
+    float tstep = 1.0f / m_pFiffInfo->sfreq;
+    qint64 t_iNumSamples = 0;
+    qint32 t_iSinceEstimate = 0;
+
+    while(true)
+    {
+        {
+            QMutexLocker locker(&m_qMutex);
+            if(!m_bIsRunning)
+                break;
+        }
+
+        MatrixXd rawSegment = t_pMatrixDataBuffer->pop();
+
+        {
+            QMutexLocker locker(&m_qMutex);
+            if(!m_bIsRunning)
+                break;
+        }
+
+        MatrixXd t_matPicked(m_vecPickSel.size(), rawSegment.cols());
+        for(qint32 i = 0; i < m_vecPickSel.size(); ++i)
+            t_matPicked.row(i) = rawSegment.row(m_vecPickSel[i]);
+
+        bool t_bWindowFull = m_pRapMusic->appendStreamingData(t_matPicked);
+
+        t_iNumSamples += t_matPicked.cols();
+        t_iSinceEstimate += t_matPicked.cols();
+
+        //Only the scan is done per estimate -> the subspace is already up to date
+        if(t_bWindowFull && t_iSinceEstimate >= t_iStreamCadence)
+        {
+            float tmin = (t_iNumSamples - t_iSinceEstimate) * tstep;
+
+            MNESourceEstimate sourceEstimate = m_pRapMusic->calculateStreamingInverse(t_iSinceEstimate, tmin, tstep);
+            if(!sourceEstimate.isEmpty())
+                m_pRTSEOutput->data()->setValue(sourceEstimate);
+
+            t_iSinceEstimate = 0;
+        }
+    }
+}
@@ -53,8 +53,9 @@
 #include <fiff/fiff_evoked.h>
 #include <mne/mne_forwardsolution.h>
 #include <mne/mne_sourceestimate.h>
-#include <inverse/rapMusic/pwlrapmusic.h>
+#include <inverse/rapMusic/rapmusic.h>
 
+#include <scMeas/newrealtimemultisamplearray.h>
 #include <scMeas/realtimesourceestimate.h>
 #include <scMeas/realtimeevoked.h>
 
@@ -165,6 +166,24 @@ public:
     */
     void updateRTE(SCMEASLIB::NewMeasurement::SPtr pMeasurement);
 
+    //=========================================================================================================
+    /**
+    * Slot to update the raw data stream. The samples are fed into the streaming RAP MUSIC window.
+    *
+    * @param[in] pMeasurement   The real-time multi sample array to be appended
+    */
+    void updateRTMSA(SCMEASLIB::NewMeasurement::SPtr pMeasurement);
+
+    //=========================================================================================================
+    /**
+    * Sets the parameters of the streaming RAP MUSIC. They take effect with the next start.
+    *
+    * @param[in] iWindowSize    Number of samples of the sliding window
+    * @param[in] iRank          Dimension of the tracked signal subspace
+    * @param[in] iCadence       Number of samples after which a new source estimate is emitted
+    */
+    void setStreamingSettings(qint32 iWindowSize, qint32 iRank, qint32 iCadence);
+
 signals:
     //=========================================================================================================
     /**
@@ -181,13 +200,23 @@ signals:
 protected:
     virtual void run();
 
+    //=========================================================================================================
+    /**
+    * Processes the raw data stream with the streaming RAP MUSIC, i.e. the signal subspace is tracked
+    * sample block wise and a source estimate is emitted every m_iStreamCadence samples.
+    */
+    void runStreaming();
+
 private:
     PluginInputData<RealTimeEvoked>::SPtr   m_pRTEInput;    /**< The RealTimeEvoked input.*/
+    PluginInputData<NewRealTimeMultiSampleArray>::SPtr  m_pRTMSAInput;  /**< The RealTimeMultiSampleArray input.*/
 
     PluginOutputData<RealTimeSourceEstimate>::SPtr      m_pRTSEOutput;  /**< The RealTimeSourceEstimate output.*/
 
     QMutex m_qMutex;
 
+    CircularMatrixBuffer<double>::SPtr  m_pMatrixDataBuffer;    /**< Holds incoming RealTimeMultiSampleArray data.*/
+
     QVector<FiffEvoked> m_qVecFiffEvoked;
     qint32 m_iNumAverages;
 
@@ -209,13 +238,19 @@ private:
 
     FiffInfo::SPtr              m_pFiffInfo;        /**< Fiff information. */
     FiffInfo::SPtr              m_pFiffInfoEvoked;  /**< Fiff information of the evoked. */
+    FiffInfo::SPtr              m_pFiffInfoInput;   /**< Fiff information of the raw data stream. */
     FiffInfoBase::SPtr          m_pFiffInfoForward; /**< Fiff information of the forward solution. */
 
     QStringList                 m_qListPickChannels;        /**< Channels to pick */
+    RowVectorXi                 m_vecPickSel;               /**< Row selection of the picked channels within the raw data stream */
 
-    PwlRapMusic::SPtr           m_pPwlRapMusic;     /**< Powell RAP MUSIC. */
+    RapMusic::SPtr              m_pRapMusic;        /**< RAP MUSIC. */
     qint32                      m_iDownSample;      /**< Sampling rate */
 
+    qint32                      m_iStreamWindowSize;    /**< Number of samples of the streaming RAP MUSIC window */
+    qint32                      m_iStreamRank;          /**< Tracked signal subspace dimension */
+    qint32                      m_iStreamCadence;       /**< Number of samples after which a new source estimate is emitted */
+
 //    RealTimeSourceEstimate::SPtr m_pRTSE_MNE; /**< Source Estimate output channel. */
 };
 
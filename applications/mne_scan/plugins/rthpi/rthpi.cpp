@@ -225,7 +225,7 @@ void RtHpi::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
         m_qMutex.lock();
         //Check if buffer initialized
         if(!m_pRtHpiBuffer)
-            m_pRtHpiBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(8, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleArray()[0].cols()));
+            m_pRtHpiBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(8, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleBlocks()[0]->cols()));
 
         //Fiff information
         if(!m_pFiffInfo)
@@ -237,12 +237,12 @@ void RtHpi::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
         m_qMutex.unlock();
         if(m_bProcessData)
         {
-            MatrixXd t_mat;
+            //The blocks are shared with the producer, double precision blocks are pushed without a copy
+            QList<MeasurementBlock::ConstSPtr> t_qListBlocks = pRTMSA->getMultiSampleBlocks();
 
-            for(qint32 i = 0; i < pRTMSA->getMultiArraySize(); ++i)
+            for(qint32 i = 0; i < t_qListBlocks.size(); ++i)
             {
-                t_mat = pRTMSA->getMultiSampleArray()[i];
-                m_pRtHpiBuffer->push(&t_mat);
+                m_pRtHpiBuffer->push(&t_qListBlocks.at(i)->toDouble());
             }
         }
     }
@@ -274,7 +274,7 @@ void RtSss::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
     {
         //Check if buffer initialized
         if(!m_pRtSssBuffer)
-            m_pRtSssBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(32, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleArray()[0].cols()));
+            m_pRtSssBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(32, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleBlocks()[0]->cols()));
 
         //Fiff information
         if(!m_pFiffInfo)
@@ -282,11 +282,10 @@ void RtSss::update(SCMEASLIB::NewMeasurement::SPtr pMeasurement)
 
         if(m_bProcessData)
         {
-            MatrixXd in_mat;
-            for(unsigned char i = 0; i < pRTMSA->getMultiArraySize(); ++i)
+            QList<MeasurementBlock::ConstSPtr> t_qListBlocks = pRTMSA->getMultiSampleBlocks();
+            for(qint32 i = 0; i < t_qListBlocks.size(); ++i)
             {
-                in_mat = pRTMSA->getMultiSampleArray()[i];
-                m_pRtSssBuffer->push(&in_mat);
+                m_pRtSssBuffer->push(&t_qListBlocks.at(i)->toDouble());
             }
         }
     }
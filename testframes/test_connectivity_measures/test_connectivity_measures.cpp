@@ -0,0 +1,270 @@
+//=============================================================================================================
+/**
+* @file     test_connectivity_measures.cpp
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Connectivity measures unit test
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <connectivity/connectivitymeasures.h>
+#include <connectivity/network/network.h>
+#include <connectivity/network/networkedge.h>
+#include <connectivity/network/networknode.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace CONNECTIVITYLIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS ConnectivityMeasuresProbe
+*
+* @brief The ConnectivityMeasuresProbe class exposes the per pair measures of ConnectivityMeasures to the tests
+*
+*/
+class ConnectivityMeasuresProbe : public ConnectivityMeasures
+{
+public:
+    using ConnectivityMeasures::CrossCorrelationRowJob;
+    using ConnectivityMeasures::calcSpectra;
+    using ConnectivityMeasures::calcCrossCorrelationRow;
+    using ConnectivityMeasures::calcCrossCorrelation;
+    using ConnectivityMeasures::calcPearsonsCorrelationCoeff;
+};
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestConnectivityMeasures
+*
+* @brief The TestConnectivityMeasures class provides tests of the all pairs connectivity measures
+*
+*/
+class TestConnectivityMeasures : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestConnectivityMeasures();
+
+private slots:
+    void initTestCase();
+    void crossCorrelation();
+    void pearsonsCorrelation();
+    void cleanupTestCase();
+
+private:
+    //=========================================================================================================
+    /**
+    * Collects the edge weights of a network in the upper triangle of a matrix.
+    *
+    * @param[in] p_network  The network.
+    * @return the weights, the strictly lower triangle is zero
+    */
+    static MatrixXd edgeWeights(const Network& p_network);
+
+    MatrixXd m_matData;     /**< Random data with lagged copies of rows, one row per node */
+    double m_dEpsilon;      /**< Tolerance relative to the largest value */
+};
+
+
+//*************************************************************************************************************
+
+TestConnectivityMeasures::TestConnectivityMeasures()
+: m_dEpsilon(1e-10)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestConnectivityMeasures::initTestCase()
+{
+    //More rows than a row block of the correlation matrix, an odd number of samples
+    std::srand(42);
+    m_matData = MatrixXd::Random(150, 77);
+
+    //Some rows are lagged copies of their predecessor, so that the maxima are not all found at lag zero
+    for(int i = 1; i < m_matData.rows(); i += 5) {
+        RowVectorXd rowLagged = RowVectorXd::Zero(m_matData.cols());
+        rowLagged.tail(m_matData.cols() - i % 7) = m_matData.row(i - 1).head(m_matData.cols() - i % 7);
+        m_matData.row(i) = rowLagged + 0.1 * m_matData.row(i);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestConnectivityMeasures::crossCorrelation()
+{
+    const int nRows = m_matData.rows();
+
+    //Direct computation per pair
+    MatrixXd matRef = MatrixXd::Zero(nRows, nRows);
+    MatrixXi matRefIdx = MatrixXi::Zero(nRows, nRows);
+    for(int i = 0; i < nRows; ++i) {
+        for(int j = i; j < nRows; ++j) {
+            QPair<int,double> pairResult = ConnectivityMeasuresProbe::calcCrossCorrelation(m_matData.row(i), m_matData.row(j));
+            matRefIdx(i,j) = pairResult.first;
+            matRef(i,j) = pairResult.second;
+        }
+    }
+
+    double dTol = m_dEpsilon * matRef.cwiseAbs().maxCoeff();
+
+    //All pairs from the cached half spectra
+    MatrixXd matNetwork = edgeWeights(ConnectivityMeasures::crossCorrelation(m_matData, MatrixX3f()));
+    QVERIFY((matNetwork - matRef).cwiseAbs().maxCoeff() < dTol);
+
+    //Lags of the maxima
+    int iFftSize = pow(2, ceil(log2(2.0 * m_matData.cols() - 1)));
+    MatrixXcd matSpectra = ConnectivityMeasuresProbe::calcSpectra(m_matData, iFftSize);
+
+    for(int i = 0; i < nRows; ++i) {
+        ConnectivityMeasuresProbe::CrossCorrelationRowJob job;
+        job.iRow = i;
+        job.iFftSize = iFftSize;
+        job.pMatSpectra = &matSpectra;
+        ConnectivityMeasuresProbe::calcCrossCorrelationRow(job);
+
+        QCOMPARE(job.vecResults.size(), nRows - i);
+        for(int j = i; j < nRows; ++j) {
+            QCOMPARE(job.vecResults.at(j - i).first, matRefIdx(i,j));
+            QVERIFY(std::fabs(job.vecResults.at(j - i).second - matRef(i,j)) < dTol);
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestConnectivityMeasures::pearsonsCorrelation()
+{
+    //A constant row has no defined correlation, it is expected to be zero
+    MatrixXd matData = m_matData;
+    matData.row(7).setConstant(0.5);
+
+    const int nRows = matData.rows();
+
+    //Direct computation per pair from the z-scored rows
+    MatrixXd matZ = matData.colwise() - matData.rowwise().mean();
+    for(int i = 0; i < nRows; ++i) {
+        double dStd = std::sqrt(matZ.row(i).squaredNorm() / matZ.cols());
+        if(dStd > 0) {
+            matZ.row(i) /= dStd;
+        } else {
+            matZ.row(i).setZero();
+        }
+    }
+
+    MatrixXd matRef = MatrixXd::Zero(nRows, nRows);
+    for(int i = 0; i < nRows; ++i) {
+        for(int j = i; j < nRows; ++j) {
+            matRef(i,j) = ConnectivityMeasuresProbe::calcPearsonsCorrelationCoeff(matZ.row(i), matZ.row(j));
+        }
+    }
+
+    //One product of the standardized data
+    MatrixXd matCorr = ConnectivityMeasures::pearsonsCorrelationMatrix(matData);
+    QVERIFY((matCorr - matRef).cwiseAbs().maxCoeff() < m_dEpsilon);
+
+    MatrixXd matCorrFloat = ConnectivityMeasures::pearsonsCorrelationMatrix(matData, true);
+    QVERIFY((matCorrFloat - matRef).cwiseAbs().maxCoeff() < 1e-5);
+
+    //Network with all edges and with the thresholded ones without self connections
+    MatrixXd matNetwork = edgeWeights(ConnectivityMeasures::pearsonsCorrelationCoeff(matData, MatrixX3f()));
+    QVERIFY((matNetwork - matRef).cwiseAbs().maxCoeff() < m_dEpsilon);
+
+    double dThreshold = 0.2;
+    MatrixXd matRefThresholded = matRef;
+    for(int i = 0; i < nRows; ++i) {
+        for(int j = i; j < nRows; ++j) {
+            if(i == j || std::fabs(matCorr(i,j)) < dThreshold) {
+                matRefThresholded(i,j) = 0.0;
+            }
+        }
+    }
+
+    matNetwork = edgeWeights(ConnectivityMeasures::pearsonsCorrelationCoeff(matData, MatrixX3f(), dThreshold));
+    QVERIFY((matNetwork - matRefThresholded).cwiseAbs().maxCoeff() < m_dEpsilon);
+}
+
+
+//*************************************************************************************************************
+
+void TestConnectivityMeasures::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+MatrixXd TestConnectivityMeasures::edgeWeights(const Network& p_network)
+{
+    int nNodes = p_network.getNodes().size();
+    MatrixXd matWeights = MatrixXd::Zero(nNodes, nNodes);
+
+    for(int k = 0; k < p_network.getEdges().size(); ++k) {
+        QSharedPointer<NetworkEdge> pEdge = p_network.getEdges().at(k);
+        int i = pEdge->getStartNode()->getId();
+        int j = pEdge->getEndNode()->getId();
+
+        matWeights(std::min(i,j), std::max(i,j)) = pEdge->getWeight();
+    }
+
+    return matWeights;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestConnectivityMeasures)
+#include "test_connectivity_measures.moc"
@@ -0,0 +1,308 @@
+//=============================================================================================================
+/**
+* @file     test_fiff_data_buffer_codec.cpp
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Round trip tests of the compact raw buffer encodings.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_data_buffer_codec.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QtEndian>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestFiffDataBufferCodec
+*
+* @brief The TestFiffDataBufferCodec class provides encode/decode round trip tests of the raw buffer encodings
+*
+*/
+class TestFiffDataBufferCodec: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestFiffDataBufferCodec();
+
+private slots:
+    void initTestCase();
+    void int16RoundTrip();
+    void int24SignExtension();
+    void deltaBitpackLossless();
+    void deltaBitpackWidths();
+    void decodeRejectsInvalid();
+    void cleanupTestCase();
+
+private:
+    //=========================================================================================================
+    /**
+    * Checks that a lossy round trip is within one quantization step of every channel: half a step of rounding
+    * plus the float precision of the scaled samples, which matters for 24 bit.
+    *
+    * @param[in] p_matData      The original buffer.
+    * @param[in] p_matDecoded   The decoded buffer.
+    * @param[in] p_iMaxInt      The maximal integer of the encoding.
+    *
+    * @return true if all samples are within the quantization error
+    */
+    bool withinQuantization(const MatrixXf &p_matData, const MatrixXf &p_matDecoded, int p_iMaxInt) const;
+
+    //=========================================================================================================
+    /**
+    * Checks that two buffers have the same size and bit patterns.
+    *
+    * @param[in] p_matA     The first buffer.
+    * @param[in] p_matB     The second buffer.
+    *
+    * @return true if both are bitwise equal
+    */
+    bool bitwiseEqual(const MatrixXf &p_matA, const MatrixXf &p_matB) const;
+
+    MatrixXf m_matData;     /**< Raw buffer with signed float channels of different magnitudes */
+};
+
+
+//*************************************************************************************************************
+
+TestFiffDataBufferCodec::TestFiffDataBufferCodec()
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffDataBufferCodec::initTestCase()
+{
+    //
+    //   Deterministic signed samples, one channel per order of magnitude, one all negative
+    //
+    m_matData.resize(6, 100);
+    quint32 t_iState = 4711;
+    for(qint32 i = 0; i < m_matData.rows(); ++i)
+    {
+        for(qint32 j = 0; j < m_matData.cols(); ++j)
+        {
+            t_iState = 1664525u * t_iState + 1013904223u;
+            m_matData(i,j) = (float)(((double)(t_iState >> 8) / 16777216.0 - 0.5) * std::pow(10.0, -3.0 * i));
+        }
+    }
+    m_matData.row(5) = -m_matData.row(4).cwiseAbs() - MatrixXf::Constant(1, m_matData.cols(), 1e-13f);
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffDataBufferCodec::int16RoundTrip()
+{
+    QByteArray t_blockPayload = FiffDataBufferCodec::encode(m_matData, FiffDataBufferCodec::Int16);
+    QCOMPARE(t_blockPayload.size(), 12 + 4 * (int)m_matData.rows() + 2 * (int)m_matData.size());
+
+    MatrixXf t_matDecoded;
+    QVERIFY(FiffDataBufferCodec::decode(t_blockPayload.constData(), t_blockPayload.size(), t_matDecoded));
+    QVERIFY(withinQuantization(m_matData, t_matDecoded, 32767));
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffDataBufferCodec::int24SignExtension()
+{
+    //The extremes of each channel map to +-8388607, the negative ones have to be sign extended from 24 bits
+    MatrixXf t_matData = m_matData;
+    t_matData(0,0) = -1.0f;
+    t_matData(0,1) = 1.0f;
+    t_matData(0,2) = -1.0f / 8388607.0f;
+
+    QByteArray t_blockPayload = FiffDataBufferCodec::encode(t_matData, FiffDataBufferCodec::Int24);
+    QCOMPARE(t_blockPayload.size(), 12 + 4 * (int)t_matData.rows() + 3 * (int)t_matData.size());
+
+    MatrixXf t_matDecoded;
+    QVERIFY(FiffDataBufferCodec::decode(t_blockPayload.constData(), t_blockPayload.size(), t_matDecoded));
+    QVERIFY(withinQuantization(t_matData, t_matDecoded, 8388607));
+
+    QCOMPARE(t_matDecoded(0,0), -1.0f);
+    QCOMPARE(t_matDecoded(0,1), 1.0f);
+    QVERIFY(t_matDecoded(0,2) < 0.0f);
+    QVERIFY((t_matDecoded.row(5).array() < 0.0f).all());
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffDataBufferCodec::deltaBitpackLossless()
+{
+    //Float channels, an integer channel going up and down (negative zigzag differences) and a constant channel
+    MatrixXf t_matData(m_matData.rows() + 2, m_matData.cols());
+    t_matData.topRows(m_matData.rows()) = m_matData;
+    for(qint32 j = 0; j < t_matData.cols(); ++j)
+        t_matData(m_matData.rows(), j) = (float)((j % 7) * (j % 2 ? -1 : 1) * 1000);
+    t_matData.row(m_matData.rows() + 1).setConstant(5.0f);
+
+    QByteArray t_blockPayload = FiffDataBufferCodec::encode(t_matData, FiffDataBufferCodec::DeltaBitpack);
+
+    MatrixXf t_matDecoded;
+    QVERIFY(FiffDataBufferCodec::decode(t_blockPayload.constData(), t_blockPayload.size(), t_matDecoded));
+    QVERIFY(bitwiseEqual(t_matData, t_matDecoded));
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffDataBufferCodec::deltaBitpackWidths()
+{
+    MatrixXf t_matDecoded;
+
+    //A constant channel packs with width 0: mode, first sample and width only
+    MatrixXf t_matConstant = MatrixXf::Constant(1, 50, -3.25f);
+    QByteArray t_blockConstant = FiffDataBufferCodec::encode(t_matConstant, FiffDataBufferCodec::DeltaBitpack);
+    QCOMPARE(t_blockConstant.size(), 12 + 6);
+    QCOMPARE((int)(uchar)t_blockConstant[12 + 5], 0);
+    QVERIFY(FiffDataBufferCodec::decode(t_blockConstant.constData(), t_blockConstant.size(), t_matDecoded));
+    QVERIFY(bitwiseEqual(t_matConstant, t_matDecoded));
+
+    //Sign flips of the float bit pattern need all 32 bits
+    MatrixXf t_matFlip(1, 9);
+    for(qint32 j = 0; j < t_matFlip.cols(); ++j)
+        t_matFlip(0,j) = j % 2 ? -1.5f : 1.5f;
+    QByteArray t_blockFlip = FiffDataBufferCodec::encode(t_matFlip, FiffDataBufferCodec::DeltaBitpack);
+    QCOMPARE(t_blockFlip.size(), 12 + 6 + 4 * (int)(t_matFlip.cols() - 1));
+    QCOMPARE((int)(uchar)t_blockFlip[12 + 5], 32);
+    QVERIFY(FiffDataBufferCodec::decode(t_blockFlip.constData(), t_blockFlip.size(), t_matDecoded));
+    QVERIFY(bitwiseEqual(t_matFlip, t_matDecoded));
+
+    //Alternating integer differences of +-1 zigzag to 1 and 2 and pack with width 2
+    MatrixXf t_matSteps(1, 17);
+    for(qint32 j = 0; j < t_matSteps.cols(); ++j)
+        t_matSteps(0,j) = (float)(j % 2);
+    QByteArray t_blockSteps = FiffDataBufferCodec::encode(t_matSteps, FiffDataBufferCodec::DeltaBitpack);
+    QCOMPARE((int)(uchar)t_blockSteps[12], 1);
+    QCOMPARE((int)(uchar)t_blockSteps[12 + 5], 2);
+    QCOMPARE(t_blockSteps.size(), 12 + 6 + (2 * (int)(t_matSteps.cols() - 1) + 7) / 8);
+    QVERIFY(FiffDataBufferCodec::decode(t_blockSteps.constData(), t_blockSteps.size(), t_matDecoded));
+    QVERIFY(bitwiseEqual(t_matSteps, t_matDecoded));
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffDataBufferCodec::decodeRejectsInvalid()
+{
+    MatrixXf t_matDecoded = MatrixXf::Zero(2, 3);
+
+    //Truncated payloads
+    for(qint32 e = FiffDataBufferCodec::Int16; e < FiffDataBufferCodec::NumEncodings; ++e)
+    {
+        QByteArray t_blockPayload = FiffDataBufferCodec::encode(m_matData, (FiffDataBufferCodec::Encoding)e);
+        QVERIFY(!FiffDataBufferCodec::decode(t_blockPayload.constData(), t_blockPayload.size() - 1, t_matDecoded));
+        QVERIFY(!FiffDataBufferCodec::decode(t_blockPayload.constData(), 11, t_matDecoded));
+    }
+
+    //A header whose size overflows 32 bit must be rejected before anything is allocated
+    t_matDecoded = MatrixXf::Zero(2, 3);
+    QByteArray t_blockHeader(12 + 64, 0);
+    qToLittleEndian<qint32>((qint32)FiffDataBufferCodec::Int16, (uchar*)t_blockHeader.data());
+    qToLittleEndian<qint32>(65536, (uchar*)t_blockHeader.data() + 4);
+    qToLittleEndian<qint32>(65536, (uchar*)t_blockHeader.data() + 8);
+    QVERIFY(!FiffDataBufferCodec::decode(t_blockHeader.constData(), t_blockHeader.size(), t_matDecoded));
+
+    qToLittleEndian<qint32>((qint32)FiffDataBufferCodec::DeltaBitpack, (uchar*)t_blockHeader.data());
+    QVERIFY(!FiffDataBufferCodec::decode(t_blockHeader.constData(), t_blockHeader.size(), t_matDecoded));
+
+    //Unknown encoding
+    qToLittleEndian<qint32>(FiffDataBufferCodec::NumEncodings, (uchar*)t_blockHeader.data());
+    QVERIFY(!FiffDataBufferCodec::decode(t_blockHeader.constData(), t_blockHeader.size(), t_matDecoded));
+
+    QCOMPARE((int)t_matDecoded.rows(), 2);
+    QCOMPARE((int)t_matDecoded.cols(), 3);
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffDataBufferCodec::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+bool TestFiffDataBufferCodec::withinQuantization(const MatrixXf &p_matData, const MatrixXf &p_matDecoded, int p_iMaxInt) const
+{
+    if(p_matData.rows() != p_matDecoded.rows() || p_matData.cols() != p_matDecoded.cols())
+        return false;
+
+    for(qint32 i = 0; i < p_matData.rows(); ++i)
+    {
+        float t_fStep = p_matData.row(i).cwiseAbs().maxCoeff() / p_iMaxInt;
+        if((p_matData.row(i) - p_matDecoded.row(i)).cwiseAbs().maxCoeff() > t_fStep)
+            return false;
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool TestFiffDataBufferCodec::bitwiseEqual(const MatrixXf &p_matA, const MatrixXf &p_matB) const
+{
+    return p_matA.rows() == p_matB.rows() && p_matA.cols() == p_matB.cols()
+            && memcmp(p_matA.data(), p_matB.data(), sizeof(float) * p_matA.size()) == 0;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestFiffDataBufferCodec)
+#include "test_fiff_data_buffer_codec.moc"
@@ -0,0 +1,223 @@
+//=============================================================================================================
+/**
+* @file     test_forward_cluster_cache.cpp
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Forward solution cluster cache write read unit test
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff.h>
+#include <fiff/fiff_cov.h>
+#include <fs/annotationset.h>
+#include <mne/mne.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace FSLIB;
+using namespace MNELIB;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestForwardClusterCache
+*
+* @brief The TestForwardClusterCache class provides cluster cache write read tests
+*
+*/
+class TestForwardClusterCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestForwardClusterCache();
+
+private slots:
+    void initTestCase();
+    void writeReadCache();
+    void keyDependsOnSettings();
+    void cleanupTestCase();
+
+private:
+    //=========================================================================================================
+    /**
+    * Number of cluster cache files in the cache directory.
+    *
+    * @return the number of cache files
+    */
+    qint32 numCacheFiles() const;
+
+    QString m_sCacheDir;                /**< Cache directory of this test */
+    MNEForwardSolution m_Fwd;           /**< The unclustered forward solution */
+    AnnotationSet m_annotationSet;      /**< The annotation the forward solution is clustered with */
+    FiffCov m_noiseCov;                 /**< The noise covariance used for whitening */
+    FiffInfo m_info;                    /**< The measurement info used for whitening */
+};
+
+
+//*************************************************************************************************************
+
+TestForwardClusterCache::TestForwardClusterCache()
+: m_sCacheDir(QDir::currentPath()+"/mne-cpp-test-data/Result/cluster_cache")
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardClusterCache::initTestCase()
+{
+    QDir(m_sCacheDir).removeRecursively();
+
+    QFile t_fileFwd(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-meg-eeg-oct-6-fwd.fif");
+    QVERIFY(t_fileFwd.exists());
+    m_Fwd = MNEForwardSolution(t_fileFwd);
+    QVERIFY(!m_Fwd.isEmpty());
+
+    m_annotationSet = AnnotationSet("sample", 2, "aparc.a2009s", QDir::currentPath()+"/mne-cpp-test-data/subjects");
+    QVERIFY(!m_annotationSet.isEmpty());
+
+    QFile t_fileCov(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-cov.fif");
+    QVERIFY(t_fileCov.exists());
+    m_noiseCov = FiffCov(t_fileCov);
+
+    QFile t_fileRaw(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis_raw_short.fif");
+    QVERIFY(t_fileRaw.exists());
+    FiffRawData t_raw(t_fileRaw);
+    m_info = t_raw.info;
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardClusterCache::writeReadCache()
+{
+    //
+    //   First run clusters and writes the cache, second run reads it
+    //
+    MatrixXd t_matDWritten;
+    MNEForwardSolution t_fwdWritten = m_Fwd.cluster_forward_solution(m_annotationSet, 40, t_matDWritten, m_noiseCov, m_info, "cityblock", m_sCacheDir);
+    QCOMPARE(numCacheFiles(), 1);
+
+    MatrixXd t_matDRead;
+    MNEForwardSolution t_fwdRead = m_Fwd.cluster_forward_solution(m_annotationSet, 40, t_matDRead, m_noiseCov, m_info, "cityblock", m_sCacheDir);
+    QCOMPARE(numCacheFiles(), 1);
+
+    QCOMPARE(t_fwdRead.nsource, t_fwdWritten.nsource);
+    QVERIFY(t_fwdRead.sol->data == t_fwdWritten.sol->data);
+    QVERIFY(t_matDRead == t_matDWritten);
+
+    QCOMPARE(t_fwdRead.src.size(), t_fwdWritten.src.size());
+    for(qint32 h = 0; h < t_fwdWritten.src.size(); ++h)
+    {
+        const MNEClusterInfo& t_infoWritten = t_fwdWritten.src[h].cluster_info;
+        const MNEClusterInfo& t_infoRead = t_fwdRead.src[h].cluster_info;
+
+        QVERIFY(t_fwdRead.src[h].vertno == t_fwdWritten.src[h].vertno);
+        QCOMPARE(t_infoRead.clusterLabelNames, t_infoWritten.clusterLabelNames);
+        QCOMPARE(t_infoRead.clusterLabelIds, t_infoWritten.clusterLabelIds);
+        QCOMPARE(t_infoRead.centroidVertno, t_infoWritten.centroidVertno);
+        QCOMPARE(t_infoRead.clusterVertnos.size(), t_infoWritten.clusterVertnos.size());
+        for(qint32 i = 0; i < t_infoWritten.clusterVertnos.size(); ++i)
+        {
+            QVERIFY(t_infoRead.centroidSource_rr[i] == t_infoWritten.centroidSource_rr[i]);
+            QVERIFY(t_infoRead.clusterVertnos[i] == t_infoWritten.clusterVertnos[i]);
+            QVERIFY(t_infoRead.clusterSource_rr[i] == t_infoWritten.clusterSource_rr[i]);
+            QVERIFY(t_infoRead.clusterDistances[i] == t_infoWritten.clusterDistances[i]);
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardClusterCache::keyDependsOnSettings()
+{
+    MatrixXd t_matD;
+    qint32 t_iFiles = numCacheFiles();
+
+    //Another cluster size
+    m_Fwd.cluster_forward_solution(m_annotationSet, 30, t_matD, m_noiseCov, m_info, "cityblock", m_sCacheDir);
+    QCOMPARE(numCacheFiles(), ++t_iFiles);
+
+    //Without the projectors of the measurement info the whitening changes
+    FiffInfo t_infoNoProjs = m_info;
+    t_infoNoProjs.projs.clear();
+    m_Fwd.cluster_forward_solution(m_annotationSet, 40, t_matD, m_noiseCov, t_infoNoProjs, "cityblock", m_sCacheDir);
+    QCOMPARE(numCacheFiles(), ++t_iFiles);
+
+    //Without the projectors of the noise covariance the whitening changes
+    FiffCov t_noiseCovNoProjs = m_noiseCov;
+    t_noiseCovNoProjs.projs.clear();
+    m_Fwd.cluster_forward_solution(m_annotationSet, 40, t_matD, t_noiseCovNoProjs, m_info, "cityblock", m_sCacheDir);
+    QCOMPARE(numCacheFiles(), ++t_iFiles);
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardClusterCache::cleanupTestCase()
+{
+    QDir(m_sCacheDir).removeRecursively();
+}
+
+
+//*************************************************************************************************************
+
+qint32 TestForwardClusterCache::numCacheFiles() const
+{
+    return QDir(m_sCacheDir).entryList(QStringList() << "*-clu-fwd.fif", QDir::Files).size();
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestForwardClusterCache)
+#include "test_forward_cluster_cache.moc"
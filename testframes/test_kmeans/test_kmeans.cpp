@@ -0,0 +1,248 @@
+//=============================================================================================================
+/**
+* @file     test_kmeans.cpp
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    K-Means clustering unit test
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/kmeans.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestKMeans
+*
+* @brief The TestKMeans class provides k-means clustering tests
+*
+*/
+class TestKMeans: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestKMeans();
+
+private slots:
+    void initTestCase();
+    void plusRecoversClusters();
+    void plusMatchesSample();
+    void threadsDoNotChangeResult();
+    void tolStopsClustering();
+    void cleanupTestCase();
+
+private:
+    //=========================================================================================================
+    /**
+    * Checks that every generated cluster ended up in one cluster of its own.
+    *
+    * @param[in] idx    The cluster indeces of the points.
+    *
+    * @return true if the generated clusters were recovered
+    */
+    bool recovered(const VectorXi &idx) const;
+
+    qint32 m_iClusters;     /**< Number of generated clusters */
+    qint32 m_iPerCluster;   /**< Points per generated cluster */
+    MatrixXd m_matX;        /**< Points, the points of one generated cluster are consecutive */
+};
+
+
+//*************************************************************************************************************
+
+TestKMeans::TestKMeans()
+: m_iClusters(4)
+, m_iPerCluster(50)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::initTestCase()
+{
+    //
+    //   Well separated clusters with a deterministic spread
+    //
+    MatrixXd t_matCenters(m_iClusters, 3);
+    t_matCenters << 0, 0, 0,
+                    10, 0, 0,
+                    0, 10, 0,
+                    0, 0, 10;
+
+    m_matX.resize(m_iClusters*m_iPerCluster, 3);
+    quint32 t_iState = 12345;
+    for(qint32 i = 0; i < m_matX.rows(); ++i)
+    {
+        for(qint32 j = 0; j < m_matX.cols(); ++j)
+        {
+            t_iState = 1664525u * t_iState + 1013904223u;
+            m_matX(i,j) = t_matCenters(i / m_iPerCluster, j) + ((double)(t_iState >> 8) / 16777216.0 - 0.5);
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::plusRecoversClusters()
+{
+    KMeans t_kMeans(QString("sqeuclidean"), QString("plus"), 5);
+    t_kMeans.setSeed(42);
+
+    VectorXi idx;
+    MatrixXd C;
+    VectorXd sumD;
+    MatrixXd D;
+    QVERIFY(t_kMeans.calculate(m_matX, m_iClusters, idx, C, sumD, D));
+
+    QCOMPARE((qint32)C.rows(), m_iClusters);
+    QVERIFY(recovered(idx));
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::plusMatchesSample()
+{
+    VectorXi idxPlus, idxSample;
+    MatrixXd CPlus, CSample;
+    VectorXd sumDPlus, sumDSample;
+    MatrixXd DPlus, DSample;
+
+    KMeans t_kMeansPlus(QString("sqeuclidean"), QString("plus"), 5);
+    t_kMeansPlus.setSeed(7);
+    QVERIFY(t_kMeansPlus.calculate(m_matX, m_iClusters, idxPlus, CPlus, sumDPlus, DPlus));
+
+    KMeans t_kMeansSample(QString("sqeuclidean"), QString("sample"), 5);
+    t_kMeansSample.setSeed(7);
+    QVERIFY(t_kMeansSample.calculate(m_matX, m_iClusters, idxSample, CSample, sumDSample, DSample));
+
+    // The plus initialization must not end in a worse local minimum than the previous default
+    QVERIFY(sumDPlus.sum() <= sumDSample.sum() * (1.0 + 1e-9));
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::threadsDoNotChangeResult()
+{
+    VectorXi idx1, idx4;
+    MatrixXd C1, C4;
+    VectorXd sumD1, sumD4;
+    MatrixXd D1, D4;
+
+    KMeans t_kMeans1(QString("sqeuclidean"), QString("plus"), 4, QString("error"), true, 100, 1);
+    t_kMeans1.setSeed(3);
+    QVERIFY(t_kMeans1.calculate(m_matX, m_iClusters, idx1, C1, sumD1, D1));
+
+    KMeans t_kMeans4(QString("sqeuclidean"), QString("plus"), 4, QString("error"), true, 100, 4);
+    t_kMeans4.setSeed(3);
+    QVERIFY(t_kMeans4.calculate(m_matX, m_iClusters, idx4, C4, sumD4, D4));
+
+    // Every replicate draws from its own sequence -> the result does not depend on the scheduling
+    QVERIFY(idx1 == idx4);
+    QVERIFY((C1 - C4).cwiseAbs().maxCoeff() < 1e-9);
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::tolStopsClustering()
+{
+    KMeans t_kMeans(QString("sqeuclidean"), QString("plus"), 3, QString("error"), true, 100, 1, 1e-3);
+    t_kMeans.setSeed(11);
+
+    VectorXi idx;
+    MatrixXd C;
+    VectorXd sumD;
+    MatrixXd D;
+    QVERIFY(t_kMeans.calculate(m_matX, m_iClusters, idx, C, sumD, D));
+
+    QVERIFY(recovered(idx));
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+bool TestKMeans::recovered(const VectorXi &idx) const
+{
+    QList<qint32> t_qListUsed;
+    for(qint32 c = 0; c < m_iClusters; ++c)
+    {
+        qint32 t_iCluster = idx[c*m_iPerCluster];
+        for(qint32 i = 1; i < m_iPerCluster; ++i)
+            if(idx[c*m_iPerCluster + i] != t_iCluster)
+                return false;
+
+        if(t_qListUsed.contains(t_iCluster))
+            return false;
+        t_qListUsed.append(t_iCluster);
+    }
+    return true;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestKMeans)
+#include "test_kmeans.moc"
@@ -0,0 +1,439 @@
+//=============================================================================================================
+/**
+* @file     test_minimum_norm.cpp
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    MinimumNorm kernel unit test
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff.h>
+#include <fiff/fiff_cov.h>
+#include <fiff/fiff_evoked.h>
+#include <fs/label.h>
+#include <mne/mne.h>
+#include <inverse/minimumNorm/minimumnorm.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace FSLIB;
+using namespace MNELIB;
+using namespace INVERSELIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestMinimumNorm
+*
+* @brief The TestMinimumNorm class provides tests of the MinimumNorm kernel paths and the label kernel cache
+*
+*/
+class TestMinimumNorm : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestMinimumNorm();
+
+private slots:
+    void initTestCase();
+    void factoredAndFloatKernels();
+    void labelRestrictedKernel();
+    void kernelCacheInvalidation();
+    void cleanupTestCase();
+
+private:
+    //=========================================================================================================
+    /**
+    * Compares the dense, factored and single precision kernel paths of MinimumNorm with the kernel of
+    * assemble_kernel applied to the data.
+    *
+    * @param[in] p_inverseOperator  The inverse operator.
+    * @param[in] p_sMethod          The method ("MNE" | "dSPM" | "sLORETA").
+    */
+    void compareKernelPaths(const MNEInverseOperator& p_inverseOperator, const QString& p_sMethod);
+
+    //=========================================================================================================
+    /**
+    * Applies the kernel of assemble_kernel to the data, combines the current components and applies the
+    * noise normalization.
+    *
+    * @param[in] p_inverseOperator  The inverse operator.
+    * @param[in] p_sMethod          The method ("MNE" | "dSPM" | "sLORETA").
+    * @param[in] p_matData          The data, picked to the channels of the inverse operator.
+    * @return the source estimate data
+    */
+    MatrixXd referenceSolution(const MNEInverseOperator& p_inverseOperator, const QString& p_sMethod, const MatrixXd& p_matData) const;
+
+    //=========================================================================================================
+    /**
+    * Relative deviation of two matrices in the Frobenius norm.
+    *
+    * @param[in] p_matA     The matrix to check.
+    * @param[in] p_matRef   The reference.
+    * @return the relative deviation
+    */
+    static double relDiff(const MatrixXd& p_matA, const MatrixXd& p_matRef);
+
+    //=========================================================================================================
+    /**
+    * Label with every third source of the right hemisphere.
+    *
+    * @param[in] p_inverseOperator  The inverse operator whose source space is used.
+    * @return the label
+    */
+    static Label makeLabel(const MNEInverseOperator& p_inverseOperator);
+
+    //=========================================================================================================
+    /**
+    * Assembles the kernel of a label.
+    *
+    * @param[in] p_inverseOperator  The prepared inverse operator.
+    * @param[in] p_label            The label.
+    * @param[in] p_sMethod          The method ("MNE" | "dSPM" | "sLORETA").
+    * @param[out] p_noiseNorm       The noise normalization of the label.
+    * @return the kernel of the label
+    */
+    static MatrixXd assembleLabelKernel(MNEInverseOperator& p_inverseOperator, const Label& p_label, const QString& p_sMethod, SparseMatrix<double>& p_noiseNorm);
+
+    FiffEvoked m_evoked;                /**< The evoked data */
+    MNEInverseOperator m_invFree;       /**< Free orientation inverse operator */
+    MNEInverseOperator m_invFixed;      /**< Fixed orientation inverse operator */
+    float m_fLambda2;                   /**< Regularization parameter */
+    double m_dEpsilon;                  /**< Tolerance of the double precision paths */
+    double m_dEpsilonFloat;             /**< Tolerance of the single precision paths */
+};
+
+
+//*************************************************************************************************************
+
+TestMinimumNorm::TestMinimumNorm()
+: m_fLambda2(1.0f / 9.0f)
+, m_dEpsilon(1e-10)
+, m_dEpsilonFloat(1e-4)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::initTestCase()
+{
+    QFile t_fileEvoked(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-ave.fif");
+    QVERIFY(t_fileEvoked.exists());
+    QPair<QVariant, QVariant> t_baseline(QVariant(), 0);
+    m_evoked = FiffEvoked(t_fileEvoked, 0, t_baseline);
+    QVERIFY(!m_evoked.isEmpty());
+
+    QFile t_fileCov(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-cov.fif");
+    QVERIFY(t_fileCov.exists());
+    FiffCov t_noiseCov(t_fileCov);
+    t_noiseCov = t_noiseCov.regularize(m_evoked.info, 0.05, 0.05, 0.1, true);
+
+    QFile t_fileFwd(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-meg-eeg-oct-6-fwd.fif");
+    QVERIFY(t_fileFwd.exists());
+
+    MNEForwardSolution t_fwdFree(t_fileFwd, false, true);
+    QVERIFY(!t_fwdFree.isEmpty());
+    m_invFree = MNEInverseOperator(m_evoked.info, t_fwdFree, t_noiseCov, 0.2f, 0.8f);
+    QVERIFY(m_invFree.source_ori == FIFFV_MNE_FREE_ORI);
+
+    MNEForwardSolution t_fwdFixed(t_fileFwd, true, true);
+    QVERIFY(!t_fwdFixed.isEmpty());
+    m_invFixed = MNEInverseOperator(m_evoked.info, t_fwdFixed, t_noiseCov, 0.0f, 0.8f, true);
+    QVERIFY(m_invFixed.source_ori == FIFFV_MNE_FIXED_ORI);
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::factoredAndFloatKernels()
+{
+    QStringList t_qListMethods;
+    t_qListMethods << "MNE" << "dSPM" << "sLORETA";
+
+    for(qint32 i = 0; i < t_qListMethods.size(); ++i)
+    {
+        compareKernelPaths(m_invFree, t_qListMethods[i]);
+        compareKernelPaths(m_invFixed, t_qListMethods[i]);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::labelRestrictedKernel()
+{
+    QList<MNEInverseOperator> t_qListInv;
+    t_qListInv << m_invFree << m_invFixed;
+
+    for(qint32 o = 0; o < t_qListInv.size(); ++o)
+    {
+        MNEInverseOperator t_inv = t_qListInv[o].prepare_inverse_operator(m_evoked.nave, m_fLambda2, true, false);
+        qint32 nComp = t_inv.source_ori == FIFFV_MNE_FREE_ORI ? 3 : 1;
+
+        MatrixXd t_matK;
+        SparseMatrix<double> t_noiseNorm;
+        QList<VectorXi> t_qListVertno;
+        QVERIFY(t_inv.assemble_kernel(Label(), "dSPM", false, t_matK, t_noiseNorm, t_qListVertno));
+
+        Label t_label = makeLabel(t_inv);
+        VectorXi t_vecSrcSel;
+        t_inv.src.label_src_vertno_sel(t_label, t_vecSrcSel);
+        QVERIFY(t_vecSrcSel.size() > 0);
+
+        SparseMatrix<double> t_noiseNormLabel;
+        MatrixXd t_matKLabel = assembleLabelKernel(t_inv, t_label, "dSPM", t_noiseNormLabel);
+
+        //Rows of the full kernel and its noise normalization
+        QVERIFY(t_matKLabel.rows() == t_vecSrcSel.size()*nComp);
+        QVERIFY(t_matKLabel.cols() == t_matK.cols());
+        QVERIFY(t_noiseNormLabel.rows() == t_vecSrcSel.size());
+
+        MatrixXd t_matKRows(t_matKLabel.rows(), t_matK.cols());
+        VectorXd t_vecNoiseNormRows(t_vecSrcSel.size());
+        for(qint32 i = 0; i < t_vecSrcSel.size(); ++i)
+        {
+            t_matKRows.middleRows(i*nComp, nComp) = t_matK.middleRows(t_vecSrcSel[i]*nComp, nComp);
+            t_vecNoiseNormRows[i] = t_noiseNorm.coeff(t_vecSrcSel[i], t_vecSrcSel[i]);
+        }
+
+        QVERIFY(relDiff(t_matKLabel, t_matKRows) < m_dEpsilon);
+        QVERIFY(relDiff(VectorXd(t_noiseNormLabel.diagonal()), t_vecNoiseNormRows) < m_dEpsilon);
+
+        //Second assembly is served by the cache
+        SparseMatrix<double> t_noiseNormCached;
+        MatrixXd t_matKCached = assembleLabelKernel(t_inv, t_label, "dSPM", t_noiseNormCached);
+        QVERIFY(t_matKCached == t_matKLabel);
+        QVERIFY(VectorXd(t_noiseNormCached.diagonal()) == VectorXd(t_noiseNormLabel.diagonal()));
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::kernelCacheInvalidation()
+{
+    Label t_label = makeLabel(m_invFree);
+    SparseMatrix<double> t_noiseNorm, t_noiseNormRef;
+
+    //
+    //   Method -> the MNE entry of a label must not be reused for dSPM
+    //
+    MNEInverseOperator t_inv = m_invFree.prepare_inverse_operator(m_evoked.nave, m_fLambda2, true, false);
+    assembleLabelKernel(t_inv, t_label, "MNE", t_noiseNorm);
+    QVERIFY(t_noiseNorm.rows() == 0);
+
+    MatrixXd t_matK = assembleLabelKernel(t_inv, t_label, "dSPM", t_noiseNorm);
+
+    MNEInverseOperator t_invRef = m_invFree.prepare_inverse_operator(m_evoked.nave, m_fLambda2, true, false);
+    MatrixXd t_matKRef = assembleLabelKernel(t_invRef, t_label, "dSPM", t_noiseNormRef);
+
+    QVERIFY(t_noiseNorm.rows() == t_noiseNormRef.rows());
+    QVERIFY(relDiff(VectorXd(t_noiseNorm.diagonal()), VectorXd(t_noiseNormRef.diagonal())) < m_dEpsilon);
+    QVERIFY(relDiff(t_matK, t_matKRef) < m_dEpsilon);
+
+    //
+    //   Regularization -> the right factor of the previous lambda must not be reused
+    //
+    float t_fLambda2New = 10.0f*m_fLambda2;
+
+    MatrixXd t_matKOld = assembleLabelKernel(t_inv, t_label, "dSPM", t_noiseNorm);
+    t_inv = m_invFree.prepare_inverse_operator(m_evoked.nave, t_fLambda2New, true, false);
+    t_matK = assembleLabelKernel(t_inv, t_label, "dSPM", t_noiseNorm);
+
+    t_invRef = m_invFree.prepare_inverse_operator(m_evoked.nave, t_fLambda2New, true, false);
+    t_matKRef = assembleLabelKernel(t_invRef, t_label, "dSPM", t_noiseNormRef);
+
+    QVERIFY(relDiff(t_matKOld, t_matKRef) > 1e-3);
+    QVERIFY(relDiff(t_matK, t_matKRef) < m_dEpsilon);
+    QVERIFY(relDiff(VectorXd(t_noiseNorm.diagonal()), VectorXd(t_noiseNormRef.diagonal())) < m_dEpsilon);
+
+    //
+    //   The same through MinimumNorm with the factored kernel
+    //
+    MatrixXd t_matData = m_evoked.pick_channels(m_invFree.noise_cov->names).data;
+    float tmin = ((float)m_evoked.first) / m_evoked.info.sfreq;
+    float tstep = 1/m_evoked.info.sfreq;
+
+    MinimumNorm t_minimumNorm(m_invFree, m_fLambda2, QString("MNE"));
+    t_minimumNorm.setFactoredKernel(true);
+    t_minimumNorm.doInverseSetup(m_evoked.nave);
+
+    t_minimumNorm.setRegularization(t_fLambda2New);
+    t_minimumNorm.setMethod(QString("sLORETA"));
+    t_minimumNorm.doInverseSetup(m_evoked.nave);
+    MNESourceEstimate t_stc = t_minimumNorm.calculateInverse(t_matData, tmin, tstep);
+
+    MinimumNorm t_minimumNormRef(m_invFree, t_fLambda2New, QString("sLORETA"));
+    t_minimumNormRef.doInverseSetup(m_evoked.nave);
+    MNESourceEstimate t_stcRef = t_minimumNormRef.calculateInverse(t_matData, tmin, tstep);
+
+    QVERIFY(relDiff(t_stc.data, t_stcRef.data) < m_dEpsilon);
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::compareKernelPaths(const MNEInverseOperator& p_inverseOperator, const QString& p_sMethod)
+{
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> %s, %s orientation >>>>>>>>>>>>>>>>>>>>>>>>>\n", p_sMethod.toUtf8().constData(),
+           p_inverseOperator.source_ori == FIFFV_MNE_FREE_ORI ? "free" : "fixed");
+
+    MatrixXd t_matData = m_evoked.pick_channels(p_inverseOperator.noise_cov->names).data;
+    MatrixXd t_matRef = referenceSolution(p_inverseOperator, p_sMethod, t_matData);
+    QVERIFY(t_matRef.rows() == p_inverseOperator.nsource);
+
+    float tmin = ((float)m_evoked.first) / m_evoked.info.sfreq;
+    float tstep = 1/m_evoked.info.sfreq;
+
+    for(qint32 f = 0; f < 2; ++f)
+    {
+        bool t_bFactored = f == 1;
+
+        MinimumNorm t_minimumNorm(p_inverseOperator, m_fLambda2, p_sMethod);
+        t_minimumNorm.setFactoredKernel(t_bFactored);
+        t_minimumNorm.setFloatKernel(true);
+        t_minimumNorm.doInverseSetup(m_evoked.nave);
+
+        //Double precision
+        MNESourceEstimate t_stc = t_minimumNorm.calculateInverse(t_matData, tmin, tstep);
+        QCOMPARE(t_stc.data.rows(), t_matRef.rows());
+        QCOMPARE(t_stc.data.cols(), t_matRef.cols());
+        QVERIFY(relDiff(t_stc.data, t_matRef) < m_dEpsilon);
+
+        //Single precision, split across threads
+        MatrixXf t_matSolFloat;
+        QVERIFY(t_minimumNorm.applyKernel(t_matData.cast<float>(), t_matSolFloat, 4));
+        QVERIFY(relDiff(t_matSolFloat.cast<double>(), t_matRef) < m_dEpsilonFloat);
+
+        //Single precision with a caller owned workspace, applied twice to reuse the buffers
+        MinimumNorm::FloatKernelWorkspace t_workspace;
+        for(qint32 k = 0; k < 2; ++k)
+        {
+            QVERIFY(t_minimumNorm.applyKernel(t_matData.cast<float>(), t_matSolFloat, 2, t_workspace));
+            QVERIFY(relDiff(t_matSolFloat.cast<double>(), t_matRef) < m_dEpsilonFloat);
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+MatrixXd TestMinimumNorm::referenceSolution(const MNEInverseOperator& p_inverseOperator, const QString& p_sMethod, const MatrixXd& p_matData) const
+{
+    MNEInverseOperator t_inv = p_inverseOperator.prepare_inverse_operator(m_evoked.nave, m_fLambda2, p_sMethod == "dSPM", p_sMethod == "sLORETA");
+
+    MatrixXd t_matK;
+    SparseMatrix<double> t_noiseNorm;
+    QList<VectorXi> t_qListVertno;
+    t_inv.assemble_kernel(Label(), p_sMethod, false, t_matK, t_noiseNorm, t_qListVertno);
+
+    MatrixXd t_matSol = t_matK*p_matData;
+
+    if(t_inv.source_ori == FIFFV_MNE_FREE_ORI)
+    {
+        MatrixXd t_matComb(t_matSol.rows()/3, t_matSol.cols());
+        for(qint32 i = 0; i < t_matComb.rows(); ++i)
+            t_matComb.row(i) = t_matSol.middleRows(3*i, 3).colwise().norm();
+        t_matSol = t_matComb;
+    }
+
+    if(p_sMethod != "MNE")
+        t_matSol = t_noiseNorm*t_matSol;
+
+    return t_matSol;
+}
+
+
+//*************************************************************************************************************
+
+double TestMinimumNorm::relDiff(const MatrixXd& p_matA, const MatrixXd& p_matRef)
+{
+    return (p_matA - p_matRef).norm() / p_matRef.norm();
+}
+
+//*************************************************************************************************************
+
+Label TestMinimumNorm::makeLabel(const MNEInverseOperator& p_inverseOperator)
+{
+    const VectorXi& t_vecVertno = p_inverseOperator.src[1].vertno;
+
+    VectorXi t_vecVertices((t_vecVertno.size() + 2) / 3);
+    for(qint32 i = 0; i < t_vecVertices.size(); ++i)
+        t_vecVertices[i] = t_vecVertno[3*i];
+
+    return Label(t_vecVertices, MatrixX3f::Zero(t_vecVertices.size(), 3), VectorXd::Zero(t_vecVertices.size()), 1, "test-rh", 1);
+}
+
+
+//*************************************************************************************************************
+
+MatrixXd TestMinimumNorm::assembleLabelKernel(MNEInverseOperator& p_inverseOperator, const Label& p_label, const QString& p_sMethod, SparseMatrix<double>& p_noiseNorm)
+{
+    MatrixXd t_matK;
+    QList<VectorXi> t_qListVertno;
+    p_inverseOperator.assemble_kernel(p_label, p_sMethod, false, t_matK, p_noiseNorm, t_qListVertno);
+
+    return t_matK;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestMinimumNorm)
+#include "test_minimum_norm.moc"
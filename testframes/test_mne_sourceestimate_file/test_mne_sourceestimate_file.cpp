@@ -0,0 +1,212 @@
+//=============================================================================================================
+/**
+* @file     test_mne_sourceestimate_file.cpp
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Source estimate file write read unit test
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <mne/mne_sourceestimate.h>
+#include <mne/mne_sourceestimate_file.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace MNELIB;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestMNESourceEstimateFile
+*
+* @brief The TestMNESourceEstimateFile class provides stc write read tests
+*
+*/
+class TestMNESourceEstimateFile : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestMNESourceEstimateFile();
+
+private slots:
+    void initTestCase();
+    void appendAndRead();
+    void readBlocksOfWrittenFile();
+    void cleanupTestCase();
+
+private:
+    QString m_sFileName;        /**< The stc file of this test */
+    MNESourceEstimate m_stc;    /**< The reference estimate, all values are exact in single precision */
+};
+
+
+//*************************************************************************************************************
+
+TestMNESourceEstimateFile::TestMNESourceEstimateFile()
+: m_sFileName(QDir::currentPath()+"/mne-cpp-test-data/Result/test_mne_sourceestimate_file-lh.stc")
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestMNESourceEstimateFile::initTestCase()
+{
+    QDir().mkpath(QFileInfo(m_sFileName).path());
+
+    qint32 nVertices = 7;
+    qint32 nTimes = 8;
+
+    MatrixXd t_matData(nVertices, nTimes);
+    for(qint32 i = 0; i < nVertices; ++i)
+        for(qint32 j = 0; j < nTimes; ++j)
+            t_matData(i,j) = 0.25*(i*nTimes + j) - 3.0;
+
+    VectorXi t_vecVertices(nVertices);
+    t_vecVertices << 3, 17, 42, 108, 1024, 70000, 131071;
+
+    m_stc = MNESourceEstimate(t_matData, t_vecVertices, 0.125f, 0.0625f);
+}
+
+
+//*************************************************************************************************************
+
+void TestMNESourceEstimateFile::appendAndRead()
+{
+    //
+    //   Write block wise
+    //
+    MNESourceEstimateFile t_file(m_sFileName);
+    QVERIFY(t_file.create(m_stc.vertices, m_stc.tmin, m_stc.tstep));
+    QVERIFY(t_file.append(m_stc.data.leftCols(3)));
+    QVERIFY(t_file.append(m_stc.data.rightCols(m_stc.data.cols() - 3)));
+    QCOMPARE(t_file.numTimes(), (qint32)m_stc.data.cols());
+    t_file.close();
+
+    //
+    //   Layout: big endian header, number of time points at 12 + 4*nvert, float data
+    //
+    qint32 nVertices = m_stc.vertices.size();
+    QFile t_qFile(m_sFileName);
+    QCOMPARE(t_qFile.size(), (qint64)(16 + 4*nVertices + 4*nVertices*m_stc.data.cols()));
+
+    QVERIFY(t_qFile.open(QIODevice::ReadOnly));
+    QDataStream t_stream(&t_qFile);
+    t_stream.setByteOrder(QDataStream::BigEndian);
+    t_stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    float t_fTminMs;
+    t_stream >> t_fTminMs;
+    QCOMPARE(t_fTminMs, 1000.0f*m_stc.tmin);
+
+    QVERIFY(t_qFile.seek(8));
+    quint32 t_iNumVertices;
+    t_stream >> t_iNumVertices;
+    QCOMPARE((qint32)t_iNumVertices, nVertices);
+
+    QVERIFY(t_qFile.seek(12 + 4*nVertices));
+    quint32 t_iNumTimes;
+    t_stream >> t_iNumTimes;
+    QCOMPARE((qint32)t_iNumTimes, (qint32)m_stc.data.cols());
+    t_qFile.close();
+
+    //
+    //   The classic reader sees the same estimate
+    //
+    MNESourceEstimate t_stcRead;
+    QVERIFY(MNESourceEstimate::read(t_qFile, t_stcRead));
+    QVERIFY(t_stcRead.vertices == m_stc.vertices);
+    QCOMPARE(t_stcRead.tmin, m_stc.tmin);
+    QCOMPARE(t_stcRead.tstep, m_stc.tstep);
+    QVERIFY(t_stcRead.data == m_stc.data);
+}
+
+
+//*************************************************************************************************************
+
+void TestMNESourceEstimateFile::readBlocksOfWrittenFile()
+{
+    QFile t_qFile(m_sFileName);
+    QVERIFY(m_stc.write(t_qFile));
+
+    MNESourceEstimateFile t_file(m_sFileName);
+    QVERIFY(t_file.open());
+    QVERIFY(t_file.vertices() == m_stc.vertices);
+    QCOMPARE(t_file.numTimes(), (qint32)m_stc.data.cols());
+    QCOMPARE(t_file.tmin(), m_stc.tmin);
+    QCOMPARE(t_file.tstep(), m_stc.tstep);
+
+    MatrixXd t_matBlock;
+    QVERIFY(t_file.readBlock(2, 4, t_matBlock));
+    QVERIFY(t_matBlock == m_stc.data.middleCols(2, 4));
+
+    //Reading past the end fails
+    QVERIFY(!t_file.readBlock(6, 4, t_matBlock));
+
+    MNESourceEstimate t_stcView = t_file.view().reduce(1, 5).reduce(2, 2).toSourceEstimate();
+    QVERIFY(t_stcView.data == m_stc.data.middleCols(3, 2));
+    QCOMPARE(t_stcView.tmin, m_stc.tmin + 3*m_stc.tstep);
+
+    t_file.close();
+}
+
+
+//*************************************************************************************************************
+
+void TestMNESourceEstimateFile::cleanupTestCase()
+{
+    QFile::remove(m_sFileName);
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestMNESourceEstimateFile)
+#include "test_mne_sourceestimate_file.moc"
@@ -0,0 +1,326 @@
+//=============================================================================================================
+/**
+* @file     test_rap_music.cpp
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    RAP MUSIC pair scan and streaming unit test
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fs/annotationset.h>
+#include <mne/mne.h>
+#include <inverse/rapMusic/rapmusic.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FSLIB;
+using namespace MNELIB;
+using namespace INVERSELIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS RapMusicProbe
+*
+* @brief The RapMusicProbe class exposes the scan internals of RapMusic to the tests
+*
+*/
+class RapMusicProbe : public RapMusic
+{
+public:
+    RapMusicProbe(MNEForwardSolution& p_Fwd, int p_iN)
+    : RapMusic(p_Fwd, false, p_iN)
+    {
+    }
+
+    using RapMusic::calcPhi_s;
+    using RapMusic::subcorr;
+    using RapMusic::calcPairCorrelations;
+    using RapMusic::getGainMatrixPair;
+    using RapMusic::assignDipolePairs;
+
+    using RapMusic::m_iNumChannels;
+    using RapMusic::m_iNumGridPoints;
+    using RapMusic::m_iNumLeadFieldCombinations;
+    using RapMusic::m_ppPairIdxCombinations;
+    using RapMusic::m_matStreamPhi_s;
+};
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestRapMusic
+*
+* @brief The TestRapMusic class provides tests of the RAP MUSIC pair scan and its streaming variant
+*
+*/
+class TestRapMusic : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRapMusic();
+
+private slots:
+    void initTestCase();
+    void pairCorrelations();
+    void streamingMatchesBatch();
+    void cleanupTestCase();
+
+private:
+    //=========================================================================================================
+    /**
+    * Compares the correlations of all lead field pairs computed by calcPairCorrelations with the ones of
+    * subcorr, which decomposes each m x 6 pair.
+    *
+    * @param[in] p_matLeadField The lead field to scan.
+    * @param[in] p_matU_B       The signal subspace the pairs are correlated with.
+    */
+    void comparePairCorrelations(const MatrixXd& p_matLeadField, const MatrixXd& p_matU_B);
+
+    //=========================================================================================================
+    /**
+    * Topography of a fixed orientation source of the lead field.
+    *
+    * @param[in] p_iIdx         Grid point of the source.
+    * @param[in] p_vecOri       Orientation of the source.
+    * @return the topography
+    */
+    VectorXd topography(qint32 p_iIdx, const Vector3d& p_vecOri) const;
+
+    MNEForwardSolution m_clusteredFwd;  /**< The clustered forward solution which is scanned */
+    MatrixXd m_matLeadField;            /**< The lead field of the clustered forward solution */
+    qint32 m_iIdx1;                     /**< Grid point of the first simulated source */
+    qint32 m_iIdx2;                     /**< Grid point of the second simulated source */
+    double m_dEpsilon;                  /**< Tolerance of the correlations */
+};
+
+
+//*************************************************************************************************************
+
+TestRapMusic::TestRapMusic()
+: m_iIdx1(0)
+, m_iIdx2(0)
+, m_dEpsilon(1e-8)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestRapMusic::initTestCase()
+{
+    QFile t_fileFwd(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-meg-eeg-oct-6-fwd.fif");
+    QVERIFY(t_fileFwd.exists());
+    MNEForwardSolution t_Fwd(t_fileFwd);
+    QVERIFY(!t_Fwd.isEmpty());
+
+    AnnotationSet t_annotationSet("sample", 2, "aparc.a2009s", QDir::currentPath()+"/mne-cpp-test-data/subjects");
+    QVERIFY(!t_annotationSet.isEmpty());
+
+    m_clusteredFwd = t_Fwd.cluster_forward_solution(t_annotationSet, 40);
+    m_matLeadField = m_clusteredFwd.sol->data;
+    QVERIFY(m_matLeadField.cols() % 3 == 0);
+
+    //One source in each hemisphere
+    m_iIdx1 = m_clusteredFwd.src[0].vertno.size() / 2;
+    m_iIdx2 = m_clusteredFwd.src[0].vertno.size() + m_clusteredFwd.src[1].vertno.size() / 2;
+}
+
+
+//*************************************************************************************************************
+
+void TestRapMusic::pairCorrelations()
+{
+    //Signal subspace of two sources
+    MatrixXd t_matF(m_matLeadField.rows(), 2);
+    t_matF.col(0) = topography(m_iIdx1, Vector3d(1.0, 2.0, -1.0).normalized());
+    t_matF.col(1) = topography(m_iIdx2, Vector3d(-0.5, 1.0, 3.0).normalized());
+
+    HouseholderQR<MatrixXd> t_qrF(t_matF);
+    MatrixXd t_matU_B = t_qrF.householderQ()*MatrixXd::Identity(t_matF.rows(), 2);
+
+    //
+    //   The lead field as it is and scaled up -> the rank cut of the identical pairs (idx1 == idx2) and the
+    //   near-collinear neighbouring clusters has to agree with subcorr independent of the scale
+    //
+    comparePairCorrelations(m_matLeadField, t_matU_B);
+    comparePairCorrelations(m_matLeadField*(1e3/m_matLeadField.colwise().norm().maxCoeff()), t_matU_B);
+    comparePairCorrelations(m_matLeadField*(1e5/m_matLeadField.colwise().norm().maxCoeff()), t_matU_B);
+}
+
+
+//*************************************************************************************************************
+
+void TestRapMusic::streamingMatchesBatch()
+{
+    //
+    //   Two sources with independent time courses -> rank 2 measurement
+    //
+    qint32 t_iNumChannels = m_matLeadField.rows();
+    qint32 t_iNumSamples = 2*t_iNumChannels;
+
+    MatrixXd t_matTopo(t_iNumChannels, 2);
+    t_matTopo.col(0) = topography(m_iIdx1, Vector3d(0.0, 1.0, 1.0).normalized());
+    t_matTopo.col(1) = topography(m_iIdx2, Vector3d(1.0, 0.0, 1.0).normalized());
+
+    MatrixXd t_matTimeCourses(2, t_iNumSamples);
+    for(qint32 i = 0; i < t_iNumSamples; ++i)
+    {
+        t_matTimeCourses(0, i) = sin(0.05*i);
+        t_matTimeCourses(1, i) = cos(0.13*i + 0.3);
+    }
+
+    MatrixXd t_matData = t_matTopo*t_matTimeCourses;
+    t_matData /= JacobiSVD<MatrixXd>(t_matData).singularValues()(0);
+
+    //
+    //   Windows with less and with more samples than channels -> calcPhi_s decomposes F and F*F^T respectively
+    //
+    QList<qint32> t_qListWindowSizes;
+    t_qListWindowSizes << t_iNumChannels / 2 << t_iNumChannels + t_iNumChannels / 4;
+
+    for(qint32 w = 0; w < t_qListWindowSizes.size(); ++w)
+    {
+        qint32 t_iWindowSize = t_qListWindowSizes[w];
+
+        RapMusicProbe t_rapMusic(m_clusteredFwd, 2);
+        QCOMPARE(t_rapMusic.m_iNumChannels, t_iNumChannels);
+
+        //Feed sample by sample -> the window slides over half of its size after being filled once
+        t_rapMusic.initStreaming(t_iWindowSize, 4, 2);
+
+        qint32 t_iNumFed = t_iWindowSize + t_iWindowSize / 2;
+        bool t_bFull = false;
+        for(qint32 i = 0; i < t_iNumFed; ++i)
+            t_bFull = t_rapMusic.appendStreamingData(t_matData.col(i));
+        QVERIFY(t_bFull);
+
+        MatrixXd t_matWindow = t_matData.middleCols(t_iNumFed - t_iWindowSize, t_iWindowSize);
+
+        //Tracked subspace
+        MatrixXd* t_pMatPhi_s = NULL;
+        int t_iRank = t_rapMusic.calcPhi_s(t_matWindow, t_pMatPhi_s);
+        QCOMPARE(t_iRank, 2);
+
+        MatrixXd t_matPhiStream = t_rapMusic.m_matStreamPhi_s.leftCols(t_iRank);
+        MatrixXd t_matProjBatch = (*t_pMatPhi_s)*t_pMatPhi_s->transpose();
+        MatrixXd t_matProjStream = t_matPhiStream*t_matPhiStream.transpose();
+        delete t_pMatPhi_s;
+
+        QVERIFY((t_matProjStream - t_matProjBatch).norm() < 1e-6);
+
+        //Dipole pairs
+        QList< DipolePair<double> > t_RapDipoles;
+        t_rapMusic.calculateInverse(t_matWindow, t_RapDipoles);
+        QVERIFY(!t_RapDipoles.isEmpty());
+        QCOMPARE(qMin(t_RapDipoles[0].m_iIdx1, t_RapDipoles[0].m_iIdx2), m_iIdx1);
+        QCOMPARE(qMax(t_RapDipoles[0].m_iIdx1, t_RapDipoles[0].m_iIdx2), m_iIdx2);
+
+        MatrixXd t_matBatchData = MatrixXd::Zero(m_clusteredFwd.nsource, 10);
+        RapMusicProbe::assignDipolePairs(t_RapDipoles, 0, 10, t_matBatchData);
+
+        MNESourceEstimate t_stcStream = t_rapMusic.calculateStreamingInverse(10, 0.0f, 0.001f);
+        QCOMPARE(t_stcStream.data.rows(), t_matBatchData.rows());
+        QCOMPARE(t_stcStream.data.cols(), t_matBatchData.cols());
+        QVERIFY((t_stcStream.data - t_matBatchData).norm() <= 1e-6*t_matBatchData.norm());
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestRapMusic::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestRapMusic::comparePairCorrelations(const MatrixXd& p_matLeadField, const MatrixXd& p_matU_B)
+{
+    RapMusicProbe t_rapMusic(m_clusteredFwd, 2);
+
+    VectorXd t_vecRoh;
+    t_rapMusic.calcPairCorrelations(p_matLeadField, p_matU_B, t_vecRoh);
+    QCOMPARE((int)t_vecRoh.size(), t_rapMusic.m_iNumLeadFieldCombinations);
+
+    qint32 t_iNumIdentical = 0;
+    double t_dMaxDiff = 0;
+    RapMusic::MatrixX6T t_matPair(p_matLeadField.rows(), 6);
+    for(qint32 i = 0; i < t_rapMusic.m_iNumLeadFieldCombinations; ++i)
+    {
+        int t_iIdx1 = t_rapMusic.m_ppPairIdxCombinations[i]->x1;
+        int t_iIdx2 = t_rapMusic.m_ppPairIdxCombinations[i]->x2;
+
+        RapMusicProbe::getGainMatrixPair(p_matLeadField, t_matPair, t_iIdx1, t_iIdx2);
+        double t_dRoh = RapMusicProbe::subcorr(t_matPair, p_matU_B);
+
+        t_dMaxDiff = qMax(t_dMaxDiff, fabs(t_vecRoh[i] - t_dRoh));
+        if(t_iIdx1 == t_iIdx2)
+            ++t_iNumIdentical;
+    }
+
+    QCOMPARE(t_iNumIdentical, t_rapMusic.m_iNumGridPoints);
+    QVERIFY(t_dMaxDiff < m_dEpsilon);
+}
+
+
+//*************************************************************************************************************
+
+VectorXd TestRapMusic::topography(qint32 p_iIdx, const Vector3d& p_vecOri) const
+{
+    return m_matLeadField.middleCols(3*p_iIdx, 3)*p_vecOri;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestRapMusic)
+#include "test_rap_music.moc"
@@ -0,0 +1,234 @@
+//=============================================================================================================
+/**
+* @file     test_smooth_operator.cpp
+* @author   MNE-CPP authors
+* @version  1.0
+* @date     October, 2026
+*
+* @section  LICENSE
+*
+* Copyright (C) 2026, MNE-CPP authors. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Smoothing operator unit test
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <disp3D/engine/model/workers/rtSourceLoc/rtsourcelocdataworker.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QVector3D>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace DISP3DLIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestSmoothOperator
+*
+* @brief The TestSmoothOperator class provides tests of the grid based smoothing operator
+*
+*/
+class TestSmoothOperator : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestSmoothOperator();
+
+private slots:
+    void initTestCase();
+    void gridMatchesAllPairs();
+    void cleanupTestCase();
+
+private:
+    //=========================================================================================================
+    /**
+    * Computes the smoothing operator by comparing each vertex with every source, like it was done before the
+    * source grid was introduced.
+    *
+    * @param[in] p_info     The smoothing operator info.
+    * @return the smoothing operator
+    */
+    static SparseMatrix<double> allPairsSmoothOperator(const SmoothOperatorInfo& p_info);
+
+    MatrixX3f m_matVertPos;     /**< Vertices of a regular lattice */
+    VectorXi m_vecVertNo;       /**< Vertices which are sources */
+    float m_fSpacing;           /**< Spacing of the lattice */
+};
+
+
+//*************************************************************************************************************
+
+TestSmoothOperator::TestSmoothOperator()
+: m_fSpacing(1.0f/1024.0f)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestSmoothOperator::initTestCase()
+{
+    //
+    //   Lattice of about 1 mm spacing with exactly representable coordinates, so that many vertex source distances
+    //   equal the threshold exactly and many positions lie on the cell boundaries of the source grid.
+    //   The number of vertices exceeds one block of rows.
+    //
+    int n = 40;
+    m_matVertPos.resize(3*n*n, 3);
+    int v = 0;
+    for(int z = 0; z < 3; ++z) {
+        for(int y = 0; y < n; ++y) {
+            for(int x = 0; x < n; ++x) {
+                m_matVertPos.row(v++) << 0.0625f + x*m_fSpacing, -0.03125f + y*m_fSpacing, 0.5f + z*m_fSpacing;
+            }
+        }
+    }
+
+    m_vecVertNo.resize((m_matVertPos.rows() + 2) / 3);
+    for(int j = 0; j < m_vecVertNo.rows(); ++j) {
+        m_vecVertNo(j) = 3*j;
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestSmoothOperator::gridMatchesAllPairs()
+{
+    //The default threshold, the lattice distances 3h, sqrt(2)h and sqrt(5)h as ties, and a threshold below the
+    //spacing which coarsens the grid
+    QList<double> lThresholds;
+    lThresholds << 0.003
+                << 3.0*m_fSpacing
+                << QVector3D(m_fSpacing, m_fSpacing, 0.0f).length()
+                << QVector3D(2.0f*m_fSpacing, m_fSpacing, 0.0f).length()
+                << 0.25*m_fSpacing;
+
+    for(int t = 0; t < lThresholds.size(); ++t) {
+        SmoothOperatorInfo info;
+        info.vecVertNo = m_vecVertNo;
+        info.matVertPos = m_matVertPos;
+        info.iDistPow = 3;
+        info.dThresholdDistance = lThresholds.at(t);
+
+        SparseMatrix<double> matRef = allPairsSmoothOperator(info);
+
+        generateSmoothOperator(info);
+        SparseMatrix<double> matGrid = info.sparseSmoothMatrix;
+
+        QCOMPARE(matGrid.rows(), matRef.rows());
+        QCOMPARE(matGrid.cols(), matRef.cols());
+        QCOMPARE(matGrid.nonZeros(), matRef.nonZeros());
+
+        //Same sparsity pattern, weights equal up to the order of the summation
+        for(int k = 0; k < matRef.outerSize(); ++k) {
+            SparseMatrix<double>::InnerIterator itRef(matRef, k);
+            SparseMatrix<double>::InnerIterator itGrid(matGrid, k);
+            for(; itRef && itGrid; ++itRef, ++itGrid) {
+                QCOMPARE(itGrid.row(), itRef.row());
+                QVERIFY(std::fabs(itGrid.value() - itRef.value()) < 1e-12);
+            }
+            QVERIFY(!itRef && !itGrid);
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestSmoothOperator::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+SparseMatrix<double> TestSmoothOperator::allPairsSmoothOperator(const SmoothOperatorInfo& p_info)
+{
+    QList<QVector3D> lSourcePos;
+    for(int j = 0; j < p_info.vecVertNo.rows(); ++j) {
+        lSourcePos.append(QVector3D(p_info.matVertPos(p_info.vecVertNo(j),0),
+                                    p_info.matVertPos(p_info.vecVertNo(j),1),
+                                    p_info.matVertPos(p_info.vecVertNo(j),2)));
+    }
+
+    QList<Triplet<double> > lTriplets;
+    for(int i = 0; i < p_info.matVertPos.rows(); ++i) {
+        QVector3D from(p_info.matVertPos(i,0), p_info.matVertPos(i,1), p_info.matVertPos(i,2));
+        QList<Triplet<double> > lRow;
+        double dist, valueWeight;
+        double dWeightsSum = 0;
+
+        for(int j = 0; j < lSourcePos.size(); ++j) {
+            QVector3D to = lSourcePos.at(j);
+
+            if(to == from) {
+                dist = exp(-25);
+            } else {
+                dist = from.distanceToPoint(to);
+            }
+
+            if(dist <= p_info.dThresholdDistance) {
+                valueWeight = fabs(1.0/pow(dist,p_info.iDistPow));
+                lRow.append(Triplet<double>(i, j, valueWeight));
+                dWeightsSum += valueWeight;
+            }
+        }
+
+        for(int j = 0; j < lRow.size(); ++j) {
+            lTriplets.append(Triplet<double>(lRow.at(j).row(), lRow.at(j).col(), lRow.at(j).value()/dWeightsSum));
+        }
+    }
+
+    SparseMatrix<double> matSmooth(p_info.matVertPos.rows(), p_info.vecVertNo.rows());
+    matSmooth.setFromTriplets(lTriplets.begin(), lTriplets.end());
+
+    return matSmooth;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestSmoothOperator)
+#include "test_smooth_operator.moc"
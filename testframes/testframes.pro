@@ -42,8 +42,18 @@ SUBDIRS += \
     test_dipole_fit \
     test_fiff_rwr \
     test_fiff_mne_types_io \
-    test_forward_solution
+    test_forward_solution \
+    test_kmeans \
+    test_forward_cluster_cache \
+    test_mne_sourceestimate_file \
+    test_fiff_data_buffer_codec \
+    test_rap_music \
+    test_minimum_norm \
+    test_connectivity_measures
 
 !contains(MNECPP_CONFIG, minimalVersion) {
-#    SUBDIRS += \
+    qtHaveModule(charts) {
+        SUBDIRS += \
+            test_smooth_operator
+    }
 }